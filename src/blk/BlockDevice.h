@@ -293,6 +293,7 @@ public:
   virtual void close() = 0;
 
   struct hugepaged_raw_marker_t {};
+  struct preallocated_raw_marker_t {};
 
 protected:
   bool is_valid_io(uint64_t off, uint64_t len) const;
@@ -103,6 +103,12 @@ struct io_queue_t {
   virtual int submit_batch(aio_iter begin, aio_iter end, uint16_t aios_size,
 			   void *priv, int *retries) = 0;
   virtual int get_next_completed(int timeout_ms, aio_t **paio, int max) = 0;
+
+  // pin long-lived memory regions with the kernel up front; only
+  // meaningful for backends that can issue IOs against registered buffers
+  virtual int register_buffers(const std::vector<iovec> &iovs) {
+    return -EOPNOTSUPP;
+  }
 };
 
 struct aio_queue_t final : public io_queue_t {
@@ -520,6 +520,9 @@ int KernelDevice::_aio_start()
       }
       return r;
     }
+    if (cct->_conf.get_val<bool>("bdev_ioring_fixed_buffers")) {
+      _aio_register_buffers();
+    }
     aio_thread.create("bstore_aio");
   }
   return 0;
@@ -1166,6 +1169,7 @@ struct ExplicitHugePagePool {
                    " /proc/sys/vm/nr_hugepages misconfigured?");
       } else {
         region_q.push(mmaped_region);
+        regions.push_back(iovec{mmaped_region, buffer_size});
       }
     }
   }
@@ -1191,13 +1195,108 @@ struct ExplicitHugePagePool {
     return buffer_size;
   }
 
+  void get_regions(std::vector<iovec>* iovs) const {
+    iovs->insert(std::end(*iovs), std::begin(regions), std::end(regions));
+  }
+
+private:
+  const size_t buffer_size;
+  region_queue_t region_q;
+  std::vector<iovec> regions;
+};
+
+// a pool of small, equally-sized buffers carved out of a single
+// anonymous mapping. unlike ExplicitHugePagePool it is meant for the
+// hot, small (e.g. 4 KB) random reads; the single mapping keeps the
+// number of regions that need registering with io_uring tiny.
+struct PreallocatedBufferPool {
+  using region_queue_t = boost::lockfree::queue<void*>;
+  using instrumented_raw = ceph::buffer_instrumentation::instrumented_raw<
+    BlockDevice::preallocated_raw_marker_t>;
+
+  // the kernel refuses to register a single buffer larger than 1 GB
+  static constexpr size_t MAX_REGISTERED_REGION = 1ull << 30;
+
+  struct pooled_buffer_raw : public instrumented_raw {
+    region_queue_t& region_q; // for recycling
+
+    pooled_buffer_raw(void* region, PreallocatedBufferPool& parent)
+      : instrumented_raw(static_cast<char*>(region), parent.buffer_size),
+	region_q(parent.region_q) {
+    }
+    ~pooled_buffer_raw() override {
+      region_q.push(data);
+    }
+  };
+
+  PreallocatedBufferPool(const size_t buffer_size, size_t buffers_in_pool)
+    : buffer_size(buffer_size),
+      mapping_size(buffer_size * buffers_in_pool),
+      region_q(buffers_in_pool) {
+    if (buffer_size % CEPH_PAGE_SIZE) {
+      ceph_abort("preallocated buffer size must be page aligned");
+    }
+    if (mapping_size == 0) {
+      return;
+    }
+    mapping = ::mmap(
+      nullptr,
+      mapping_size,
+      PROT_READ | PROT_WRITE,
+#if defined(__FreeBSD__)
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_PREFAULT_READ,
+#else
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE,
+#endif // __FreeBSD__
+      -1,
+      0);
+    if (mapping == MAP_FAILED) {
+      ceph_abort("can't allocate preallocated read buffers");
+    }
+    for (size_t i = 0; i < buffers_in_pool; ++i) {
+      region_q.push(static_cast<char*>(mapping) + i * buffer_size);
+    }
+  }
+  ~PreallocatedBufferPool() {
+    if (mapping_size) {
+      ::munmap(mapping, mapping_size);
+    }
+  }
+
+  ceph::unique_leakable_ptr<buffer::raw> try_create() {
+    if (void* region; region_q.pop(region)) {
+      return ceph::unique_leakable_ptr<buffer::raw> {
+	new pooled_buffer_raw(region, *this)
+      };
+    } else {
+      return nullptr;
+    }
+  }
+
+  size_t get_buffer_size() const {
+    return buffer_size;
+  }
+
+  void get_regions(std::vector<iovec>* iovs) const {
+    // split on buffer boundaries so no buffer straddles two regions
+    const size_t step =
+      std::max(MAX_REGISTERED_REGION / buffer_size, size_t(1)) * buffer_size;
+    for (size_t off = 0; off < mapping_size; off += step) {
+      iovs->push_back(iovec{static_cast<char*>(mapping) + off,
+			    std::min(step, mapping_size - off)});
+    }
+  }
+
 private:
   const size_t buffer_size;
+  const size_t mapping_size;
+  void* mapping = nullptr;
   region_queue_t region_q;
 };
 
-struct HugePagePoolOfPools {
-  HugePagePoolOfPools(const std::map<size_t, size_t> conf)
+template <class PoolT>
+struct BufferPoolOfPools {
+  BufferPoolOfPools(const std::map<size_t, size_t> conf)
     : pools(conf.size(), [conf] (size_t index, auto emplacer) {
         ceph_assert(index < conf.size());
         // it could be replaced with a state-mutating lambda and
@@ -1223,31 +1322,77 @@ struct HugePagePoolOfPools {
     return nullptr;
   }
 
-  static HugePagePoolOfPools from_desc(const std::string& conf);
+  void get_regions(std::vector<iovec>* iovs) const {
+    for (const auto& pool : pools) {
+      pool.get_regions(iovs);
+    }
+  }
+
+  static BufferPoolOfPools from_desc(const std::string& desc) {
+    std::map<size_t, size_t> conf; // buffer_size -> buffers_in_pool
+    std::map<std::string, std::string> exploded_str_conf;
+    get_str_map(desc, &exploded_str_conf);
+    for (const auto& [buffer_size_s, buffers_in_pool_s] : exploded_str_conf) {
+      size_t buffer_size, buffers_in_pool;
+      if (sscanf(buffer_size_s.c_str(), "%zu", &buffer_size) != 1) {
+	ceph_abort("can't parse a key in the configuration");
+      }
+      if (sscanf(buffers_in_pool_s.c_str(), "%zu", &buffers_in_pool) != 1) {
+	ceph_abort("can't parse a value in the configuration");
+      }
+      conf[buffer_size] = buffers_in_pool;
+    }
+    return BufferPoolOfPools{std::move(conf)};
+  }
 
 private:
   // let's have some space inside (for 2 MB and 4 MB perhaps?)
   // NOTE: we need tiny_vector as the boost::lockfree queue inside
   // pool is not-movable.
-  ceph::containers::tiny_vector<ExplicitHugePagePool, 2> pools;
+  ceph::containers::tiny_vector<PoolT, 2> pools;
 };
 
+using HugePagePoolOfPools = BufferPoolOfPools<ExplicitHugePagePool>;
+using PreallocatedPoolOfPools = BufferPoolOfPools<PreallocatedBufferPool>;
 
-HugePagePoolOfPools HugePagePoolOfPools::from_desc(const std::string& desc) {
-  std::map<size_t, size_t> conf; // buffer_size -> buffers_in_pool
-  std::map<std::string, std::string> exploded_str_conf;
-  get_str_map(desc, &exploded_str_conf);
-  for (const auto& [buffer_size_s, buffers_in_pool_s] : exploded_str_conf) {
-    size_t buffer_size, buffers_in_pool;
-    if (sscanf(buffer_size_s.c_str(), "%zu", &buffer_size) != 1) {
-      ceph_abort("can't parse a key in the configuration");
-    }
-    if (sscanf(buffers_in_pool_s.c_str(), "%zu", &buffers_in_pool) != 1) {
-      ceph_abort("can't parse a value in the configuration");
-    }
-    conf[buffer_size] = buffers_in_pool;
+// the pools are process-wide and outlive any single device as buffers
+// handed out may still be referenced after close().
+static HugePagePoolOfPools& get_huge_page_pools(CephContext* cct)
+{
+  static HugePagePoolOfPools hp_pools = HugePagePoolOfPools::from_desc(
+    cct->_conf.get_val<std::string>("bdev_read_preallocated_huge_buffers")
+  );
+  return hp_pools;
+}
+
+static PreallocatedPoolOfPools& get_preallocated_pools(CephContext* cct)
+{
+  static PreallocatedPoolOfPools pa_pools = PreallocatedPoolOfPools::from_desc(
+    cct->_conf.get_val<std::string>("bdev_read_preallocated_buffers")
+  );
+  return pa_pools;
+}
+
+// register the read buffer pools with the io queue so that reads landing
+// in them can skip the per-IO page pinning (READ_FIXED with io_uring).
+void KernelDevice::_aio_register_buffers()
+{
+  std::vector<iovec> iovs;
+  get_huge_page_pools(cct).get_regions(&iovs);
+  get_preallocated_pools(cct).get_regions(&iovs);
+  if (iovs.empty()) {
+    dout(1) << __func__ << " no preallocated read buffers to register" << dendl;
+    return;
+  }
+  int r = io_queue->register_buffers(iovs);
+  if (r < 0) {
+    derr << __func__ << " failed to register " << iovs.size()
+	 << " read buffer regions: " << cpp_strerror(r)
+	 << "; check RLIMIT_MEMLOCK" << dendl;
+  } else {
+    dout(1) << __func__ << " registered " << iovs.size()
+	    << " read buffer regions" << dendl;
   }
-  return HugePagePoolOfPools{std::move(conf)};
 }
 
 // create a buffer basing on user-configurable. it's intended to make
@@ -1260,10 +1405,7 @@ ceph::unique_leakable_ptr<buffer::raw> KernelDevice::create_custom_aligned(
   if (len < CEPH_PAGE_SIZE) {
     return ceph::buffer::create_small_page_aligned(len);
   } else {
-    static HugePagePoolOfPools hp_pools = HugePagePoolOfPools::from_desc(
-      cct->_conf.get_val<std::string>("bdev_read_preallocated_huge_buffers")
-    );
-    if (auto lucky_raw = hp_pools.try_create(len); lucky_raw) {
+    if (auto lucky_raw = get_huge_page_pools(cct).try_create(len); lucky_raw) {
       dout(20) << __func__ << " allocated from huge pool"
 	       << " lucky_raw.data=" << (void*)lucky_raw->get_data()
 	       << " bdev_read_preallocated_huge_buffers="
@@ -1271,6 +1413,14 @@ ceph::unique_leakable_ptr<buffer::raw> KernelDevice::create_custom_aligned(
 	       << dendl;
       ioc->flags |= IOContext::FLAG_DONT_CACHE;
       return lucky_raw;
+    } else if (auto pooled_raw = get_preallocated_pools(cct).try_create(len);
+	       pooled_raw) {
+      dout(20) << __func__ << " allocated from preallocated pool"
+	       << " pooled_raw.data=" << (void*)pooled_raw->get_data()
+	       << dendl;
+      // don't let the cache pin the (bounded) pool
+      ioc->flags |= IOContext::FLAG_DONT_CACHE;
+      return pooled_raw;
     } else {
       // fallthrough due to empty buffer pool. this can happen also
       // when the configurable was explicitly set to 0.
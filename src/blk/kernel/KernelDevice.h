@@ -92,6 +92,7 @@ private:
 
   int _aio_start();
   void _aio_stop();
+  void _aio_register_buffers();
 
   void _discard_start();
   void _discard_stop();
@@ -17,6 +17,8 @@ struct ioring_data {
   pthread_mutex_t sq_mutex;
   int epoll_fd = -1;
   std::map<int, int> fixed_fds_map;
+  // registered buffer start -> (length, buffer index)
+  std::map<uintptr_t, std::pair<size_t, int>> fixed_bufs_map;
 };
 
 static int ioring_get_cqe(struct ioring_data *d, unsigned int max,
@@ -50,6 +52,22 @@ static int find_fixed_fd(struct ioring_data *d, int real_fd)
   return it->second;
 }
 
+static int find_fixed_buf(struct ioring_data *d, const iovec &iov)
+{
+  if (d->fixed_bufs_map.empty())
+    return -1;
+
+  uintptr_t base = (uintptr_t)iov.iov_base;
+  auto it = d->fixed_bufs_map.upper_bound(base);
+  if (it == d->fixed_bufs_map.begin())
+    return -1;
+  --it;
+  if (base + iov.iov_len > it->first + it->second.first)
+    return -1;
+
+  return it->second.second;
+}
+
 static void init_sqe(struct ioring_data *d, struct io_uring_sqe *sqe,
 		     struct aio_t *io)
 {
@@ -57,13 +75,23 @@ static void init_sqe(struct ioring_data *d, struct io_uring_sqe *sqe,
 
   ceph_assert(fixed_fd != -1);
 
-  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV)
+  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV) {
     io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
 			 io->iov.size(), io->offset);
-  else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV)
-    io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
-			io->iov.size(), io->offset);
-  else
+  } else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV) {
+    /* A single segment wholly inside a registered read buffer can skip
+     * the per-IO page pinning via READ_FIXED.  Write payloads come from
+     * the messenger and bluestore, never from these pools. */
+    int buf_index = -1;
+    if (io->iov.size() == 1)
+      buf_index = find_fixed_buf(d, io->iov[0]);
+    if (buf_index >= 0)
+      io_uring_prep_read_fixed(sqe, fixed_fd, io->iov[0].iov_base,
+			       io->iov[0].iov_len, io->offset, buf_index);
+    else
+      io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
+			  io->iov.size(), io->offset);
+  } else
     ceph_assert(0);
 
   io_uring_sqe_set_data(sqe, io);
@@ -170,6 +198,7 @@ close_ring_fd:
 void ioring_queue_t::shutdown()
 {
   d->fixed_fds_map.clear();
+  d->fixed_bufs_map.clear();
   close(d->epoll_fd);
   d->epoll_fd = -1;
   io_uring_queue_exit(&d->io_uring);
@@ -209,6 +238,28 @@ get_cqe:
   return events;
 }
 
+int ioring_queue_t::register_buffers(const std::vector<iovec> &iovs)
+{
+  if (iovs.empty())
+    return 0;
+
+  /* io_uring allows a single buffer table per ring; replacing it would
+   * require quiescing in-flight IO, so only register once after init */
+  ceph_assert(d->fixed_bufs_map.empty());
+
+  int ret = io_uring_register_buffers(&d->io_uring, iovs.data(), iovs.size());
+  if (ret < 0)
+    return ret;
+
+  int index = 0;
+  for (auto &iov : iovs) {
+    d->fixed_bufs_map[(uintptr_t)iov.iov_base] =
+      std::make_pair(iov.iov_len, index++);
+  }
+
+  return 0;
+}
+
 bool ioring_queue_t::supported()
 {
   struct io_uring ring;
@@ -256,6 +307,11 @@ int ioring_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
   ceph_assert(0);
 }
 
+int ioring_queue_t::register_buffers(const std::vector<iovec> &iovs)
+{
+  ceph_assert(0);
+}
+
 bool ioring_queue_t::supported()
 {
   return false;
@@ -120,6 +120,38 @@ __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c)
 	}
 }
 
+/*
+ * out[i] = crush_hash32_3(type, a, b[i], c) for i < n.  The hashes are
+ * independent of each other, and a block of a constant number of them
+ * is something the compiler turns into vector instructions.
+ */
+#define CRUSH_HASH_VEC_BLOCK 8
+
+void crush_hash32_3_vec(int type, __u32 a, const __s32 *b, __u32 c,
+			__u32 *out, unsigned int n)
+{
+	unsigned int i = 0, j;
+
+	if (type != CRUSH_HASH_RJENKINS1) {
+		for (; i < n; i++)
+			out[i] = 0;
+		return;
+	}
+	for (; i + CRUSH_HASH_VEC_BLOCK <= n; i += CRUSH_HASH_VEC_BLOCK) {
+		/* local copies, so that out cannot alias b */
+		__u32 bv[CRUSH_HASH_VEC_BLOCK], hv[CRUSH_HASH_VEC_BLOCK];
+
+		for (j = 0; j < CRUSH_HASH_VEC_BLOCK; j++)
+			bv[j] = b[i + j];
+		for (j = 0; j < CRUSH_HASH_VEC_BLOCK; j++)
+			hv[j] = crush_hash32_rjenkins1_3(a, bv[j], c);
+		for (j = 0; j < CRUSH_HASH_VEC_BLOCK; j++)
+			out[i + j] = hv[j];
+	}
+	for (; i < n; i++)
+		out[i] = crush_hash32_rjenkins1_3(a, b[i], c);
+}
+
 __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d)
 {
 	switch (type) {
@@ -94,6 +94,21 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/** @ingroup API
+ *
+ * Map each of the __n__ values in __x__ with crush_do_rule(), sharing
+ * the workspace __cwin__ between them.  The items of __x[i]__ are stored
+ * from __result + i * result_max__ and their number in __result_len[i]__.
+ *
+ * @return __n__
+ */
+extern int crush_do_rule_batch(const struct crush_map *map,
+			       int ruleno, const int *x, int n,
+			       int *result, int *result_len, int result_max,
+			       const __u32 *weights, int weight_max,
+			       void *cwin,
+			       const struct crush_choose_arg *choose_args);
+
 /* Returns enough workspace for any crush rule within map to generate
    result_max outputs. The caller can then allocate this much on its own,
    either on the stack, in a per-thread long-lived buffer, or however it likes.*/
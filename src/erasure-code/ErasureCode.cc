@@ -242,6 +242,15 @@ int ErasureCode::_decode(const set<int> &want_to_read,
     }
     return 0;
   }
+  int r = decode_prepare(chunks, decoded);
+  if (r)
+    return r;
+  return decode_chunks(want_to_read, chunks, decoded);
+}
+
+int ErasureCode::decode_prepare(const map<int, bufferlist> &chunks,
+                                map<int, bufferlist> *decoded) const
+{
   unsigned int k = get_data_chunk_count();
   unsigned int m = get_chunk_count() - k;
   unsigned blocksize = (*chunks.begin()).second.length();
@@ -257,7 +266,7 @@ int ErasureCode::_decode(const set<int> &want_to_read,
       (*decoded)[i].rebuild_aligned(SIMD_ALIGN);
     }
   }
-  return decode_chunks(want_to_read, chunks, decoded);
+  return 0;
 }
 
 int ErasureCode::decode(const set<int> &want_to_read,
@@ -267,6 +276,20 @@ int ErasureCode::decode(const set<int> &want_to_read,
   return _decode(want_to_read, chunks, decoded);
 }
 
+int ErasureCode::decode_batch(const set<int> &want_to_read,
+                              const vector<map<int, bufferlist>> &chunks,
+                              vector<map<int, bufferlist>> *decoded,
+                              int chunk_size)
+{
+  decoded->resize(chunks.size());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    int r = decode(want_to_read, chunks[i], &(*decoded)[i], chunk_size);
+    if (r)
+      return r;
+  }
+  return 0;
+}
+
 int ErasureCode::parse(const ErasureCodeProfile &profile,
 		       ostream *ss)
 {
@@ -365,4 +388,39 @@ int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
   }
   return r;
 }
+
+bool ErasureCode::supports_parity_delta() const
+{
+  return false;
+}
+
+int ErasureCode::encode_delta(const bufferlist &old_data,
+			      const bufferlist &new_data,
+			      bufferlist *delta)
+{
+  if (old_data.length() != new_data.length())
+    return -EINVAL;
+  unsigned length = old_data.length();
+  // c_str() may rebuild, so work on copies to leave the inputs alone
+  bufferlist o = old_data;
+  bufferlist n = new_data;
+  const char *op = o.c_str();
+  const char *np = n.c_str();
+  bufferptr out(buffer::create_aligned(length, SIMD_ALIGN));
+  char *dp = out.c_str();
+  // the codes with parity delta support are linear over GF(2^w),
+  // where addition is xor
+  for (unsigned i = 0; i < length; ++i) {
+    dp[i] = op[i] ^ np[i];
+  }
+  delta->clear();
+  delta->push_back(std::move(out));
+  return 0;
+}
+
+int ErasureCode::apply_delta(const map<int, bufferlist> &deltas,
+			     map<int, bufferlist> *coding)
+{
+  return -ENOTSUP;
+}
 }
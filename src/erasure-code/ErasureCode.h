@@ -77,6 +77,9 @@ namespace ceph {
     int encode_prepare(const bufferlist &raw,
                        std::map<int, bufferlist> &encoded) const;
 
+    int decode_prepare(const std::map<int, bufferlist> &chunks,
+                       std::map<int, bufferlist> *decoded) const;
+
     int encode(const std::set<int> &want_to_encode,
                        const bufferlist &in,
                        std::map<int, bufferlist> *encoded) override;
@@ -89,6 +92,11 @@ namespace ceph {
 			const std::map<int, bufferlist> &chunks,
 			std::map<int, bufferlist> *decoded);
 
+    int decode_batch(const std::set<int> &want_to_read,
+                     const std::vector<std::map<int, bufferlist>> &chunks,
+                     std::vector<std::map<int, bufferlist>> *decoded,
+                     int chunk_size) override;
+
     const std::vector<int> &get_chunk_mapping() const override;
 
     int to_mapping(const ErasureCodeProfile &profile,
@@ -115,6 +123,15 @@ namespace ceph {
     int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) override;
 
+    bool supports_parity_delta() const override;
+
+    int encode_delta(const bufferlist &old_data,
+		     const bufferlist &new_data,
+		     bufferlist *delta) override;
+
+    int apply_delta(const std::map<int, bufferlist> &deltas,
+		    std::map<int, bufferlist> *coding) override;
+
   protected:
     int parse(const ErasureCodeProfile &profile,
 	      std::ostream *ss);
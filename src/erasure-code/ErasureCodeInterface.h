@@ -412,6 +412,30 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) = 0;
 
+    /**
+     * Decode several independent sets of **chunks** at once, for
+     * instance the stripes of many objects being recovered. It is
+     * equivalent to calling **decode** on each element of **chunks**
+     * and storing the result in the same element of **decoded**,
+     * which is resized to match.
+     *
+     * When every element has the same chunk indexes available and
+     * the same chunk size, a plugin may set up the decoding matrix
+     * once for the whole batch instead of once per element.
+     *
+     * Returns 0 on success.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks vector of maps of chunk indexes to chunk data
+     * @param [out] decoded vector of maps of chunk indexes to chunk data
+     * @param [in] chunk_size chunk size
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_batch(const std::set<int> &want_to_read,
+                             const std::vector<std::map<int, bufferlist>> &chunks,
+                             std::vector<std::map<int, bufferlist>> *decoded,
+                             int chunk_size) = 0;
+
     /**
      * Return the ordered list of chunks or an empty vector
      * if no remapping is necessary.
@@ -459,6 +483,51 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Return true if the coding chunks can be updated in place with
+     * **apply_delta** instead of being encoded again from all the
+     * data chunks. This is the case for linear codes where each
+     * coding chunk is a sum of the data chunks multiplied by a
+     * constant, such as the Reed Solomon matrix techniques.
+     *
+     * @return **true** if **apply_delta** is implemented
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute the difference between the **old_data** and
+     * **new_data** content of a region of a data chunk and store it
+     * in **delta**. Both buffers must have the same size.
+     *
+     * @param [in] old_data content of the region before the update
+     * @param [in] new_data content of the region after the update
+     * @param [out] delta difference suitable for **apply_delta**
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_delta(const bufferlist &old_data,
+			     const bufferlist &new_data,
+			     bufferlist *delta) = 0;
+
+    /**
+     * Update the same region of every coding chunk with the
+     * **deltas** computed by **encode_delta** for some of the data
+     * chunks. The **coding** map must contain the current content of
+     * the region for every coding chunk and is modified in place.
+     * The data chunks missing from **deltas** are unchanged.
+     *
+     * All buffers in **deltas** and **coding** must have the same
+     * size. Chunk indexes are the ones used by **encode_chunks**,
+     * i.e. before the **get_chunk_mapping** remapping.
+     *
+     * @param [in] deltas map data chunk indexes to region deltas
+     * @param [in,out] coding map coding chunk indexes to region content
+     * @return **0** on success, **-ENOTSUP** if
+     *         **supports_parity_delta** is false or a negative
+     *         errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferlist> &deltas,
+			    std::map<int, bufferlist> *coding) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
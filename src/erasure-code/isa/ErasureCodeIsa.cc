@@ -19,6 +19,7 @@
 #include "common/debug.h"
 #include "ErasureCodeIsa.h"
 #include "xor_op.h"
+#include "ec_kernel.h"
 #include "include/ceph_assert.h"
 using namespace std;
 using namespace ceph;
@@ -45,6 +46,7 @@ _prefix(std::ostream* _dout)
 
 const std::string ErasureCodeIsaDefault::DEFAULT_K("7");
 const std::string ErasureCodeIsaDefault::DEFAULT_M("3");
+const std::string ErasureCodeIsaDefault::DEFAULT_KERNEL("auto");
 
 
 // -----------------------------------------------------------------------------
@@ -111,7 +113,94 @@ int ErasureCodeIsa::decode_chunks(const set<int> &want_to_read,
   }
   erasures[erasures_count] = -1;
   ceph_assert(erasures_count > 0);
-  return isa_decode(erasures, data, coding, blocksize);
+  return isa_decode(erasures, data, coding, blocksize, 1);
+}
+
+// -----------------------------------------------------------------------------
+
+int ErasureCodeIsa::decode_batch(const set<int> &want_to_read,
+                                 const vector<map<int, bufferlist>> &chunks,
+                                 vector<map<int, bufferlist>> *decoded,
+                                 int chunk_size)
+{
+  if (chunks.size() < 2 || chunks.front().empty())
+    return ErasureCode::decode_batch(want_to_read, chunks, decoded, chunk_size);
+
+  // the decoding tables only depend on which chunks are missing: look
+  // them up once if all elements lost the same chunks
+  const map<int, bufferlist> &first = chunks.front();
+  unsigned blocksize = first.begin()->second.length();
+  for (auto &c : chunks) {
+    if (c.size() != first.size() ||
+        !std::equal(c.begin(), c.end(), first.begin(),
+                    [blocksize](auto &a, auto &b) {
+                      return a.first == b.first &&
+                        a.second.length() == blocksize;
+                    }))
+      return ErasureCode::decode_batch(want_to_read, chunks, decoded,
+                                       chunk_size);
+  }
+
+  int erasures[k + m + 1];
+  int erasures_count = 0;
+  for (int i = 0; i < k + m; i++) {
+    if (first.find(i) == first.end()) {
+      erasures[erasures_count] = i;
+      erasures_count++;
+    }
+  }
+  erasures[erasures_count] = -1;
+  bool have_all = true;
+  for (int i : want_to_read) {
+    if (first.find(i) == first.end())
+      have_all = false;
+  }
+  if (have_all || erasures_count > m)
+    return ErasureCode::decode_batch(want_to_read, chunks, decoded, chunk_size);
+
+  int count = chunks.size();
+  decoded->resize(count);
+  vector<char*> data(count * k);
+  vector<char*> coding(count * m);
+  for (int n = 0; n < count; n++) {
+    map<int, bufferlist> &d = (*decoded)[n];
+    int r = decode_prepare(chunks[n], &d);
+    if (r)
+      return r;
+    for (int i = 0; i < k + m; i++) {
+      if (i < k)
+        data[n * k + i] = d[i].c_str();
+      else
+        coding[n * m + i - k] = d[i].c_str();
+    }
+  }
+  return isa_decode(erasures, data.data(), coding.data(), blocksize, count);
+}
+
+int ErasureCodeIsa::apply_delta(const map<int, bufferlist> &deltas,
+                                map<int, bufferlist> *coding)
+{
+  if (deltas.empty())
+    return 0;
+  unsigned blocksize = deltas.begin()->second.length();
+  for (auto &[i, delta] : deltas) {
+    if (i < 0 || i >= k || delta.length() != blocksize)
+      return -EINVAL;
+  }
+  char *parity[m];
+  for (int i = 0; i < m; i++) {
+    auto c = coding->find(k + i);
+    if (c == coding->end() || c->second.length() != blocksize)
+      return -EINVAL;
+    c->second.rebuild_aligned(SIMD_ALIGN);
+    parity[i] = c->second.c_str();
+  }
+  for (auto &[i, d] : deltas) {
+    bufferlist delta = d;
+    delta.rebuild_aligned(SIMD_ALIGN);
+    isa_apply_delta(i, delta.c_str(), parity, blocksize);
+  }
+  return 0;
 }
 
 // -----------------------------------------------------------------------------
@@ -124,10 +213,34 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
   if (m == 1)
     // single parity stripe
-    region_xor((unsigned char**) data, (unsigned char*) coding[0], k, blocksize);
+    ec_isa_region_xor(kernel, (unsigned char**) data, (unsigned char*) coding[0],
+                      k, blocksize);
   else
-    ec_encode_data(blocksize, k, m, encode_tbls,
-                   (unsigned char**) data, (unsigned char**) coding);
+    ec_isa_dot_prod(kernel, blocksize, k, m, encode_tbls,
+                    (unsigned char**) data, (unsigned char**) coding);
+}
+
+// -----------------------------------------------------------------------------
+
+void
+ErasureCodeIsaDefault::isa_apply_delta(int data_index,
+                                       char *delta,
+                                       char **coding,
+                                       int blocksize)
+{
+  if (m == 1) {
+    // single parity stripe: coding ^= delta
+    unsigned vector_size = blocksize - blocksize % EC_ISA_VECTOR_OP_WORDSIZE;
+    vector_xor((vector_op_t*) delta, (vector_op_t*) coding[0],
+               (vector_op_t*) (delta + vector_size));
+    byte_xor((unsigned char*) delta + vector_size,
+             (unsigned char*) coding[0] + vector_size,
+             (unsigned char*) delta + blocksize);
+  } else {
+    // coding[j] ^= encode_coeff[k * (k + j) + data_index] * delta
+    ec_encode_data_update(blocksize, k, m, data_index, encode_tbls,
+                          (unsigned char*) delta, (unsigned char**) coding);
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -146,13 +259,31 @@ ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 
 
 
+// -----------------------------------------------------------------------------
+
+void
+ErasureCodeIsaDefault::stripe_buffers(int n,
+                                      char **data,
+                                      char **coding,
+                                      int *index,
+                                      int count,
+                                      unsigned char **buffers)
+{
+  for (int l = 0; l < count; l++) {
+    int c = index[l];
+    buffers[l] = (unsigned char*)
+      (c < k ? data[n * k + c] : coding[n * m + c - k]);
+  }
+}
+
 // -----------------------------------------------------------------------------
 
 int
 ErasureCodeIsaDefault::isa_decode(int *erasures,
                                   char **data,
                                   char **coding,
-                                  int blocksize)
+                                  int blocksize,
+                                  int count)
 {
   int nerrs = 0;
   int i, r, s;
@@ -162,6 +293,8 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
     nerrs++;
   }
 
+  int source_index[k];
+  int target_index[m];
   unsigned char *recover_source[k];
   unsigned char *recover_target[m];
 
@@ -169,36 +302,35 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
   memset(recover_target, 0, sizeof (recover_target));
 
   // ---------------------------------------------
-  // Assign source and target buffers
+  // Assign source and target chunks
   // ---------------------------------------------
   for (i = 0, s = 0, r = 0; ((r < k) || (s < nerrs)) && (i < (k + m)); i++) {
     if (!erasure_contains(erasures, i)) {
       if (r < k) {
-        if (i < k) {
-          recover_source[r] = (unsigned char*) data[i];
-        } else {
-          recover_source[r] = (unsigned char*) coding[i - k];
-        }
+        source_index[r] = i;
         r++;
       }
     } else {
       if (s < m) {
-        if (i < k) {
-          recover_target[s] = (unsigned char*) data[i];
-        } else {
-          recover_target[s] = (unsigned char*) coding[i - k];
-        }
+        target_index[s] = i;
         s++;
       }
     }
   }
 
+  int sources = r;
+  int targets = s;
+
   if (m == 1) {
     // single parity decoding
     ceph_assert(1 == nerrs);
     dout(20) << "isa_decode: reconstruct using region xor [" <<
       erasures[0] << "]" << dendl;
-    region_xor(recover_source, recover_target[0], k, blocksize);
+    for (int n = 0; n < count; n++) {
+      stripe_buffers(n, data, coding, source_index, sources, recover_source);
+      stripe_buffers(n, data, coding, target_index, targets, recover_target);
+      ec_isa_region_xor(kernel, recover_source, recover_target[0], k, blocksize);
+    }
     return 0;
   }
 
@@ -211,7 +343,11 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
       erasures[0] << "]" << dendl;
     ceph_assert(1 == s);
     ceph_assert(k == r);
-    region_xor(recover_source, recover_target[0], k, blocksize);
+    for (int n = 0; n < count; n++) {
+      stripe_buffers(n, data, coding, source_index, sources, recover_source);
+      stripe_buffers(n, data, coding, target_index, targets, recover_target);
+      ec_isa_region_xor(kernel, recover_source, recover_target[0], k, blocksize);
+    }
     return 0;
   }
 
@@ -303,8 +439,12 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
     tcache.putDecodingTableToCache(erasure_signature, p_tbls, matrixtype, k, m);
   }
   // Recover data sources
-  ec_encode_data(blocksize,
-                 k, nerrs, decode_tbls, recover_source, recover_target);
+  for (int n = 0; n < count; n++) {
+    stripe_buffers(n, data, coding, source_index, sources, recover_source);
+    stripe_buffers(n, data, coding, target_index, targets, recover_target);
+    ec_isa_dot_prod(kernel, blocksize,
+                    k, nerrs, decode_tbls, recover_source, recover_target);
+  }
 
 
   return 0;
@@ -328,6 +468,27 @@ int ErasureCodeIsaDefault::parse(ErasureCodeProfile &profile,
   err |= to_int("m", profile, &m, DEFAULT_M, ss);
   err |= sanity_check_k_m(k, m, ss);
 
+  std::string kernel_name;
+  err |= to_string("kernel", profile, &kernel_name, DEFAULT_KERNEL, ss);
+  if (kernel_name == "auto") {
+    kernel = ec_isa_kernel_best();
+  } else {
+    kernel = ec_isa_kernel_from_name(kernel_name);
+    if (kernel < 0) {
+      *ss << "kernel=" << kernel_name << " is not one of auto";
+      for (int i = 0; i < EC_ISA_KERNEL_MAX; i++)
+        *ss << ", " << ec_isa_kernel_name(i);
+      *ss << std::endl;
+      kernel = ec_isa_kernel_best();
+      err = -EINVAL;
+    } else if (!ec_isa_kernel_supported(kernel)) {
+      // the profile is shared by OSDs on different hardware
+      dout(0) << "kernel=" << kernel_name << " is not supported by this CPU,"
+              << " using " << ec_isa_kernel_name(ec_isa_kernel_best()) << dendl;
+      kernel = ec_isa_kernel_best();
+    }
+  }
+
   if (matrixtype == kVandermonde) {
     // these are verified safe values evaluated using the
     // benchmarktool and 10*(combinatoric for maximum loss) random
@@ -414,7 +575,8 @@ ErasureCodeIsaDefault::prepare()
 
   dout(10) << "[ cache memory ] = " << memory_lru_cache << " bytes" <<
     " [ matrix ] = " <<
-    ((matrixtype == kVandermonde) ? "Vandermonde" : "Cauchy") << dendl;
+    ((matrixtype == kVandermonde) ? "Vandermonde" : "Cauchy") <<
+    " [ kernel ] = " << ec_isa_kernel_name(kernel) << dendl;
 
   ceph_assert((matrixtype == kVandermonde) || (matrixtype == kCauchy));
 
@@ -40,6 +40,7 @@ public:
   int k;
   int m;
   int w;
+  int kernel; // ec_isa_kernel_t used to encode and decode
 
   ErasureCodeIsaTableCache &tcache;
   const char *technique;
@@ -49,6 +50,7 @@ public:
   k(0),
   m(0),
   w(0),
+  kernel(0),
   tcache(_tcache),
   technique(_technique)
   {
@@ -80,17 +82,39 @@ public:
                             const std::map<int, ceph::buffer::list> &chunks,
                             std::map<int, ceph::buffer::list> *decoded) override;
 
+  int decode_batch(const std::set<int> &want_to_read,
+                   const std::vector<std::map<int, ceph::buffer::list>> &chunks,
+                   std::vector<std::map<int, ceph::buffer::list>> *decoded,
+                   int chunk_size) override;
+
   int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override;
 
+  bool supports_parity_delta() const override
+  {
+    return true;
+  }
+
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+                  std::map<int, ceph::buffer::list> *coding) override;
+
   virtual void isa_encode(char **data,
                           char **coding,
                           int blocksize) = 0;
 
+  // xor the contribution of delta to data chunk data_index into all
+  // coding chunks
+  virtual void isa_apply_delta(int data_index,
+                               char *delta,
+                               char **coding,
+                               int blocksize) = 0;
 
+  // decode count stripes which lost the same chunks, data and coding
+  // holding k and m pointers per stripe
   virtual int isa_decode(int *erasures,
                          char **data,
                          char **coding,
-                         int blocksize) = 0;
+                         int blocksize,
+                         int count) = 0;
 
   virtual unsigned get_alignment() const = 0;
 
@@ -111,6 +135,7 @@ public:
 
   static const std::string DEFAULT_K;
   static const std::string DEFAULT_M;
+  static const std::string DEFAULT_KERNEL;
 
   unsigned char* encode_coeff; // encoding coefficient
   unsigned char* encode_tbls; // encoding table
@@ -134,12 +159,26 @@ public:
                           char **coding,
                           int blocksize) override;
 
+  void isa_apply_delta(int data_index,
+                       char *delta,
+                       char **coding,
+                       int blocksize) override;
+
   virtual bool erasure_contains(int *erasures, int i);
 
+  // point buffers to the count chunks listed in index for stripe n
+  void stripe_buffers(int n,
+                      char **data,
+                      char **coding,
+                      int *index,
+                      int count,
+                      unsigned char **buffers);
+
   int isa_decode(int *erasures,
                          char **data,
                          char **coding,
-                         int blocksize) override;
+                         int blocksize,
+                         int count) override;
 
   unsigned get_alignment() const override;
 
@@ -0,0 +1,415 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+// -----------------------------------------------------------------------------
+#include "ec_kernel.h"
+#include <algorithm>
+#include <stdint.h>
+#include "xor_op.h"
+#include "arch/intel.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+extern "C" {
+#include "isa-l/include/erasure_code.h"
+}
+// -----------------------------------------------------------------------------
+
+static const char* kernel_names[EC_ISA_KERNEL_MAX] = {
+  "isal",
+  "avx2",
+  "avx512",
+  "avx2_gfni",
+  "avx512_gfni",
+};
+
+// outputs accumulated per pass over the sources
+#define EC_ISA_KERNEL_MAX_ROWS 8
+
+const char*
+ec_isa_kernel_name(int kernel)
+{
+  if (kernel < 0 || kernel >= EC_ISA_KERNEL_MAX)
+    return "unknown";
+  return kernel_names[kernel];
+}
+
+int
+ec_isa_kernel_from_name(const std::string &name)
+{
+  for (int kernel = 0; kernel < EC_ISA_KERNEL_MAX; kernel++) {
+    if (name == kernel_names[kernel])
+      return kernel;
+  }
+  return -1;
+}
+
+bool
+ec_isa_kernel_supported(int kernel)
+{
+  switch (kernel) {
+  case EC_ISA_KERNEL_ISAL:
+    return true;
+#ifdef __x86_64__
+  case EC_ISA_KERNEL_AVX2:
+    return ceph_arch_intel_avx2;
+  case EC_ISA_KERNEL_AVX512:
+    return ceph_arch_intel_avx512;
+  case EC_ISA_KERNEL_AVX2_GFNI:
+    return ceph_arch_intel_avx2 && ceph_arch_intel_gfni;
+  case EC_ISA_KERNEL_AVX512_GFNI:
+    return ceph_arch_intel_avx512 && ceph_arch_intel_gfni;
+#endif
+  default:
+    return false;
+  }
+}
+
+int
+ec_isa_kernel_best()
+{
+  // GFNI multiplies by a constant in one instruction where the nibble
+  // table lookups take five; without it ISA-L's own assembly is at
+  // least as fast as the kernels here
+  if (ec_isa_kernel_supported(EC_ISA_KERNEL_AVX512_GFNI))
+    return EC_ISA_KERNEL_AVX512_GFNI;
+  if (ec_isa_kernel_supported(EC_ISA_KERNEL_AVX2_GFNI))
+    return EC_ISA_KERNEL_AVX2_GFNI;
+  return EC_ISA_KERNEL_ISAL;
+}
+
+// -----------------------------------------------------------------------------
+// gftbls hold 32 bytes per coefficient c: c * n and c * (n << 4) for
+// n < 16, i.e. the products with the low and the high nibble
+// -----------------------------------------------------------------------------
+
+static void
+dot_prod_tail(int pos,
+              int len,
+              int k,
+              int row,
+              int rows,
+              const unsigned char *gftbls,
+              unsigned char **src,
+              unsigned char **dest)
+{
+  for (int j = row; j < row + rows; j++) {
+    for (int p = pos; p < len; p++) {
+      unsigned char s = 0;
+      for (int i = 0; i < k; i++) {
+        const unsigned char *t = gftbls + (j * k + i) * 32;
+        unsigned char x = src[i][p];
+        s ^= t[x & 0x0f] ^ t[16 + (x >> 4)];
+      }
+      dest[j][p] = s;
+    }
+  }
+}
+
+static void
+region_xor_tail(unsigned pos,
+                unsigned char **src,
+                unsigned char *parity,
+                int src_size,
+                unsigned size)
+{
+  for (unsigned p = pos; p < size; p++) {
+    unsigned char x = src[0][p];
+    for (int i = 1; i < src_size; i++)
+      x ^= src[i][p];
+    parity[p] = x;
+  }
+}
+
+#ifdef __x86_64__
+
+// -----------------------------------------------------------------------------
+// multiplication by a constant is linear over GF(2), so it is an 8x8 bit
+// matrix that GF2P8AFFINEQB applies to every byte: bit i of the product
+// is the parity of row i, stored in byte 7 - i, and'ed with the input
+// -----------------------------------------------------------------------------
+static uint64_t
+gf_affine_matrix(const unsigned char *tbl)
+{
+  unsigned char col[8]; // c * (1 << b)
+  for (int b = 0; b < 4; b++) {
+    col[b] = tbl[1 << b];
+    col[b + 4] = tbl[16 + (1 << b)];
+  }
+  uint64_t matrix = 0;
+  for (int i = 0; i < 8; i++) {
+    uint64_t row = 0;
+    for (int b = 0; b < 8; b++)
+      row |= (uint64_t)((col[b] >> i) & 1) << b;
+    matrix |= row << (8 * (7 - i));
+  }
+  return matrix;
+}
+
+__attribute__((target("avx2")))
+static void
+dot_prod_avx2(int len,
+              int k,
+              int rows,
+              unsigned char *gftbls,
+              unsigned char **src,
+              unsigned char **dest)
+{
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  for (int row = 0; row < rows; row += EC_ISA_KERNEL_MAX_ROWS) {
+    int n = std::min(rows - row, EC_ISA_KERNEL_MAX_ROWS);
+    int pos = 0;
+    for (; pos + 32 <= len; pos += 32) {
+      __m256i acc[EC_ISA_KERNEL_MAX_ROWS];
+      for (int j = 0; j < n; j++)
+        acc[j] = _mm256_setzero_si256();
+      for (int i = 0; i < k; i++) {
+        __m256i x = _mm256_loadu_si256((const __m256i*) (src[i] + pos));
+        __m256i lo = _mm256_and_si256(x, mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi64(x, 4), mask);
+        for (int j = 0; j < n; j++) {
+          const unsigned char *t = gftbls + ((row + j) * k + i) * 32;
+          __m256i tlo = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i*) t));
+          __m256i thi = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i*) (t + 16)));
+          acc[j] = _mm256_xor_si256(
+            acc[j],
+            _mm256_xor_si256(_mm256_shuffle_epi8(tlo, lo),
+                             _mm256_shuffle_epi8(thi, hi)));
+        }
+      }
+      for (int j = 0; j < n; j++)
+        _mm256_storeu_si256((__m256i*) (dest[row + j] + pos), acc[j]);
+    }
+    dot_prod_tail(pos, len, k, row, n, gftbls, src, dest);
+  }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void
+dot_prod_avx512(int len,
+                int k,
+                int rows,
+                unsigned char *gftbls,
+                unsigned char **src,
+                unsigned char **dest)
+{
+  const __m512i mask = _mm512_set1_epi8(0x0f);
+  for (int row = 0; row < rows; row += EC_ISA_KERNEL_MAX_ROWS) {
+    int n = std::min(rows - row, EC_ISA_KERNEL_MAX_ROWS);
+    int pos = 0;
+    for (; pos + 64 <= len; pos += 64) {
+      __m512i acc[EC_ISA_KERNEL_MAX_ROWS];
+      for (int j = 0; j < n; j++)
+        acc[j] = _mm512_setzero_si512();
+      for (int i = 0; i < k; i++) {
+        __m512i x = _mm512_loadu_si512((const void*) (src[i] + pos));
+        __m512i lo = _mm512_and_si512(x, mask);
+        // the unmasked forms of these pass _mm512_undefined_epi32() as
+        // their source, which GCC 12 flags with -Wmaybe-uninitialized
+        __m512i hi = _mm512_and_si512(
+          _mm512_maskz_srli_epi64((__mmask8) -1, x, 4), mask);
+        for (int j = 0; j < n; j++) {
+          const unsigned char *t = gftbls + ((row + j) * k + i) * 32;
+          __m512i tlo = _mm512_maskz_broadcast_i32x4(
+            (__mmask16) -1, _mm_loadu_si128((const __m128i*) t));
+          __m512i thi = _mm512_maskz_broadcast_i32x4(
+            (__mmask16) -1, _mm_loadu_si128((const __m128i*) (t + 16)));
+          acc[j] = _mm512_xor_si512(
+            acc[j],
+            _mm512_xor_si512(_mm512_shuffle_epi8(tlo, lo),
+                             _mm512_shuffle_epi8(thi, hi)));
+        }
+      }
+      for (int j = 0; j < n; j++)
+        _mm512_storeu_si512((void*) (dest[row + j] + pos), acc[j]);
+    }
+    dot_prod_tail(pos, len, k, row, n, gftbls, src, dest);
+  }
+}
+
+__attribute__((target("avx2,gfni")))
+static void
+dot_prod_avx2_gfni(int len,
+                   int k,
+                   int rows,
+                   unsigned char *gftbls,
+                   unsigned char **src,
+                   unsigned char **dest)
+{
+  uint64_t matrix[rows * k];
+  for (int c = 0; c < rows * k; c++)
+    matrix[c] = gf_affine_matrix(gftbls + c * 32);
+
+  for (int row = 0; row < rows; row += EC_ISA_KERNEL_MAX_ROWS) {
+    int n = std::min(rows - row, EC_ISA_KERNEL_MAX_ROWS);
+    int pos = 0;
+    for (; pos + 32 <= len; pos += 32) {
+      __m256i acc[EC_ISA_KERNEL_MAX_ROWS];
+      for (int j = 0; j < n; j++)
+        acc[j] = _mm256_setzero_si256();
+      for (int i = 0; i < k; i++) {
+        __m256i x = _mm256_loadu_si256((const __m256i*) (src[i] + pos));
+        for (int j = 0; j < n; j++) {
+          __m256i a = _mm256_set1_epi64x(matrix[(row + j) * k + i]);
+          acc[j] = _mm256_xor_si256(
+            acc[j], _mm256_gf2p8affine_epi64_epi8(x, a, 0));
+        }
+      }
+      for (int j = 0; j < n; j++)
+        _mm256_storeu_si256((__m256i*) (dest[row + j] + pos), acc[j]);
+    }
+    dot_prod_tail(pos, len, k, row, n, gftbls, src, dest);
+  }
+}
+
+__attribute__((target("avx512f,avx512bw,gfni")))
+static void
+dot_prod_avx512_gfni(int len,
+                     int k,
+                     int rows,
+                     unsigned char *gftbls,
+                     unsigned char **src,
+                     unsigned char **dest)
+{
+  uint64_t matrix[rows * k];
+  for (int c = 0; c < rows * k; c++)
+    matrix[c] = gf_affine_matrix(gftbls + c * 32);
+
+  for (int row = 0; row < rows; row += EC_ISA_KERNEL_MAX_ROWS) {
+    int n = std::min(rows - row, EC_ISA_KERNEL_MAX_ROWS);
+    int pos = 0;
+    for (; pos + 64 <= len; pos += 64) {
+      __m512i acc[EC_ISA_KERNEL_MAX_ROWS];
+      for (int j = 0; j < n; j++)
+        acc[j] = _mm512_setzero_si512();
+      for (int i = 0; i < k; i++) {
+        __m512i x = _mm512_loadu_si512((const void*) (src[i] + pos));
+        for (int j = 0; j < n; j++) {
+          __m512i a = _mm512_set1_epi64(matrix[(row + j) * k + i]);
+          acc[j] = _mm512_xor_si512(
+            acc[j], _mm512_gf2p8affine_epi64_epi8(x, a, 0));
+        }
+      }
+      for (int j = 0; j < n; j++)
+        _mm512_storeu_si512((void*) (dest[row + j] + pos), acc[j]);
+    }
+    dot_prod_tail(pos, len, k, row, n, gftbls, src, dest);
+  }
+}
+
+__attribute__((target("avx2")))
+static void
+region_xor_avx2(unsigned char **src,
+                unsigned char *parity,
+                int src_size,
+                unsigned size)
+{
+  unsigned pos = 0;
+  for (; pos + 64 <= size; pos += 64) {
+    __m256i p0 = _mm256_loadu_si256((const __m256i*) (src[0] + pos));
+    __m256i p1 = _mm256_loadu_si256((const __m256i*) (src[0] + pos + 32));
+    for (int i = 1; i < src_size; i++) {
+      p0 = _mm256_xor_si256(
+        p0, _mm256_loadu_si256((const __m256i*) (src[i] + pos)));
+      p1 = _mm256_xor_si256(
+        p1, _mm256_loadu_si256((const __m256i*) (src[i] + pos + 32)));
+    }
+    _mm256_storeu_si256((__m256i*) (parity + pos), p0);
+    _mm256_storeu_si256((__m256i*) (parity + pos + 32), p1);
+  }
+  region_xor_tail(pos, src, parity, src_size, size);
+}
+
+__attribute__((target("avx512f")))
+static void
+region_xor_avx512(unsigned char **src,
+                  unsigned char *parity,
+                  int src_size,
+                  unsigned size)
+{
+  unsigned pos = 0;
+  for (; pos + 128 <= size; pos += 128) {
+    __m512i p0 = _mm512_loadu_si512((const void*) (src[0] + pos));
+    __m512i p1 = _mm512_loadu_si512((const void*) (src[0] + pos + 64));
+    for (int i = 1; i < src_size; i++) {
+      p0 = _mm512_xor_si512(
+        p0, _mm512_loadu_si512((const void*) (src[i] + pos)));
+      p1 = _mm512_xor_si512(
+        p1, _mm512_loadu_si512((const void*) (src[i] + pos + 64)));
+    }
+    _mm512_storeu_si512((void*) (parity + pos), p0);
+    _mm512_storeu_si512((void*) (parity + pos + 64), p1);
+  }
+  region_xor_tail(pos, src, parity, src_size, size);
+}
+
+#endif // __x86_64__
+
+// -----------------------------------------------------------------------------
+
+void
+ec_isa_dot_prod(int kernel,
+                int len,
+                int k,
+                int rows,
+                unsigned char *gftbls,
+                unsigned char **src,
+                unsigned char **dest)
+{
+  switch (kernel) {
+#ifdef __x86_64__
+  case EC_ISA_KERNEL_AVX2:
+    dot_prod_avx2(len, k, rows, gftbls, src, dest);
+    return;
+  case EC_ISA_KERNEL_AVX512:
+    dot_prod_avx512(len, k, rows, gftbls, src, dest);
+    return;
+  case EC_ISA_KERNEL_AVX2_GFNI:
+    dot_prod_avx2_gfni(len, k, rows, gftbls, src, dest);
+    return;
+  case EC_ISA_KERNEL_AVX512_GFNI:
+    dot_prod_avx512_gfni(len, k, rows, gftbls, src, dest);
+    return;
+#endif
+  default:
+    ec_encode_data(len, k, rows, gftbls, src, dest);
+  }
+}
+
+void
+ec_isa_region_xor(int kernel,
+                  unsigned char **src,
+                  unsigned char *parity,
+                  int src_size,
+                  unsigned size)
+{
+  if (!src_size || !size)
+    return;
+  switch (kernel) {
+#ifdef __x86_64__
+  case EC_ISA_KERNEL_AVX2:
+  case EC_ISA_KERNEL_AVX2_GFNI:
+    region_xor_avx2(src, parity, src_size, size);
+    return;
+  case EC_ISA_KERNEL_AVX512:
+  case EC_ISA_KERNEL_AVX512_GFNI:
+    region_xor_avx512(src, parity, src_size, size);
+    return;
+#endif
+  default:
+    region_xor(src, parity, src_size, size);
+  }
+}
@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef EC_ISA_KERNEL_H
+#define EC_ISA_KERNEL_H
+
+#include <string>
+
+// -------------------------------------------------------------------------
+// SIMD kernels for the two hot loops of the codec, selected at runtime:
+// the GF(2^8) matrix multiply used to encode and decode and the region
+// xor used for single parity.
+//
+// EC_ISA_KERNEL_ISAL leaves the matrix multiply to the dispatcher built
+// into ISA-L, which picks its own SSE/AVX/AVX2/AVX512 assembly, and uses
+// the SSE2/NEON region xor.  The other kernels are implemented here,
+// the GFNI ones with GF2P8AFFINEQB which ISA-L as bundled does not use.
+// -------------------------------------------------------------------------
+
+enum ec_isa_kernel_t {
+  EC_ISA_KERNEL_ISAL = 0,
+  EC_ISA_KERNEL_AVX2,
+  EC_ISA_KERNEL_AVX512,
+  EC_ISA_KERNEL_AVX2_GFNI,
+  EC_ISA_KERNEL_AVX512_GFNI,
+  EC_ISA_KERNEL_MAX
+};
+
+// -------------------------------------------------------------------------
+// name of a kernel as used in the erasure code profile
+// -------------------------------------------------------------------------
+const char*
+ec_isa_kernel_name(int kernel);
+
+// -------------------------------------------------------------------------
+// kernel for a name, -1 if there is no such kernel
+// -------------------------------------------------------------------------
+int
+ec_isa_kernel_from_name(const std::string &name);
+
+// -------------------------------------------------------------------------
+// true if the CPU (and OS) can run kernel
+// -------------------------------------------------------------------------
+bool
+ec_isa_kernel_supported(int kernel);
+
+// -------------------------------------------------------------------------
+// the fastest supported kernel for the matrix multiply
+// -------------------------------------------------------------------------
+int
+ec_isa_kernel_best();
+
+// -------------------------------------------------------------------------
+// dest[j] = sum over i of coeff(j, i) * src[i] for j < rows, gftbls being
+// the k * rows tables built by ec_init_tables()
+// -------------------------------------------------------------------------
+void
+ec_isa_dot_prod(int kernel,
+                int len,
+                int k,
+                int rows,
+                unsigned char *gftbls,
+                unsigned char **src,
+                unsigned char **dest);
+
+// -------------------------------------------------------------------------
+// parity = src[0] ^ src[1] ... ^ src[src_size - 1]
+// -------------------------------------------------------------------------
+void
+ec_isa_region_xor(int kernel,
+                  unsigned char **src,
+                  unsigned char *parity,
+                  int src_size,
+                  unsigned size);
+
+#endif // EC_ISA_KERNEL_H
@@ -137,6 +137,58 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+int ErasureCodeJerasure::apply_delta(const map<int, bufferlist> &deltas,
+				     map<int, bufferlist> *coding)
+{
+  int *matrix = get_coding_matrix();
+  if (!matrix)
+    return -ENOTSUP;
+  if (deltas.empty())
+    return 0;
+  unsigned blocksize = deltas.begin()->second.length();
+  for (auto &[i, delta] : deltas) {
+    if (i < 0 || i >= k || delta.length() != blocksize)
+      return -EINVAL;
+  }
+  char *parity[m];
+  for (int j = 0; j < m; j++) {
+    auto c = coding->find(k + j);
+    if (c == coding->end() || c->second.length() != blocksize)
+      return -EINVAL;
+    c->second.rebuild_aligned(SIMD_ALIGN);
+    parity[j] = c->second.c_str();
+  }
+  for (auto &[i, d] : deltas) {
+    bufferlist delta = d;
+    delta.rebuild_aligned(SIMD_ALIGN);
+    char *src = delta.c_str();
+    // same as jerasure_matrix_dotprod, restricted to one data chunk
+    for (int j = 0; j < m; j++) {
+      int multby = matrix[j * k + i];
+      if (multby == 0) {
+	continue;
+      } else if (multby == 1) {
+	galois_region_xor(src, parity[j], blocksize);
+      } else {
+	switch (w) {
+	case 8:
+	  galois_w08_region_multiply(src, multby, blocksize, parity[j], 1);
+	  break;
+	case 16:
+	  galois_w16_region_multiply(src, multby, blocksize, parity[j], 1);
+	  break;
+	case 32:
+	  galois_w32_region_multiply(src, multby, blocksize, parity[j], 1);
+	  break;
+	default:
+	  return -EINVAL;
+	}
+      }
+    }
+  }
+  return 0;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
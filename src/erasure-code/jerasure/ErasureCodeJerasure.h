@@ -65,6 +65,19 @@ public:
 
   int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override;
 
+  bool supports_parity_delta() const override {
+    return get_coding_matrix() != nullptr;
+  }
+
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+		  std::map<int, ceph::buffer::list> *coding) override;
+
+  // the m x k coding matrix over GF(2^w), or nullptr for the bit
+  // matrix techniques, for which parity deltas are not implemented
+  virtual int *get_coding_matrix() const {
+    return nullptr;
+  }
+
   virtual void jerasure_encode(char **data,
                                char **coding,
                                int blocksize) = 0;
@@ -104,6 +117,9 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  int *get_coding_matrix() const override {
+    return matrix;
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -134,6 +150,9 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  int *get_coding_matrix() const override {
+    return matrix;
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
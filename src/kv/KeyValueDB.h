@@ -189,6 +189,20 @@ public:
 		  ceph::buffer::list *value) {
     return get(prefix, std::string(key, keylen), value);
   }
+  /// Retrieve many keys in one batched lookup
+  virtual int multi_get(
+    const std::string &prefix,                ///< [in] prefix or CF name
+    const std::vector<std::string> &keys,     ///< [in] keys to retrieve
+    std::vector<ceph::buffer::list> *values,  ///< [out] values, by key index
+    std::vector<int> *rvals) {                ///< [out] 0 or -ENOENT, by key index
+    values->clear();
+    values->resize(keys.size());
+    rvals->resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      (*rvals)[i] = get(prefix, keys[i], &(*values)[i]);
+    }
+    return 0;
+  }
 
   // This superclass is used both by kv iterators *and* by the ObjectMap
   // omap iterator.  The class hierarchies are unfortunately tied together
@@ -20,6 +20,7 @@
 #include "rocksdb/utilities/convenience.h"
 #include "rocksdb/utilities/table_properties_collectors.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/version.h"
 
 #include "common/perf_counters.h"
 #include "common/PriorityCache.h"
@@ -460,6 +461,8 @@ std::shared_ptr<rocksdb::Cache> RocksDBStore::create_block_cache(
   auto shard_bits = cct->_conf->rocksdb_cache_shard_bits;
   if (cache_type == "binned_lru") {
     cache = rocksdb_cache::NewBinnedLRUCache(cct, cache_size, shard_bits, false, cache_prio_high);
+  } else if (cache_type == "binned_clock") {
+    cache = rocksdb_cache::NewBinnedClockCache(cct, cache_size, shard_bits, false, cache_prio_high);
   } else if (cache_type == "lru") {
     cache = rocksdb::NewLRUCache(cache_size, shard_bits);
   } else if (cache_type == "clock") {
@@ -1251,6 +1254,8 @@ int RocksDBStore::do_open(ostream &out,
   plb.add_time_avg(l_rocksdb_write_delay_time, "rocksdb_write_delay_time", "Rocksdb write delay time");
   plb.add_time_avg(l_rocksdb_write_pre_and_post_process_time, 
       "rocksdb_write_pre_and_post_time", "total time spent on writing a record, excluding write process");
+  plb.add_time_avg(l_rocksdb_multi_get_latency, "multi_get_latency", "MultiGet latency");
+  plb.add_u64_counter(l_rocksdb_multi_get_keys, "multi_get_keys", "Keys looked up by MultiGet");
   logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 
@@ -1858,39 +1863,71 @@ int RocksDBStore::get(
     const std::set<string> &keys,
     std::map<string, bufferlist> *out)
 {
-  rocksdb::PinnableSlice value;
   utime_t start = ceph_clock_now();
+  std::vector<string> kv(keys.begin(), keys.end());
+  std::vector<bufferlist> values;
+  std::vector<int> rvals;
+  multi_get(prefix, kv, &values, &rvals);
+  for (size_t i = 0; i < kv.size(); ++i) {
+    if (rvals[i] == 0) {
+      (*out)[kv[i]] = std::move(values[i]);
+    }
+  }
+  utime_t lat = ceph_clock_now() - start;
+  logger->tinc(l_rocksdb_get_latency, lat);
+  return 0;
+}
+
+int RocksDBStore::multi_get(
+    const string &prefix,
+    const std::vector<string> &keys,
+    std::vector<bufferlist> *values,
+    std::vector<int> *rvals)
+{
+  utime_t start = ceph_clock_now();
+  size_t n = keys.size();
+  values->clear();
+  values->resize(n);
+  rvals->assign(n, -ENOENT);
+  if (n == 0) {
+    return 0;
+  }
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs(n, default_cf);
+  std::vector<rocksdb::Slice> slices;
+  slices.reserve(n);
+  std::vector<string> combined;
   if (cf_handles.count(prefix) > 0) {
-    for (auto& key : keys) {
-      auto cf_handle = get_cf_handle(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    cf_handle,
-			    rocksdb::Slice(key),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+    for (size_t i = 0; i < n; ++i) {
+      // sharded prefixes may spread the keys over several CFs
+      cfs[i] = get_cf_handle(prefix, keys[i]);
+      slices.emplace_back(keys[i]);
     }
   } else {
+    combined.reserve(n);  // slices point into it
     for (auto& key : keys) {
-      string k = combine_strings(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    default_cf,
-			    rocksdb::Slice(k),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+      combined.push_back(combine_strings(prefix, key));
+      slices.emplace_back(combined.back());
+    }
+  }
+  std::vector<rocksdb::PinnableSlice> pvalues(n);
+  std::vector<rocksdb::Status> statuses(n);
+  rocksdb::ReadOptions ropts;
+#if (ROCKSDB_MAJOR >= 8 || (ROCKSDB_MAJOR == 7 && ROCKSDB_MINOR >= 2))
+  ropts.async_io = cct->_conf.get_val<bool>("rocksdb_multi_get_async_io");
+#endif
+  db->MultiGet(ropts, n, cfs.data(), slices.data(), pvalues.data(),
+	       statuses.data());
+  for (size_t i = 0; i < n; ++i) {
+    if (statuses[i].ok()) {
+      (*values)[i].append(pvalues[i].data(), pvalues[i].size());
+      (*rvals)[i] = 0;
+    } else if (!statuses[i].IsNotFound()) {
+      ceph_abort_msg(statuses[i].getState());
     }
   }
   utime_t lat = ceph_clock_now() - start;
-  logger->tinc(l_rocksdb_get_latency, lat);
+  logger->tinc(l_rocksdb_multi_get_latency, lat);
+  logger->inc(l_rocksdb_multi_get_keys, n);
   return 0;
 }
 
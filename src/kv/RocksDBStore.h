@@ -18,6 +18,7 @@
 #include "rocksdb/table.h"
 #include "rocksdb/db.h"
 #include "kv/rocksdb_cache/BinnedLRUCache.h"
+#include "kv/rocksdb_cache/BinnedClockCache.h"
 #include <errno.h>
 #include "common/errno.h"
 #include "common/dout.h"
@@ -42,6 +43,8 @@ enum {
   l_rocksdb_write_memtable_time,
   l_rocksdb_write_delay_time,
   l_rocksdb_write_pre_and_post_process_time,
+  l_rocksdb_multi_get_latency,
+  l_rocksdb_multi_get_keys,
   l_rocksdb_last,
 };
 
@@ -350,6 +353,11 @@ public:
     const char *key,
     size_t keylen,
     ceph::bufferlist *out) override;
+  int multi_get(
+    const std::string &prefix,
+    const std::vector<std::string> &keys,
+    std::vector<ceph::bufferlist> *values,
+    std::vector<int> *rvals) override;
 
 
   class RocksDBWholeSpaceIteratorImpl :
@@ -0,0 +1,693 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include "BinnedClockCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_rocksdb
+#undef dout_prefix
+#define dout_prefix *_dout << "rocksdb: "
+
+namespace rocksdb_cache {
+
+BinnedClockHandleTable::BinnedClockHandleTable() : list_(nullptr), length_(0), elems_(0) {
+  Resize();
+}
+
+BinnedClockHandleTable::~BinnedClockHandleTable() {
+  delete[] list_;
+}
+
+BinnedClockHandle* BinnedClockHandleTable::Lookup(const rocksdb::Slice& key, uint32_t hash) const {
+  return *FindPointer(key, hash);
+}
+
+BinnedClockHandle* BinnedClockHandleTable::Insert(BinnedClockHandle* h) {
+  BinnedClockHandle** ptr = FindPointer(h->key(), h->hash);
+  BinnedClockHandle* old = *ptr;
+  h->next_hash = (old == nullptr ? nullptr : old->next_hash);
+  *ptr = h;
+  if (old == nullptr) {
+    ++elems_;
+    if (elems_ > length_) {
+      Resize();
+    }
+  }
+  return old;
+}
+
+BinnedClockHandle* BinnedClockHandleTable::Remove(const rocksdb::Slice& key, uint32_t hash) {
+  BinnedClockHandle** ptr = FindPointer(key, hash);
+  BinnedClockHandle* result = *ptr;
+  if (result != nullptr) {
+    *ptr = result->next_hash;
+    --elems_;
+  }
+  return result;
+}
+
+BinnedClockHandle** BinnedClockHandleTable::FindPointer(const rocksdb::Slice& key, uint32_t hash) const {
+  BinnedClockHandle** ptr = &list_[hash & (length_ - 1)];
+  while (*ptr != nullptr && ((*ptr)->hash != hash || key != (*ptr)->key())) {
+    ptr = &(*ptr)->next_hash;
+  }
+  return ptr;
+}
+
+void BinnedClockHandleTable::Resize() {
+  uint32_t new_length = 16;
+  while (new_length < elems_ * 1.5) {
+    new_length *= 2;
+  }
+  BinnedClockHandle** new_list = new BinnedClockHandle*[new_length];
+  memset(new_list, 0, sizeof(new_list[0]) * new_length);
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < length_; i++) {
+    BinnedClockHandle* h = list_[i];
+    while (h != nullptr) {
+      BinnedClockHandle* next = h->next_hash;
+      BinnedClockHandle** ptr = &new_list[h->hash & (new_length - 1)];
+      h->next_hash = *ptr;
+      *ptr = h;
+      h = next;
+      count++;
+    }
+  }
+  ceph_assert(elems_ == count);
+  delete[] list_;
+  list_ = new_list;
+  length_ = new_length;
+}
+
+BinnedClockCacheShard::BinnedClockCacheShard(CephContext *c, size_t capacity,
+                                             bool strict_capacity_limit,
+                                             double high_pri_pool_ratio)
+    : cct(c),
+      capacity_(0),
+      strict_capacity_limit_(strict_capacity_limit),
+      high_pri_pool_ratio_(high_pri_pool_ratio),
+      high_pri_pool_capacity_(0),
+      age_bins(1) {
+  SetCapacity(capacity);
+}
+
+BinnedClockCacheShard::~BinnedClockCacheShard() {
+  table_.ApplyToAllCacheEntries([](BinnedClockHandle* h) {
+    if (BinnedClockHandle::refs(h->state.load()) == 0) {
+      h->Free();
+    }
+  });
+}
+
+void BinnedClockCacheShard::Clock_Insert(BinnedClockHandle* e) {
+  ceph_assert(e->next == nullptr && e->prev == nullptr);
+  if (hand_ == nullptr) {
+    e->next = e->prev = e;
+    hand_ = e;
+  } else {
+    // behind the hand, i.e. the last to be visited
+    e->next = hand_;
+    e->prev = hand_->prev;
+    e->prev->next = e;
+    hand_->prev = e;
+  }
+  if (e->high_pri) {
+    high_pri_pool_usage_ += e->charge;
+  } else {
+    e->epoch = epoch_;
+    *bin_of(epoch_) += e->charge;
+  }
+}
+
+void BinnedClockCacheShard::Clock_Remove(BinnedClockHandle* e) {
+  ceph_assert(e->next != nullptr && e->prev != nullptr);
+  if (e->next == e) {
+    hand_ = nullptr;
+  } else {
+    if (hand_ == e) {
+      hand_ = e->next;
+    }
+    e->next->prev = e->prev;
+    e->prev->next = e->next;
+  }
+  e->next = e->prev = nullptr;
+  if (e->high_pri) {
+    ceph_assert(high_pri_pool_usage_ >= e->charge);
+    high_pri_pool_usage_ -= e->charge;
+  } else if (auto bin = bin_of(e->epoch)) {
+    ceph_assert(*bin >= e->charge);
+    *bin -= e->charge;
+  }
+}
+
+std::atomic<uint64_t>* BinnedClockCacheShard::bin_of(uint64_t epoch) {
+  if (epoch_ - epoch >= age_bins.size()) {
+    return nullptr;  // aged out of all bins
+  }
+  return &age_bins[epoch % age_bins.size()];
+}
+
+void BinnedClockCacheShard::EvictFromClock(size_t charge,
+                                           ceph::autovector<BinnedClockHandle*>* deleted) {
+  const uint64_t n = table_.size();
+  for (uint64_t steps = 0;
+       usage_ + charge > capacity_ && hand_ != nullptr && steps < 2 * n;
+       ++steps) {
+    BinnedClockHandle* e = hand_;
+    hand_ = e->next;
+    uint32_t s = e->state.load(std::memory_order_acquire);
+    ceph_assert(s & BinnedClockHandle::IN_CACHE);
+    if (BinnedClockHandle::refs(s) > 0) {
+      continue;
+    }
+    if (s & BinnedClockHandle::USAGE) {
+      e->state.fetch_and(~BinnedClockHandle::USAGE, std::memory_order_relaxed);
+      continue;
+    }
+    if (e->high_pri && high_pri_pool_usage_ <= high_pri_pool_capacity_ &&
+        steps < n) {
+      // high-pri entries within their pool only go on the second round
+      continue;
+    }
+    // no references and lookups are excluded, so nobody can grab it
+    Clock_Remove(e);
+    table_.Remove(e->key(), e->hash);
+    e->state.store(0, std::memory_order_relaxed);
+    usage_ -= e->charge;
+    deleted->push_back(e);
+  }
+}
+
+void BinnedClockCacheShard::EraseUnRefEntries() {
+  ceph::autovector<BinnedClockHandle*> last_reference_list;
+  {
+    std::unique_lock l(mutex_);
+    for (uint64_t n = table_.size(); n > 0 && hand_ != nullptr; --n) {
+      BinnedClockHandle* e = hand_;
+      hand_ = e->next;
+      if (BinnedClockHandle::refs(e->state.load()) > 0) {
+        continue;
+      }
+      Clock_Remove(e);
+      table_.Remove(e->key(), e->hash);
+      e->state.store(0);
+      usage_ -= e->charge;
+      last_reference_list.push_back(e);
+    }
+  }
+
+  for (auto entry : last_reference_list) {
+    entry->Free();
+  }
+}
+
+void BinnedClockCacheShard::ApplyToAllCacheEntries(
+  const std::function<void(const rocksdb::Slice& key,
+                           void* value,
+                           size_t charge,
+                           DeleterFn)>& callback,
+  bool thread_safe)
+{
+  std::shared_lock l(mutex_, std::defer_lock);
+  if (thread_safe) {
+    l.lock();
+  }
+  table_.ApplyToAllCacheEntries(
+    [callback](BinnedClockHandle* h) {
+      callback(h->key(), h->value, h->charge, h->deleter);
+    });
+}
+
+double BinnedClockCacheShard::GetHighPriPoolRatio() const {
+  std::shared_lock l(mutex_);
+  return high_pri_pool_ratio_;
+}
+
+size_t BinnedClockCacheShard::GetHighPriPoolUsage() const {
+  std::shared_lock l(mutex_);
+  return high_pri_pool_usage_;
+}
+
+uint64_t BinnedClockCacheShard::sum_bins(uint32_t start, uint32_t end) const {
+  std::shared_lock l(mutex_);
+  auto size = age_bins.size();
+  if (size < start) {
+    return 0;
+  }
+  uint64_t bytes = 0;
+  end = (size < end) ? size : end;
+  for (auto i = start; i < end && i <= epoch_; i++) {
+    bytes += age_bins[(epoch_ - i) % size];
+  }
+  return bytes;
+}
+
+void BinnedClockCacheShard::SetCapacity(size_t capacity) {
+  ceph::autovector<BinnedClockHandle*> last_reference_list;
+  {
+    std::unique_lock l(mutex_);
+    capacity_ = capacity;
+    high_pri_pool_capacity_ = capacity_ * high_pri_pool_ratio_;
+    EvictFromClock(0, &last_reference_list);
+  }
+  for (auto entry : last_reference_list) {
+    entry->Free();
+  }
+}
+
+void BinnedClockCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
+  std::unique_lock l(mutex_);
+  strict_capacity_limit_ = strict_capacity_limit;
+}
+
+void BinnedClockCacheShard::SetHighPriPoolRatio(double high_pri_pool_ratio) {
+  std::unique_lock l(mutex_);
+  high_pri_pool_ratio_ = high_pri_pool_ratio;
+  high_pri_pool_capacity_ = capacity_ * high_pri_pool_ratio_;
+}
+
+rocksdb::Cache::Handle* BinnedClockCacheShard::Lookup(const rocksdb::Slice& key, uint32_t hash) {
+  std::shared_lock l(mutex_);
+  BinnedClockHandle* e = table_.Lookup(key, hash);
+  if (e == nullptr) {
+    return nullptr;
+  }
+  uint32_t old = e->state.fetch_add(BinnedClockHandle::REF, std::memory_order_acq_rel);
+  ceph_assert(old & BinnedClockHandle::IN_CACHE);
+  if (!(old & BinnedClockHandle::USAGE)) {
+    e->state.fetch_or(BinnedClockHandle::USAGE, std::memory_order_relaxed);
+  }
+  if (BinnedClockHandle::refs(old) == 0) {
+    pinned_usage_ += e->charge;
+  }
+  if (!e->high_pri) {
+    // epoch_ and the bins only change with the lock held exclusively
+    uint64_t prev = e->epoch.exchange(epoch_, std::memory_order_relaxed);
+    if (prev != epoch_) {
+      if (auto bin = bin_of(prev)) {
+        *bin -= e->charge;
+      }
+      *bin_of(epoch_) += e->charge;
+    }
+  }
+  return reinterpret_cast<rocksdb::Cache::Handle*>(e);
+}
+
+bool BinnedClockCacheShard::Ref(rocksdb::Cache::Handle* h) {
+  BinnedClockHandle* e = reinterpret_cast<BinnedClockHandle*>(h);
+  // the caller holds a reference, so the entry cannot go away
+  uint32_t old = e->state.fetch_add(BinnedClockHandle::REF, std::memory_order_relaxed);
+  ceph_assert(BinnedClockHandle::refs(old) > 0);
+  return true;
+}
+
+bool BinnedClockCacheShard::Release(rocksdb::Cache::Handle* handle, bool force_erase) {
+  if (handle == nullptr) {
+    return false;
+  }
+  BinnedClockHandle* e = reinterpret_cast<BinnedClockHandle*>(handle);
+  // once our reference is gone the entry may be evicted at any time
+  const size_t charge = e->charge;
+
+  if (force_erase || usage_ > capacity_) {
+    // drop the entry right away if ours is the last reference
+    bool last_reference = false;
+    {
+      std::unique_lock l(mutex_);
+      uint32_t old = e->state.fetch_sub(BinnedClockHandle::REF, std::memory_order_acq_rel);
+      ceph_assert(BinnedClockHandle::refs(old) > 0);
+      if (BinnedClockHandle::refs(old) == 1) {
+        pinned_usage_ -= charge;
+        if (old & BinnedClockHandle::IN_CACHE) {
+          Clock_Remove(e);
+          table_.Remove(e->key(), e->hash);
+          e->state.store(0, std::memory_order_relaxed);
+        }
+        usage_ -= charge;
+        last_reference = true;
+      }
+    }
+    if (last_reference) {
+      e->Free();
+    }
+    return last_reference;
+  }
+
+  uint32_t old = e->state.fetch_sub(BinnedClockHandle::REF, std::memory_order_acq_rel);
+  ceph_assert(BinnedClockHandle::refs(old) > 0);
+  if (BinnedClockHandle::refs(old) > 1) {
+    return false;
+  }
+  pinned_usage_ -= charge;
+  if (old & BinnedClockHandle::IN_CACHE) {
+    // stays cached; the clock hand decides when it goes
+    return false;
+  }
+  // erased or replaced while we held it
+  usage_ -= charge;
+  e->Free();
+  return true;
+}
+
+rocksdb::Status BinnedClockCacheShard::Insert(const rocksdb::Slice& key, uint32_t hash, void* value,
+                             size_t charge,
+                             DeleterFn deleter,
+                             rocksdb::Cache::Handle** handle, rocksdb::Cache::Priority priority) {
+  auto e = new BinnedClockHandle();
+  rocksdb::Status s;
+  ceph::autovector<BinnedClockHandle*> last_reference_list;
+
+  e->value = value;
+  e->deleter = deleter;
+  e->charge = charge;
+  e->key_length = key.size();
+  e->key_data = new char[e->key_length];
+  e->hash = hash;
+  std::copy_n(key.data(), e->key_length, e->key_data);
+
+  {
+    std::unique_lock l(mutex_);
+    e->high_pri = high_pri_pool_ratio_ > 0 &&
+      priority == rocksdb::Cache::Priority::HIGH;
+    EvictFromClock(charge, &last_reference_list);
+
+    if (pinned_usage_ + charge > capacity_ &&
+        (strict_capacity_limit_ || handle == nullptr)) {
+      if (handle == nullptr) {
+        // Don't insert the entry but still return ok, as if the entry inserted
+        // into cache and get evicted immediately.
+        last_reference_list.push_back(e);
+      } else {
+        delete[] e->key_data;
+        delete e;
+        *handle = nullptr;
+        s = rocksdb::Status::Incomplete("Insert failed due to clock cache being full.");
+      }
+    } else {
+      // note that the cache might get larger than its capacity if not enough
+      // space was freed
+      e->state = BinnedClockHandle::IN_CACHE |
+        (handle == nullptr ? 0 : BinnedClockHandle::REF);
+      BinnedClockHandle* old = table_.Insert(e);
+      Clock_Insert(e);
+      usage_ += charge;
+      if (old != nullptr) {
+        Clock_Remove(old);
+        uint32_t os = old->state.fetch_and(~BinnedClockHandle::IN_CACHE,
+                                           std::memory_order_acq_rel);
+        if (BinnedClockHandle::refs(os) == 0) {
+          usage_ -= old->charge;
+          last_reference_list.push_back(old);
+        }
+      }
+      if (handle != nullptr) {
+        pinned_usage_ += charge;
+        *handle = reinterpret_cast<rocksdb::Cache::Handle*>(e);
+      }
+      s = rocksdb::Status::OK();
+    }
+  }
+
+  // we free the entries here outside of mutex for
+  // performance reasons
+  for (auto entry : last_reference_list) {
+    entry->Free();
+  }
+
+  return s;
+}
+
+void BinnedClockCacheShard::Erase(const rocksdb::Slice& key, uint32_t hash) {
+  BinnedClockHandle* e;
+  bool last_reference = false;
+  {
+    std::unique_lock l(mutex_);
+    e = table_.Remove(key, hash);
+    if (e != nullptr) {
+      Clock_Remove(e);
+      uint32_t old = e->state.fetch_and(~BinnedClockHandle::IN_CACHE,
+                                        std::memory_order_acq_rel);
+      if (BinnedClockHandle::refs(old) == 0) {
+        usage_ -= e->charge;
+        last_reference = true;
+      }
+    }
+  }
+
+  // mutex not held here
+  // last_reference will only be true if e != nullptr
+  if (last_reference) {
+    e->Free();
+  }
+}
+
+size_t BinnedClockCacheShard::GetUsage() const {
+  return usage_;
+}
+
+size_t BinnedClockCacheShard::GetPinnedUsage() const {
+  return pinned_usage_;
+}
+
+void BinnedClockCacheShard::shift_bins() {
+  std::unique_lock l(mutex_);
+  ++epoch_;
+  // whatever was charged here belongs to entries that just aged out
+  age_bins[epoch_ % age_bins.size()] = 0;
+}
+
+uint32_t BinnedClockCacheShard::get_bin_count() const {
+  std::shared_lock l(mutex_);
+  return age_bins.size();
+}
+
+void BinnedClockCacheShard::set_bin_count(uint32_t count) {
+  std::unique_lock l(mutex_);
+  count = std::max<uint32_t>(count, 1);
+  if (count == age_bins.size()) {
+    return;
+  }
+  // recharge the new ring from the entries themselves
+  std::vector<std::atomic<uint64_t>> bins(count);
+  table_.ApplyToAllCacheEntries([&](BinnedClockHandle* h) {
+    uint64_t epoch = h->epoch;
+    if (!h->high_pri && epoch_ - epoch < count) {
+      bins[epoch % count] += h->charge;
+    }
+  });
+  age_bins.swap(bins);
+}
+
+std::string BinnedClockCacheShard::GetPrintableOptions() const {
+  const int kBufferSize = 200;
+  char buffer[kBufferSize];
+  {
+    std::shared_lock l(mutex_);
+    snprintf(buffer, kBufferSize, "    high_pri_pool_ratio: %.3lf\n",
+             high_pri_pool_ratio_);
+  }
+  return std::string(buffer);
+}
+
+DeleterFn BinnedClockCacheShard::GetDeleter(rocksdb::Cache::Handle* h) const
+{
+  auto* handle = reinterpret_cast<BinnedClockHandle*>(h);
+  return handle->deleter;
+}
+
+BinnedClockCache::BinnedClockCache(CephContext *c,
+                                   size_t capacity,
+                                   int num_shard_bits,
+                                   bool strict_capacity_limit,
+                                   double high_pri_pool_ratio)
+    : ShardedCache(capacity, num_shard_bits, strict_capacity_limit), cct(c) {
+  num_shards_ = 1 << num_shard_bits;
+  int rc = posix_memalign((void**) &shards_,
+                          CACHE_LINE_SIZE,
+                          sizeof(BinnedClockCacheShard) * num_shards_);
+  if (rc != 0) {
+    throw std::bad_alloc();
+  }
+  size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
+  for (int i = 0; i < num_shards_; i++) {
+    new (&shards_[i])
+        BinnedClockCacheShard(c, per_shard, strict_capacity_limit, high_pri_pool_ratio);
+  }
+}
+
+BinnedClockCache::~BinnedClockCache() {
+  for (int i = 0; i < num_shards_; i++) {
+    shards_[i].~BinnedClockCacheShard();
+  }
+  aligned_free(shards_);
+}
+
+CacheShard* BinnedClockCache::GetShard(int shard) {
+  return reinterpret_cast<CacheShard*>(&shards_[shard]);
+}
+
+const CacheShard* BinnedClockCache::GetShard(int shard) const {
+  return reinterpret_cast<CacheShard*>(&shards_[shard]);
+}
+
+void* BinnedClockCache::Value(Handle* handle) {
+  return reinterpret_cast<const BinnedClockHandle*>(handle)->value;
+}
+
+size_t BinnedClockCache::GetCharge(Handle* handle) const {
+  return reinterpret_cast<const BinnedClockHandle*>(handle)->charge;
+}
+
+uint32_t BinnedClockCache::GetHash(Handle* handle) const {
+  return reinterpret_cast<const BinnedClockHandle*>(handle)->hash;
+}
+
+void BinnedClockCache::DisownData() {
+// Do not drop data if compile with ASAN to suppress leak warning.
+#ifndef __SANITIZE_ADDRESS__
+  shards_ = nullptr;
+#endif  // !__SANITIZE_ADDRESS__
+}
+
+#if (ROCKSDB_MAJOR >= 7 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 22))
+DeleterFn BinnedClockCache::GetDeleter(Handle* handle) const
+{
+  return reinterpret_cast<const BinnedClockHandle*>(handle)->deleter;
+}
+#endif
+
+void BinnedClockCache::SetHighPriPoolRatio(double high_pri_pool_ratio) {
+  for (int i = 0; i < num_shards_; i++) {
+    shards_[i].SetHighPriPoolRatio(high_pri_pool_ratio);
+  }
+}
+
+double BinnedClockCache::GetHighPriPoolRatio() const {
+  double result = 0.0;
+  if (num_shards_ > 0) {
+    result = shards_[0].GetHighPriPoolRatio();
+  }
+  return result;
+}
+
+size_t BinnedClockCache::GetHighPriPoolUsage() const {
+  size_t usage = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    usage += shards_[s].GetHighPriPoolUsage();
+  }
+  return usage;
+}
+
+// PriCache
+
+int64_t BinnedClockCache::request_cache_bytes(PriorityCache::Priority pri, uint64_t total_cache) const
+{
+  int64_t assigned = get_cache_bytes(pri);
+  int64_t request = 0;
+
+  switch(pri) {
+  // PRI0 is for rocksdb's high priority items (indexes/filters)
+  case PriorityCache::Priority::PRI0:
+    {
+      request = PriorityCache::get_chunk(GetHighPriPoolUsage(), total_cache);
+      break;
+    }
+  case PriorityCache::Priority::LAST:
+    {
+      auto max = get_bin_count();
+      request = GetUsage();
+      request -= GetHighPriPoolUsage();
+      request -= sum_bins(0, max);
+      break;
+    }
+  default:
+    {
+      ceph_assert(pri > 0 && pri < PriorityCache::Priority::LAST);
+      auto prev_pri = static_cast<PriorityCache::Priority>(pri - 1);
+      uint64_t start = get_bins(prev_pri);
+      uint64_t end = get_bins(pri);
+      request = sum_bins(start, end);
+      break;
+    }
+  }
+  request = (request > assigned) ? request - assigned : 0;
+  ldout(cct, 10) << __func__ << " Priority: " << static_cast<uint32_t>(pri)
+                 << " Request: " << request << dendl;
+  return request;
+}
+
+int64_t BinnedClockCache::commit_cache_size(uint64_t total_bytes)
+{
+  size_t old_bytes = GetCapacity();
+  int64_t new_bytes = PriorityCache::get_chunk(
+      get_cache_bytes(), total_bytes);
+  ldout(cct, 10) << __func__ << " old: " << old_bytes
+                 << " new: " << new_bytes << dendl;
+  SetCapacity((size_t) new_bytes);
+
+  double ratio = 0;
+  if (new_bytes > 0) {
+    int64_t pri0_bytes = get_cache_bytes(PriorityCache::Priority::PRI0);
+    ratio = (double) pri0_bytes / new_bytes;
+  }
+  ldout(cct, 5) << __func__ << " High Pri Pool Ratio set to " << ratio << dendl;
+  SetHighPriPoolRatio(ratio);
+  return new_bytes;
+}
+
+void BinnedClockCache::shift_bins() {
+  for (int s = 0; s < num_shards_; s++) {
+    shards_[s].shift_bins();
+  }
+}
+
+uint64_t BinnedClockCache::sum_bins(uint32_t start, uint32_t end) const {
+  uint64_t bytes = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    bytes += shards_[s].sum_bins(start, end);
+  }
+  return bytes;
+}
+
+uint32_t BinnedClockCache::get_bin_count() const {
+  uint32_t result = 0;
+  if (num_shards_ > 0) {
+    result = shards_[0].get_bin_count();
+  }
+  return result;
+}
+
+void BinnedClockCache::set_bin_count(uint32_t count) {
+  for (int s = 0; s < num_shards_; s++) {
+    shards_[s].set_bin_count(count);
+  }
+}
+
+std::shared_ptr<rocksdb::Cache> NewBinnedClockCache(
+    CephContext *c,
+    size_t capacity,
+    int num_shard_bits,
+    bool strict_capacity_limit,
+    double high_pri_pool_ratio) {
+  if (num_shard_bits >= 20) {
+    return nullptr;  // the cache cannot be sharded into too many fine pieces
+  }
+  if (high_pri_pool_ratio < 0.0 || high_pri_pool_ratio > 1.0) {
+    return nullptr;
+  }
+  if (num_shard_bits < 0) {
+    num_shard_bits = GetDefaultCacheShardBits(capacity);
+  }
+  return std::make_shared<BinnedClockCache>(
+      c, capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio);
+}
+
+}  // namespace rocksdb_cache
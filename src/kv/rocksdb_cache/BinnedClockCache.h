@@ -0,0 +1,253 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef ROCKSDB_BINNED_CLOCK_CACHE
+#define ROCKSDB_BINNED_CLOCK_CACHE
+
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "ShardedCache.h"
+#include "common/autovector.h"
+#include "common/dout.h"
+#include "include/ceph_assert.h"
+#include "common/ceph_context.h"
+
+namespace rocksdb_cache {
+
+// CLOCK cache implementation
+//
+// A variant of BinnedLRUCache whose hit path does not serialize on the
+// shard.  Lookup() only takes the shard lock shared and marks the entry
+// with atomic operations; Release() and Ref() are lock free.  Instead of
+// an LRU list, in-cache entries sit on a clock ring and are evicted by a
+// hand that gives recently used entries a second chance.  Only Insert(),
+// Erase() and eviction take the lock exclusively.
+//
+// The per-entry state word holds the external reference count together
+// with two flags:
+//   IN_CACHE: the entry is in the hash table and on the clock ring.
+//             Only changed with the shard lock held exclusively.
+//   USAGE:    set by Lookup(), cleared by the clock hand.
+// An entry with no external references can only gain one through
+// Lookup(), which is excluded while the hand runs, so an unreferenced
+// entry seen by the hand can be evicted without further checks.
+//
+// Age binning works like in BinnedLRUCache but is driven by an epoch:
+// each shift_bins() starts a new epoch, and each low priority entry
+// charges the bin of the epoch in which it was last looked up.  Bins are
+// kept in a ring of get_bin_count() counters; entries older than that
+// are not counted in any bin.
+
+std::shared_ptr<rocksdb::Cache> NewBinnedClockCache(
+    CephContext *c,
+    size_t capacity,
+    int num_shard_bits = -1,
+    bool strict_capacity_limit = false,
+    double high_pri_pool_ratio = 0.0);
+
+struct BinnedClockHandle {
+  static constexpr uint32_t IN_CACHE = 1;
+  static constexpr uint32_t USAGE = 2;
+  static constexpr uint32_t REF = 4;
+  static uint32_t refs(uint32_t state) { return state / REF; }
+
+  void* value;
+  DeleterFn deleter;
+  BinnedClockHandle* next_hash = nullptr;
+  // clock ring, protected by the shard lock
+  BinnedClockHandle* next = nullptr;
+  BinnedClockHandle* prev = nullptr;
+  size_t charge;
+  size_t key_length;
+  uint32_t hash;     // Hash of key(); used for fast sharding and comparisons
+  bool high_pri = false;
+
+  std::atomic<uint32_t> state = {0};
+  std::atomic<uint64_t> epoch = {0};  // age bin epoch of the last lookup
+
+  char* key_data = nullptr;
+
+  rocksdb::Slice key() const {
+    return rocksdb::Slice(key_data, key_length);
+  }
+
+  void Free() {
+    ceph_assert(refs(state.load()) == 0);
+    if (deleter) {
+      (*deleter)(key(), value);
+    }
+    delete[] key_data;
+    delete this;
+  }
+};
+
+// Same layout as BinnedLRUHandleTable.  Lookup() may run concurrently
+// with other lookups; everything else needs the shard lock exclusively.
+class BinnedClockHandleTable {
+ public:
+  BinnedClockHandleTable();
+  ~BinnedClockHandleTable();
+
+  BinnedClockHandle* Lookup(const rocksdb::Slice& key, uint32_t hash) const;
+  BinnedClockHandle* Insert(BinnedClockHandle* h);
+  BinnedClockHandle* Remove(const rocksdb::Slice& key, uint32_t hash);
+
+  template <typename T>
+  void ApplyToAllCacheEntries(T func) const {
+    for (uint32_t i = 0; i < length_; i++) {
+      BinnedClockHandle* h = list_[i];
+      while (h != nullptr) {
+        auto n = h->next_hash;
+        func(h);
+        h = n;
+      }
+    }
+  }
+
+  uint32_t size() const { return elems_; }
+
+ private:
+  BinnedClockHandle** FindPointer(const rocksdb::Slice& key, uint32_t hash) const;
+
+  void Resize();
+
+  BinnedClockHandle** list_;
+  uint32_t length_;
+  uint32_t elems_;
+};
+
+// A single shard of sharded cache.
+class alignas(CACHE_LINE_SIZE) BinnedClockCacheShard : public CacheShard {
+ public:
+  BinnedClockCacheShard(CephContext *c, size_t capacity, bool strict_capacity_limit,
+                        double high_pri_pool_ratio);
+  virtual ~BinnedClockCacheShard();
+
+  virtual void SetCapacity(size_t capacity) override;
+  virtual void SetStrictCapacityLimit(bool strict_capacity_limit) override;
+  void SetHighPriPoolRatio(double high_pri_pool_ratio);
+
+  virtual rocksdb::Status Insert(const rocksdb::Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        DeleterFn deleter,
+                        rocksdb::Cache::Handle** handle,
+                        rocksdb::Cache::Priority priority) override;
+  virtual rocksdb::Cache::Handle* Lookup(const rocksdb::Slice& key, uint32_t hash) override;
+  virtual bool Ref(rocksdb::Cache::Handle* handle) override;
+  virtual bool Release(rocksdb::Cache::Handle* handle,
+                       bool force_erase = false) override;
+  virtual void Erase(const rocksdb::Slice& key, uint32_t hash) override;
+
+  virtual size_t GetUsage() const override;
+  virtual size_t GetPinnedUsage() const override;
+
+  virtual void ApplyToAllCacheEntries(
+    const std::function<void(const rocksdb::Slice& key,
+                             void* value,
+                             size_t charge,
+                             DeleterFn)>& callback,
+    bool thread_safe) override;
+
+  virtual void EraseUnRefEntries() override;
+
+  virtual std::string GetPrintableOptions() const override;
+
+  virtual DeleterFn GetDeleter(rocksdb::Cache::Handle* handle) const override;
+
+  double GetHighPriPoolRatio() const;
+  size_t GetHighPriPoolUsage() const;
+
+  // Rotate the bins
+  void shift_bins();
+  uint32_t get_bin_count() const;
+  void set_bin_count(uint32_t count);
+  // Get the byte counts for a range of age bins
+  uint64_t sum_bins(uint32_t start, uint32_t end) const;
+
+ private:
+  CephContext *cct;
+
+  void Clock_Insert(BinnedClockHandle* e);
+  void Clock_Remove(BinnedClockHandle* e);
+  std::atomic<uint64_t>* bin_of(uint64_t epoch);
+
+  // Run the clock hand until usage_ + charge fits or every entry was
+  // visited twice.  Needs mutex_ held exclusively.
+  void EvictFromClock(size_t charge, ceph::autovector<BinnedClockHandle*>* deleted);
+
+  // read without the lock by Release()
+  std::atomic<size_t> capacity_;
+  bool strict_capacity_limit_;
+  double high_pri_pool_ratio_;
+  double high_pri_pool_capacity_;
+
+  // ------------^^^^^^^^^^^^^-----------
+  // Not frequently modified data members
+  // ------------------------------------
+  // Frequently modified data members
+  // ------------vvvvvvvvvvvvv-----------
+  BinnedClockHandleTable table_;
+  BinnedClockHandle* hand_ = nullptr;
+  size_t high_pri_pool_usage_ = 0;
+
+  // Memory size for entries residing in the cache or referenced
+  std::atomic<size_t> usage_ = {0};
+  // Memory size for entries with external references
+  std::atomic<size_t> pinned_usage_ = {0};
+
+  // Shared by Lookup(), exclusive for anything that changes the table
+  // or the ring.
+  mutable std::shared_mutex mutex_;
+
+  // Age bins, indexed by epoch modulo their number
+  uint64_t epoch_ = 0;
+  std::vector<std::atomic<uint64_t>> age_bins;
+};
+
+class BinnedClockCache : public ShardedCache {
+ public:
+  BinnedClockCache(CephContext *c, size_t capacity, int num_shard_bits,
+      bool strict_capacity_limit, double high_pri_pool_ratio);
+  virtual ~BinnedClockCache();
+  virtual const char* Name() const override { return "BinnedClockCache"; }
+  virtual CacheShard* GetShard(int shard) override;
+  virtual const CacheShard* GetShard(int shard) const override;
+  virtual void* Value(Handle* handle) override;
+  virtual size_t GetCharge(Handle* handle) const override;
+  virtual uint32_t GetHash(Handle* handle) const override;
+  virtual void DisownData() override;
+#if (ROCKSDB_MAJOR >= 7 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 22))
+  virtual DeleterFn GetDeleter(Handle* handle) const override;
+#endif
+  void SetHighPriPoolRatio(double high_pri_pool_ratio);
+  double GetHighPriPoolRatio() const;
+  size_t GetHighPriPoolUsage() const;
+
+  // PriorityCache
+  virtual int64_t request_cache_bytes(
+      PriorityCache::Priority pri, uint64_t total_cache) const;
+  virtual int64_t commit_cache_size(uint64_t total_cache);
+  virtual int64_t get_committed_size() const {
+    return GetCapacity();
+  }
+  virtual void shift_bins();
+  uint64_t sum_bins(uint32_t start, uint32_t end) const;
+  uint32_t get_bin_count() const;
+  void set_bin_count(uint32_t count);
+
+  virtual std::string get_cache_name() const {
+    return "RocksDB Binned Clock Cache";
+  }
+
+ private:
+  CephContext *cct;
+  BinnedClockCacheShard* shards_;
+  int num_shards_ = 0;
+};
+
+}  // namespace rocksdb_cache
+
+#endif // ROCKSDB_BINNED_CLOCK_CACHE
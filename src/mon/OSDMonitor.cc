@@ -828,6 +828,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     OSDMap::Incremental inc(inc_bl);
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
+    bool reloaded = false;
 
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
@@ -875,6 +876,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	reloaded = true;
 
 	dout(20) << __func__ << " canonical full osdmap:\n";
 	JSONFormatter jf(true);
@@ -909,6 +911,11 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 	osd_epochs.erase(osd);
       }
     }
+    if (reloaded) {
+      mapping_inc.reset();
+    } else {
+      mapping_inc = std::move(inc);
+    }
   }
 
   if (t) {
@@ -1071,8 +1078,17 @@ void OSDMonitor::start_mapping()
   }
   if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
-    mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf()->mon_osd_mapping_pgs_per_chunk);
+    if (mapping_inc &&
+	g_conf().get_val<bool>("mon_osd_mapping_incremental")) {
+      // only remap the pgs the last incremental may have moved, if the
+      // mapping is still at the epoch before it
+      mapping_job = mapping.start_update(
+	osdmap, mapper, g_conf()->mon_osd_mapping_pgs_per_chunk,
+	*mapping_inc);
+    } else {
+      mapping_job = mapping.start_update(
+	osdmap, mapper, g_conf()->mon_osd_mapping_pgs_per_chunk);
+    }
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
 	     << " at " << fin->start << dendl;
     mapping_job->set_finish_event(fin);
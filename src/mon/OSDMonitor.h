@@ -389,6 +389,7 @@ private:
   ParallelPGMapper mapper;                        ///< for background pg work
   OSDMapMapping mapping;                          ///< pg <-> osd mappings
   std::unique_ptr<ParallelPGMapper::Job> mapping_job;  ///< background mapping job
+  std::optional<OSDMap::Incremental> mapping_inc;  ///< incremental that led to osdmap
   void start_mapping();
 
   void update_logger();
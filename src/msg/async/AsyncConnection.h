@@ -185,6 +185,7 @@ private:
 
   // lockfree, only used in own thread
   ceph::buffer::list outgoing_bl;
+  unsigned outgoing_frames = 0;  ///< appended to outgoing_bl since the last send
   bool open_write = false;
 
   std::mutex write_lock;
@@ -19,6 +19,10 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <poll.h>
+#endif
 
 #include <algorithm>
 
@@ -37,16 +41,103 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   ceph::NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
 
+#ifdef HAVE_MSG_ZEROCOPY
+  PerfCounters *logger;
+  ZerocopyTracker zerocopy;
+
+  void zerocopy_complete(uint32_t lo, uint32_t hi, bool copied) {
+    if (copied) {
+      logger->inc(l_msgr_send_zerocopy_copied, hi - lo + 1);
+    }
+    zerocopy.complete(lo, hi, copied);
+  }
+
+  void zerocopy_reap() {
+    while (!zerocopy.empty()) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) +
+		   CMSG_SPACE(sizeof(struct sockaddr_in6))];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE) < 0) {
+	// EAGAIN: nothing has completed since we last looked
+	break;
+      }
+      for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+	  continue;
+	}
+	auto *serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+	  continue;
+	}
+	zerocopy_complete(serr->ee_info, serr->ee_data,
+			  serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+      }
+    }
+  }
+
+  // the kernel keeps reading from the buffers of a zero-copy send until
+  // the peer acked its data, which closing the socket does not wait for.
+  // give it a moment, then reset the connection, so that whatever it still
+  // has queued is dropped rather than sent from buffers we released.
+  void zerocopy_drain() {
+    static constexpr auto timeout = std::chrono::milliseconds(200);
+    auto deadline = ceph::mono_clock::now() + timeout;
+    zerocopy_reap();
+    while (!zerocopy.empty()) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+	deadline - ceph::mono_clock::now());
+      if (left.count() <= 0) {
+	break;
+      }
+      // the completions are reported as POLLERR
+      struct pollfd pfd = {_fd, 0, 0};
+      if (::poll(&pfd, 1, left.count()) < 0 && errno != EINTR) {
+	break;
+      }
+      zerocopy_reap();
+    }
+    if (!zerocopy.empty()) {
+      logger->inc(l_msgr_send_zerocopy_reset);
+      struct linger l = {1, 0};
+      ::setsockopt(_fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+    }
+  }
+#endif
+
  public:
   explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
-				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+				    int f, bool connected, Worker *w)
+      : handler(h), _fd(f), sa(sa), connected(connected) {
+#ifdef HAVE_MSG_ZEROCOPY
+    logger = w->get_perf_counter();
+    if (w->cct->_conf.get_val<bool>("ms_tcp_zerocopy")) {
+      int on = 1;
+      if (::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0) {
+	zerocopy.enabled = true;
+	zerocopy.min_bytes =
+	  w->cct->_conf.get_val<Option::size_t>("ms_tcp_zerocopy_min_bytes");
+      } else {
+	ldout(w->cct, 1) << __func__ << " SO_ZEROCOPY: "
+			 << cpp_strerror(ceph_sock_errno()) << dendl;
+      }
+    }
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -64,6 +155,10 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    #ifdef HAVE_MSG_ZEROCOPY
+    // the completions wake us up as errors, so we look for them here
+    zerocopy_reap();
+    #endif
     #ifdef _WIN32
     ssize_t r = ::recv(_fd, buf, len, 0);
     #else
@@ -77,13 +172,20 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   // return the sent length
   // < 0 means error occurred
   #ifndef _WIN32
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+		     bool zc)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+      #ifdef HAVE_MSG_ZEROCOPY
+      if (zc) {
+        flags |= MSG_ZEROCOPY;
+      }
+      #endif
+      r = ::sendmsg(fd, &msg, flags);
       if (r < 0) {
         int err = ceph_sock_errno();
         if (err == EINTR) {
@@ -91,8 +193,23 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         } else if (err == EAGAIN) {
           break;
         }
+        #ifdef HAVE_MSG_ZEROCOPY
+        if (zc && ZerocopyTracker::retry_with_copy(err)) {
+          logger->inc(l_msgr_send_zerocopy_fallback);
+          zc = false;
+          continue;
+        }
+        #endif
         return -err;
       }
+      #ifdef HAVE_MSG_ZEROCOPY
+      if (zc) {
+        // every successful MSG_ZEROCOPY sendmsg gets the next id
+        zerocopy.sent();
+        logger->inc(l_msgr_send_zerocopy);
+        logger->inc(l_msgr_send_zerocopy_bytes, r);
+      }
+      #endif
 
       sent += r;
       if (len == sent) break;
@@ -114,6 +231,10 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(ceph::buffer::list &bl, bool more) override {
+    #ifdef HAVE_MSG_ZEROCOPY
+    zerocopy_reap();
+    uint32_t zerocopy_first = zerocopy.get_next();
+    #endif
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
@@ -133,7 +254,11 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      bool zc = false;
+      #ifdef HAVE_MSG_ZEROCOPY
+      zc = zerocopy.want(msglen);
+      #endif
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, zc);
       if (r < 0)
         return r;
 
@@ -144,6 +269,21 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
       // only "r" == 0 continue
     }
 
+    #ifdef HAVE_MSG_ZEROCOPY
+    if (zerocopy.get_next() != zerocopy_first) {
+      // hold on to what we sent until the kernel is done with it.  this
+      // may keep a few bytes that were copied too, which does no harm.
+      ceph::buffer::list sent;
+      if (sent_bytes < bl.length()) {
+        bl.splice(0, sent_bytes, &sent);
+      } else {
+        sent.swap(bl);
+      }
+      zerocopy.hold(zerocopy_first, std::move(sent));
+      return static_cast<ssize_t>(sent_bytes);
+    }
+    #endif
+
     if (sent_bytes) {
       ceph::buffer::list swapped;
       if (sent_bytes < bl.length()) {
@@ -204,6 +344,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     ::shutdown(_fd, SHUT_RDWR);
   }
   void close() override {
+    #ifdef HAVE_MSG_ZEROCOPY
+    zerocopy_drain();
+    #endif
     compat_closesocket(_fd);
   }
   void set_priority(int sd, int prio, int domain) override {
@@ -262,7 +405,7 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true, w));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -331,7 +474,7 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock, this)));
   return 0;
 }
 
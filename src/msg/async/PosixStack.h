@@ -17,13 +17,95 @@
 #ifndef CEPH_MSG_ASYNC_POSIXSTACK_H
 #define CEPH_MSG_ASYNC_POSIXSTACK_H
 
+#include <errno.h>
+
+#include <algorithm>
+#include <deque>
 #include <thread>
 
+#include "include/buffer.h"
 #include "msg/msg_types.h"
 #include "msg/async/net_handler.h"
 
 #include "Stack.h"
 
+/**
+ * Book-keeping of the MSG_ZEROCOPY sends of a socket.  The kernel numbers
+ * such sends from 0 and reports the ranges of ids it is done with on the
+ * socket error queue; until then it may still read from the buffers they
+ * sent, so those are held here.
+ */
+class ZerocopyTracker {
+  struct Send {
+    uint32_t first;        ///< id of the first sendmsg
+    uint32_t count;        ///< number of sendmsgs
+    uint32_t remaining;    ///< those not completed yet
+    ceph::buffer::list bl; ///< the data they sent
+  };
+  uint32_t next;           ///< id of our next MSG_ZEROCOPY sendmsg
+  std::deque<Send> pending;
+
+ public:
+  bool enabled = false;
+  unsigned min_bytes = 0;
+
+  explicit ZerocopyTracker(uint32_t next = 0) : next(next) {}
+
+  /// should a sendmsg of len bytes go zero-copy?
+  bool want(unsigned len) const {
+    return enabled && len >= min_bytes;
+  }
+  /// should a zero-copy sendmsg that failed with err be retried with a copy?
+  static bool retry_with_copy(int err) {
+    // out of optmem for the notifications
+    return err == ENOBUFS;
+  }
+  /// a zero-copy sendmsg succeeded, and got the next id
+  void sent() {
+    ++next;
+  }
+  uint32_t get_next() const {
+    return next;
+  }
+  /// hold bl, the data of the zero-copy sendmsgs since first
+  void hold(uint32_t first, ceph::buffer::list&& bl) {
+    if (next != first) {
+      uint32_t count = next - first;
+      pending.push_back(Send{first, count, count, std::move(bl)});
+    }
+  }
+  /// the kernel is done with sendmsgs lo..hi, and had to copy their data
+  /// if copied
+  void complete(uint32_t lo, uint32_t hi, bool copied) {
+    if (copied) {
+      // the kernel could not avoid the copy (loopback, a device without
+      // scatter-gather...), so stop paying for the notifications
+      enabled = false;
+    }
+    // the ids wrap, and the ranges usually but not always complete in
+    // order
+    for (auto& p : pending) {
+      int64_t begin = std::max<int64_t>((int32_t)(lo - p.first), 0);
+      int64_t end = std::min<int64_t>((int32_t)(hi - p.first), p.count - 1);
+      if (end >= begin) {
+	p.remaining -= std::min<int64_t>(end - begin + 1, p.remaining);
+      }
+    }
+    std::erase_if(pending, [](const Send& p) { return p.remaining == 0; });
+  }
+  bool empty() const {
+    return pending.empty();
+  }
+  /// bytes held for sends the kernel has not completed
+  uint64_t get_pending_bytes() const {
+    uint64_t bytes = 0;
+    for (auto& p : pending) {
+      bytes += p.bl.length();
+    }
+    return bytes;
+  }
+};
+
 class PosixWorker : public Worker {
   ceph::NetHandler net;
   void initialize() override;
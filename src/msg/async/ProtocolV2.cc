@@ -100,8 +100,14 @@ ProtocolV2::ProtocolV2(AsyncConnection *connection)
                    &session_compression_handlers),
       rx_frame_asm(&session_stream_handlers, false, cct->_conf->ms_crc_data,
                    &session_compression_handlers),
+      rx_buffer_pool(cct->lookup_or_create_singleton_object<RxBufferPool>(
+                       "AsyncMessenger::RxBufferPool", false, cct)),
       next_tag(static_cast<Tag>(0)),
-      keepalive(false) {
+      keepalive(false),
+      tx_batch_max_bytes(
+        cct->_conf.get_val<Option::size_t>("ms_async_send_batch_max_bytes")),
+      tx_batch_max_latency(std::chrono::microseconds(
+        cct->_conf.get_val<uint64_t>("ms_async_send_batch_max_latency_us"))) {
 }
 
 ProtocolV2::~ProtocolV2() {
@@ -543,6 +549,9 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
 			     m->get_payload(),
 			     m->get_middle(),
 			     m->get_data());
+  if (!connection->is_queued()) {
+    tx_batch_start = ceph::mono_clock::now();
+  }
   if (!append_frame(message)) {
     m->put();
     return -EILSEQ;
@@ -556,17 +565,18 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " src=" << entity_name_t(messenger->get_myname())
                  << " off=" << header2.data_off
                  << dendl;
-  ssize_t total_send_size = connection->outgoing_bl.length();
-  ssize_t rc = connection->_try_send(more);
-  if (rc < 0) {
+  ssize_t rc = 0;
+  if (more &&
+      connection->outgoing_bl.length() < tx_batch_max_bytes &&
+      ceph::mono_clock::now() - tx_batch_start < tx_batch_max_latency) {
+    // the next message goes out in the same send
+    ldout(cct, 20) << __func__ << " batching " << m << ", "
+                   << connection->outgoing_bl.length() << " bytes queued"
+                   << dendl;
+  } else if (rc = send_queued(more); rc < 0) {
     ldout(cct, 1) << __func__ << " error sending " << m << ", "
                   << cpp_strerror(rc) << dendl;
   } else {
-    const auto sent_bytes = total_send_size - connection->outgoing_bl.length();
-    connection->logger->inc(l_msgr_send_bytes, sent_bytes);
-    if (session_stream_handlers.tx) {
-      connection->logger->inc(l_msgr_send_encrypted_bytes, sent_bytes);
-    }
     ldout(cct, 10) << __func__ << " sending " << m
                    << (rc ? " continuely." : " done.") << dendl;
   }
@@ -582,6 +592,21 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
   return rc;
 }
 
+// send what is queued in outgoing_bl, which may be the frames of several
+// messages batched up by write_message(), and account for the bytes sent
+ssize_t ProtocolV2::send_queued(bool more) {
+  const auto total_send_size = connection->outgoing_bl.length();
+  ssize_t r = connection->_try_send(more);
+  if (r >= 0) {
+    const auto sent_bytes = total_send_size - connection->outgoing_bl.length();
+    connection->logger->inc(l_msgr_send_bytes, sent_bytes);
+    if (session_stream_handlers.tx) {
+      connection->logger->inc(l_msgr_send_encrypted_bytes, sent_bytes);
+    }
+  }
+  return r;
+}
+
 template <class F>
 bool ProtocolV2::append_frame(F& frame) {
   ceph::bufferlist bl;
@@ -595,6 +620,7 @@ bool ProtocolV2::append_frame(F& frame) {
   ldout(cct, 25) << __func__ << " assembled frame " << bl.length()
                  << " bytes " << tx_frame_asm << dendl;
   connection->outgoing_bl.claim_append(bl);
+  connection->outgoing_frames++;
   return true;
 }
 
@@ -655,14 +681,11 @@ void ProtocolV2::write_event() {
 
     auto start = ceph::mono_clock::now();
     bool more;
-    do {
-      if (connection->is_queued()) {
-	if (r = connection->_try_send(); r!= 0) {
-	  // either fails to send or not all queued buffer is sent
-	  break;
-	}
-      }
-
+    if (connection->is_queued()) {
+      // either fails to send or not all queued buffer is sent if r != 0
+      r = send_queued();
+    }
+    while (r == 0 && can_write) {
       const auto out_entry = _get_next_outgoing();
       if (!out_entry.m) {
         break;
@@ -700,7 +723,7 @@ void ProtocolV2::write_event() {
 	// when the outbound socket is writeable again
         break;
       }
-    } while (can_write);
+    }
     write_in_progress = false;
 
     // if r > 0 mean data still lefted, so no need _try_send.
@@ -713,12 +736,13 @@ void ProtocolV2::write_event() {
         if (append_frame(ack_frame)) {
           ack_left -= left;
           left = ack_left;
-          r = connection->_try_send(left);
+          r = send_queued(left);
         } else {
           r = -EILSEQ;
         }
       } else if (is_queued()) {
-        r = connection->_try_send();
+        // flush the batch write_message() left queued
+        r = send_queued();
       }
     }
     connection->write_lock.unlock();
@@ -1189,8 +1213,8 @@ CtPtr ProtocolV2::read_frame_segment() {
   rx_buffer_t rx_buffer;
   uint16_t align = rx_frame_asm.get_segment_align(seg_idx);
   try {
-    rx_buffer = ceph::buffer::ptr_node::create(ceph::buffer::create_aligned(
-        onwire_len, align));
+    rx_buffer = ceph::buffer::ptr_node::create(
+        rx_buffer_pool.create(onwire_len, align));
   } catch (const ceph::buffer::bad_alloc&) {
     // Catching because of potential issues with satisfying alignment.
     ldout(cct, 1) << __func__ << " can't allocate aligned rx_buffer"
@@ -9,6 +9,7 @@
 #include "compression_meta.h"
 #include "compression_onwire.h"
 #include "frames_v2.h"
+#include "RxBufferPool.h"
 
 class ProtocolV2 : public Protocol {
 private:
@@ -104,6 +105,7 @@ private:
 
   ceph::msgr::v2::FrameAssembler tx_frame_asm;
   ceph::msgr::v2::FrameAssembler rx_frame_asm;
+  RxBufferPool& rx_buffer_pool;
 
   ceph::bufferlist rx_preamble;
   ceph::bufferlist rx_epilogue;
@@ -122,6 +124,12 @@ private:
   bool keepalive;
   bool write_in_progress = false;
 
+  // while more messages are queued their frames are gathered into a
+  // single send, up to these many bytes or this long after the first
+  uint64_t tx_batch_max_bytes;
+  ceph::timespan tx_batch_max_latency;
+  ceph::mono_time tx_batch_start;
+
   CompConnectionMeta comp_meta;
   std::ostream& _conn_prefix(std::ostream *_dout);
   void run_continuation(Ct<ProtocolV2> *pcontinuation);
@@ -151,6 +159,7 @@ private:
   void prepare_send_message(uint64_t features, Message *m);
   out_queue_entry_t _get_next_outgoing();
   ssize_t write_message(Message *m, bool more);
+  ssize_t send_queued(bool more = false);
   void handle_message_ack(uint64_t seq);
   void reset_compression();
 
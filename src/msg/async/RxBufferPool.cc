@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <bit>
+#include <cstdlib>
+
+#include "RxBufferPool.h"
+#include "common/ceph_context.h"
+#include "common/deleter.h"
+#include "include/intarith.h"
+#include "include/page.h"
+
+RxBufferPool::Cache::~Cache()
+{
+  for (auto& [size, bufs] : free) {
+    for (auto buf : bufs) {
+      std::free(buf);
+    }
+  }
+}
+
+char *RxBufferPool::Cache::get(unsigned size)
+{
+  std::lock_guard l(lock);
+  auto p = free.find(size);
+  if (p == free.end() || p->second.empty()) {
+    return nullptr;
+  }
+  char *buf = p->second.back();
+  p->second.pop_back();
+  bytes -= size;
+  return buf;
+}
+
+void RxBufferPool::Cache::put(char *buf, unsigned size)
+{
+  {
+    std::lock_guard l(lock);
+    if (bytes + size <= max_bytes) {
+      free[size].push_back(buf);
+      bytes += size;
+      return;
+    }
+  }
+  std::free(buf);
+}
+
+RxBufferPool::RxBufferPool(CephContext *cct)
+  : cache(std::make_shared<Cache>(
+      cct->_conf.get_val<Option::size_t>("ms_rx_buffer_pool_size"))),
+    min_size(cct->_conf.get_val<Option::size_t>("ms_rx_buffer_pool_min_size"))
+{
+}
+
+ceph::unique_leakable_ptr<ceph::buffer::raw> RxBufferPool::create(
+  unsigned len,
+  unsigned align)
+{
+  if (len < min_size || align > CEPH_PAGE_SIZE || !cache->max_bytes) {
+    return ceph::buffer::create_aligned(len, align);
+  }
+  // round up to pages and to an eighth of the power of two below, so
+  // that segments of about the same size share buffers
+  unsigned size = p2roundup<unsigned>(
+    len, std::max<unsigned>(CEPH_PAGE_SIZE, std::bit_floor(len) / 8));
+  char *buf = cache->get(size);
+  if (!buf) {
+    buf = static_cast<char*>(std::aligned_alloc(CEPH_PAGE_SIZE, size));
+    if (!buf) {
+      throw ceph::buffer::bad_alloc();
+    }
+  }
+  return ceph::buffer::claim_buffer(
+    len, buf, make_deleter([cache = cache, buf, size] {
+      cache->put(buf, size);
+    }));
+}
+
+uint64_t RxBufferPool::free_bytes() const
+{
+  std::lock_guard l(cache->lock);
+  return cache->bytes;
+}
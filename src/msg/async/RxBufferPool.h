@@ -0,0 +1,51 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_MSG_ASYNC_RX_BUFFER_POOL_H
+#define CEPH_MSG_ASYNC_RX_BUFFER_POOL_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+#include "include/common_fwd.h"
+
+/// page aligned buffers to receive large frame segments into
+///
+/// A 4MB write payload that is allocated afresh for every message is
+/// mmap()ed, faulted in a page at a time and unmapped again once the
+/// OSD is done with it.  Instead, when the last reference to one of
+/// these buffers goes away its memory goes back to the pool, up to
+/// ms_rx_buffer_pool_size bytes of it, for the next segment of about
+/// the same size.  Being page aligned, the data can go on to the block
+/// device with O_DIRECT as it is.
+class RxBufferPool {
+  struct Cache {
+    ceph::mutex lock = ceph::make_mutex("RxBufferPool::Cache::lock");
+    std::map<unsigned, std::vector<char*>> free;  ///< by allocated size
+    uint64_t bytes = 0;      ///< in free
+    uint64_t max_bytes;
+
+    explicit Cache(uint64_t max_bytes) : max_bytes(max_bytes) {}
+    ~Cache();
+
+    char *get(unsigned size);
+    void put(char *buf, unsigned size);
+  };
+  std::shared_ptr<Cache> cache;
+  unsigned min_size;
+
+public:
+  explicit RxBufferPool(CephContext *cct);
+
+  /// a buffer of len bytes aligned to align
+  ceph::unique_leakable_ptr<ceph::buffer::raw> create(unsigned len,
+						      unsigned align);
+
+  /// bytes of released buffers held for reuse
+  uint64_t free_bytes() const;
+};
+
+#endif
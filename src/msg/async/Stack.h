@@ -213,6 +213,14 @@ enum {
   l_msgr_recv_encrypted_bytes,
   l_msgr_send_encrypted_bytes,
 
+  l_msgr_send_zerocopy,
+  l_msgr_send_zerocopy_bytes,
+  l_msgr_send_zerocopy_copied,
+  l_msgr_send_zerocopy_fallback,
+  l_msgr_send_zerocopy_reset,
+
+  l_msgr_send_frames_per_call,
+
   l_msgr_last,
 };
 
@@ -271,6 +279,14 @@ class Worker {
     plb.add_u64_counter(l_msgr_recv_encrypted_bytes, "msgr_recv_encrypted_bytes", "Network received encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_encrypted_bytes, "msgr_send_encrypted_bytes", "Network sent encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
 
+    plb.add_u64_counter(l_msgr_send_zerocopy, "msgr_send_zerocopy", "Network sends made with MSG_ZEROCOPY");
+    plb.add_u64_counter(l_msgr_send_zerocopy_bytes, "msgr_send_zerocopy_bytes", "Network bytes sent with MSG_ZEROCOPY", NULL, 0, unit_t(UNIT_BYTES));
+    plb.add_u64_counter(l_msgr_send_zerocopy_copied, "msgr_send_zerocopy_copied", "MSG_ZEROCOPY sends the kernel copied anyway");
+    plb.add_u64_counter(l_msgr_send_zerocopy_fallback, "msgr_send_zerocopy_fallback", "MSG_ZEROCOPY sends retried with a copy for lack of buffers");
+    plb.add_u64_counter(l_msgr_send_zerocopy_reset, "msgr_send_zerocopy_reset", "Sockets reset on close with MSG_ZEROCOPY sends still in flight");
+
+    plb.add_u64_avg(l_msgr_send_frames_per_call, "msgr_send_frames_per_call", "Frames written per socket send call");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
 
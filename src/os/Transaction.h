@@ -235,6 +235,12 @@ private:
   std::map<coll_t, uint32_t> coll_index;
   std::map<ghobject_t, uint32_t> object_index;
 
+  // the entries of coll_index and object_index as they are encoded on
+  // the wire, in the order they were added (or received), so that
+  // encode() only has to reference them
+  ceph::buffer::list coll_index_bl;
+  ceph::buffer::list object_index_bl;
+
   uint32_t coll_id = 0;
   uint32_t object_id = 0;
 
@@ -261,6 +267,8 @@ public:
     data(std::move(other.data)),
     coll_index(std::move(other.coll_index)),
     object_index(std::move(other.object_index)),
+    coll_index_bl(std::move(other.coll_index_bl)),
+    object_index_bl(std::move(other.object_index_bl)),
     coll_id(other.coll_id),
     object_id(other.object_id),
     data_bl(std::move(other.data_bl)),
@@ -276,6 +284,8 @@ public:
     data = std::move(other.data);
     coll_index = std::move(other.coll_index);
     object_index = std::move(other.object_index);
+    coll_index_bl = std::move(other.coll_index_bl);
+    object_index_bl = std::move(other.object_index_bl);
     coll_id = other.coll_id;
     object_id = other.object_id;
     data_bl = std::move(other.data_bl);
@@ -396,6 +406,8 @@ public:
 
     std::swap(coll_index, other.coll_index);
     std::swap(object_index, other.object_index);
+    coll_index_bl.swap(other.coll_index_bl);
+    object_index_bl.swap(other.object_index_bl);
     std::swap(coll_id, other.coll_id);
     std::swap(object_id, other.object_id);
     op_bl.swap(other.op_bl);
@@ -578,18 +590,8 @@ public:
     // all here, so they may be computed at compile-time
     size_t final_size = sizeof(__u32) * 2 + sizeof(data);
 
-    // coll_index second and object_index second
-    final_size += (coll_index.size() + object_index.size()) * sizeof(__u32);
-
-    // coll_index first
-    for (auto p = coll_index.begin(); p != coll_index.end(); ++p) {
-	final_size += p->first.encoded_size();
-    }
-
-    // object_index first
-    for (auto p = object_index.begin(); p != object_index.end(); ++p) {
-	final_size += p->first.encoded_size();
-    }
+    // coll_index and object_index entries, already encoded
+    final_size += coll_index_bl.length() + object_index_bl.length();
 
     return data_bl.length() +
 	op_bl.length() +
@@ -656,7 +658,9 @@ public:
     Transaction *t;
 
     uint64_t ops;
-    char* op_buffer_p;
+    // walks op_bl in place rather than rebuilding it contiguous
+    ceph::buffer::list::iterator op_bl_p;
+    Op op_split;  // an op straddling two buffers of op_bl
 
     ceph::buffer::list::const_iterator data_bl_p;
 
@@ -667,12 +671,12 @@ public:
   private:
     explicit iterator(Transaction *t)
       : t(t),
+	  op_bl_p(t->op_bl.begin()),
 	  data_bl_p(t->data_bl.cbegin()),
         colls(t->coll_index.size()),
         objects(t->object_index.size()) {
 
       ops = t->data.ops;
-      op_buffer_p = t->op_bl.c_str();
 
       std::map<coll_t, uint32_t>::iterator coll_index_p;
       for (coll_index_p = t->coll_index.begin();
@@ -699,8 +703,19 @@ public:
     Op* decode_op() {
       ceph_assert(ops > 0);
 
-      Op* op = reinterpret_cast<Op*>(op_buffer_p);
-      op_buffer_p += sizeof(Op);
+      const char* p;
+      size_t len = op_bl_p.get_ptr_and_advance(sizeof(Op), &p);
+      Op* op;
+      if (len == sizeof(Op)) {
+	op = reinterpret_cast<Op*>(const_cast<char*>(p));
+      } else {
+	// only happens for a decoded transaction whose op_bl was split
+	// by the messenger
+	char* split = reinterpret_cast<char*>(&op_split);
+	memcpy(split, p, len);
+	op_bl_p.copy(sizeof(Op) - len, split + len);
+	op = &op_split;
+      }
       ops--;
 
       return op;
@@ -785,8 +800,11 @@ private:
     if (c != coll_index.end())
       return c->second;
 
+    using ceph::encode;
     uint32_t index_id = coll_id++;
     coll_index[coll] = index_id;
+    encode(coll, coll_index_bl);
+    encode(index_id, coll_index_bl);
     return index_id;
   }
   uint32_t _get_object_id(const ghobject_t& oid) {
@@ -794,8 +812,11 @@ private:
     if (o != object_index.end())
       return o->second;
 
+    using ceph::encode;
     uint32_t index_id = object_id++;
     object_index[oid] = index_id;
+    encode(oid, object_index_bl);
+    encode(index_id, object_index_bl);
     return index_id;
   }
 
@@ -1272,11 +1293,15 @@ public:
 
   void encode(ceph::buffer::list& bl) const {
     //layout: data_bl + op_bl + coll_index + object_index + data
+    // nothing is encoded one element at a time: the payloads and the
+    // index entries are appended by reference
     ENCODE_START(9, 9, bl);
     encode(data_bl, bl);
     encode(op_bl, bl);
-    encode(coll_index, bl);
-    encode(object_index, bl);
+    encode((__u32)coll_index.size(), bl);
+    bl.append(coll_index_bl);
+    encode((__u32)object_index.size(), bl);
+    bl.append(object_index_bl);
     data.encode(bl);
     ENCODE_FINISH(bl);
   }
@@ -1287,8 +1312,8 @@ public:
 
     decode(data_bl, bl);
     decode(op_bl, bl);
-    decode(coll_index, bl);
-    decode(object_index, bl);
+    _decode_index(coll_index, coll_index_bl, bl);
+    _decode_index(object_index, object_index_bl, bl);
     data.decode(bl);
     coll_id = coll_index.size();
     object_id = object_index.size();
@@ -1296,6 +1321,19 @@ public:
     DECODE_FINISH(bl);
   }
 
+  /// decode an index map, keeping its entries as received in index_bl
+  template <typename T>
+  static void _decode_index(std::map<T, uint32_t>& index,
+			    ceph::buffer::list& index_bl,
+			    ceph::buffer::list::const_iterator &bl) {
+    using ceph::decode;
+    auto start = bl;
+    decode(index, bl);
+    start += sizeof(__u32);
+    index_bl.clear();
+    start.copy(bl.get_off() - start.get_off(), index_bl);
+  }
+
   void dump(ceph::Formatter *f);
   static void generate_test_instances(std::list<Transaction*>& o);
 };
@@ -3,13 +3,17 @@
 
 #include "Allocator.h"
 #include <bit>
+#include <fstream>
 #include "StupidAllocator.h"
 #include "BitmapAllocator.h"
 #include "AvlAllocator.h"
 #include "BtreeAllocator.h"
 #include "HybridAllocator.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
 #include "common/debug.h"
 #include "common/admin_socket.h"
+#include "common/errno.h"
 #define dout_subsys ceph_subsys_bluestore
 using TOPNSPC::common::cmd_getval;
 
@@ -57,6 +61,18 @@ public:
 	  this,
 	  "build allocator free regions state histogram");
         ceph_assert(r == 0);
+        r = admin_socket->register_command(
+	  ("bluestore allocator trace start " + name +
+           " name=path,type=CephString" +
+           " name=max_ops,type=CephInt,req=false").c_str(),
+	  this,
+	  "start tracing allocations and releases to a file");
+        ceph_assert(r == 0);
+        r = admin_socket->register_command(
+	  ("bluestore allocator trace stop " + name).c_str(),
+	  this,
+	  "stop tracing allocations and releases");
+        ceph_assert(r == 0);
       }
     }
   }
@@ -138,6 +154,18 @@ public:
         f->close_section();
       }
       f->close_section();
+    } else if (command == "bluestore allocator trace start " + name) {
+      std::string path;
+      cmd_getval(cmdmap, "path", path);
+      int64_t max_ops = 0;
+      cmd_getval(cmdmap, "max_ops", max_ops);
+      if (max_ops < 0) {
+        ss << "Invalid max_ops: " << max_ops << std::endl;
+        return -EINVAL;
+      }
+      r = alloc->start_trace(path, max_ops, ss);
+    } else if (command == "bluestore allocator trace stop " + name) {
+      r = alloc->stop_trace(ss);
     } else {
       ss << "Invalid command" << std::endl;
       r = -ENOSYS;
@@ -146,6 +174,32 @@ public:
   }
 
 };
+/*
+ * Text trace of allocator activity, one record per line, numbers in hex:
+ *
+ *   h <type> <capacity> <block_size>
+ *   f <offset> <length>                  free extent when tracing started
+ *   a <nsec> <want> <unit> <max_alloc_size> <hint> <result> [<off>~<len> ...]
+ *   r <nsec> <off>~<len> [<off>~<len> ...]
+ *
+ * <nsec> is the time since the start of the trace.  A negative result
+ * is printed as a negative decimal errno.
+ */
+class Allocator::Tracer {
+public:
+  ceph::mutex lock = ceph::make_mutex("Allocator::Tracer::lock");
+  std::ofstream out;
+  std::string path;
+  ceph::mono_time start;
+  uint64_t ops = 0;
+  uint64_t max_ops = 0;   ///< stop after this many records, 0 = no limit
+
+  uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      ceph::mono_clock::now() - start).count();
+  }
+};
+
 Allocator::Allocator(std::string_view name,
                      int64_t _capacity,
                      int64_t _block_size)
@@ -165,6 +219,120 @@ const string& Allocator::get_name() const {
   return asok_hook->name;
 }
 
+int Allocator::start_trace(const std::string& path, uint64_t max_ops,
+			   std::ostream& ss)
+{
+  if (!tracer) {
+    tracer = std::make_unique<Tracer>();
+  }
+  // snapshot the free space without holding the tracer lock: the
+  // implementation lock is taken ahead of it by traced operations
+  std::vector<std::pair<uint64_t, uint64_t>> free;
+  foreach([&](uint64_t off, uint64_t len) {
+    free.emplace_back(off, len);
+  });
+
+  std::lock_guard l(tracer->lock);
+  if (tracing) {
+    ss << "already tracing to " << tracer->path << std::endl;
+    return -EBUSY;
+  }
+  tracer->out.open(path, std::ios::out | std::ios::trunc);
+  if (!tracer->out.is_open()) {
+    int r = -errno;
+    ss << "unable to open " << path << ": " << cpp_strerror(r) << std::endl;
+    return r;
+  }
+  tracer->path = path;
+  tracer->ops = 0;
+  tracer->max_ops = max_ops;
+  tracer->start = ceph::mono_clock::now();
+  auto& out = tracer->out;
+  out << std::hex << "h " << get_type() << " " << get_capacity() << " "
+      << get_block_size() << "\n";
+  for (auto& [off, len] : free) {
+    out << "f " << off << " " << len << "\n";
+  }
+  // operations that completed between the snapshot and this point are
+  // lost; the replay tool tolerates the resulting inconsistencies
+  tracing = true;
+  ss << "tracing to " << path << std::endl;
+  return 0;
+}
+
+int Allocator::stop_trace(std::ostream& ss)
+{
+  if (!tracer) {
+    ss << "not tracing" << std::endl;
+    return 0;
+  }
+  std::lock_guard l(tracer->lock);
+  if (!tracing) {
+    ss << "not tracing" << std::endl;
+    return 0;
+  }
+  tracing = false;
+  tracer->out.close();
+  ss << "traced " << tracer->ops << " operations to " << tracer->path
+     << std::endl;
+  return 0;
+}
+
+void Allocator::_trace_allocate(uint64_t want, uint64_t unit,
+				uint64_t max_alloc_size, int64_t hint,
+				int64_t result, const PExtentVector& extents,
+				size_t first)
+{
+  std::lock_guard l(tracer->lock);
+  if (!tracing) {
+    return;
+  }
+  auto& out = tracer->out;
+  out << std::hex << "a " << tracer->now() << " " << want << " " << unit
+      << " " << max_alloc_size << " " << hint << " ";
+  if (result < 0) {
+    out << std::dec << result;
+  } else {
+    out << result;
+    uint64_t appended = 0;
+    for (size_t i = first; i < extents.size(); ++i) {
+      appended += extents[i].length;
+    }
+    if (appended < (uint64_t)result && first > 0) {
+      // the rest was merged into the caller's last extent
+      auto& e = extents[first - 1];
+      uint64_t merged = result - appended;
+      out << " " << e.end() - merged << "~" << merged;
+    }
+    for (size_t i = first; i < extents.size(); ++i) {
+      out << " " << extents[i].offset << "~" << extents[i].length;
+    }
+  }
+  out << "\n";
+  if (++tracer->ops == tracer->max_ops) {
+    tracing = false;
+    tracer->out.close();
+  }
+}
+
+void Allocator::_trace_release(const interval_set<uint64_t>& release_set)
+{
+  std::lock_guard l(tracer->lock);
+  if (!tracing) {
+    return;
+  }
+  auto& out = tracer->out;
+  out << std::hex << "r " << tracer->now();
+  for (auto p = release_set.begin(); p != release_set.end(); ++p) {
+    out << " " << p.get_start() << "~" << p.get_len();
+  }
+  out << "\n";
+  if (++tracer->ops == tracer->max_ops) {
+    tracing = false;
+    tracer->out.close();
+  }
+}
+
 Allocator *Allocator::create(
   CephContext* cct,
   std::string_view type,
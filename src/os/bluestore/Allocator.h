@@ -12,7 +12,9 @@
 #ifndef CEPH_OS_BLUESTORE_ALLOCATOR_H
 #define CEPH_OS_BLUESTORE_ALLOCATOR_H
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <ostream>
 #include "include/ceph_assert.h"
 #include "bluestore_types.h"
@@ -117,12 +119,51 @@ public:
   typedef std::vector<free_state_hist_bucket> FreeStateHistogram;
   void build_free_state_histogram(size_t alloc_unit, FreeStateHistogram& hist);
 
+  // Allocation tracing, toggled with the "bluestore allocator trace"
+  // admin socket commands.  The trace starts with the free extents at
+  // the time tracing was enabled, followed by every allocate/release,
+  // and can be replayed against any allocator with
+  // ceph_test_alloc_replay.
+  int start_trace(const std::string& path, uint64_t max_ops,
+		  std::ostream& ss);
+  int stop_trace(std::ostream& ss);
+  bool is_tracing() const {
+    return tracing.load(std::memory_order_relaxed);
+  }
+
 private:
   class SocketHook;
   SocketHook* asok_hook = nullptr;
+  class Tracer;
+  std::unique_ptr<Tracer> tracer;
+  std::atomic<bool> tracing = {false};
+
+  void _trace_allocate(uint64_t want, uint64_t unit, uint64_t max_alloc_size,
+		       int64_t hint, int64_t result,
+		       const PExtentVector& extents, size_t first);
+  void _trace_release(const interval_set<uint64_t>& release_set);
+
 protected:
   const int64_t device_size = 0;
   const int64_t block_size = 0;
+
+  // Implementations call these from allocate() after the allocation is
+  // done and from release() before the space is returned, so that a
+  // release is always traced ahead of any allocation reusing its space.
+  // extents[first..] are the extents returned by this call.
+  void trace_allocate(uint64_t want, uint64_t unit, uint64_t max_alloc_size,
+		      int64_t hint, int64_t result,
+		      const PExtentVector& extents, size_t first) {
+    if (is_tracing()) {
+      _trace_allocate(want, unit, max_alloc_size, hint, result, extents,
+		      first);
+    }
+  }
+  void trace_release(const interval_set<uint64_t>& release_set) {
+    if (is_tracing()) {
+      _trace_release(release_set);
+    }
+  }
 };
 
 #endif
@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 #include <chrono>
+#include <deque>
 #include "boost/algorithm/string.hpp" 
 #include "bluestore_common.h"
 #include "BlueFS.h"
@@ -10,6 +11,7 @@
 #include "common/perf_counters.h"
 #include "Allocator.h"
 #include "include/ceph_assert.h"
+#include "include/random.h"
 #include "common/admin_socket.h"
 
 #define dout_context cct
@@ -451,6 +453,19 @@ void BlueFS::_init_logger()
              "Max allocation latency for primary/shared device",
              "asxt",
              PerfCountersBuilder::PRIO_INTERESTING);
+  b.add_u64(l_bluefs_replay_txns, "replay_txns",
+	    "Transactions replayed from the log at the last mount");
+  b.add_u64(l_bluefs_replay_bytes, "replay_bytes",
+	    "Size of the log replayed at the last mount",
+	    NULL, 0, unit_t(UNIT_BYTES));
+  b.add_time(l_bluefs_replay_read_time, "replay_read_time",
+             "Time spent reading the log at the last mount");
+  b.add_time(l_bluefs_replay_decode_time, "replay_decode_time",
+             "Time spent decoding log transactions at the last mount");
+  b.add_time(l_bluefs_replay_apply_time, "replay_apply_time",
+             "Time spent applying log transactions at the last mount");
+  b.add_u64(l_bluefs_replay_prefetch_chunks, "replay_prefetch_chunks",
+	    "Log chunks served by replay read-ahead at the last mount");
 
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
@@ -999,6 +1014,22 @@ int BlueFS::mount()
     goto out;
   }
 
+  // the log does not follow the size of envelope-encoded files
+  bool has_envelope_files = false;
+  for (auto& p : nodes.file_map) {
+    if (p.second->fnode.is_wal_envelope()) {
+      has_envelope_files = true;
+      if (!super.has_feature(bluefs_super_t::FEATURE_WAL_ENVELOPE)) {
+	derr << __func__ << " envelope-encoded file " << p.second->fnode
+	     << " but superblock lacks the feature" << dendl;
+	r = -EIO;
+	_stop_alloc();
+	goto out;
+      }
+      _wal_envelope_recover(p.second);
+    }
+  }
+
   // init freelist
   for (auto& p : nodes.file_map) {
     dout(30) << __func__ << " noting alloc for " << p.second->fnode << dendl;
@@ -1032,6 +1063,19 @@ int BlueFS::mount()
            << dendl;
   // update log size
   logger->set(l_bluefs_log_bytes, log.writer->file->fnode.size);
+
+  // envelope-encoded files may only be created once the superblock says
+  // so, which older releases refuse to mount; drop the feature again once
+  // the option is off and no such file is left
+  bool want_envelope = cct->_conf.get_val<bool>("bluefs_wal_envelope_mode");
+  if (want_envelope != super.has_feature(bluefs_super_t::FEATURE_WAL_ENVELOPE) &&
+      (want_envelope || !has_envelope_files)) {
+    dout(1) << __func__ << (want_envelope ? " setting" : " clearing")
+	    << " wal envelope feature" << dendl;
+    super.features ^= bluefs_super_t::FEATURE_WAL_ENVELOPE;
+    _write_super(BDEV_DB);
+    _flush_bdev();
+  }
   return 0;
 
  out:
@@ -1240,6 +1284,139 @@ int BlueFS::_verify_alloc_granularity(
   return 0;
 }
 
+/**
+ * Keeps up to `depth` chunks of the log in flight as async device reads
+ * ahead of the replay position, so fetching the next chunk overlaps with
+ * decoding and applying the current one.  Completed chunks are handed to
+ * the FileReader's buffer, from which _read() then serves the replay.
+ *
+ * Read-ahead only follows extents already known from the log fnode; when
+ * replay extends the log (ino 1 updates) the next feed() picks up the new
+ * extents.
+ */
+struct BlueFS::LogReplayPrefetcher {
+  struct chunk_t {
+    uint64_t off = 0;  ///< logical offset within the log
+    uint64_t len = 0;
+    std::unique_ptr<IOContext> ioc;
+    bufferlist bl;
+  };
+
+  BlueFS *fs;
+  const uint64_t chunk_size;
+  const unsigned depth;
+  uint64_t next_off = 0;  ///< logical offset of the next chunk to issue
+  std::deque<chunk_t> inflight;
+
+  LogReplayPrefetcher(BlueFS *fs, uint64_t chunk_size, unsigned depth)
+    : fs(fs), chunk_size(chunk_size), depth(depth) {}
+  ~LogReplayPrefetcher() {
+    reset();
+  }
+
+  /// forget everything in flight; the next feed() restarts read-ahead
+  void reset() {
+    for (auto& c : inflight) {
+      c.ioc->aio_wait();
+    }
+    inflight.clear();
+  }
+
+  void issue(const bluefs_fnode_t& fnode) {
+    while (inflight.size() < depth) {
+      uint64_t x_off = 0;
+      auto p = fnode.seek(next_off, &x_off);
+      if (p == fnode.extents.end()) {
+	break;
+      }
+      auto& c = inflight.emplace_back();
+      c.off = next_off;
+      c.len = std::min(p->length - x_off, chunk_size);
+      c.ioc = std::make_unique<IOContext>(fs->cct, nullptr);
+      int r = fs->bdev[p->bdev]->aio_read(p->offset + x_off, c.len,
+					  &c.bl, c.ioc.get());
+      ceph_assert(r == 0);
+      if (c.ioc->has_pending_aios()) {
+	fs->bdev[p->bdev]->aio_submit(c.ioc.get());
+      }
+      next_off += c.len;
+    }
+  }
+
+  /// make the reader's buffer cover off, from read-ahead if possible
+  void feed(FileReader *h, uint64_t off) {
+    FileReaderBuffer *buf = &h->buf;
+    if (off >= buf->bl_off && off < buf->get_buf_end()) {
+      return;
+    }
+    while (!inflight.empty() &&
+	   inflight.front().off + inflight.front().len <= off) {
+      inflight.front().ioc->aio_wait();
+      inflight.pop_front();
+    }
+    if (inflight.empty() || inflight.front().off > off) {
+      // replay moved outside of the read-ahead window (e.g. op_jump)
+      reset();
+      next_off = off & fs->super.block_mask();
+      issue(h->file->fnode);
+      if (inflight.empty()) {
+	return;
+      }
+    }
+    auto& c = inflight.front();
+    c.ioc->aio_wait();
+    if (c.ioc->get_return_value() < 0) {
+      // let the synchronous path retry and report it
+      reset();
+      return;
+    }
+    {
+      std::unique_lock l(h->lock);
+      buf->bl = std::move(c.bl);
+      buf->bl.reassign_to_mempool(mempool::mempool_bluefs_file_reader);
+      buf->bl_off = c.off;
+    }
+    inflight.pop_front();
+    fs->logger->inc(l_bluefs_replay_prefetch_chunks);
+    issue(h->file->fnode);
+  }
+};
+
+int64_t BlueFS::_replay_read(
+  FileReader *h,
+  LogReplayPrefetcher *pf,
+  uint64_t off,
+  size_t len,
+  bufferlist *outbl)
+{
+  if (!pf) {
+    return _read(h, off, len, outbl, NULL);
+  }
+  // read chunk by chunk so that each refill comes from the read-ahead
+  outbl->clear();
+  int64_t ret = 0;
+  while (len > 0) {
+    pf->feed(h, off);
+    size_t l = len;
+    if (auto left = h->buf.get_buf_remaining(off); left) {
+      l = std::min<size_t>(l, left);
+    }
+    bufferlist t;
+    int64_t r = _read(h, off, l, &t, NULL);
+    if (r <= 0) {
+      break;
+    }
+    outbl->claim_append(t);
+    off += r;
+    len -= r;
+    ret += r;
+    if ((size_t)r < l) {
+      break;
+    }
+  }
+  return ret;
+}
+
 int BlueFS::_replay(bool noop, bool to_stdout)
 {
   dout(10) << __func__ << (noop ? " NO-OP" : "") << dendl;
@@ -1264,7 +1441,24 @@ int BlueFS::_replay(bool noop, bool to_stdout)
     false,  // !random
     true);  // ignore eof
 
+  // the recovery and zero-checking read paths need the synchronous reads
+  std::unique_ptr<LogReplayPrefetcher> pf;
+  auto prefetch_depth = cct->_conf.get_val<uint64_t>("bluefs_log_replay_prefetch");
+  if (cct->_conf->bluefs_replay_recovery ||
+      cct->_conf->bluefs_check_for_zeros) {
+    prefetch_depth = 0;
+  }
+  if (prefetch_depth) {
+    uint64_t chunk_size = std::max<uint64_t>(
+      p2align<uint64_t>(cct->_conf->bluefs_max_prefetch, super.block_size),
+      super.block_size);
+    pf = std::make_unique<LogReplayPrefetcher>(this, chunk_size, prefetch_depth);
+  }
+
   bool seen_recs = false;
+  uint64_t replayed_txns = 0;
+  auto replay_start = mono_clock::now();
+  mono_clock::duration read_time{}, decode_time{}, apply_time{};
 
   boost::dynamic_bitset<uint64_t> used_blocks[MAX_BDEV];
 
@@ -1292,15 +1486,18 @@ int BlueFS::_replay(bool noop, bool to_stdout)
     uint64_t pos = log_reader->buf.pos;
     uint64_t read_pos = pos;
     bufferlist bl;
+    auto t0 = mono_clock::now();
     {
-      int r = _read(log_reader, read_pos, super.block_size,
-		    &bl, NULL);
+      int r = _replay_read(log_reader, pf.get(), read_pos, super.block_size,
+			   &bl);
       if (r != (int)super.block_size && cct->_conf->bluefs_replay_recovery) {
 	r += _do_replay_recovery_read(log_reader, pos, read_pos + r, super.block_size - r, &bl);
       }
       assert(r == (int)super.block_size);
       read_pos += r;
     }
+    auto t1 = mono_clock::now();
+    read_time += t1 - t0;
     uint64_t more = 0;
     uint64_t seq;
     uuid_d uuid;
@@ -1317,6 +1514,7 @@ int BlueFS::_replay(bool noop, bool to_stdout)
 	more = round_up_to(len + 6 - bl.length(), super.block_size);
       }
     }
+    decode_time += mono_clock::now() - t1;
     if (uuid != super.uuid) {
       if (seen_recs) {
 	dout(10) << __func__ << " 0x" << std::hex << pos << std::dec
@@ -1349,7 +1547,9 @@ int BlueFS::_replay(bool noop, bool to_stdout)
       dout(20) << __func__ << " need 0x" << std::hex << more << std::dec
                << " more bytes" << dendl;
       bufferlist t;
-      int r = _read(log_reader, read_pos, more, &t, NULL);
+      t0 = mono_clock::now();
+      int r = _replay_read(log_reader, pf.get(), read_pos, more, &t);
+      read_time += mono_clock::now() - t0;
       if (r < (int)more) {
 	dout(10) << __func__ << " 0x" << std::hex << pos
                  << ": stop: len is 0x" << bl.length() + more << std::dec
@@ -1368,10 +1568,12 @@ int BlueFS::_replay(bool noop, bool to_stdout)
       read_pos += r;
     }
     bluefs_transaction_t t;
+    t0 = mono_clock::now();
     try {
       auto p = bl.cbegin();
       decode(t, p);
       seen_recs = true;
+      decode_time += mono_clock::now() - t0;
     }
     catch (ceph::buffer::error& e) {
       // Multi-block transactions might be incomplete due to unexpected
@@ -1390,6 +1592,7 @@ int BlueFS::_replay(bool noop, bool to_stdout)
       break;
     }
     ceph_assert(seq == t.seq);
+    t0 = mono_clock::now();
     dout(10) << __func__ << " 0x" << std::hex << pos << std::dec
              << ": " << t << dendl;
     if (unlikely(to_stdout)) {
@@ -1437,8 +1640,11 @@ int BlueFS::_replay(bool noop, bool to_stdout)
 	  uint64_t skip = offset - read_pos;
 	  if (skip) {
 	    bufferlist junk;
-	    int r = _read(log_reader, read_pos, skip, &junk,
-			  NULL);
+	    auto tj = mono_clock::now();
+	    int r = _replay_read(log_reader, pf.get(), read_pos, skip, &junk);
+	    auto dt = mono_clock::now() - tj;
+	    read_time += dt;
+	    t0 += dt; // not part of apply
 	    if (r != (int)skip) {
 	      dout(10) << __func__ << " 0x" << std::hex << read_pos
 		       << ": stop: failed to skip to " << offset
@@ -1593,6 +1799,10 @@ int BlueFS::_replay(bool noop, bool to_stdout)
         {
 	  bluefs_fnode_t fnode;
 	  decode(fnode, p);
+	  if (pf && fnode.ino == 1) {
+	    // the log may have been relocated; don't trust the read-ahead
+	    pf->reset();
+	  }
 	  dout(20) << __func__ << " 0x" << std::hex << pos << std::dec
                    << ":  op_file_update " << " " << fnode << " " << dendl;
           if (unlikely(to_stdout)) {
@@ -1732,8 +1942,11 @@ int BlueFS::_replay(bool noop, bool to_stdout)
 
     // we successfully replayed the transaction; bump the seq and log size
     ++log_seq;
+    ++replayed_txns;
     log_file->fnode.size = log_reader->buf.pos;
+    apply_time += mono_clock::now() - t0;
   }
+  pf.reset();
   if (!noop) {
     vselector->add_usage(log_file->vselector_hint, log_file->fnode);
     log.seq_live = log_seq + 1;
@@ -1764,6 +1977,19 @@ int BlueFS::_replay(bool noop, bool to_stdout)
   }
   // reflect file count in logger
   logger->set(l_bluefs_num_files, nodes.file_map.size());
+  logger->set(l_bluefs_replay_txns, replayed_txns);
+  logger->set(l_bluefs_replay_bytes, log_file->fnode.size);
+  logger->tset(l_bluefs_replay_read_time, utime_t(read_time));
+  logger->tset(l_bluefs_replay_decode_time, utime_t(decode_time));
+  logger->tset(l_bluefs_replay_apply_time, utime_t(apply_time));
+  dout(1) << __func__ << " replayed " << replayed_txns << " txns, 0x"
+	  << std::hex << log_file->fnode.size << std::dec << " bytes in "
+	  << mono_clock::now() - replay_start
+	  << " (read " << read_time
+	  << ", decode " << decode_time
+	  << ", apply " << apply_time
+	  << (prefetch_depth ? ", prefetched" : "")
+	  << ")" << dendl;
 
   dout(10) << __func__ << " done" << dendl;
   return 0;
@@ -2362,6 +2588,123 @@ int64_t BlueFS::_read(
   return ret;
 }
 
+int64_t BlueFS::_read_wal_envelope(
+  FileReader *h,         ///< [in] read from here
+  uint64_t off,          ///< [in] logical offset
+  size_t len,            ///< [in] this many bytes
+  bufferlist *outbl,     ///< [out] optional: reference the result here
+  char *out)             ///< [out] optional: or copy it here
+{
+  const uint64_t hlen = bluefs_wal_envelope_t::HEADER_SIZE;
+  auto& c = h->wal_cursor;
+  uint64_t size = h->file->wal_size;
+  dout(10) << __func__ << " h " << h
+           << " 0x" << std::hex << off << "~" << len
+	   << " of 0x" << size << std::dec << dendl;
+
+  if (outbl) {
+    outbl->clear();
+  }
+  if (off >= size) {
+    return 0;
+  }
+  len = std::min<uint64_t>(len, size - off);
+  if (off < c.logical) {
+    // envelopes can only be walked forward
+    c = {};
+  }
+
+  int64_t ret = 0;
+  while (len > 0) {
+    if (c.seq == 0 || off >= c.logical + c.len) {
+      uint64_t next = c.seq ? c.phys + hlen + c.len : 0;
+      bufferlist hbl;
+      int64_t r = _read(h, next, hlen, &hbl, nullptr);
+      bluefs_wal_envelope_t e;
+      if (r != (int64_t)hlen ||
+	  !e.decode(hbl.c_str()) ||
+	  e.nonce != h->file->fnode.wal_nonce ||
+	  e.seq != c.seq + 1) {
+	derr << __func__ << " no envelope at 0x" << std::hex << next
+	     << " for logical 0x" << off << std::dec
+	     << " on " << h->file->fnode << dendl;
+	c = {};
+	return -EIO;
+      }
+      c.logical += c.len;
+      c.phys = next;
+      c.len = e.len;
+      c.seq = e.seq;
+      continue;
+    }
+    uint64_t x_off = off - c.logical;
+    size_t l = std::min<uint64_t>(len, c.len - x_off);
+    bufferlist t;
+    int64_t r = _read(h, c.phys + hlen + x_off, l, outbl ? &t : nullptr, out);
+    if (r <= 0) {
+      break;
+    }
+    if (outbl) {
+      outbl->claim_append(t);
+    }
+    if (out) {
+      out += r;
+    }
+    off += r;
+    len -= r;
+    ret += r;
+    if ((size_t)r < l) {
+      break;
+    }
+  }
+  // _read advanced the position in envelope space; report the logical one
+  h->buf.pos = off;
+  return ret;
+}
+
+// Walk the envelopes of a WAL file to find how much of it is valid. Only
+// allocations are logged for such files, so the logged size is stale.
+void BlueFS::_wal_envelope_recover(FileRef f)
+{
+  const uint64_t hlen = bluefs_wal_envelope_t::HEADER_SIZE;
+  FileReader *h = new FileReader(f, cct->_conf->bluefs_max_prefetch,
+				 false,  // !random
+				 true);  // ignore eof; walk the allocation
+  uint64_t allocated = f->fnode.get_allocated();
+  uint64_t phys = 0, logical = 0, seq = 0;
+  while (phys + hlen <= allocated) {
+    bufferlist bl;
+    if (_read(h, phys, hlen, &bl, nullptr) != (int64_t)hlen) {
+      break;
+    }
+    bluefs_wal_envelope_t e;
+    if (!e.decode(bl.c_str()) ||
+	e.nonce != f->fnode.wal_nonce ||
+	e.seq != seq + 1 ||
+	phys + hlen + e.len > allocated) {
+      break;
+    }
+    bufferlist payload;
+    if (_read(h, phys + hlen, e.len, &payload, nullptr) != (int64_t)e.len ||
+	payload.crc32c(-1) != e.crc) {
+      dout(10) << __func__ << " torn envelope seq " << e.seq
+	       << " at 0x" << std::hex << phys << std::dec << dendl;
+      break;
+    }
+    phys += hlen + e.len;
+    logical += e.len;
+    seq = e.seq;
+  }
+  delete h;
+  dout(10) << __func__ << " " << f->fnode << " has " << seq
+	   << " envelopes, 0x" << std::hex << logical << " bytes in 0x"
+	   << phys << std::dec << dendl;
+  vselector->sub_usage(f->vselector_hint, f->fnode.size);
+  f->fnode.size = phys;
+  vselector->add_usage(f->vselector_hint, f->fnode.size);
+  f->wal_size = logical;
+}
+
 void BlueFS::invalidate_cache(FileRef f, uint64_t offset, uint64_t length)
 {
   std::lock_guard l(f->lock);
@@ -3384,6 +3727,28 @@ ceph::bufferlist BlueFS::FileWriter::flush_buffer(
   return bl;
 }
 
+// Fill in the header reserved at the front of the buffer by append().
+// Returns the number of payload bytes covered by the envelope.
+unsigned BlueFS::FileWriter::seal_wal_envelope()
+{
+  ceph_assert(ceph_mutex_is_locked(this->lock));
+  constexpr unsigned hlen = bluefs_wal_envelope_t::HEADER_SIZE;
+  if (buffer.length() <= hlen) {
+    return 0;
+  }
+  bluefs_wal_envelope_t e;
+  e.nonce = file->fnode.wal_nonce;
+  e.seq = ++wal_seq;
+  e.len = buffer.length() - hlen;
+  bufferlist payload;
+  payload.substr_of(buffer, hlen, e.len);
+  e.crc = payload.crc32c(-1);
+  char header[hlen];
+  e.encode(header);
+  buffer.begin().copy_in(hlen, header);
+  return e.len;
+}
+
 int BlueFS::_signal_dirty_to_log_D(FileWriter *h)
 {
   ceph_assert(ceph_mutex_is_locked(h->lock));
@@ -3422,6 +3787,10 @@ void BlueFS::flush_range(FileWriter *h, uint64_t offset, uint64_t length)/*_WF*/
 {
   _maybe_check_vselector_LNF();
   std::unique_lock hl(h->lock);
+  if (h->wal_envelope) {
+    // an envelope covers the whole buffer; it goes out on the next flush
+    return;
+  }
   _flush_range_F(h, offset, length);
 }
 
@@ -3460,10 +3829,16 @@ int BlueFS::_flush_range_F(FileWriter *h, uint64_t offset, uint64_t length)
   // do not bother to dirty the file if we are overwriting
   // previously allocated extents.
   if (allocated < offset + length) {
+    uint64_t want = offset + length - allocated;
+    if (h->wal_envelope) {
+      // allocate ahead so that most syncs need no log update at all
+      want = std::max<uint64_t>(
+	want, cct->_conf.get_val<Option::size_t>("bluefs_wal_envelope_prealloc"));
+    }
     // we should never run out of log space here; see the min runway check
     // in _flush_and_sync_log.
     int r = _allocate(vselector->select_prefer_bdev(h->file->vselector_hint),
-		      offset + length - allocated,
+		      want,
                       0,
 		      &h->file->fnode,
 		      [&](const bluefs_extent_t& e) {
@@ -3481,7 +3856,10 @@ int BlueFS::_flush_range_F(FileWriter *h, uint64_t offset, uint64_t length)
   if (h->file->fnode.size < offset + length) {
     vselector->add_usage(h->file->vselector_hint, offset + length - h->file->fnode.size);
     h->file->fnode.size = offset + length;
-    h->file->is_dirty = true;
+    // envelope-encoded files find their size on mount by themselves
+    if (!h->wal_envelope) {
+      h->file->is_dirty = true;
+    }
   }
   dout(20) << __func__ << " file now, unflushed " << h->file->fnode << dendl;
   int res = _flush_data(h, offset, length, buffered);
@@ -3677,7 +4055,15 @@ int BlueFS::_flush_F(FileWriter *h, bool force, bool *flushed)
            << std::hex << offset << "~" << length << std::dec
 	   << " to " << h->file->fnode << dendl;
   ceph_assert(h->pos <= h->file->fnode.size);
+  unsigned payload = 0;
+  if (h->wal_envelope) {
+    payload = h->seal_wal_envelope();
+  }
   int r = _flush_range_F(h, offset, length);
+  if (payload) {
+    std::lock_guard file_lock(h->file->lock);
+    h->file->wal_size += payload;
+  }
   if (flushed) {
     *flushed = true;
   }
@@ -4127,6 +4513,29 @@ int BlueFS::open_for_write(
   }
   ceph_assert(file->fnode.ino > 1);
 
+  if (create || !overwrite) {
+    // fresh content; an in-place overwrite keeps the existing encoding
+    // envelope files need the superblock feature, which is only set at
+    // mount; enabling the option at runtime takes effect on remount
+    file->fnode.encoding =
+      (cct->_conf.get_val<bool>("bluefs_wal_envelope_mode") &&
+       super.has_feature(bluefs_super_t::FEATURE_WAL_ENVELOPE) &&
+       boost::algorithm::ends_with(filename, ".log")) ?
+      bluefs_fnode_t::ENCODING_WAL_ENVELOPE :
+      bluefs_fnode_t::ENCODING_PLAIN;
+    file->fnode.wal_nonce = 0;
+  }
+  if (file->fnode.is_wal_envelope()) {
+    // a new nonce invalidates the envelopes of any previous writer
+    do {
+      file->fnode.wal_nonce = ceph::util::generate_random_number<uint64_t>();
+    } while (file->fnode.wal_nonce == 0);
+    file->wal_size = 0;
+    // the first fsync has to make the nonce stable along with the data,
+    // even if it does not allocate
+    file->is_dirty = true;
+  }
+
   file->fnode.mtime = ceph_clock_now();
   dout(20) << __func__ << " mapping " << dirname << "/" << filename
 	   << " vsel_hint " << file->vselector_hint
@@ -4142,6 +4551,7 @@ int BlueFS::open_for_write(
   }
   }
   *h = _create_writer(file);
+  (*h)->wal_envelope = file->fnode.is_wal_envelope();
 
   if (boost::algorithm::ends_with(filename, ".log")) {
     (*h)->writer_type = BlueFS::WRITER_WAL;
@@ -4362,7 +4772,7 @@ int BlueFS::stat(std::string_view dirname, std::string_view filename,
   dout(10) << __func__ << " " << dirname << "/" << filename
 	   << " " << file->fnode << dendl;
   if (size)
-    *size = file->fnode.size;
+    *size = file->fnode.is_wal_envelope() ? file->wal_size : file->fnode.size;
   if (mtime)
     *mtime = file->fnode.mtime;
   return 0;
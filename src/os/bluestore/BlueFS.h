@@ -85,6 +85,12 @@ enum {
   l_bluefs_wal_alloc_max_lat,
   l_bluefs_db_alloc_max_lat,
   l_bluefs_slow_alloc_max_lat,
+  l_bluefs_replay_txns,
+  l_bluefs_replay_bytes,
+  l_bluefs_replay_read_time,
+  l_bluefs_replay_decode_time,
+  l_bluefs_replay_apply_time,
+  l_bluefs_replay_prefetch_chunks,
   l_bluefs_last,
 };
 
@@ -247,6 +253,9 @@ public:
     std::atomic_int num_reading;
 
     void* vselector_hint = nullptr;
+    /// payload bytes of an envelope-encoded file; fnode.size is the
+    /// on-disk (envelope) size for those
+    uint64_t wal_size = 0;
     /* lock protects fnode and other the parts that can be modified during read & write operations.
        Does not protect values that are fixed
        Does not need to be taken when doing one-time operations:
@@ -311,10 +320,13 @@ public:
       const bool partial,
       const unsigned length,
       const bluefs_super_t& super);
+    unsigned seal_wal_envelope();
     ceph::buffer::list::page_aligned_appender buffer_appender;  //< for const char* only
   public:
     int writer_type = 0;    ///< WRITER_*
     int write_hint = WRITE_LIFE_NOT_SET;
+    bool wal_envelope = false; ///< wrap each flush in a bluefs_wal_envelope_t
+    uint64_t wal_seq = 0;      ///< seq of the last sealed envelope
 
     ceph::mutex lock = ceph::make_mutex("BlueFS::FileWriter::lock");
     std::array<IOContext*,MAX_BDEV> iocv; ///< for each bdev
@@ -342,6 +354,10 @@ public:
     void append(const char *buf, size_t len) {
       uint64_t l0 = get_buffer_length();
       ceph_assert(l0 + len <= std::numeric_limits<unsigned>::max());
+      if (wal_envelope && l0 == 0 && len) {
+	// reserve room for the header, filled in by seal_wal_envelope()
+	buffer_appender.append_zero(bluefs_wal_envelope_t::HEADER_SIZE);
+      }
       buffer_appender.append(buf, len);
     }
 
@@ -366,6 +382,16 @@ public:
     uint64_t get_effective_write_pos() {
       return pos + buffer.length();
     }
+
+    /// size of the file as seen by the user of this writer
+    uint64_t get_logical_size() const {
+      if (wal_envelope) {
+	auto l = buffer.length();
+	return file->wal_size +
+	  (l ? l - bluefs_wal_envelope_t::HEADER_SIZE : 0);
+      }
+      return file->fnode.size + buffer.length();
+    }
   };
 
   struct FileReaderBuffer {
@@ -410,6 +436,16 @@ public:
     bool random;
     bool ignore_eof;        ///< used when reading our log file
 
+    /// envelope-encoded files: envelope holding the last read data
+    struct {
+      uint64_t logical = 0; ///< logical offset of its payload
+      uint64_t phys = 0;    ///< offset of its header
+      uint32_t len = 0;     ///< payload length
+      uint64_t seq = 0;     ///< 0 if positioned before the first envelope
+    } wal_cursor;
+    ceph::mutex wal_read_lock =
+      ceph::make_mutex("BlueFS::FileReader::wal_read_lock");
+
     ceph::shared_mutex lock {
      ceph::make_shared_mutex(std::string(), false, false, false)
     };
@@ -628,6 +664,20 @@ private:
     uint64_t alloc_unit,
     const char *op);
   int _replay(bool noop, bool to_stdout = false); ///< replay journal
+  void _wal_envelope_recover(FileRef f);
+  int64_t _read_wal_envelope(
+    FileReader *h,   ///< [in] read from here
+    uint64_t offset, ///< [in] logical offset
+    size_t len,      ///< [in] this many bytes
+    ceph::buffer::list *outbl,   ///< [out] optional: reference the result here
+    char *out);      ///< [out] optional: or copy it here
+  struct LogReplayPrefetcher;
+  int64_t _replay_read(
+    FileReader *h,            ///< [in] log reader
+    LogReplayPrefetcher *pf,  ///< [in] optional: read-ahead queue
+    uint64_t offset,          ///< [in] offset
+    size_t len,               ///< [in] this many bytes
+    ceph::buffer::list *outbl); ///< [out] the result
 
   FileWriter *_create_writer(FileRef f);
   void _drain_writer(FileWriter *h);
@@ -757,6 +807,9 @@ public:
     // no need to hold the global lock here; we only touch h and
     // h->file, and read vs write or delete is already protected (via
     // atomics and asserts).
+    if (h->file->fnode.is_wal_envelope()) {
+      return _read_wal_envelope(h, offset, len, outbl, out);
+    }
     return _read(h, offset, len, outbl, out);
   }
   int64_t read_random(FileReader *h, uint64_t offset, size_t len,
@@ -764,6 +817,11 @@ public:
     // no need to hold the global lock here; we only touch h and
     // h->file, and read vs write or delete is already protected (via
     // atomics and asserts).
+    if (h->file->fnode.is_wal_envelope()) {
+      // WAL files are only ever read sequentially
+      std::lock_guard l(h->wal_read_lock);
+      return _read_wal_envelope(h, offset, len, nullptr, out);
+    }
     return _read_random(h, offset, len, out);
   }
   void invalidate_cache(FileRef f, uint64_t offset, uint64_t len);
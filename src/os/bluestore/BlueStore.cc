@@ -30,7 +30,9 @@
 #include "BlueStore.h"
 #include "bluestore_common.h"
 #include "simple_bitmap.h"
+#include "frequency_sketch.h"
 #include "os/kv.h"
+#include "include/ceph_hash.h"
 #include "include/compat.h"
 #include "include/intarith.h"
 #include "include/stringify.h"
@@ -41,6 +43,7 @@
 #include "common/PriorityCache.h"
 #include "common/url_escape.h"
 #include "Allocator.h"
+#include "CachingAllocator.h"
 #include "FreelistManager.h"
 #include "BlueFS.h"
 #include "BlueRocksEnv.h"
@@ -1095,6 +1098,7 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
       ocs->lock.lock();
     }
     if (o->is_cached() && o->pin_nref == 1) {
+      _maybe_compact(o);
       if(!o->lru_item.is_linked()) {
         if (o->exists) {
 	  lru.push_front(*o);
@@ -1176,6 +1180,208 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
 #endif
 };
 
+// TinyLfuOnodeCacheShard
+
+/*
+ * W-TinyLFU flavour of the onode LRU: unpinned onodes enter a small LRU
+ * window, and an onode falling out of the window only displaces the tail
+ * of the main LRU if the frequency sketch says it is accessed more often.
+ * Objects touched once by scrub or backfill thus age out of the window
+ * without pushing the working set out of the cache.
+ */
+struct TinyLfuOnodeCacheShard : public BlueStore::OnodeCacheShard {
+  typedef boost::intrusive::list<
+    BlueStore::Onode,
+    boost::intrusive::member_hook<
+      BlueStore::Onode,
+      boost::intrusive::list_member_hook<>,
+      &BlueStore::Onode::lru_item> > list_t;
+
+  enum {
+    ONODE_NEW = 0,
+    ONODE_WINDOW,  ///< in window
+    ONODE_MAIN,    ///< in main
+  };
+
+  list_t window;
+  list_t main;
+  frequency_sketch_t sketch;
+
+  explicit TinyLfuOnodeCacheShard(CephContext *cct)
+    : BlueStore::OnodeCacheShard(cct) {}
+
+  static uint64_t _key(const BlueStore::Onode *o) {
+    return ceph_str_hash_rjenkins(o->key.c_str(), o->key.length());
+  }
+
+  list_t& _list(const BlueStore::Onode *o) {
+    return o->cache_private == ONODE_MAIN ? main : window;
+  }
+
+  // link an unpinned onode, keeping the segment it was in before pinning
+  void _link(BlueStore::Onode *o, bool front) {
+    if (o->cache_private != ONODE_MAIN) {
+      o->cache_private = ONODE_WINDOW;
+    }
+    front ? _list(o).push_front(*o) : _list(o).push_back(*o);
+    o->cache_age_bin = age_bins.front();
+    *(o->cache_age_bin) += 1;
+  }
+  void _unlink(BlueStore::Onode *o) {
+    *(o->cache_age_bin) -= 1;
+    _list(o).erase(_list(o).iterator_to(*o));
+  }
+  void _evict(BlueStore::Onode *o) {
+    _unlink(o);
+    ceph_assert(num);
+    --num;
+    o->clear_cached();
+    o->c->onode_space._remove(o->oid);
+  }
+
+  void _add(BlueStore::Onode* o, int level) override
+  {
+    o->set_cached();
+    sketch.increment(_key(o));
+    if (o->pin_nref == 1) {
+      _link(o, level > 0);
+    }
+    ++num; // we count both pinned and unpinned entries
+    dout(20) << __func__ << " " << this << " " << o->oid << " added, num="
+             << num << dendl;
+  }
+  void _rm(BlueStore::Onode* o) override
+  {
+    o->clear_cached();
+    if (o->lru_item.is_linked()) {
+      _unlink(o);
+    }
+    ceph_assert(num);
+    --num;
+    dout(20) << __func__ << " " << this << " " << " " << o->oid << " removed, num=" << num << dendl;
+  }
+
+  void maybe_unpin(BlueStore::Onode* o) override
+  {
+    OnodeCacheShard* ocs = this;
+    ocs->lock.lock();
+    // It is possible that during waiting split_cache moved us to different OnodeCacheShard.
+    while (ocs != o->c->get_onode_cache()) {
+      ocs->lock.unlock();
+      ocs = o->c->get_onode_cache();
+      ocs->lock.lock();
+    }
+    if (o->is_cached() && o->pin_nref == 1) {
+      _maybe_compact(o);
+      if (!o->lru_item.is_linked()) {
+        if (o->exists) {
+	  sketch.increment(_key(o));
+	  _link(o, true);
+	  dout(20) << __func__ << " " << this << " " << o->oid << " unpinned"
+                   << dendl;
+        } else {
+	  ceph_assert(num);
+	  --num;
+	  o->clear_cached();
+	  dout(20) << __func__ << " " << this << " " << o->oid << " removed"
+                   << dendl;
+          // remove will also decrement nref
+          o->c->onode_space._remove(o->oid);
+        }
+      } else if (o->exists) {
+        sketch.increment(_key(o));
+        _unlink(o);
+        _link(o, true);
+        dout(20) << __func__ << " " << this << " " << o->oid << " touched"
+                 << dendl;
+      }
+    }
+    ocs->lock.unlock();
+  }
+
+  void _trim_to(uint64_t new_size) override
+  {
+    if (new_size >= window.size() + main.size()) {
+      return; // don't even try
+    }
+    sketch.ensure_capacity(num);
+    uint64_t kwindow = std::max<uint64_t>(1,
+      new_size * cct->_conf->bluestore_tinylfu_cache_window_ratio);
+    uint64_t kmain = new_size > kwindow ? new_size - kwindow : 0;
+    uint64_t n = num - new_size; // as with lru, pinned entries we meet
+                                 // count against n
+
+    // drain the window into main through the admission filter
+    while (n > 0 && window.size() > kwindow) {
+      BlueStore::Onode *cand = &window.back();
+      if (cand->pin_nref > 1) {
+        _unlink(cand);
+        --n;
+        continue;
+      }
+      if (main.size() < kmain) {
+        _unlink(cand);
+        cand->cache_private = ONODE_MAIN;
+        _link(cand, true);
+        continue;
+      }
+      BlueStore::Onode *victim = main.empty() ? nullptr : &main.back();
+      if (victim && victim->pin_nref > 1) {
+        _unlink(victim);
+        --n;
+        continue;
+      }
+      --n;
+      if (victim && sketch.estimate(_key(cand)) > sketch.estimate(_key(victim))) {
+        dout(20) << __func__ << " admit " << cand->oid
+                 << " evict " << victim->oid << dendl;
+        logger->inc(l_bluestore_onode_cache_admitted);
+        _evict(victim);
+        _unlink(cand);
+        cand->cache_private = ONODE_MAIN;
+        _link(cand, true);
+      } else {
+        dout(20) << __func__ << " reject " << cand->oid << dendl;
+        logger->inc(l_bluestore_onode_cache_rejected);
+        _evict(cand);
+      }
+    }
+
+    while (n > 0 && (main.size() || window.size())) {
+      --n;
+      BlueStore::Onode *o = main.empty() ? &window.back() : &main.back();
+      if (o->pin_nref > 1) {
+        _unlink(o);
+        dout(20) << __func__ << " " << this << " pinned " << o->oid << dendl;
+      } else {
+        dout(20) << __func__ << "  rm " << o->oid << " "
+                 << o->nref << " " << o->cached << dendl;
+        _evict(o);
+      }
+    }
+  }
+  void _move_pinned(OnodeCacheShard *to, BlueStore::Onode *o) override
+  {
+    if (to == this) {
+      return;
+    }
+    _rm(o);
+    ceph_assert(o->nref > 1);
+    to->_add(o, 0);
+  }
+  void add_stats(uint64_t *onodes, uint64_t *pinned_onodes) override
+  {
+    std::lock_guard l(lock);
+    *onodes += num;
+    *pinned_onodes += num - window.size() - main.size();
+  }
+#ifdef DEBUG_CACHE
+  void _audit(const char *when) override
+  {
+  }
+#endif
+};
+
 // OnodeCacheShard
 BlueStore::OnodeCacheShard *BlueStore::OnodeCacheShard::create(
     CephContext* cct,
@@ -1183,12 +1389,25 @@ BlueStore::OnodeCacheShard *BlueStore::OnodeCacheShard::create(
     PerfCounters *logger)
 {
   BlueStore::OnodeCacheShard *c = nullptr;
-  // Currently we only implement an LRU cache for onodes
-  c = new LruOnodeCacheShard(cct);
+  // 2q has no onode flavour, onodes fall back to plain LRU
+  if (type == "tinylfu")
+    c = new TinyLfuOnodeCacheShard(cct);
+  else
+    c = new LruOnodeCacheShard(cct);
   c->logger = logger;
   return c;
 }
 
+void BlueStore::OnodeCacheShard::_maybe_compact(Onode* o)
+{
+  if (compact_extent_map && o->exists) {
+    // nobody but the cache references o and lookups are blocked
+    // by our lock, so it is safe to unload its shards here
+    logger->inc(l_bluestore_onode_shard_compacted,
+		o->extent_map.compact_shards());
+  }
+}
+
 // LruBufferCacheShard
 struct LruBufferCacheShard : public BlueStore::BufferCacheShard {
   typedef boost::intrusive::list<
@@ -1630,6 +1849,253 @@ public:
 #endif
 };
 
+// TinyLfuBufferCacheShard
+
+/*
+ * W-TinyLFU: new buffers enter a small LRU window.  Buffers falling out
+ * of the window are admitted to the main segmented LRU (probation +
+ * protected) only if the frequency sketch rates them above the probation
+ * victim they would displace, so a streaming scan cannot flush the hot set.
+ * A hit in probation promotes the buffer to protected; protected overflow
+ * is demoted back to probation.
+ */
+struct TinyLfuBufferCacheShard : public BlueStore::BufferCacheShard {
+  typedef boost::intrusive::list<
+    BlueStore::Buffer,
+    boost::intrusive::member_hook<
+      BlueStore::Buffer,
+      boost::intrusive::list_member_hook<>,
+      &BlueStore::Buffer::lru_item> > list_t;
+  list_t window;     ///< recently added buffers
+  list_t probation;  ///< admitted, not (yet) hit again
+  list_t hot;        ///< "protected": hit while on probation
+
+  enum {
+    BUFFER_NEW = 0,
+    BUFFER_WINDOW,     ///< in window
+    BUFFER_PROBATION,  ///< in probation
+    BUFFER_HOT,        ///< in hot
+    BUFFER_TYPE_MAX
+  };
+
+  uint64_t list_bytes[BUFFER_TYPE_MAX] = {0}; ///< bytes per type
+  frequency_sketch_t sketch;
+
+public:
+  explicit TinyLfuBufferCacheShard(CephContext *cct) : BufferCacheShard(cct) {}
+
+  static uint64_t _key(const BlueStore::Buffer *b) {
+    return (uint64_t)(uintptr_t)b->space ^ ((uint64_t)b->offset << 20);
+  }
+
+  list_t& _list(int cache_private) {
+    switch (cache_private) {
+    case BUFFER_WINDOW:
+      return window;
+    case BUFFER_PROBATION:
+      return probation;
+    case BUFFER_HOT:
+      return hot;
+    default:
+      ceph_abort_msg("bad cache_private");
+    }
+  }
+
+  void _link(BlueStore::Buffer *b, int cache_private, bool front) {
+    b->cache_private = cache_private;
+    front ? _list(cache_private).push_front(*b) :
+      _list(cache_private).push_back(*b);
+    list_bytes[cache_private] += b->length;
+  }
+  void _unlink(BlueStore::Buffer *b) {
+    _list(b->cache_private).erase(_list(b->cache_private).iterator_to(*b));
+    ceph_assert(list_bytes[b->cache_private] >= b->length);
+    list_bytes[b->cache_private] -= b->length;
+  }
+  void _relink(BlueStore::Buffer *b, int cache_private) {
+    _unlink(b);
+    _link(b, cache_private, true);
+  }
+  void _rebin(BlueStore::Buffer *b) {
+    *(b->cache_age_bin) -= b->length;
+    b->cache_age_bin = age_bins.front();
+    *(b->cache_age_bin) += b->length;
+  }
+
+  void _add(BlueStore::Buffer *b, int level, BlueStore::Buffer *near) override
+  {
+    dout(20) << __func__ << " level " << level << " near " << near
+             << " on " << *b
+             << " which has cache_private " << b->cache_private << dendl;
+    sketch.increment(_key(b));
+    if (near) {
+      b->cache_private = near->cache_private;
+      _list(b->cache_private).insert(
+        _list(b->cache_private).iterator_to(*near), *b);
+      list_bytes[b->cache_private] += b->length;
+    } else if (b->cache_private == BUFFER_NEW) {
+      // take caller hint to start at the back of the window
+      _link(b, BUFFER_WINDOW, level > 0);
+    } else if (b->cache_private == BUFFER_WINDOW) {
+      // hint from discard: the replaced buffer was still in the window
+      _link(b, BUFFER_WINDOW, true);
+    } else {
+      // hint from discard: the replaced buffer was admitted, this is hot
+      _link(b, BUFFER_HOT, true);
+    }
+    buffer_bytes += b->length;
+    b->cache_age_bin = age_bins.front();
+    *(b->cache_age_bin) += b->length;
+    num = window.size() + probation.size() + hot.size();
+  }
+
+  void _rm(BlueStore::Buffer *b) override
+  {
+    dout(20) << __func__ << " " << *b << dendl;
+    ceph_assert(buffer_bytes >= b->length);
+    buffer_bytes -= b->length;
+    assert(*(b->cache_age_bin) >= b->length);
+    *(b->cache_age_bin) -= b->length;
+    _unlink(b);
+    num = window.size() + probation.size() + hot.size();
+  }
+
+  void _move(BlueStore::BufferCacheShard *srcc, BlueStore::Buffer *b) override
+  {
+    srcc->_rm(b);
+    // preserve which list we're on (even if we can't preserve the order!)
+    _link(b, b->cache_private, false);
+    buffer_bytes += b->length;
+    b->cache_age_bin = age_bins.front();
+    *(b->cache_age_bin) += b->length;
+    num = window.size() + probation.size() + hot.size();
+  }
+
+  void _adjust_size(BlueStore::Buffer *b, int64_t delta) override
+  {
+    dout(20) << __func__ << " delta " << delta << " on " << *b << dendl;
+    ceph_assert((int64_t)buffer_bytes + delta >= 0);
+    buffer_bytes += delta;
+    ceph_assert((int64_t)list_bytes[b->cache_private] + delta >= 0);
+    list_bytes[b->cache_private] += delta;
+    assert(*(b->cache_age_bin) + delta >= 0);
+    *(b->cache_age_bin) += delta;
+  }
+
+  void _touch(BlueStore::Buffer *b) override {
+    sketch.increment(_key(b));
+    switch (b->cache_private) {
+    case BUFFER_WINDOW:
+      _relink(b, BUFFER_WINDOW);
+      break;
+    case BUFFER_PROBATION:
+    case BUFFER_HOT:
+      _relink(b, BUFFER_HOT);
+      break;
+    default:
+      ceph_abort_msg("bad cache_private");
+    }
+    _rebin(b);
+    _audit("_touch_buffer end");
+  }
+
+  void _evict(BlueStore::Buffer *b) {
+    ceph_assert(b->is_clean());
+    dout(20) << __func__ << " rm " << *b << dendl;
+    b->space->_rm_buffer(this, b);
+  }
+
+  void _trim_to(uint64_t max) override
+  {
+    if (buffer_bytes > max) {
+      uint64_t kwindow = max * cct->_conf->bluestore_tinylfu_cache_window_ratio;
+      uint64_t kmain = max - kwindow;
+      uint64_t khot = kmain * cct->_conf->bluestore_tinylfu_cache_protected_ratio;
+      sketch.ensure_capacity(num);
+
+      // demote protected overflow to probation
+      while (list_bytes[BUFFER_HOT] > khot && !hot.empty()) {
+        _relink(&*hot.rbegin(), BUFFER_PROBATION);
+      }
+
+      // drain the window into main through the admission filter
+      uint64_t admitted = 0, rejected = 0;
+      while (list_bytes[BUFFER_WINDOW] > kwindow && !window.empty()) {
+        BlueStore::Buffer *cand = &*window.rbegin();
+        uint64_t main_bytes =
+          list_bytes[BUFFER_PROBATION] + list_bytes[BUFFER_HOT];
+        if (main_bytes + cand->length <= kmain || probation.empty()) {
+          _relink(cand, BUFFER_PROBATION);
+          ++admitted;
+          continue;
+        }
+        BlueStore::Buffer *victim = &*probation.rbegin();
+        if (sketch.estimate(_key(cand)) > sketch.estimate(_key(victim))) {
+          _evict(victim);
+          _relink(cand, BUFFER_PROBATION);
+          ++admitted;
+        } else {
+          _evict(cand);
+          ++rejected;
+        }
+      }
+      if (admitted || rejected) {
+        dout(20) << __func__ << " window admitted " << admitted
+                 << " rejected " << rejected << dendl;
+        logger->inc(l_bluestore_buffer_cache_admitted, admitted);
+        logger->inc(l_bluestore_buffer_cache_rejected, rejected);
+      }
+
+      // evict what is still over budget, coldest segment first
+      while (buffer_bytes > max) {
+        list_t *l = !probation.empty() ? &probation :
+          (!hot.empty() ? &hot : &window);
+        if (l->empty()) {
+          // stop if all lists are now empty
+          break;
+        }
+        _evict(&*l->rbegin());
+      }
+    }
+    num = window.size() + probation.size() + hot.size();
+  }
+
+  void add_stats(uint64_t *extents,
+                 uint64_t *blobs,
+                 uint64_t *buffers,
+                 uint64_t *bytes) override {
+    std::lock_guard l(lock);
+    *extents += num_extents;
+    *blobs += num_blobs;
+    *buffers += num;
+    *bytes += buffer_bytes;
+  }
+
+#ifdef DEBUG_CACHE
+  void _audit(const char *when) override
+  {
+    dout(10) << __func__ << " " << when << " start" << dendl;
+    uint64_t s = 0;
+    for (int t = BUFFER_WINDOW; t < BUFFER_TYPE_MAX; ++t) {
+      uint64_t ls = 0;
+      for (auto& b : _list(t)) {
+        ceph_assert(b.cache_private == t);
+        ls += b.length;
+      }
+      ceph_assert(ls == list_bytes[t]);
+      s += ls;
+    }
+    if (s != buffer_bytes) {
+      derr << __func__ << " buffer_bytes " << buffer_bytes << " actual " << s
+           << dendl;
+      ceph_assert(s == buffer_bytes);
+    }
+    dout(20) << __func__ << " " << when << " buffer_bytes " << buffer_bytes
+             << " ok" << dendl;
+  }
+#endif
+};
+
 // BuferCacheShard
 
 BlueStore::BufferCacheShard *BlueStore::BufferCacheShard::create(
@@ -1642,6 +2108,8 @@ BlueStore::BufferCacheShard *BlueStore::BufferCacheShard::create(
     c = new LruBufferCacheShard(cct);
   else if (type == "2q")
     c = new TwoQBufferCacheShard(cct);
+  else if (type == "tinylfu")
+    c = new TinyLfuBufferCacheShard(cct);
   else
     ceph_abort_msg("unrecognized cache type");
   c->logger = logger;
@@ -1802,6 +2270,8 @@ void BlueStore::BufferSpace::read(
   uint64_t miss_bytes = want_bytes - hit_bytes;
   cache->logger->inc(l_bluestore_buffer_hit_bytes, hit_bytes);
   cache->logger->inc(l_bluestore_buffer_miss_bytes, miss_bytes);
+  cache->hits += hit_bytes;
+  cache->misses += miss_bytes;
 }
 
 void BlueStore::BufferSpace::_finish_write(BufferCacheShard* cache, uint64_t seq)
@@ -1971,6 +2441,7 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
     if (p == onode_map.end()) {
       ldout(cache->cct, 30) << __func__ << " " << oid << " miss" << dendl;
       cache->logger->inc(l_bluestore_onode_misses);
+      ++cache->misses;
     } else {
       ldout(cache->cct, 30) << __func__ << " " << oid << " hit " << p->second
                             << " " << p->second->nref
@@ -1981,12 +2452,19 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
       o = p->second;
 
       cache->logger->inc(l_bluestore_onode_hits);
+      ++cache->hits;
     }
   }
 
   return o;
 }
 
+bool BlueStore::OnodeSpace::contains(const ghobject_t& oid)
+{
+  std::lock_guard l(cache->lock);
+  return onode_map.count(oid);
+}
+
 void BlueStore::OnodeSpace::clear()
 {
   std::lock_guard l(cache->lock);
@@ -4171,6 +4649,9 @@ void BlueStore::ExtentMap::init_shards(bool loaded, bool dirty)
     shards[i].shard_info = &s;
     shards[i].loaded = loaded;
     shards[i].dirty = dirty;
+    if (dirty) {
+      shards[i].packed.clear();
+    }
     ++i;
   }
 }
@@ -4199,18 +4680,27 @@ void BlueStore::ExtentMap::fault_range(
       dout(30) << __func__ << " opening shard 0x" << std::hex
 	       << p->shard_info->offset << std::dec << dendl;
       bufferlist v;
-      generate_extent_shard_key_and_apply(
-	onode->key, p->shard_info->offset, &key,
-        [&](const string& final_key) {
-          int r = db->get(PREFIX_OBJ, final_key, &v);
-          if (r < 0) {
-	    derr << __func__ << " missing shard 0x" << std::hex
-		 << p->shard_info->offset << std::dec << " for " << onode->oid
-		 << dendl;
-	    ceph_assert(r >= 0);
-          }
-        }
-      );
+      if (p->packed.length()) {
+	v = p->packed;
+	onode->c->store->logger->inc(l_bluestore_onode_shard_unpacked);
+      } else {
+	generate_extent_shard_key_and_apply(
+	  onode->key, p->shard_info->offset, &key,
+	  [&](const string& final_key) {
+	    int r = db->get(PREFIX_OBJ, final_key, &v);
+	    if (r < 0) {
+	      derr << __func__ << " missing shard 0x" << std::hex
+		   << p->shard_info->offset << std::dec << " for " << onode->oid
+		   << dendl;
+	      ceph_assert(r >= 0);
+	    }
+	  }
+	);
+	if (onode->c->get_onode_cache()->compact_extent_map) {
+	  p->packed = v;
+	  p->packed.reassign_to_mempool(mempool::mempool_bluestore_inline_bl);
+	}
+      }
       p->extents = decode_some(v);
       p->loaded = true;
       dout(20) << __func__ << " open shard 0x" << std::hex
@@ -4260,11 +4750,59 @@ void BlueStore::ExtentMap::dirty_range(
       dout(20) << __func__ << " mark shard 0x" << std::hex
 	       << p->shard_info->offset << std::dec << " dirty" << dendl;
       p->dirty = true;
+      p->packed.clear();
     }
     ++start;
   }
 }
 
+unsigned BlueStore::ExtentMap::compact_shards()
+{
+  if (shards.empty() || needs_reshard() || onode->flushing_count.load()) {
+    return 0;
+  }
+  for (auto& s : shards) {
+    if (s.dirty) {
+      return 0;
+    }
+  }
+  // the extents dropped, disposed of once the cache lock is released:
+  // deleting the last reference to a blob takes that lock again
+  extent_map_t dropped;
+  auto cache = onode->c->cache;
+  std::unique_lock l(cache->lock);
+  unsigned n = 0;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    auto& s = shards[i];
+    if (!s.loaded) {
+      continue;
+    }
+    uint32_t end = i + 1 < shards.size() ?
+      shards[i + 1].shard_info->offset : OBJECT_MAX_SIZE;
+    Extent dummy(s.shard_info->offset);
+    auto begin = extent_map.lower_bound(dummy);
+    auto p = begin;
+    for (; p != extent_map.end() && p->logical_offset < end; ++p) {
+      if (!p->blob->bc.buffer_map.empty()) {
+	break;  // keep shards backing cached data materialized
+      }
+    }
+    if (p != extent_map.end() && p->logical_offset < end) {
+      continue;
+    }
+    while (begin != p) {
+      Extent& e = *begin;
+      begin = extent_map.erase(begin);
+      dropped.insert(e);
+    }
+    s.loaded = false;
+    ++n;
+  }
+  l.unlock();
+  dropped.clear_and_dispose(DeleteDisposer());
+  return n;
+}
+
 BlueStore::extent_map_t::iterator BlueStore::ExtentMap::find(
   uint64_t offset)
 {
@@ -5106,6 +5644,43 @@ BlueStore::OnodeRef BlueStore::Collection::get_onode(
   return onode_space.add_onode(oid, o);
 }
 
+void BlueStore::Collection::prefetch_onodes(const std::vector<ghobject_t>& oids)
+{
+  ceph_assert(ceph_mutex_is_wlocked(lock));
+
+  spg_t pgid;
+  bool is_pg = cid.is_pg(&pgid);
+  std::vector<const ghobject_t*> missing;
+  std::vector<string> keys;
+  for (auto& oid : oids) {
+    if ((is_pg && !oid.match(cnode.bits, pgid.ps())) ||
+	onode_space.contains(oid)) {
+      // get_onode() will complain about the former
+      continue;
+    }
+    missing.push_back(&oid);
+    get_object_key(store->cct, oid, &keys.emplace_back());
+  }
+  if (keys.size() < 2) {
+    return;
+  }
+  std::vector<bufferlist> values;
+  std::vector<int> rvals;
+  store->db->multi_get(PREFIX_OBJ, keys, &values, &rvals);
+  unsigned found = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (rvals[i] < 0 || values[i].length() == 0) {
+      continue;
+    }
+    OnodeRef o(Onode::create_decode(this, *missing[i], keys[i], values[i],
+				    true));
+    onode_space.add_onode(*missing[i], o);
+    ++found;
+  }
+  ldout(store->cct, 20) << __func__ << " " << cid << " loaded " << found
+			<< "/" << keys.size() << " onodes" << dendl;
+}
+
 void BlueStore::Collection::split_cache(
   Collection *dest)
 {
@@ -6283,6 +6858,19 @@ void BlueStore::_init_logger()
   b.add_u64_counter(l_bluestore_onode_shard_misses,
 		    "onode_shard_misses",
 		    "Count of onode shard cache lookups misses");
+  b.add_u64_counter(l_bluestore_onode_shard_compacted,
+		    "onode_shard_compacted",
+		    "Count of onode shards unloaded by compaction");
+  b.add_u64_counter(l_bluestore_onode_shard_unpacked,
+		    "onode_shard_unpacked",
+		    "Count of onode shard misses served from packed copy");
+  b.add_u64_counter(l_bluestore_onode_cache_admitted,
+		    "onode_cache_admitted",
+		    "Count of onodes admitted past the tinylfu window");
+  b.add_u64_counter(l_bluestore_onode_cache_rejected,
+		    "onode_cache_rejected",
+		    "Count of onodes the tinylfu admission filter evicted "
+		    "from the window");
   b.add_u64(l_bluestore_extents, "onode_extents",
 	    "Number of extents in cache");
   b.add_u64(l_bluestore_blobs, "onode_blobs",
@@ -6308,6 +6896,11 @@ void BlueStore::_init_logger()
 	    NULL,
 	    PerfCountersBuilder::PRIO_DEBUGONLY,
 	    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_buffer_cache_admitted, "buffer_cache_admitted",
+		    "Count of buffers admitted past the tinylfu window");
+  b.add_u64_counter(l_bluestore_buffer_cache_rejected, "buffer_cache_rejected",
+		    "Count of buffers the tinylfu admission filter evicted "
+		    "from the window");
   //****************************************
 
   // internal stats
@@ -6848,17 +7441,29 @@ int BlueStore::_create_alloc()
   uint64_t alloc_size = min_alloc_size;
 
   std::string allocator_type = cct->_conf->bluestore_allocator;
+  unsigned cache_shards =
+    cct->_conf.get_val<uint64_t>("bluestore_allocator_cache_shards");
 
   alloc = Allocator::create(
     cct, allocator_type,
     bdev->get_size(),
     alloc_size,
-    "block");
+    // with caching on, the front end owns the "block" admin socket commands
+    cache_shards ? "block.backend" : "block");
   if (!alloc) {
     lderr(cct) << __func__ << " failed to create " << allocator_type << " allocator"
 	       << dendl;
     return -EINVAL;
   }
+  if (cache_shards) {
+    alloc = new CachingAllocator(
+      cct, alloc, cache_shards,
+      cct->_conf.get_val<Option::size_t>("bluestore_allocator_cache_chunk"),
+      std::max<uint64_t>(
+	cct->_conf.get_val<Option::size_t>("bluestore_allocator_cache_max_alloc"),
+	alloc_size),
+      "block");
+  }
 
   // BlueFS will share the same allocator
   shared_alloc.set(alloc, alloc_size);
@@ -8605,6 +9210,41 @@ int BlueStore::dump_bluefs_sizes(ostream& out)
   return r;
 }
 
+void BlueStore::dump_cache_stats(Formatter *f)
+{
+  int onode_count = 0, buffers_bytes = 0;
+  for (auto i: onode_cache_shards) {
+    onode_count += i->_get_num();
+  }
+  for (auto i: buffer_cache_shards) {
+    buffers_bytes += i->_get_bytes();
+  }
+  f->dump_int("bluestore_onode", onode_count);
+  f->dump_int("bluestore_buffers", buffers_bytes);
+
+  auto dump_shard = [f](CacheShard *c) {
+    uint64_t hits = c->hits, misses = c->misses;
+    f->open_object_section("shard");
+    f->dump_unsigned("num", c->_get_num());
+    f->dump_unsigned("hits", hits);
+    f->dump_unsigned("misses", misses);
+    f->dump_float("hit_ratio",
+		  hits + misses ? (double)hits / (hits + misses) : 0.0);
+    f->close_section();
+  };
+  f->dump_string("bluestore_cache_type", cct->_conf->bluestore_cache_type);
+  f->open_array_section("bluestore_onode_shards");
+  for (auto i: onode_cache_shards) {
+    dump_shard(i);
+  }
+  f->close_section();
+  f->open_array_section("bluestore_buffer_shards");
+  for (auto i: buffer_cache_shards) {
+    dump_shard(i);
+  }
+  f->close_section();
+}
+
 void BlueStore::set_cache_shards(unsigned num)
 {
   dout(10) << __func__ << " " << num << dendl;
@@ -12982,14 +13622,23 @@ int BlueStore::omap_get_values(
     const string& prefix = o->get_omap_prefix();
     o->get_omap_key(string(), &final_key);
     size_t base_key_len = final_key.size();
-    for (set<string>::const_iterator p = keys.begin(); p != keys.end(); ++p) {
+    vector<string> final_keys;
+    final_keys.reserve(keys.size());
+    for (auto& k : keys) {
       final_key.resize(base_key_len); // keep prefix
-      final_key += *p;
-      bufferlist val;
-      if (db->get(prefix, final_key, &val) >= 0) {
-	dout(30) << __func__ << "  got " << pretty_binary_string(final_key)
+      final_key += k;
+      final_keys.push_back(final_key);
+    }
+    // one batched lookup instead of a round trip per key
+    vector<bufferlist> vals;
+    vector<int> rvals;
+    db->multi_get(prefix, final_keys, &vals, &rvals);
+    auto p = keys.begin();
+    for (size_t i = 0; i < final_keys.size(); ++i, ++p) {
+      if (rvals[i] >= 0) {
+	dout(30) << __func__ << "  got " << pretty_binary_string(final_keys[i])
 		 << " -> " << *p << dendl;
-	out->insert(make_pair(*p, val));
+	out->insert(make_pair(*p, std::move(vals[i])));
       }
     }
   }
@@ -13516,6 +14165,10 @@ void BlueStore::_txc_state_proc(TransContext *txc)
 	  _txc_apply_kv(txc, true);
 	}
       }
+      if (!kv_sync_shards.empty()) {
+	_kv_sync_shard_queue(txc);
+	return;
+      }
       {
 	std::lock_guard l(kv_lock);
 	kv_queue.push_back(txc);
@@ -14047,11 +14700,46 @@ void BlueStore::_kv_start()
   finisher.start();
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
+
+  ceph_assert(kv_sync_shards.empty());
+  auto num_shards = cct->_conf.get_val<uint64_t>("bluestore_kv_sync_shards");
+  for (unsigned i = 0; i < num_shards; ++i) {
+    auto shard = std::make_unique<KVSyncShard>(this, i);
+    PerfCountersBuilder b(cct, "bluestore-kv-sync-shard-" + stringify(i),
+			  l_bluestore_kv_shard_first, l_bluestore_kv_shard_last);
+    b.add_u64_avg(l_bluestore_kv_shard_batch, "batch_size",
+		  "Txcs committed per kv sync shard commit cycle");
+    b.add_time_avg(l_bluestore_kv_shard_queue_lat, "queue_wait_lat",
+		   "Average wait of a txc in the kv sync shard queue");
+    b.add_time_avg(l_bluestore_kv_shard_commit_lat, "commit_lat",
+		   "Average kv sync shard commit cycle latency");
+    b.add_u64_counter(l_bluestore_kv_shard_commits, "commits",
+		      "kv sync shard commit cycles");
+    shard->logger = b.create_perf_counters();
+    cct->get_perfcounters_collection()->add(shard->logger);
+    shard->thread.create("bstore_kv_shard");
+    kv_sync_shards.emplace_back(std::move(shard));
+  }
+  if (num_shards) {
+    dout(1) << __func__ << " using " << num_shards << " kv sync shards" << dendl;
+  }
 }
 
 void BlueStore::_kv_stop()
 {
   dout(10) << __func__ << dendl;
+  // shards feed the finalize thread, stop them first
+  for (auto& shard : kv_sync_shards) {
+    std::unique_lock l{shard->lock};
+    while (!shard->started) {
+      shard->cond.wait(l);
+    }
+    shard->stop = true;
+    shard->cond.notify_all();
+  }
+  for (auto& shard : kv_sync_shards) {
+    shard->thread.join();
+  }
   {
     std::unique_lock l{kv_lock};
     while (!kv_sync_started) {
@@ -14070,6 +14758,11 @@ void BlueStore::_kv_stop()
   }
   kv_sync_thread.join();
   kv_finalize_thread.join();
+  for (auto& shard : kv_sync_shards) {
+    cct->get_perfcounters_collection()->remove(shard->logger);
+    delete shard->logger;
+  }
+  kv_sync_shards.clear();
   ceph_assert(removed_collections.empty());
   {
     std::lock_guard l(kv_lock);
@@ -14113,9 +14806,11 @@ void BlueStore::_kv_sync_thread()
       kv_submitted = 0;
     }
     ceph_assert(kv_committing.empty());
+    // with kv sync shards there are no commits of ours to piggyback the
+    // deferred cleanup on, so do it as soon as there is some
     if (kv_queue.empty() &&
 	((deferred_done_queue.empty() && deferred_stable_queue.empty()) ||
-	 !deferred_aggressive)) {
+	 !(deferred_aggressive || !kv_sync_shards.empty()))) {
       if (kv_stop)
 	break;
       dout(20) << __func__ << " sleep" << dendl;
@@ -14199,23 +14894,13 @@ void BlueStore::_kv_sync_thread()
       // it.  in either case, we increase the max in the earlier txn
       // we submit.
       uint64_t new_nid_max = 0, new_blobid_max = 0;
-      if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
-	KeyValueDB::Transaction t =
-	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
-	new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
-	bufferlist bl;
-	encode(new_nid_max, bl);
-	t->set(PREFIX_SUPER, "nid_max", bl);
-	dout(10) << __func__ << " new_nid_max " << new_nid_max << dendl;
-      }
-      if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
-	KeyValueDB::Transaction t =
-	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
-	new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
-	bufferlist bl;
-	encode(new_blobid_max, bl);
-	t->set(PREFIX_SUPER, "blobid_max", bl);
-	dout(10) << __func__ << " new_blobid_max " << new_blobid_max << dendl;
+      std::unique_lock id_l{kv_id_prealloc_lock, std::defer_lock};
+      if (_kv_need_id_prealloc()) {
+	if (!kv_sync_shards.empty()) {
+	  id_l.lock();
+	}
+	_kv_prealloc_ids(kv_submitting.empty() ? synct : kv_submitting.front()->t,
+			 &new_nid_max, &new_blobid_max);
       }
 
       for (auto txc : kv_committing) {
@@ -14288,31 +14973,7 @@ void BlueStore::_kv_sync_thread()
       }
 #endif
 
-      {
-	std::unique_lock m{kv_finalize_lock};
-	if (kv_committing_to_finalize.empty()) {
-	  kv_committing_to_finalize.swap(kv_committing);
-	} else {
-	  kv_committing_to_finalize.insert(
-	      kv_committing_to_finalize.end(),
-	      kv_committing.begin(),
-	      kv_committing.end());
-	  kv_committing.clear();
-	}
-	if (deferred_stable_to_finalize.empty()) {
-	  deferred_stable_to_finalize.swap(deferred_stable);
-	} else {
-	  deferred_stable_to_finalize.insert(
-	      deferred_stable_to_finalize.end(),
-	      deferred_stable.begin(),
-	      deferred_stable.end());
-	  deferred_stable.clear();
-	}
-	if (!kv_finalize_in_progress) {
-	  kv_finalize_in_progress = true;
-	  kv_finalize_cond.notify_one();
-	}
-      }
+      _kv_queue_finalize(kv_committing, deferred_stable);
 
       if (new_nid_max) {
 	nid_max = new_nid_max;
@@ -14322,6 +14983,9 @@ void BlueStore::_kv_sync_thread()
 	blobid_max = new_blobid_max;
 	dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
       }
+      if (id_l.owns_lock()) {
+	id_l.unlock();
+      }
 
       {
 	auto finish = mono_clock::now();
@@ -14357,6 +15021,198 @@ void BlueStore::_kv_sync_thread()
   kv_sync_started = false;
 }
 
+void BlueStore::_kv_queue_finalize(
+  deque<TransContext*>& committed,
+  deque<DeferredBatch*>& stable)
+{
+  std::lock_guard l{kv_finalize_lock};
+  if (kv_committing_to_finalize.empty()) {
+    kv_committing_to_finalize.swap(committed);
+  } else {
+    kv_committing_to_finalize.insert(
+      kv_committing_to_finalize.end(),
+      committed.begin(),
+      committed.end());
+    committed.clear();
+  }
+  if (deferred_stable_to_finalize.empty()) {
+    deferred_stable_to_finalize.swap(stable);
+  } else {
+    deferred_stable_to_finalize.insert(
+      deferred_stable_to_finalize.end(),
+      stable.begin(),
+      stable.end());
+    stable.clear();
+  }
+  if (!kv_finalize_in_progress) {
+    kv_finalize_in_progress = true;
+    kv_finalize_cond.notify_one();
+  }
+}
+
+bool BlueStore::_kv_need_id_prealloc() const
+{
+  return nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max ||
+    blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max;
+}
+
+void BlueStore::_kv_prealloc_ids(
+  KeyValueDB::Transaction t,
+  uint64_t *new_nid_max,
+  uint64_t *new_blobid_max)
+{
+  if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
+    *new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
+    bufferlist bl;
+    encode(*new_nid_max, bl);
+    t->set(PREFIX_SUPER, "nid_max", bl);
+    dout(10) << __func__ << " new_nid_max " << *new_nid_max << dendl;
+  }
+  if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
+    *new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
+    bufferlist bl;
+    encode(*new_blobid_max, bl);
+    t->set(PREFIX_SUPER, "blobid_max", bl);
+    dout(10) << __func__ << " new_blobid_max " << *new_blobid_max << dendl;
+  }
+}
+
+void *BlueStore::KVSyncShardThread::entry()
+{
+  shard->store->_kv_sync_shard_thread(shard);
+  return NULL;
+}
+
+void BlueStore::_kv_sync_shard_queue(TransContext *txc)
+{
+  KVSyncShard *shard =
+    kv_sync_shards[txc->osr->get_sequencer_id() % kv_sync_shards.size()].get();
+  std::lock_guard l(shard->lock);
+  shard->queue.push_back(txc);
+  if (!shard->in_progress) {
+    shard->in_progress = true;
+    shard->cond.notify_one();
+  }
+  if (txc->get_state() != TransContext::STATE_KV_SUBMITTED) {
+    shard->queue_unsubmitted.push_back(txc);
+    ++txc->osr->kv_committing_serially;
+  }
+  if (txc->had_ios)
+    shard->ios++;
+  shard->throttle_costs += txc->cost;
+}
+
+/*
+ * Sharded counterpart of _kv_sync_thread.  Each shard group-commits the
+ * txcs of the sequencers hashed to it; deferred write cleanup stays with
+ * the main kv sync thread.  {nid,blobid}_max bumps are serialized across
+ * shards (and the main thread) by kv_id_prealloc_lock, which is held until
+ * the new max is durable so no txc may commit ids beyond a persisted max.
+ */
+void BlueStore::_kv_sync_shard_thread(KVSyncShard *shard)
+{
+  dout(10) << __func__ << " shard " << shard->id << " start" << dendl;
+  std::unique_lock l{shard->lock};
+  ceph_assert(!shard->started);
+  shard->started = true;
+  shard->cond.notify_all();
+
+  while (true) {
+    if (shard->queue.empty()) {
+      if (shard->stop)
+	break;
+      dout(20) << __func__ << " shard " << shard->id << " sleep" << dendl;
+      shard->in_progress = false;
+      shard->cond.wait(l);
+      dout(20) << __func__ << " shard " << shard->id << " wake" << dendl;
+      continue;
+    }
+
+    deque<TransContext*> committing, submitting;
+    deque<DeferredBatch*> no_deferred;
+    committing.swap(shard->queue);
+    submitting.swap(shard->queue_unsubmitted);
+    uint64_t aios = shard->ios;
+    uint64_t costs = shard->throttle_costs;
+    shard->ios = 0;
+    shard->throttle_costs = 0;
+    l.unlock();
+
+    dout(20) << __func__ << " shard " << shard->id
+	     << " committing " << committing.size()
+	     << " submitting " << submitting.size() << dendl;
+
+    auto start = mono_clock::now();
+    if (aios) {
+      // make data ios stable before the metadata referencing them
+      bdev->flush();
+    }
+
+    KeyValueDB::Transaction synct = db->get_transaction();
+    uint64_t new_nid_max = 0, new_blobid_max = 0;
+    std::unique_lock id_l{kv_id_prealloc_lock, std::defer_lock};
+    if (_kv_need_id_prealloc()) {
+      id_l.lock();
+      // another shard may have raised the max while we waited
+      _kv_prealloc_ids(submitting.empty() ? synct : submitting.front()->t,
+		       &new_nid_max, &new_blobid_max);
+      if (!new_nid_max && !new_blobid_max) {
+	id_l.unlock();
+      }
+    }
+
+    for (auto txc : committing) {
+      shard->logger->tinc(l_bluestore_kv_shard_queue_lat,
+			  mono_clock::now() - txc->last_stamp);
+      throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_queued_lat);
+      if (txc->get_state() == TransContext::STATE_KV_QUEUED) {
+	_txc_apply_kv(txc, false);
+	--txc->osr->kv_committing_serially;
+      } else {
+	ceph_assert(txc->get_state() == TransContext::STATE_KV_SUBMITTED);
+      }
+      if (txc->had_ios) {
+	--txc->osr->txc_with_unstable_io;
+      }
+    }
+    throttle.release_kv_throttle(costs);
+
+    int r = db_was_opened_read_only || cct->_conf->bluestore_debug_omit_kv_commit ?
+      0 : db->submit_transaction_sync(synct);
+    ceph_assert(r == 0);
+
+    if (new_nid_max) {
+      nid_max = new_nid_max;
+      dout(10) << __func__ << " nid_max now " << nid_max << dendl;
+    }
+    if (new_blobid_max) {
+      blobid_max = new_blobid_max;
+      dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
+    }
+    if (id_l.owns_lock()) {
+      id_l.unlock();
+    }
+
+    size_t committed_size = committing.size();
+    _kv_queue_finalize(committing, no_deferred);
+
+    auto dur = mono_clock::now() - start;
+    shard->logger->inc(l_bluestore_kv_shard_commits);
+    shard->logger->inc(l_bluestore_kv_shard_batch, committed_size);
+    shard->logger->tinc(l_bluestore_kv_shard_commit_lat, dur);
+    log_latency("kv_sync",
+      l_bluestore_kv_sync_lat,
+      dur,
+      cct->_conf->bluestore_log_op_age);
+    dout(20) << __func__ << " shard " << shard->id
+	     << " committed " << committed_size << " in " << dur << dendl;
+
+    l.lock();
+  }
+  dout(10) << __func__ << " shard " << shard->id << " finish" << dendl;
+  shard->started = false;
+}
+
 void BlueStore::_kv_finalize_thread()
 {
   deque<TransContext*> kv_committed;
@@ -14635,8 +15491,10 @@ void BlueStore::_deferred_aio_finish(OpSequencer *osr)
     deferred_done_queue.emplace_back(b);
 
     // in the normal case, do not bother waking up the kv thread; it will
-    // catch us on the next commit anyway.
-    if (deferred_aggressive && !kv_sync_in_progress) {
+    // catch us on the next commit anyway.  with kv sync shards it commits
+    // nothing else, though.
+    if ((deferred_aggressive || !kv_sync_shards.empty()) &&
+	!kv_sync_in_progress) {
 	kv_sync_in_progress = true;
 	kv_cond.notify_one();
     }
@@ -14893,6 +15751,54 @@ void BlueStore::_txc_aio_submit(TransContext *txc)
   bdev->aio_submit(&txc->ioc);
 }
 
+// Look up the onodes a transaction is about to touch in one batch per
+// collection.  Ops live in their own buffer, so they can be walked
+// without decoding their data.
+void BlueStore::_txc_prefetch_onodes(
+  Transaction *t,
+  const vector<CollectionRef>& cvec,
+  uint64_t min)
+{
+  Transaction::iterator i = t->begin();
+  std::map<uint32_t, std::set<uint32_t>> by_coll;  // cid -> oids
+  while (i.have_op()) {
+    Transaction::Op *op = i.decode_op();
+    switch (op->op) {
+    case Transaction::OP_NOP:
+    case Transaction::OP_CREATE:  // must not exist
+    case Transaction::OP_RMCOLL:
+    case Transaction::OP_MKCOLL:
+    case Transaction::OP_SPLIT_COLLECTION:
+    case Transaction::OP_SPLIT_COLLECTION2:
+    case Transaction::OP_MERGE_COLLECTION:
+    case Transaction::OP_COLL_HINT:
+    case Transaction::OP_COLL_SETATTR:
+    case Transaction::OP_COLL_RMATTR:
+    case Transaction::OP_COLL_RENAME:
+      continue;
+    case Transaction::OP_CLONE:
+    case Transaction::OP_CLONERANGE:
+    case Transaction::OP_CLONERANGE2:
+      by_coll[op->cid].insert(op->dest_oid);
+      break;
+    }
+    by_coll[op->cid].insert(op->oid);
+  }
+  for (auto& [cidx, oidxs] : by_coll) {
+    const CollectionRef& c = cvec[cidx];
+    if (!c || oidxs.size() < min) {
+      continue;
+    }
+    vector<ghobject_t> oids;
+    oids.reserve(oidxs.size());
+    for (auto oidx : oidxs) {
+      oids.push_back(i.get_oid(oidx));
+    }
+    std::unique_lock l(c->lock);
+    c->prefetch_onodes(oids);
+  }
+}
+
 void BlueStore::_txc_add_transaction(TransContext *txc, Transaction *t)
 {
   Transaction::iterator i = t->begin();
@@ -14908,6 +15814,11 @@ void BlueStore::_txc_add_transaction(TransContext *txc, Transaction *t)
   
   vector<OnodeRef> ovec(i.objects.size());
 
+  if (auto min = cct->_conf.get_val<uint64_t>("bluestore_onode_prefetch_min");
+      min > 0 && i.objects.size() >= min) {
+    _txc_prefetch_onodes(t, cvec, min);
+  }
+
   for (int pos = 0; i.have_op(); ++pos) {
     Transaction::Op *op = i.decode_op();
     int r = 0;
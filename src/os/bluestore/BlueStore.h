@@ -169,6 +169,10 @@ enum {
   l_bluestore_onode_misses,
   l_bluestore_onode_shard_hits,
   l_bluestore_onode_shard_misses,
+  l_bluestore_onode_shard_compacted,
+  l_bluestore_onode_shard_unpacked,
+  l_bluestore_onode_cache_admitted,
+  l_bluestore_onode_cache_rejected,
   l_bluestore_extents,
   l_bluestore_blobs,
   //****************************************
@@ -179,6 +183,8 @@ enum {
   l_bluestore_buffer_bytes,
   l_bluestore_buffer_hit_bytes,
   l_bluestore_buffer_miss_bytes,
+  l_bluestore_buffer_cache_admitted,
+  l_bluestore_buffer_cache_rejected,
   //****************************************
 
   // internal stats
@@ -226,6 +232,15 @@ enum {
   l_bluestore_last
 };
 
+enum {
+  l_bluestore_kv_shard_first = 732800,
+  l_bluestore_kv_shard_batch,
+  l_bluestore_kv_shard_queue_lat,
+  l_bluestore_kv_shard_commit_lat,
+  l_bluestore_kv_shard_commits,
+  l_bluestore_kv_shard_last
+};
+
 #define META_POOL_ID ((uint64_t)-1ull)
 using bptr_c_it_t = buffer::ptr::const_iterator;
 
@@ -957,6 +972,9 @@ public:
       unsigned extents = 0;  ///< count extents in this shard
       bool loaded = false;   ///< true if shard is loaded
       bool dirty = false;    ///< true if shard is dirty and needs reencoding
+      /// encoded shard as stored in the db, kept so a compacted shard can be
+      /// re-materialized without a db lookup; empty if unknown or dirty
+      ceph::buffer::list packed;
     };
 
     mempool::bluestore_cache_meta::vector<Shard> shards;    ///< shards
@@ -1135,6 +1153,10 @@ public:
     /// ensure a range of the map is marked dirty
     void dirty_range(uint32_t offset, uint32_t length);
 
+    /// drop decoded extents (and their non-spanning blobs) of clean shards
+    /// that have no cached data; returns the number of shards unloaded
+    unsigned compact_shards();
+
     /// for seek_lextent test
     extent_map_t::iterator find(uint64_t offset);
 
@@ -1322,6 +1344,7 @@ public:
     bool cached;              ///< Onode is logically in the cache
                               /// (it can be pinned and hence physically out
                               /// of it at the moment though)
+    uint8_t cache_private = 0;  ///< opaque cache replacement state
     ExtentMap extent_map;
 
     // track txc's that have not been committed to kv store (and whose
@@ -1446,6 +1469,11 @@ private:
     std::atomic<uint64_t> num = {0};
     boost::circular_buffer<std::shared_ptr<int64_t>> age_bins;
 
+    /// lookup stats of this shard (onodes for onode shards, bytes for
+    /// buffer shards), see dump_cache_stats()
+    std::atomic<uint64_t> hits = {0};
+    std::atomic<uint64_t> misses = {0};
+
     CacheShard(CephContext* cct) : cct(cct), logger(nullptr), age_bins(1) {
       shift_bins();
     }
@@ -1515,9 +1543,14 @@ private:
   /// A Generic onode Cache Shard
   struct OnodeCacheShard : public CacheShard {
     std::array<std::pair<ghobject_t, ceph::mono_clock::time_point>, 64> dumped_onodes;
+    /// keep unpinned onodes with their extent map shards packed
+    const bool compact_extent_map;
 
   public:
-    OnodeCacheShard(CephContext* cct) : CacheShard(cct) {}
+    OnodeCacheShard(CephContext* cct)
+      : CacheShard(cct),
+	compact_extent_map(
+	  cct->_conf.get_val<bool>("bluestore_onode_compact_extent_map")) {}
     static OnodeCacheShard *create(CephContext* cct, std::string type,
                                    PerfCounters *logger);
 
@@ -1532,6 +1565,9 @@ private:
     bool empty() {
       return _get_num() == 0;
     }
+  protected:
+    /// apply bluestore_onode_compact_extent_map to an onode being unpinned
+    void _maybe_compact(Onode* o);
   };
 
   /// A Generic buffer Cache Shard
@@ -1602,6 +1638,8 @@ private:
 
     OnodeRef add_onode(const ghobject_t& oid, OnodeRef& o);
     OnodeRef lookup(const ghobject_t& o);
+    /// like lookup() but does not count as a cache hit or miss
+    bool contains(const ghobject_t& o);
     void rename(OnodeRef& o, const ghobject_t& old_oid,
 		const ghobject_t& new_oid,
 		const mempool::bluestore_cache_meta::string& new_okey);
@@ -1642,6 +1680,8 @@ private:
       return onode_space.cache;
     }
     OnodeRef get_onode(const ghobject_t& oid, bool create, bool is_createop=false);
+    /// load the onodes of oids that are not cached with one kv lookup
+    void prefetch_onodes(const std::vector<ghobject_t>& oids);
 
     // the terminology is confusing here, sorry!
     //
@@ -2268,6 +2308,34 @@ private:
     }
   };
 
+  struct KVSyncShard;
+  struct KVSyncShardThread : public Thread {
+    KVSyncShard *shard;
+    explicit KVSyncShardThread(KVSyncShard *s) : shard(s) {}
+    void *entry() override;
+  };
+
+  /// one of bluestore_kv_sync_shards commit pipelines; an OpSequencer
+  /// is always served by the same shard so per-osr ordering is kept
+  struct KVSyncShard {
+    BlueStore *store;
+    const unsigned id;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::KVSyncShard::lock");
+    ceph::condition_variable cond;
+    bool started = false;
+    bool stop = false;
+    bool in_progress = false;
+    std::deque<TransContext*> queue;             ///< ready, already submitted
+    std::deque<TransContext*> queue_unsubmitted; ///< ready, need submit by shard
+    uint64_t ios = 0;
+    uint64_t throttle_costs = 0;
+    PerfCounters *logger = nullptr;
+    KVSyncShardThread thread;
+
+    KVSyncShard(BlueStore *s, unsigned i)
+      : store(s), id(i), thread(this) {}
+  };
+
   struct BigDeferredWriteContext {
     uint64_t off = 0;     // original logical offset
     uint32_t b_off = 0;   // blob relative offset
@@ -2364,6 +2432,12 @@ private:
   std::deque<DeferredBatch*> deferred_stable_to_finalize; ///< pending finalization
   bool kv_finalize_in_progress = false;
 
+  /// empty unless bluestore_kv_sync_shards > 0
+  std::vector<std::unique_ptr<KVSyncShard>> kv_sync_shards;
+  /// serializes {nid,blobid}_max bumps between kv sync shards
+  ceph::mutex kv_id_prealloc_lock =
+    ceph::make_mutex("BlueStore::kv_id_prealloc_lock");
+
   PerfCounters *logger = nullptr;
 
   std::list<CollectionRef> removed_collections;
@@ -2794,6 +2868,9 @@ private:
 			    std::list<Context*> *on_commits,
 			    TrackedOpRef osd_op=TrackedOpRef());
   void _txc_update_store_statfs(TransContext *txc);
+  void _txc_prefetch_onodes(Transaction *t,
+			    const std::vector<CollectionRef>& cvec,
+			    uint64_t min);
   void _txc_add_transaction(TransContext *txc, Transaction *t);
   void _txc_calc_cost(TransContext *txc);
   void _txc_write_nodes(TransContext *txc, KeyValueDB::Transaction t);
@@ -2821,6 +2898,14 @@ private:
   void _kv_stop();
   void _kv_sync_thread();
   void _kv_finalize_thread();
+  void _kv_sync_shard_thread(KVSyncShard *shard);
+  void _kv_sync_shard_queue(TransContext *txc);
+  void _kv_queue_finalize(std::deque<TransContext*>& committed,
+			  std::deque<DeferredBatch*>& stable);
+  bool _kv_need_id_prealloc() const;
+  void _kv_prealloc_ids(KeyValueDB::Transaction t,
+			uint64_t *new_nid_max,
+			uint64_t *new_blobid_max);
 
   bluestore_deferred_op_t *_get_deferred_op(TransContext *txc, uint64_t len);
   void _deferred_queue(TransContext *txc);
@@ -3009,17 +3094,7 @@ public:
   }
 
   void set_cache_shards(unsigned num) override;
-  void dump_cache_stats(ceph::Formatter *f) override {
-    int onode_count = 0, buffers_bytes = 0;
-    for (auto i: onode_cache_shards) {
-      onode_count += i->_get_num();
-    }
-    for (auto i: buffer_cache_shards) {
-      buffers_bytes += i->_get_bytes();
-    }
-    f->dump_int("bluestore_onode", onode_count);
-    f->dump_int("bluestore_buffers", buffers_bytes);
-  }
+  void dump_cache_stats(ceph::Formatter *f) override;
   void dump_cache_stats(std::ostream& ss) override {
     int onode_count = 0, buffers_bytes = 0;
     for (auto i: onode_cache_shards) {
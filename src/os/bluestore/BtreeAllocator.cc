@@ -395,11 +395,18 @@ int64_t BtreeAllocator::allocate(
       max_alloc_size >= cap) {
     max_alloc_size = p2align(uint64_t(cap), (uint64_t)block_size);
   }
-  std::lock_guard l(lock);
-  return _allocate(want, unit, max_alloc_size, hint, extents);
+  size_t first = extents->size();
+  int64_t r;
+  {
+    std::lock_guard l(lock);
+    r = _allocate(want, unit, max_alloc_size, hint, extents);
+  }
+  trace_allocate(want, unit, max_alloc_size, hint, r, *extents, first);
+  return r;
 }
 
 void BtreeAllocator::release(const interval_set<uint64_t>& release_set) {
+  trace_release(release_set);
   std::lock_guard l(lock);
   _release(release_set);
 }
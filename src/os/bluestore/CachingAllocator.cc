@@ -0,0 +1,257 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "CachingAllocator.h"
+
+#include <limits>
+
+#include "common/debug.h"
+#include "include/intarith.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef  dout_prefix
+#define dout_prefix *_dout << "CachingAllocator(" << get_name() << ") "
+
+CachingAllocator::CachingAllocator(CephContext* _cct,
+				   Allocator* _backend,
+				   unsigned num_shards,
+				   uint64_t _chunk_size,
+				   uint64_t _max_cached_alloc,
+				   std::string_view name)
+  : Allocator(name, _backend->get_capacity(), _backend->get_block_size()),
+    cct(_cct),
+    backend(_backend),
+    chunk_size(p2roundup<uint64_t>(
+      std::max<uint64_t>(_chunk_size, _max_cached_alloc), block_size)),
+    max_cached_alloc(_max_cached_alloc),
+    shards(num_shards)
+{
+  ceph_assert(num_shards > 0);
+  ldout(cct, 10) << __func__ << " backend " << backend->get_type()
+		 << " shards " << num_shards
+		 << " chunk 0x" << std::hex << chunk_size
+		 << " max_cached_alloc 0x" << max_cached_alloc << std::dec
+		 << dendl;
+}
+
+CachingAllocator::~CachingAllocator()
+{
+}
+
+CachingAllocator::shard_t& CachingAllocator::_get_shard()
+{
+  // fixed per thread for the life of the process; a thread that uses
+  // several CachingAllocators maps to the same slot in each
+  static thread_local unsigned slot = std::numeric_limits<unsigned>::max();
+  if (slot == std::numeric_limits<unsigned>::max()) {
+    slot = next_shard++;
+  }
+  return shards[slot % shards.size()];
+}
+
+void CachingAllocator::_carve(shard_t& s, uint64_t want,
+			      uint64_t max_alloc_size,
+			      PExtentVector* extents)
+{
+  if (max_alloc_size == 0) {
+    max_alloc_size = std::numeric_limits<uint32_t>::max();
+  }
+  max_alloc_size = p2align<uint64_t>(max_alloc_size, block_size);
+  uint64_t left = want;
+  auto p = s.free.begin();
+  while (left > 0) {
+    ceph_assert(p != s.free.end());
+    uint64_t len = std::min<uint64_t>(p->length, left);
+    if (!extents->empty() &&
+	extents->back().end() == p->offset &&
+	extents->back().length + len <= max_alloc_size) {
+      extents->back().length += len;
+    } else {
+      len = std::min(len, max_alloc_size);
+      extents->emplace_back(p->offset, len);
+    }
+    p->offset += len;
+    p->length -= len;
+    left -= len;
+    if (p->length == 0) {
+      ++p;
+    }
+  }
+  s.free.erase(s.free.begin(), p);
+  s.bytes -= want;
+  cached -= want;
+}
+
+void CachingAllocator::_drain(shard_t& s, interval_set<uint64_t>* out)
+{
+  for (auto& e : s.free) {
+    out->insert(e.offset, e.length);
+  }
+  cached -= s.bytes;
+  s.free.clear();
+  s.bytes = 0;
+}
+
+int64_t CachingAllocator::_allocate_direct(uint64_t want, uint64_t unit,
+					   uint64_t max_alloc_size,
+					   int64_t hint,
+					   PExtentVector* extents)
+{
+  int64_t r = backend->allocate(want, unit, max_alloc_size, hint, extents);
+  if ((r < 0 || (uint64_t)r < want) && cached > 0) {
+    // the space we are short of may be sitting in the shards
+    uint64_t got = r > 0 ? r : 0;
+    flush_caches();
+    int64_t r2 = backend->allocate(want - got, unit, max_alloc_size, hint,
+				   extents);
+    if (r2 > 0) {
+      r = got + r2;
+    }
+  }
+  return r;
+}
+
+int64_t CachingAllocator::allocate(
+  uint64_t want,
+  uint64_t unit,
+  uint64_t max_alloc_size,
+  int64_t hint,
+  PExtentVector* extents)
+{
+  size_t first = extents->size();
+  int64_t r = _allocate(want, unit, max_alloc_size, hint, extents);
+  trace_allocate(want, unit, max_alloc_size, hint, r, *extents, first);
+  return r;
+}
+
+int64_t CachingAllocator::_allocate(
+  uint64_t want,
+  uint64_t unit,
+  uint64_t max_alloc_size,
+  int64_t hint,
+  PExtentVector* extents)
+{
+  if (want > max_cached_alloc || unit != (uint64_t)block_size ||
+      want % unit != 0) {
+    return _allocate_direct(want, unit, max_alloc_size, hint, extents);
+  }
+  auto& s = _get_shard();
+  interval_set<uint64_t> leftover;
+  {
+    std::lock_guard l(s.lock);
+    if (s.bytes >= want) {
+      _carve(s, want, max_alloc_size, extents);
+      ++hits;
+      return want;
+    }
+    // too small to serve this request; give it back so it can merge
+    // with its neighbours rather than linger as a fragment
+    _drain(s, &leftover);
+  }
+  ++misses;
+  if (!leftover.empty()) {
+    backend->release(leftover);
+  }
+
+  // refill without holding the shard lock; the backend may take a while
+  PExtentVector chunk;
+  int64_t r = backend->allocate(chunk_size, block_size, chunk_size, hint,
+				&chunk);
+  if (r > 0) {
+    ++refills;
+    std::lock_guard l(s.lock);
+    s.free.insert(s.free.end(), chunk.begin(), chunk.end());
+    s.bytes += r;
+    cached += r;
+    if (s.bytes >= want) {
+      _carve(s, want, max_alloc_size, extents);
+      return want;
+    }
+  }
+  return _allocate_direct(want, unit, max_alloc_size, hint, extents);
+}
+
+void CachingAllocator::release(const interval_set<uint64_t>& release_set)
+{
+  trace_release(release_set);
+  backend->release(release_set);
+}
+
+void CachingAllocator::flush_caches()
+{
+  interval_set<uint64_t> to_release;
+  for (auto& s : shards) {
+    std::lock_guard l(s.lock);
+    _drain(s, &to_release);
+  }
+  if (!to_release.empty()) {
+    ldout(cct, 10) << __func__ << " releasing 0x" << std::hex
+		   << to_release.size() << std::dec << " bytes in "
+		   << to_release.num_intervals() << " extents" << dendl;
+    backend->release(to_release);
+  }
+}
+
+void CachingAllocator::dump()
+{
+  backend->dump();
+  ldout(cct, 0) << __func__ << " cached 0x" << std::hex << cached
+		<< std::dec << " hits " << hits << " misses " << misses
+		<< " refills " << refills << dendl;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    auto& s = shards[i];
+    std::lock_guard l(s.lock);
+    ldout(cct, 0) << __func__ << " shard " << i << " 0x" << std::hex
+		  << s.bytes << std::dec << " in " << s.free.size()
+		  << " extents" << dendl;
+  }
+}
+
+void CachingAllocator::foreach(
+  std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  backend->foreach(notify);
+  for (auto& s : shards) {
+    PExtentVector copy;
+    {
+      std::lock_guard l(s.lock);
+      copy = s.free;
+    }
+    for (auto& e : copy) {
+      notify(e.offset, e.length);
+    }
+  }
+}
+
+void CachingAllocator::init_add_free(uint64_t offset, uint64_t length)
+{
+  if (cached) {
+    flush_caches();
+  }
+  backend->init_add_free(offset, length);
+}
+
+void CachingAllocator::init_rm_free(uint64_t offset, uint64_t length)
+{
+  if (cached) {
+    flush_caches();
+  }
+  backend->init_rm_free(offset, length);
+}
+
+uint64_t CachingAllocator::get_free()
+{
+  return backend->get_free() + cached;
+}
+
+double CachingAllocator::get_fragmentation()
+{
+  return backend->get_fragmentation();
+}
+
+void CachingAllocator::shutdown()
+{
+  flush_caches();
+  backend->shutdown();
+}
@@ -0,0 +1,107 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Allocator.h"
+#include "include/spinlock.h"
+
+/*
+ * Allocator front end with per-shard allocation caches.
+ *
+ * Every backend allocator serializes allocate() on a single lock, which
+ * makes allocation a point of contention for concurrent writers.  This
+ * front end gives each shard a small private pool of free space carved
+ * out of chunks taken from the backend.  Threads are spread over shards
+ * round-robin on first use, so small allocations (up to max_cached_alloc
+ * bytes, in units of the block size) are served from an uncontended
+ * shard spinlock and never touch the backend lock.
+ *
+ * Releases always go to the backend, so freed space merges with its
+ * neighbours instead of being stranded in a shard.  When a shard cannot
+ * satisfy a request, its leftover (smaller than the request, i.e. the
+ * fragment) is handed back to the backend before a new chunk is taken.
+ * If the backend runs short, all shards are flushed and the request is
+ * retried against the backend so cached space never causes ENOSPC.
+ */
+class CachingAllocator : public Allocator {
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  struct alignas(CACHE_LINE_SIZE) shard_t {
+    ceph::spinlock lock;
+    PExtentVector free;   ///< cached extents, consumed from the front
+    uint64_t bytes = 0;   ///< total bytes in free
+  };
+
+  CephContext* cct;
+  std::unique_ptr<Allocator> backend;
+  const uint64_t chunk_size;
+  const uint64_t max_cached_alloc;
+  std::vector<shard_t> shards;
+  std::atomic<unsigned> next_shard = {0};
+
+  std::atomic<uint64_t> cached = {0};  ///< bytes held by all shards
+  std::atomic<uint64_t> hits = {0};
+  std::atomic<uint64_t> misses = {0};
+  std::atomic<uint64_t> refills = {0};
+
+  shard_t& _get_shard();
+  void _carve(shard_t& s, uint64_t want, uint64_t max_alloc_size,
+	      PExtentVector* extents);
+  // take the shard's extents, leaving it empty
+  void _drain(shard_t& s, interval_set<uint64_t>* out);
+  int64_t _allocate(uint64_t want, uint64_t unit, uint64_t max_alloc_size,
+		    int64_t hint, PExtentVector* extents);
+  int64_t _allocate_direct(uint64_t want, uint64_t unit,
+			   uint64_t max_alloc_size, int64_t hint,
+			   PExtentVector* extents);
+
+public:
+  /// takes ownership of backend
+  CachingAllocator(CephContext* cct,
+		   Allocator* backend,
+		   unsigned num_shards,
+		   uint64_t chunk_size,
+		   uint64_t max_cached_alloc,
+		   std::string_view name);
+  ~CachingAllocator() override;
+
+  const char* get_type() const override {
+    return backend->get_type();
+  }
+
+  int64_t allocate(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    int64_t hint,
+    PExtentVector* extents) override;
+
+  void release(const interval_set<uint64_t>& release_set) override;
+
+  void dump() override;
+  void foreach(
+    std::function<void(uint64_t offset, uint64_t length)> notify) override;
+
+  void init_add_free(uint64_t offset, uint64_t length) override;
+  void init_rm_free(uint64_t offset, uint64_t length) override;
+
+  uint64_t get_free() override;
+  double get_fragmentation() override;
+
+  void shutdown() override;
+
+  /// return all cached space to the backend
+  void flush_caches();
+
+  uint64_t get_cached() const {
+    return cached;
+  }
+  Allocator* get_backend() {
+    return backend.get();
+  }
+};
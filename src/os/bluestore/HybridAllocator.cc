@@ -61,6 +61,7 @@ int64_t HybridAllocator::allocate(
       0;
   };
 
+  size_t first = extents->size();
   std::lock_guard l(lock);
   // try bitmap first to avoid unneeded contiguous extents split if
   // desired amount is less than shortes range in AVL
@@ -87,10 +88,13 @@ int64_t HybridAllocator::allocate(
       ceph_assert(orig_size == extents->size());
     }
   }
-  return res ? res : -ENOSPC;
+  res = res ? res : -ENOSPC;
+  trace_allocate(want, unit, max_alloc_size, hint, res, *extents, first);
+  return res;
 }
 
 void HybridAllocator::release(const interval_set<uint64_t>& release_set) {
+  trace_release(release_set);
   std::lock_guard l(lock);
   // this will attempt to put free ranges into AvlAllocator first and
   // fallback to bitmap one via _try_insert_range call
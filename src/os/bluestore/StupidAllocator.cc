@@ -178,6 +178,8 @@ int64_t StupidAllocator::allocate(
   uint64_t offset = 0;
   uint32_t length = 0;
   int res = 0;
+  const int64_t orig_hint = hint;
+  const size_t orig_size = extents->size();
 
   if (max_alloc_size == 0) {
     max_alloc_size = want_size;
@@ -214,6 +216,9 @@ int64_t StupidAllocator::allocate(
     hint = offset + length;
   }
 
+  trace_allocate(want_size, alloc_unit, max_alloc_size, orig_hint,
+		 allocated_size ? int64_t(allocated_size) : -ENOSPC,
+		 *extents, orig_size);
   if (allocated_size == 0) {
     return -ENOSPC;
   }
@@ -223,6 +228,7 @@ int64_t StupidAllocator::allocate(
 void StupidAllocator::release(
   const interval_set<uint64_t>& release_set)
 {
+  trace_release(release_set);
   std::lock_guard l(lock);
   for (interval_set<uint64_t>::const_iterator p = release_set.begin();
        p != release_set.end();
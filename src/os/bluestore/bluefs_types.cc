@@ -2,8 +2,10 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <algorithm>
+#include <cstring>
 #include "bluefs_types.h"
 #include "common/Formatter.h"
+#include "include/byteorder.h"
 #include "include/denc.h"
 #include "include/uuid.h"
 #include "include/stringify.h"
@@ -77,19 +79,23 @@ void bluefs_layout_t::generate_test_instances(list<bluefs_layout_t*>& ls)
 
 void bluefs_super_t::encode(bufferlist& bl) const
 {
-  ENCODE_START(2, 1, bl);
+  // stay decodable by older releases unless an incompat feature is set
+  ENCODE_START(features ? 3 : 2, features ? 3 : 1, bl);
   encode(uuid, bl);
   encode(osd_uuid, bl);
   encode(version, bl);
   encode(block_size, bl);
   encode(log_fnode, bl);
   encode(memorized_layout, bl);
+  if (features) {
+    encode(features, bl);
+  }
   ENCODE_FINISH(bl);
 }
 
 void bluefs_super_t::decode(bufferlist::const_iterator& p)
 {
-  DECODE_START(2, p);
+  DECODE_START(3, p);
   decode(uuid, p);
   decode(osd_uuid, p);
   decode(version, p);
@@ -98,6 +104,11 @@ void bluefs_super_t::decode(bufferlist::const_iterator& p)
   if (struct_v >= 2) {
     decode(memorized_layout, p);
   }
+  if (struct_v >= 3) {
+    decode(features, p);
+  } else {
+    features = 0;
+  }
   DECODE_FINISH(p);
 }
 
@@ -108,6 +119,7 @@ void bluefs_super_t::dump(Formatter *f) const
   f->dump_unsigned("version", version);
   f->dump_unsigned("block_size", block_size);
   f->dump_object("log_fnode", log_fnode);
+  f->dump_unsigned("features", features);
 }
 
 void bluefs_super_t::generate_test_instances(list<bluefs_super_t*>& ls)
@@ -116,6 +128,9 @@ void bluefs_super_t::generate_test_instances(list<bluefs_super_t*>& ls)
   ls.push_back(new bluefs_super_t);
   ls.back()->version = 1;
   ls.back()->block_size = 4096;
+  ls.push_back(new bluefs_super_t);
+  ls.back()->version = 2;
+  ls.back()->features = bluefs_super_t::FEATURE_WAL_ENVELOPE;
 }
 
 ostream& operator<<(ostream& out, const bluefs_super_t& s)
@@ -125,6 +140,7 @@ ostream& operator<<(ostream& out, const bluefs_super_t& s)
 	     << " v " << s.version
 	     << " block_size 0x" << std::hex << s.block_size
 	     << " log_fnode 0x" << s.log_fnode
+	     << " features 0x" << s.features
 	     << std::dec << ")";
 }
 
@@ -186,6 +202,10 @@ void bluefs_fnode_t::dump(Formatter *f) const
   f->dump_unsigned("ino", ino);
   f->dump_unsigned("size", size);
   f->dump_stream("mtime") << mtime;
+  if (is_wal_envelope()) {
+    f->dump_unsigned("encoding", encoding);
+    f->dump_unsigned("wal_nonce", wal_nonce);
+  }
   f->open_array_section("extents");
   for (auto& p : extents)
     f->dump_object("extent", p);
@@ -201,17 +221,60 @@ void bluefs_fnode_t::generate_test_instances(list<bluefs_fnode_t*>& ls)
   ls.back()->mtime = utime_t(123,45);
   ls.back()->extents.push_back(bluefs_extent_t(0, 1048576, 4096));
   ls.back()->__unused__ = 1;
+  ls.push_back(new bluefs_fnode_t(*ls.back()));
+  ls.back()->encoding = bluefs_fnode_t::ENCODING_WAL_ENVELOPE;
+  ls.back()->wal_nonce = 0x1234;
 }
 
 ostream& operator<<(ostream& out, const bluefs_fnode_t& file)
 {
-  return out << "file(ino " << file.ino
-	     << " size 0x" << std::hex << file.size << std::dec
-	     << " mtime " << file.mtime
-	     << " allocated " << std::hex << file.allocated << std::dec
-	     << " alloc_commit " << std::hex << file.allocated_commited << std::dec
-	     << " extents " << file.extents
-	     << ")";
+  out << "file(ino " << file.ino
+      << " size 0x" << std::hex << file.size << std::dec
+      << " mtime " << file.mtime
+      << " allocated " << std::hex << file.allocated << std::dec
+      << " alloc_commit " << std::hex << file.allocated_commited << std::dec
+      << " extents " << file.extents;
+  if (file.is_wal_envelope()) {
+    out << " wal_envelope nonce 0x" << std::hex << file.wal_nonce << std::dec;
+  }
+  return out << ")";
+}
+
+// bluefs_wal_envelope_t
+
+void bluefs_wal_envelope_t::encode(char* p) const
+{
+  ceph_le32 magic_le, len_le, crc_le;
+  ceph_le64 nonce_le, seq_le;
+  magic_le = MAGIC;
+  len_le = len;
+  crc_le = crc;
+  nonce_le = nonce;
+  seq_le = seq;
+  memcpy(p, &magic_le, 4);
+  memcpy(p + 4, &len_le, 4);
+  memcpy(p + 8, &crc_le, 4);
+  memcpy(p + 12, &nonce_le, 8);
+  memcpy(p + 20, &seq_le, 8);
+}
+
+bool bluefs_wal_envelope_t::decode(const char* p)
+{
+  ceph_le32 magic_le, len_le, crc_le;
+  ceph_le64 nonce_le, seq_le;
+  memcpy(&magic_le, p, 4);
+  if ((uint32_t)magic_le != MAGIC) {
+    return false;
+  }
+  memcpy(&len_le, p + 4, 4);
+  memcpy(&crc_le, p + 8, 4);
+  memcpy(&nonce_le, p + 12, 8);
+  memcpy(&seq_le, p + 20, 8);
+  len = len_le;
+  crc = crc_le;
+  nonce = nonce_le;
+  seq = seq_le;
+  return true;
 }
 
 // bluefs_fnode_delta_t
@@ -59,10 +59,17 @@ WRITE_CLASS_DENC(bluefs_fnode_delta_t)
 std::ostream& operator<<(std::ostream& out, const bluefs_fnode_delta_t& delta);
 
 struct bluefs_fnode_t {
+  enum {
+    ENCODING_PLAIN = 0,
+    ENCODING_WAL_ENVELOPE = 1, ///< data is a sequence of bluefs_wal_envelope_t
+  };
+
   uint64_t ino;
   uint64_t size;
   utime_t mtime;
   uint8_t __unused__ = 0; // was prefer_bdev
+  uint8_t encoding = ENCODING_PLAIN;
+  uint64_t wal_nonce = 0; ///< tags envelopes of the current writer session
   mempool::bluefs::vector<bluefs_extent_t> extents;
 
   // precalculated logical offsets for extents vector entries
@@ -77,6 +84,7 @@ struct bluefs_fnode_t {
     ino(_ino), size(_size), mtime(_mtime), allocated(0), allocated_commited(0) {}
   bluefs_fnode_t(const bluefs_fnode_t& other) :
     ino(other.ino), size(other.size), mtime(other.mtime),
+    encoding(other.encoding), wal_nonce(other.wal_nonce),
     allocated(other.allocated),
     allocated_commited(other.allocated_commited) {
     clone_extents(other);
@@ -86,6 +94,10 @@ struct bluefs_fnode_t {
     return allocated;
   }
 
+  bool is_wal_envelope() const {
+    return encoding == ENCODING_WAL_ENVELOPE;
+  }
+
   void recalc_allocated() {
     allocated = 0;
     extents_index.reserve(extents.size());
@@ -105,18 +117,27 @@ struct bluefs_fnode_t {
     _denc_friend(*this, p);
   }
   void decode(ceph::buffer::ptr::const_iterator& p) {
+    encoding = ENCODING_PLAIN;
+    wal_nonce = 0;
     _denc_friend(*this, p);
     recalc_allocated();
   }
   template<typename T, typename P>
   friend std::enable_if_t<std::is_same_v<bluefs_fnode_t, std::remove_const_t<T>>>
   _denc_friend(T& v, P& p) {
-    DENC_START(1, 1, p);
+    // plain files keep the v1 layout.  DENC does not enforce compat, so a
+    // v1 decoder would silently skip the encoding; older releases are kept
+    // away from envelope-encoded files by bluefs_super_t::FEATURE_WAL_ENVELOPE
+    DENC_START(v.encoding ? 2 : 1, 1, p);
     denc_varint(v.ino, p);
     denc_varint(v.size, p);
     denc(v.mtime, p);
     denc(v.__unused__, p);
     denc(v.extents, p);
+    if (struct_v >= 2) {
+      denc(v.encoding, p);
+      denc(v.wal_nonce, p);
+    }
     DENC_FINISH(p);
   }
   void reset_delta() {
@@ -160,6 +181,8 @@ struct bluefs_fnode_t {
     std::swap(ino, other.ino);
     std::swap(size, other.size);
     std::swap(mtime, other.mtime);
+    std::swap(encoding, other.encoding);
+    std::swap(wal_nonce, other.wal_nonce);
     swap_extents(other);
   }
   void swap_extents(bluefs_fnode_t& other) {
@@ -187,6 +210,25 @@ WRITE_CLASS_DENC(bluefs_fnode_t)
 
 std::ostream& operator<<(std::ostream& out, const bluefs_fnode_t& file);
 
+/// Header preceding each flushed chunk of an envelope-encoded WAL file.
+/// Fixed size so the file can be walked without an index; a chunk is
+/// valid if it carries the file's current nonce, the next seq and a
+/// matching payload crc, which lets mount find the tail without relying
+/// on the file size recorded in the BlueFS log.
+struct bluefs_wal_envelope_t {
+  static constexpr uint32_t MAGIC = 0x45564e57; // "WNVE"
+  static constexpr size_t HEADER_SIZE = 28;
+
+  uint64_t nonce = 0;
+  uint64_t seq = 0;
+  uint32_t len = 0;  ///< payload bytes following the header
+  uint32_t crc = 0;  ///< crc32c of the payload
+
+  void encode(char* p) const;
+  /// @return false if the bytes do not look like an envelope header
+  bool decode(const char* p);
+};
+
 struct bluefs_layout_t {
   unsigned shared_bdev = 0;         ///< which bluefs bdev we are sharing
   bool dedicated_db = false;        ///< whether block.db is present
@@ -210,6 +252,11 @@ struct bluefs_layout_t {
 WRITE_CLASS_ENCODER(bluefs_layout_t)
 
 struct bluefs_super_t {
+  enum {
+    /// files may be envelope-encoded (bluefs_fnode_t::ENCODING_WAL_ENVELOPE)
+    FEATURE_WAL_ENVELOPE = 1 << 0,
+  };
+
   uuid_d uuid;      ///< unique to this bluefs instance
   uuid_d osd_uuid;  ///< matches the osd that owns us
   uint64_t version;
@@ -219,10 +266,18 @@ struct bluefs_super_t {
 
   std::optional<bluefs_layout_t> memorized_layout;
 
+  /// incompat features; any set bit bumps the encoding compat so that
+  /// releases which do not know about them refuse to mount
+  uint64_t features = 0;
+
   bluefs_super_t()
     : version(0),
       block_size(4096) { }
 
+  bool has_feature(uint64_t f) const {
+    return (features & f) == f;
+  }
+
   uint64_t block_mask() const {
     return ~((uint64_t)block_size - 1);
   }
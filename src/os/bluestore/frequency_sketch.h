@@ -0,0 +1,104 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "include/mempool.h"
+
+/**
+ * Count-min sketch with 4-bit saturating counters and periodic aging,
+ * as used by the TinyLFU admission filter.  Counters are halved once the
+ * number of recorded accesses reaches 10x the sketch width, so the
+ * estimate tracks recent popularity rather than all-time popularity.
+ *
+ * Not thread safe; the caller (a cache shard) serializes access.
+ */
+class frequency_sketch_t {
+  static constexpr unsigned DEPTH = 4;
+  static constexpr uint8_t MAX_COUNT = 15;
+  static constexpr size_t MIN_WIDTH = 64;
+  static constexpr size_t MAX_WIDTH = 1ull << 22;
+  static constexpr std::array<uint64_t, DEPTH> SEEDS = {
+    0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+    0x9ae16a3b2f90404full, 0xcbf29ce484222325ull };
+
+  mempool::bluestore_cache_other::vector<uint8_t> table;
+  size_t width_mask = 0;
+  uint64_t additions = 0;
+  uint64_t sample_size = 0;
+
+  size_t index(uint64_t h, unsigned row) const {
+    h = (h + SEEDS[row]) * SEEDS[row];
+    h ^= h >> 32;
+    return row * (width_mask + 1) + (h & width_mask);
+  }
+
+  void halve() {
+    for (auto& c : table) {
+      c >>= 1;
+    }
+    additions /= 2;
+  }
+
+public:
+  frequency_sketch_t() {
+    resize(MIN_WIDTH);
+  }
+
+  /// size the sketch for about n distinct items; drops recorded history
+  void resize(size_t n) {
+    size_t width = MIN_WIDTH;
+    while (width < n && width < MAX_WIDTH) {
+      width <<= 1;
+    }
+    table.assign(DEPTH * width, 0);
+    width_mask = width - 1;
+    additions = 0;
+    sample_size = 10 * width;
+  }
+
+  /// grow (never shrink) so that n items fit without excess collisions
+  void ensure_capacity(size_t n) {
+    if (n > width_mask + 1 && width_mask + 1 < MAX_WIDTH) {
+      resize(n * 2);
+    }
+  }
+
+  size_t get_width() const {
+    return width_mask + 1;
+  }
+
+  void increment(uint64_t h) {
+    bool added = false;
+    for (unsigned i = 0; i < DEPTH; ++i) {
+      auto& c = table[index(h, i)];
+      if (c < MAX_COUNT) {
+	++c;
+	added = true;
+      }
+    }
+    if (added && ++additions >= sample_size) {
+      halve();
+    }
+  }
+
+  unsigned estimate(uint64_t h) const {
+    uint8_t r = MAX_COUNT;
+    for (unsigned i = 0; i < DEPTH; ++i) {
+      r = std::min(r, table[index(h, i)]);
+    }
+    return r;
+  }
+};
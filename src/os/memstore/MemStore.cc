@@ -49,6 +49,13 @@ int MemStore::mount()
   int r = _load();
   if (r < 0)
     return r;
+  if (cct->_conf->memstore_page_set &&
+      cct->_conf->memstore_page_pool_bytes > 0) {
+    const size_t page_size = cct->_conf->memstore_page_size;
+    PagePool::instance().reserve(
+      Page::buffer_size(page_size),
+      cct->_conf->memstore_page_pool_bytes / page_size);
+  }
   finisher.start();
   return 0;
 }
@@ -1113,12 +1120,10 @@ int MemStore::_remove(const coll_t& cid, const ghobject_t& oid)
     return -ENOENT;
   std::lock_guard l{c->lock};
 
-  auto i = c->object_hash.find(oid);
-  if (i == c->object_hash.end())
+  ObjectRef o = c->_remove_object(oid);
+  if (!o)
     return -ENOENT;
-  used_bytes -= i->second->get_size();
-  c->object_hash.erase(i);
-  c->object_map.erase(oid);
+  used_bytes -= o->get_size();
 
   return 0;
 }
@@ -1378,13 +1383,12 @@ int MemStore::_collection_add(const coll_t& cid, const coll_t& ocid, const ghobj
   std::scoped_lock l{std::min(&(*c), &(*oc))->lock,
 		     std::max(&(*c), &(*oc))->lock};
 
-  if (c->object_hash.count(oid))
+  if (c->get_object(oid))
     return -EEXIST;
-  if (oc->object_hash.count(oid) == 0)
+  ObjectRef o = oc->get_object(oid);
+  if (!o)
     return -ENOENT;
-  ObjectRef o = oc->object_hash[oid];
-  c->object_map[oid] = o;
-  c->object_hash[oid] = o;
+  c->_add_object(oid, std::move(o));
   return 0;
 }
 
@@ -1404,17 +1408,12 @@ int MemStore::_collection_move_rename(const coll_t& oldcid, const ghobject_t& ol
   ceph_assert(&(*c) == &(*oc));
 
   std::lock_guard l{c->lock};
-  if (c->object_hash.count(oid))
+  if (c->get_object(oid))
     return -EEXIST;
-  if (oc->object_hash.count(oldoid) == 0)
+  ObjectRef o = oc->_remove_object(oldoid);
+  if (!o)
     return -ENOENT;
-  {
-    ObjectRef o = oc->object_hash[oldoid];
-    c->object_map[oid] = o;
-    c->object_hash[oid] = o;
-    oc->object_map.erase(oldoid);
-    oc->object_hash.erase(oldoid);
-  }
+  c->_add_object(oid, std::move(o));
   return 0;
 }
 
@@ -1437,10 +1436,8 @@ int MemStore::_split_collection(const coll_t& cid, uint32_t bits, uint32_t match
   while (p != sc->object_map.end()) {
     if (p->first.match(bits, match)) {
       dout(20) << " moving " << p->first << dendl;
-      dc->object_map.insert(std::make_pair(p->first, p->second));
-      dc->object_hash.insert(std::make_pair(p->first, p->second));
-      sc->object_hash.erase(p->first);
-      sc->object_map.erase(p++);
+      ghobject_t oid = (p++)->first;
+      dc->_add_object(oid, sc->_remove_object(oid));
     } else {
       ++p;
     }
@@ -1469,10 +1466,8 @@ int MemStore::_merge_collection(const coll_t& cid, uint32_t bits, coll_t dest)
     auto p = sc->object_map.begin();
     while (p != sc->object_map.end()) {
       dout(20) << " moving " << p->first << dendl;
-      dc->object_map.insert(std::make_pair(p->first, p->second));
-      dc->object_hash.insert(std::make_pair(p->first, p->second));
-      sc->object_hash.erase(p->first);
-      sc->object_map.erase(p++);
+      ghobject_t oid = (p++)->first;
+      dc->_add_object(oid, sc->_remove_object(oid));
     }
 
     dc->bits = bits;
@@ -16,6 +16,7 @@
 #ifndef CEPH_MEMSTORE_H
 #define CEPH_MEMSTORE_H
 
+#include <array>
 #include <atomic>
 #include <mutex>
 #include <boost/intrusive_ptr.hpp>
@@ -93,10 +94,20 @@ public:
     int bits = 0;
     CephContext *cct;
     bool use_page_set;
-    ceph::unordered_map<ghobject_t, ObjectRef> object_hash;  ///< for lookup
+
+    /// the lookup table is striped so that the readers and writers of
+    /// different objects do not all go through the same lock
+    struct ObjectShard {
+      ceph::shared_mutex lock{
+	ceph::make_shared_mutex("MemStore::Collection::ObjectShard::lock",
+				true, false)};
+      ceph::unordered_map<ghobject_t, ObjectRef> object_hash;
+    };
+    static constexpr size_t OBJECT_SHARDS = 32;
+    std::array<ObjectShard, OBJECT_SHARDS> object_shards;  ///< for lookup
     std::map<ghobject_t, ObjectRef> object_map;        ///< for iteration
     std::map<std::string,ceph::buffer::ptr> xattr;
-    /// for object_{map,hash}
+    /// for object_map; taken before the lock of any object shard
     ceph::shared_mutex lock{
       ceph::make_shared_mutex("MemStore::Collection::lock", true, false)};
 
@@ -113,22 +124,51 @@ public:
     // reads and writes, so we will never see them concurrently at this
     // level.
 
-    ObjectRef get_object(ghobject_t oid) {
-      std::shared_lock l{lock};
-      auto o = object_hash.find(oid);
-      if (o == object_hash.end())
+    ObjectShard& get_shard(const ghobject_t& oid) {
+      return object_shards[std::hash<ghobject_t>{}(oid) % OBJECT_SHARDS];
+    }
+
+    ObjectRef get_object(const ghobject_t& oid) {
+      auto& shard = get_shard(oid);
+      std::shared_lock l{shard.lock};
+      auto o = shard.object_hash.find(oid);
+      if (o == shard.object_hash.end())
 	return ObjectRef();
       return o->second;
     }
 
-    ObjectRef get_or_create_object(ghobject_t oid) {
+    ObjectRef get_or_create_object(const ghobject_t& oid) {
+      if (auto o = get_object(oid); o) {
+	return o;
+      }
       std::lock_guard l{lock};
-      auto result = object_hash.emplace(oid, ObjectRef());
+      auto& shard = get_shard(oid);
+      std::lock_guard sl{shard.lock};
+      auto result = shard.object_hash.emplace(oid, ObjectRef());
       if (result.second)
         object_map[oid] = result.first->second = create_object();
       return result.first->second;
     }
 
+    // the caller holds lock exclusively
+    void _add_object(const ghobject_t& oid, ObjectRef o) {
+      auto& shard = get_shard(oid);
+      std::lock_guard sl{shard.lock};
+      shard.object_hash[oid] = o;
+      object_map[oid] = std::move(o);
+    }
+    ObjectRef _remove_object(const ghobject_t& oid) {
+      auto& shard = get_shard(oid);
+      std::lock_guard sl{shard.lock};
+      auto i = shard.object_hash.find(oid);
+      if (i == shard.object_hash.end())
+	return ObjectRef();
+      ObjectRef o = std::move(i->second);
+      shard.object_hash.erase(i);
+      object_map.erase(oid);
+      return o;
+    }
+
     void encode(ceph::buffer::list& bl) const {
       ENCODE_START(1, 1, bl);
       encode(xattr, bl);
@@ -152,8 +192,7 @@ public:
 	decode(k, p);
 	auto o = create_object();
 	o->decode(p);
-	object_map.insert(std::make_pair(k, o));
-	object_hash.insert(std::make_pair(k, o));
+	_add_object(k, std::move(o));
       }
       DECODE_FINISH(p);
     }
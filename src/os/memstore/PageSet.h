@@ -25,6 +25,102 @@
 
 #include "include/encoding.h"
 
+// Keeps the buffers of freed pages so that they can be handed out again
+// without going through the allocator.  Only buffers of the configured
+// size are kept, up to the configured count; each thread also keeps a
+// few of them to itself so that most pages are recycled without taking
+// the pool lock.  Until reserve() is called nothing is kept.
+class PagePool {
+  std::mutex mutex;
+  std::vector<char*> free;
+  std::atomic<size_t> buffer_size = 0;
+  std::atomic<size_t> max_free = 0;
+
+  static constexpr size_t THREAD_CACHE_SIZE = 16;
+  struct ThreadCache {
+    std::vector<char*> free;
+    size_t buffer_size = 0;
+    ~ThreadCache() {
+      for (auto buffer : free)
+        delete[] buffer;
+    }
+  };
+  static ThreadCache& thread_cache() {
+    static thread_local ThreadCache cache;
+    return cache;
+  }
+
+ public:
+  static PagePool& instance() {
+    static PagePool pool;
+    return pool;
+  }
+  ~PagePool() {
+    for (auto buffer : free)
+      delete[] buffer;
+  }
+
+  // keep up to count buffers of size bytes, and allocate them now
+  void reserve(size_t size, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size != buffer_size) {
+      for (auto buffer : free)
+        delete[] buffer;
+      free.clear();
+      buffer_size = size;
+    }
+    max_free = count;
+    free.reserve(count);
+    while (free.size() < count)
+      free.push_back(new char[size]);
+  }
+
+  char* get(size_t size) {
+    auto& cache = thread_cache();
+    if (size == cache.buffer_size && !cache.free.empty()) {
+      auto buffer = cache.free.back();
+      cache.free.pop_back();
+      return buffer;
+    }
+    if (size == buffer_size) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (size == buffer_size && !free.empty()) {
+        auto buffer = free.back();
+        free.pop_back();
+        return buffer;
+      }
+    }
+    return new char[size];
+  }
+
+  void put(char* buffer, size_t size) {
+    if (size != buffer_size || max_free == 0) {
+      delete[] buffer;
+      return;
+    }
+    auto& cache = thread_cache();
+    if (size != cache.buffer_size) {
+      // first use by this thread, or the pool was reconfigured
+      for (auto b : cache.free)
+        delete[] b;
+      cache.free.clear();
+      cache.buffer_size = size;
+    }
+    if (cache.free.size() < THREAD_CACHE_SIZE) {
+      cache.free.push_back(buffer);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (size == buffer_size && free.size() < max_free) {
+        free.push_back(buffer);
+        return;
+      }
+    }
+    delete[] buffer;
+  }
+};
+
 struct Page {
   char *const data;
   boost::intrusive::avl_set_member_hook<> hook;
@@ -62,12 +158,15 @@ struct Page {
     decode(offset, p);
   }
 
+  // size of the buffer holding a Page and its data
+  static size_t buffer_size(size_t page_size) {
+    return data_size(page_size) + sizeof(Page);
+  }
+
   static Ref create(size_t page_size, uint64_t offset = 0) {
-    // ensure proper alignment of the Page
-    const auto align = alignof(Page);
-    page_size = (page_size + align - 1) & ~(align - 1);
+    page_size = data_size(page_size);
     // allocate the Page and its data in a single buffer
-    auto buffer = new char[page_size + sizeof(Page)];
+    auto buffer = PagePool::instance().get(page_size + sizeof(Page));
     // place the Page structure at the end of the buffer
     return new (buffer + page_size) Page(buffer, offset);
   }
@@ -79,8 +178,15 @@ struct Page {
  private: // private constructor, use create() instead
   Page(char *data, uint64_t offset) : data(data), offset(offset), nrefs(1) {}
 
+  // page_size rounded up so that the Page placed after the data is aligned
+  static size_t data_size(size_t page_size) {
+    const auto align = alignof(Page);
+    return (page_size + align - 1) & ~(align - 1);
+  }
+
   static void operator delete(void *p) {
-    delete[] reinterpret_cast<Page*>(p)->data;
+    char *data = reinterpret_cast<Page*>(p)->data;
+    PagePool::instance().put(data, static_cast<char*>(p) - data + sizeof(Page));
   }
 };
 
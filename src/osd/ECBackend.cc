@@ -362,37 +362,72 @@ void ECBackend::RecoveryBackend::handle_recovery_push_reply(
   continue_recovery_op(rop, m);
 }
 
+void ECBackend::RecoveryBackend::handle_recovery_reads_complete(
+  list<RecoveryRead> &reads,
+  RecoveryMessages *m)
+{
+  // objects read from the same shards and missing the same shards are
+  // decoded with a single call into the plugin
+  bool batch = cct->_conf.get_val<bool>("osd_ec_recovery_batch_decode");
+  vector<vector<RecoveryRead*>> batches;
+  map<pair<set<int>, set<int>>, size_t> batch_of;
+  for (auto &read : reads) {
+    dout(10) << __func__ << ": returned " << read.hoid << " "
+	     << "(" << read.to_read.get<0>()
+	     << ", " << read.to_read.get<1>()
+	     << ", " << read.to_read.get<2>()
+	     << ")"
+	     << dendl;
+    ceph_assert(recovery_ops.count(read.hoid));
+    RecoveryBackend::RecoveryOp &op = recovery_ops[read.hoid];
+    ceph_assert(op.returned_data.empty());
+    if (!batch) {
+      batches.push_back({&read});
+      continue;
+    }
+    set<int> avail;
+    for (auto &&i : read.to_read.get<2>()) {
+      avail.insert(i.first.shard);
+    }
+    set<int> missing(op.missing_on_shards.begin(), op.missing_on_shards.end());
+    auto [p, inserted] = batch_of.try_emplace(
+      make_pair(std::move(avail), std::move(missing)), batches.size());
+    if (inserted) {
+      batches.emplace_back();
+    }
+    batches[p->second].push_back(&read);
+  }
+
+  for (auto &b : batches) {
+    vector<map<int, bufferlist>> from(b.size());
+    vector<map<int, bufferlist*>> target(b.size());
+    for (size_t n = 0; n < b.size(); n++) {
+      RecoveryBackend::RecoveryOp &op = recovery_ops[b[n]->hoid];
+      for (auto &&i : op.missing_on_shards) {
+	target[n][i] = &(op.returned_data[i]);
+      }
+      for (auto &&i : b[n]->to_read.get<2>()) {
+	from[n][i.first.shard] = std::move(i.second);
+      }
+    }
+    dout(10) << __func__ << ": decoding " << b.size() << " objects from "
+	     << from.front() << dendl;
+    int r = ECUtil::decode_batch(sinfo, ec_impl, from, target);
+    ceph_assert(r == 0);
+  }
+
+  for (auto &read : reads) {
+    handle_recovery_read_complete(read.hoid, std::move(read.attrs), m);
+  }
+}
+
 void ECBackend::RecoveryBackend::handle_recovery_read_complete(
   const hobject_t &hoid,
-  boost::tuple<uint64_t, uint64_t, map<pg_shard_t, bufferlist> > &to_read,
   std::optional<map<string, bufferlist, less<>> > attrs,
   RecoveryMessages *m)
 {
-  dout(10) << __func__ << ": returned " << hoid << " "
-	   << "(" << to_read.get<0>()
-	   << ", " << to_read.get<1>()
-	   << ", " << to_read.get<2>()
-	   << ")"
-	   << dendl;
   ceph_assert(recovery_ops.count(hoid));
   RecoveryBackend::RecoveryOp &op = recovery_ops[hoid];
-  ceph_assert(op.returned_data.empty());
-  map<int, bufferlist*> target;
-  for (set<shard_id_t>::iterator i = op.missing_on_shards.begin();
-       i != op.missing_on_shards.end();
-       ++i) {
-    target[*i] = &(op.returned_data[*i]);
-  }
-  map<int, bufferlist> from;
-  for(map<pg_shard_t, bufferlist>::iterator i = to_read.get<2>().begin();
-      i != to_read.get<2>().end();
-      ++i) {
-    from[i->first.shard] = std::move(i->second);
-  }
-  dout(10) << __func__ << ": " << from << dendl;
-  int r;
-  r = ECUtil::decode(sinfo, ec_impl, from, target);
-  ceph_assert(r == 0);
   if (attrs) {
     op.xattrs.swap(*attrs);
 
@@ -478,19 +513,19 @@ struct RecoveryReadCompleter : ECCommon::ReadCompleter {
       return;
     }
     ceph_assert(res.returned.size() == 1);
-    backend.handle_recovery_read_complete(
-      hoid,
-      res.returned.back(),
-      res.attrs,
-      &rm);
+    // decoded in finish() along with the other objects of this read
+    reads.push_back({hoid, std::move(res.returned.back()),
+		     std::move(res.attrs)});
   }
 
   void finish(int priority) && override
   {
+    backend.handle_recovery_reads_complete(reads, &rm);
     backend.dispatch_recovery_messages(rm, priority);
   }
 
   ECBackend::RecoveryBackend& backend;
+  std::list<ECBackend::RecoveryBackend::RecoveryRead> reads;
   RecoveryMessages rm;
 };
 
@@ -1234,6 +1269,8 @@ void ECBackend::handle_sub_read_reply(
       ceph_assert(req_iter != rop.to_read.find(i->first)->second.to_read.end());
       ceph_assert(riter != rop.complete[i->first].returned.end());
       pair<uint64_t, uint64_t> adjusted =
+	rop.to_read.find(i->first)->second.shard_extents ?
+	make_pair(req_iter->get<0>(), req_iter->get<1>()) :
 	sinfo.aligned_offset_len_to_chunk(
 	  make_pair(req_iter->get<0>(), req_iter->get<1>()));
       ceph_assert(adjusted.first == j->first);
@@ -1426,6 +1463,7 @@ struct ECClassicalOp : ECCommon::RMWPipeline::Op {
       pgid,
       sinfo,
       remote_read_result,
+      parity_delta_read_result,
       log_entries,
       written,
       transactions,
@@ -1523,6 +1561,15 @@ void ECBackend::submit_transaction(
       return ref;
     },
     get_parent()->get_dpp());
+  if (get_parent()->get_pool().allows_ecoverwrites() &&
+      cct->_conf.get_val<bool>("osd_ec_parity_delta_writes")) {
+    ECTransaction::plan_parity_delta(
+      sinfo,
+      ec_impl,
+      *(op->t),
+      op->plan,
+      get_parent()->get_dpp());
+  }
   dout(10) << __func__ << ": op " << *op << " starting" << dendl;
   rmw_pipeline.start_rmw(std::move(op));
 }
@@ -1554,11 +1601,9 @@ void ECBackend::objects_read_async(
 	 to_read.begin();
        i != to_read.end();
        ++i) {
-    pair<uint64_t, uint64_t> tmp =
-      sinfo.offset_len_to_stripe_bounds(
-	make_pair(i->first.get<0>(), i->first.get<1>()));
-
-    es.union_insert(tmp.first, tmp.second);
+    // the read pipeline extends these to whole stripes if it has to
+    // decode
+    es.union_insert(i->first.get<0>(), i->first.get<1>());
     flags |= i->first.get<2>();
   }
 
@@ -1668,6 +1713,17 @@ void ECBackend::objects_read_and_reconstruct(
     reads, fast_read, std::move(func));
 }
 
+int ECBackend::objects_read_shards(
+  const hobject_t &hoid,
+  uint64_t chunk_off,
+  uint64_t chunk_len,
+  const set<int> &shards,
+  GenContextURef<pair<int, map<int, bufferlist>> &&> &&func)
+{
+  return read_pipeline.objects_read_shards(
+    hoid, chunk_off, chunk_len, shards, std::move(func));
+}
+
 void ECBackend::kick_reads() {
   read_pipeline.kick_reads();
 }
@@ -146,6 +146,13 @@ public:
     bool fast_read,
     GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func) override;
 
+  int objects_read_shards(
+    const hobject_t &hoid,
+    uint64_t chunk_off,
+    uint64_t chunk_len,
+    const std::set<int> &shards,
+    GenContextURef<std::pair<int, std::map<int, ceph::buffer::list>> &&> &&func) override;
+
   void objects_read_async(
     const hobject_t &hoid,
     const std::list<std::pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
@@ -283,9 +290,20 @@ public:
   void continue_recovery_op(
     RecoveryBackend::RecoveryOp &op,
     RecoveryMessages *m);
+  /// the shards read to recover one object
+  struct RecoveryRead {
+    hobject_t hoid;
+    boost::tuple<uint64_t, uint64_t, std::map<pg_shard_t, ceph::buffer::list> > to_read;
+    std::optional<std::map<std::string, ceph::buffer::list, std::less<>> > attrs;
+  };
+  /// decode the missing shards of all the objects of a recovery read,
+  /// batching the objects missing the same shards, and move them on
+  void handle_recovery_reads_complete(
+    std::list<RecoveryRead> &reads,
+    RecoveryMessages *m);
+  /// called once the missing shards of hoid are in op.returned_data
   void handle_recovery_read_complete(
     const hobject_t &hoid,
-    boost::tuple<uint64_t, uint64_t, std::map<pg_shard_t, ceph::buffer::list> > &to_read,
     std::optional<std::map<std::string, ceph::buffer::list, std::less<>> > attrs,
     RecoveryMessages *m);
   void handle_recovery_push(
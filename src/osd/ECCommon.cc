@@ -152,6 +152,7 @@ ostream &operator<<(ostream &lhs, const ECCommon::RMWPipeline::Op &rhs)
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
       << " plan.will_write=" << rhs.plan.will_write
+      << " parity_delta=" << rhs.parity_delta
       << ")";
   return lhs;
 }
@@ -405,6 +406,8 @@ void ECCommon::ReadPipeline::do_read_op(ReadOp &op)
 	 j != i->second.to_read.end();
 	 ++j) {
       pair<uint64_t, uint64_t> chunk_off_len =
+	i->second.shard_extents ?
+	make_pair(j->get<0>(), j->get<1>()) :
 	sinfo.aligned_offset_len_to_chunk(make_pair(j->get<0>(), j->get<1>()));
       for (auto k = i->second.need.begin();
 	   k != i->second.need.end();
@@ -537,7 +540,30 @@ void ECCommon::ReadPipeline::objects_read_and_reconstruct(
     kick_reads();
     return;
   }
+  ClientAsyncReadStatus *status = &(in_progress_client_reads.back());
 
+  map<hobject_t, std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
+      > to_reconstruct;
+  bool direct = !fast_read &&
+    cct->_conf.get_val<bool>("osd_ec_direct_partial_reads");
+  for (auto &&to_read: reads) {
+    if (direct && try_direct_read(to_read.first, to_read.second, status)) {
+      continue;
+    }
+    to_reconstruct.insert(to_read);
+  }
+  if (!to_reconstruct.empty()) {
+    start_reconstruct_reads(to_reconstruct, fast_read, status);
+  }
+}
+
+void ECCommon::ReadPipeline::start_reconstruct_reads(
+  const map<hobject_t,
+    std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
+  > &reads,
+  bool fast_read,
+  ClientAsyncReadStatus *status)
+{
   map<hobject_t, set<int>> obj_want_to_read;
   set<int> want_to_read;
   get_want_to_read_shards(&want_to_read);
@@ -553,11 +579,27 @@ void ECCommon::ReadPipeline::objects_read_and_reconstruct(
       &shards);
     ceph_assert(r == 0);
 
+    // decoding works on whole stripes
+    uint32_t flags = 0;
+    extent_set es;
+    for (auto &&read: to_read.second) {
+      pair<uint64_t, uint64_t> bounds =
+	sinfo.offset_len_to_stripe_bounds(
+	  make_pair(read.get<0>(), read.get<1>()));
+      es.union_insert(bounds.first, bounds.second);
+      flags |= read.get<2>();
+    }
+    std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > offsets;
+    for (auto &&extent: es) {
+      offsets.push_back(
+	boost::make_tuple(extent.first, extent.second, flags));
+    }
+
     for_read_op.insert(
       make_pair(
 	to_read.first,
 	read_request_t(
-	  to_read.second,
+	  offsets,
 	  shards,
 	  false)));
     obj_want_to_read.insert(make_pair(to_read.first, want_to_read));
@@ -570,14 +612,290 @@ void ECCommon::ReadPipeline::objects_read_and_reconstruct(
     OpRequestRef(),
     fast_read,
     false,
-    std::make_unique<ClientReadCompleter>(*this, &(in_progress_client_reads.back())));
+    std::make_unique<ClientReadCompleter>(*this, status));
 }
 
+struct DirectReadCompleter : ECCommon::ReadCompleter {
+  /// shared by the read ops of one object
+  struct State {
+    hobject_t hoid;
+    extent_set to_read;
+    uint32_t flags;
+    ECCommon::ClientAsyncReadStatus *status;
+    unsigned pending = 0;
+    int r = 0;
+    /// returned data by shard, keyed by chunk offset
+    map<int, extent_map> shard_data;
+
+    State(const hobject_t &hoid,
+	  const extent_set &to_read,
+	  uint32_t flags,
+	  ECCommon::ClientAsyncReadStatus *status)
+      : hoid(hoid), to_read(to_read), flags(flags), status(status) {}
+  };
+
+  DirectReadCompleter(ECCommon::ReadPipeline &read_pipeline,
+		      std::shared_ptr<State> state,
+		      const set<int> &shards)
+    : read_pipeline(read_pipeline),
+      state(std::move(state)),
+      shards(shards) {}
+
+  void finish_single_request(
+    const hobject_t &hoid,
+    ECCommon::read_result_t &res,
+    list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read) override
+  {
+    State &st = *state;
+    if (res.r < 0 || !res.errors.empty()) {
+      st.r = res.r < 0 ? res.r : -EIO;
+    }
+    for (auto &&ret: res.returned) {
+      if (st.r < 0)
+	break;
+      auto &bufs = ret.get<2>();
+      for (int shard: shards) {
+	auto i = std::find_if(
+	  bufs.begin(), bufs.end(),
+	  [shard](auto &&p) { return p.first.shard == shard; });
+	if (i == bufs.end() || i->second.length() != ret.get<1>()) {
+	  // short read past the end of the shard or a missing reply
+	  st.r = -EIO;
+	  break;
+	}
+	st.shard_data[shard].insert(
+	  ret.get<0>(), ret.get<1>(), std::move(i->second));
+      }
+    }
+    if (--st.pending == 0) {
+      finish_object(st);
+    }
+  }
+
+  void finish_object(State &st)
+  {
+    if (st.r < 0) {
+      // decode from whatever shards are left
+      std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > reads;
+      for (auto &&extent: st.to_read) {
+	reads.push_back(boost::make_tuple(extent.first, extent.second, st.flags));
+      }
+      read_pipeline.start_reconstruct_reads(
+	{{st.hoid, reads}}, false, st.status);
+      return;
+    }
+
+    const vector<int> &chunk_mapping = read_pipeline.ec_impl->get_chunk_mapping();
+    extent_map result;
+    for (auto &&extent: st.to_read) {
+      bufferlist bl;
+      read_pipeline.sinfo.for_each_chunk_piece(
+	extent.first, extent.second,
+	[&](int chunk, uint64_t chunk_off, uint64_t len) {
+	  int shard = (int)chunk_mapping.size() > chunk ?
+	    chunk_mapping[chunk] : chunk;
+	  auto range = st.shard_data[shard].get_containing_range(chunk_off, len);
+	  ceph_assert(range.first != range.second);
+	  bufferlist piece;
+	  piece.substr_of(
+	    range.first.get_val(), chunk_off - range.first.get_off(), len);
+	  bl.claim_append(piece);
+	});
+      result.insert(extent.first, bl.length(), std::move(bl));
+    }
+    st.status->complete_object(st.hoid, 0, std::move(result));
+    read_pipeline.kick_reads();
+  }
+
+  void finish(int priority) && override
+  {
+    // NOP
+  }
+
+  ECCommon::ReadPipeline &read_pipeline;
+  std::shared_ptr<State> state;
+  const set<int> shards;
+};
+
+bool ECCommon::ReadPipeline::try_direct_read(
+  const hobject_t &hoid,
+  const std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
+  ClientAsyncReadStatus *status)
+{
+  if (ec_impl->get_sub_chunk_count() != 1) {
+    return false;
+  }
+
+  uint32_t flags = 0;
+  extent_set logical;
+  for (auto &&read: to_read) {
+    logical.union_insert(read.get<0>(), read.get<1>());
+    flags |= read.get<2>();
+  }
+  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  map<int, extent_set> shard_extents;
+  for (auto &&extent: logical) {
+    sinfo.for_each_chunk_piece(
+      extent.first, extent.second,
+      [&](int chunk, uint64_t chunk_off, uint64_t len) {
+	int shard = (int)chunk_mapping.size() > chunk ?
+	  chunk_mapping[chunk] : chunk;
+	shard_extents[shard].union_insert(chunk_off, len);
+      });
+  }
+
+  set<int> have;
+  map<shard_id_t, pg_shard_t> avail;
+  get_all_avail_shards(hoid, set<pg_shard_t>(), have, avail, false);
+  for (auto &&i: shard_extents) {
+    if (!have.count(i.first)) {
+      dout(20) << __func__ << ": " << hoid << " shard " << i.first
+	       << " unavailable, decoding" << dendl;
+      return false;
+    }
+  }
+
+  // shards which read the same ranges, e.g. for whole stripes, share
+  // a read op
+  vector<pair<extent_set, set<int>>> groups;
+  for (auto &&[shard, extents]: shard_extents) {
+    auto g = std::find_if(
+      groups.begin(), groups.end(),
+      [&extents](auto &&g) { return g.first == extents; });
+    if (g == groups.end()) {
+      groups.emplace_back(extents, set<int>{shard});
+    } else {
+      g->second.insert(shard);
+    }
+  }
+  dout(20) << __func__ << ": " << hoid << " " << logical
+	   << " from shards " << shard_extents << dendl;
+
+  auto state = std::make_shared<DirectReadCompleter::State>(
+    hoid, logical, flags, status);
+  state->pending = groups.size();
+  vector<pair<int, int>> subchunks{make_pair(0, 1)};
+  for (auto &&[extents, shards]: groups) {
+    std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > offsets;
+    for (auto &&extent: extents) {
+      offsets.push_back(boost::make_tuple(extent.first, extent.second, flags));
+    }
+    map<pg_shard_t, vector<pair<int, int>>> need;
+    for (int shard: shards) {
+      need.insert(make_pair(avail[shard_id_t(shard)], subchunks));
+    }
+    map<hobject_t, set<int>> want_to_read;
+    want_to_read.insert(make_pair(hoid, shards));
+    map<hobject_t, read_request_t> for_read_op;
+    for_read_op.insert(
+      make_pair(
+	hoid,
+	read_request_t(offsets, need, false, true)));
+    start_read_op(
+      CEPH_MSG_PRIO_DEFAULT,
+      want_to_read,
+      for_read_op,
+      OpRequestRef(),
+      false,
+      false,
+      std::make_unique<DirectReadCompleter>(*this, state, shards));
+  }
+  return true;
+}
+
+struct ShardReadCompleter : ECCommon::ReadCompleter {
+  ShardReadCompleter(
+    const std::set<int> &shards,
+    GenContextURef<pair<int, map<int, bufferlist>> &&> &&func)
+    : shards(shards),
+      func(std::move(func)) {}
+
+  void finish_single_request(
+    const hobject_t &hoid,
+    ECCommon::read_result_t &res,
+    list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read) override
+  {
+    ceph_assert(to_read.size() == 1);
+    ceph_assert(res.returned.size() == 1);
+    uint64_t len = to_read.front().get<1>();
+    map<int, bufferlist> result;
+    int r = res.r;
+    if (r == 0 && !res.errors.empty()) {
+      r = -EIO;
+    }
+    for (auto &&[shard, bl] : res.returned.front().get<2>()) {
+      if (shards.count(shard.shard) && bl.length() == len) {
+	result[shard.shard] = std::move(bl);
+      }
+    }
+    if (r == 0 && result.size() != shards.size()) {
+      r = -EIO;
+    }
+    func.release()->complete(make_pair(r, std::move(result)));
+  }
+
+  void finish(int priority) && override
+  {
+    // NOP
+  }
+
+  const std::set<int> shards;
+  GenContextURef<pair<int, map<int, bufferlist>> &&> func;
+};
+
+int ECCommon::ReadPipeline::objects_read_shards(
+  const hobject_t &hoid,
+  uint64_t chunk_off,
+  uint64_t chunk_len,
+  const set<int> &shards,
+  GenContextURef<pair<int, map<int, bufferlist>> &&> &&func)
+{
+  set<int> have;
+  map<shard_id_t, pg_shard_t> avail;
+  get_all_avail_shards(hoid, set<pg_shard_t>(), have, avail, false);
+
+  map<pg_shard_t, vector<pair<int, int>>> need;
+  vector<pair<int, int>> subchunks{make_pair(0, ec_impl->get_sub_chunk_count())};
+  for (auto shard : shards) {
+    auto i = avail.find(shard_id_t(shard));
+    if (i == avail.end()) {
+      dout(10) << __func__ << ": " << hoid << " shard " << shard
+	       << " not available" << dendl;
+      return -EIO;
+    }
+    need.insert(make_pair(i->second, subchunks));
+  }
+
+  map<hobject_t, set<int>> want_to_read;
+  want_to_read.insert(make_pair(hoid, shards));
+  map<hobject_t, read_request_t> to_read;
+  to_read.insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	{boost::make_tuple(chunk_off, chunk_len, 0)},
+	need,
+	false,
+	true)));
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    want_to_read,
+    to_read,
+    OpRequestRef(),
+    false,
+    false,
+    std::make_unique<ShardReadCompleter>(shards, std::move(func)));
+  return 0;
+}
 
 int ECCommon::ReadPipeline::send_all_remaining_reads(
   const hobject_t &hoid,
   ReadOp &rop)
 {
+  if (rop.to_read.find(hoid)->second.shard_extents) {
+    // the caller asked for specific shards, no other shard will do
+    return -EIO;
+  }
   set<int> already_read;
   const set<pg_shard_t>& ots = rop.obj_to_source[hoid];
   for (set<pg_shard_t>::iterator i = ots.begin(); i != ots.end(); ++i)
@@ -631,6 +949,82 @@ void ECCommon::RMWPipeline::start_rmw(OpRef op)
   check_ops();
 }
 
+bool ECCommon::RMWPipeline::can_parity_delta(const Op &op) const
+{
+  // The parity delta is applied to whatever the shards hold when the
+  // read reaches them, and the result bypasses the extent cache.  Any
+  // earlier op on the object which has yet to send its writes, or whose
+  // extents later ops may still pick up from the cache, rules it out.
+  const hobject_t &oid = op.plan.parity_delta->oid;
+  for (auto &&i : waiting_reads) {
+    if (i.plan.will_write.count(oid))
+      return false;
+  }
+  for (auto &&i : waiting_commit) {
+    if (i.using_cache && i.plan.will_write.count(oid))
+      return false;
+  }
+  return true;
+}
+
+void ECCommon::RMWPipeline::start_remote_read(Op *op)
+{
+  if (!op->remote_read.empty()) {
+    ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
+    objects_read_async_no_cache(
+      op->remote_read,
+      [op, this](map<hobject_t,pair<int, extent_map> > &&results) {
+	for (auto &&i: results) {
+	  op->remote_read_result.emplace(i.first, i.second.second);
+	}
+	check_ops();
+      });
+  }
+}
+
+void ECCommon::RMWPipeline::start_parity_delta_read(Op *op)
+{
+  const auto &pd = *(op->plan.parity_delta);
+  set<int> shards = pd.data_shards;
+  for (unsigned i = ec_impl->get_data_chunk_count();
+       i < ec_impl->get_chunk_count();
+       ++i) {
+    shards.insert(i);
+  }
+
+  auto fall_back = [op, this](int r) {
+    dout(10) << __func__ << ": parity delta read failed r=" << r
+	     << ", falling back to full stripe rmw for " << *op << dendl;
+    op->plan.parity_delta.reset();
+    op->remote_read = op->plan.to_read;
+    start_remote_read(op);
+  };
+  auto on_complete =
+    [op, fall_back, this](pair<int, map<int, bufferlist>> &&result) {
+      op->parity_delta_read_in_progress = false;
+      if (result.first < 0) {
+	fall_back(result.first);
+      } else {
+	op->parity_delta_read_result = std::move(result.second);
+      }
+      check_ops();
+    };
+
+  op->parity_delta_read_in_progress = true;
+  int r = ec_backend.objects_read_shards(
+    pd.oid,
+    pd.chunk_off,
+    pd.chunk_len,
+    shards,
+    make_gen_lambda_context<
+      pair<int, map<int, bufferlist>> &&, decltype(on_complete)>(
+	std::move(on_complete)));
+  if (r < 0) {
+    op->parity_delta_read_in_progress = false;
+    fall_back(r);
+  }
+}
+
 bool ECCommon::RMWPipeline::try_state_to_reads()
 {
   if (waiting_state.empty())
@@ -646,7 +1040,26 @@ bool ECCommon::RMWPipeline::try_state_to_reads()
     return false;
   }
 
-  if (!pipeline_state.caching_enabled()) {
+  for (auto &&i : waiting_reads) {
+    if (!i.parity_delta)
+      continue;
+    for (auto &&hpair : op->plan.will_write) {
+      if (i.plan.will_write.count(hpair.first)) {
+	dout(20) << __func__ << ": blocking " << *op
+		 << " behind parity delta " << i << dendl;
+	return false;
+      }
+    }
+  }
+
+  if (op->plan.parity_delta && !can_parity_delta(*op)) {
+    dout(20) << __func__ << ": using full stripe rmw for " << *op
+	     << ", conflicting ops in flight" << dendl;
+    op->plan.parity_delta.reset();
+  }
+  op->parity_delta = bool(op->plan.parity_delta);
+
+  if (!pipeline_state.caching_enabled() || op->parity_delta) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
@@ -684,22 +1097,16 @@ bool ECCommon::RMWPipeline::try_state_to_reads()
 	op->pending_read[hpair.first] = std::move(pending_read);
       }
     }
-  } else {
+  } else if (!op->parity_delta) {
     op->remote_read = op->plan.to_read;
   }
 
   dout(10) << __func__ << ": " << *op << dendl;
 
-  if (!op->remote_read.empty()) {
-    ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
-    objects_read_async_no_cache(
-      op->remote_read,
-      [op, this](map<hobject_t,pair<int, extent_map> > &&results) {
-	for (auto &&i: results) {
-	  op->remote_read_result.emplace(i.first, i.second.second);
-	}
-	check_ops();
-      });
+  if (op->parity_delta) {
+    start_parity_delta_read(op);
+  } else {
+    start_remote_read(op);
   }
 
   return true;
@@ -774,7 +1181,7 @@ bool ECCommon::RMWPipeline::try_reads_to_commit()
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  ceph_assert(written_set == op->plan.will_write);
+  ceph_assert(op->plan.parity_delta || written_set == op->plan.will_write);
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
@@ -784,6 +1191,7 @@ bool ECCommon::RMWPipeline::try_reads_to_commit()
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->parity_delta_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -35,6 +35,14 @@ struct ECTransaction {
     std::map<hobject_t,extent_set> will_write; // superset of to_read
 
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    struct ParityDelta {
+      hobject_t oid;
+      uint64_t chunk_off = 0;
+      uint64_t chunk_len = 0;
+      std::set<int> data_shards;
+    };
+    std::optional<ParityDelta> parity_delta;
   };
 };
 
@@ -225,15 +233,33 @@ struct ECCommon {
     bool fast_read,
     GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func) = 0;
 
+  /**
+   * Read chunk_off~chunk_len from each of the given shards of hoid,
+   * without decoding.  func gets 0 and the buffers by shard, or an
+   * error if any of the shards could not be read.  Returns an error
+   * without calling func if a shard is not available.
+   */
+  virtual int objects_read_shards(
+    const hobject_t &hoid,
+    uint64_t chunk_off,
+    uint64_t chunk_len,
+    const std::set<int> &shards,
+    GenContextURef<std::pair<int, std::map<int, ceph::buffer::list>> &&> &&func) = 0;
+
   struct read_request_t {
     const std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
     std::map<pg_shard_t, std::vector<std::pair<int, int>>> need;
     bool want_attrs;
+    /// to_read holds offsets within the shards rather than logical
+    /// stripe aligned offsets
+    bool shard_extents;
     read_request_t(
       const std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
       const std::map<pg_shard_t, std::vector<std::pair<int, int>>> &need,
-      bool want_attrs)
-      : to_read(to_read), need(need), want_attrs(want_attrs) {}
+      bool want_attrs,
+      bool shard_extents = false)
+      : to_read(to_read), need(need), want_attrs(want_attrs),
+	shard_extents(shard_extents) {}
   };
   friend std::ostream &operator<<(std::ostream &lhs, const read_request_t &rhs);
   struct ReadOp;
@@ -370,6 +396,31 @@ struct ECCommon {
       bool fast_read,
       GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func);
 
+    int objects_read_shards(
+      const hobject_t &hoid,
+      uint64_t chunk_off,
+      uint64_t chunk_len,
+      const std::set<int> &shards,
+      GenContextURef<std::pair<int, std::map<int, ceph::buffer::list>> &&> &&func);
+
+    /// read and decode the stripes covering reads
+    void start_reconstruct_reads(
+      const std::map<hobject_t, std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
+      > &reads,
+      bool fast_read,
+      ClientAsyncReadStatus *status);
+
+    /**
+     * Read to_read straight from the data shards holding it, without
+     * reading whole stripes or decoding.  Returns false, having started
+     * nothing, if any of those shards is unavailable.  If a shard read
+     * fails, falls back to start_reconstruct_reads.
+     */
+    bool try_direct_read(
+      const hobject_t &hoid,
+      const std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
+      ClientAsyncReadStatus *status);
+
     template <class F, class G>
     void filter_read_op(
       const OSDMapRef& osdmap,
@@ -511,8 +562,18 @@ struct ECCommon {
       std::map<hobject_t,extent_set> pending_read; // subset already being read
       std::map<hobject_t,extent_set> remote_read;  // subset we must read
       std::map<hobject_t,extent_map> remote_read_result;
+
+      /// Updates the parity from data deltas, see
+      /// ECTransaction::WritePlan::parity_delta.  Stays set if the op
+      /// falls back to a full stripe rmw so that later ops on the
+      /// object keep waiting for it to leave waiting_reads.
+      bool parity_delta = false;
+      bool parity_delta_read_in_progress = false;
+      std::map<int, ceph::buffer::list> parity_delta_read_result;
+
       bool read_in_progress() const {
-        return !remote_read.empty() && remote_read_result.empty();
+        return (!remote_read.empty() && remote_read_result.empty()) ||
+	  parity_delta_read_in_progress;
       }
 
       /// In progress write state.
@@ -599,6 +660,9 @@ struct ECCommon {
     eversion_t completed_to;
     eversion_t committed_to;
     void start_rmw(OpRef op);
+    bool can_parity_delta(const Op &op) const;
+    void start_parity_delta_read(Op *op);
+    void start_remote_read(Op *op);
     bool try_state_to_reads();
     bool try_reads_to_commit();
     bool try_finish_rmw();
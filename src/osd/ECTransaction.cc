@@ -20,6 +20,8 @@
 #include "ECUtil.h"
 #include "os/ObjectStore.h"
 #include "common/inline_variant.h"
+#include "include/intarith.h"
+#include "include/page.h"
 
 using std::less;
 using std::make_pair;
@@ -94,6 +96,148 @@ static void encode_and_write(
   }
 }
 
+void ECTransaction::plan_parity_delta(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  PGTransaction& t,
+  WritePlan &plan,
+  DoutPrefixProvider *dpp)
+{
+  // only the common case: an overwrite of a single existing object
+  if (plan.to_read.size() != 1 ||
+      plan.will_write.size() != 1 ||
+      plan.invalidates_cache ||
+      t.op_map.size() != 1 ||
+      !ecimpl->supports_parity_delta() ||
+      !ecimpl->get_chunk_mapping().empty() ||
+      ecimpl->get_sub_chunk_count() != 1) {
+    return;
+  }
+  const auto &[oid, op] = *t.op_map.begin();
+  if (oid.is_temp() ||
+      !op.is_none() ||
+      op.truncate ||
+      op.buffer_updates.empty() ||
+      plan.to_read.count(oid) == 0) {
+    return;
+  }
+
+  const uint64_t size =
+    plan.hash_infos.at(oid)->get_projected_total_logical_size(sinfo);
+  set<int> data_shards;
+  uint64_t start = std::numeric_limits<uint64_t>::max();
+  uint64_t end = 0;
+  for (auto &&extent : op.buffer_updates) {
+    if (extent.get_off() + extent.get_len() > size) {
+      return;
+    }
+    sinfo.for_each_chunk_piece(
+      extent.get_off(), extent.get_len(),
+      [&](int shard, uint64_t chunk_off, uint64_t len) {
+	data_shards.insert(shard);
+	start = std::min(start, chunk_off);
+	end = std::max(end, chunk_off + len);
+      });
+  }
+  // page granularity keeps the shard reads and writes aligned
+  const uint64_t align = sinfo.get_chunk_size() % CEPH_PAGE_SIZE ?
+    sinfo.get_chunk_size() : CEPH_PAGE_SIZE;
+  start = p2align(start, align);
+  end = p2roundup(end, align);
+
+  // compare the bytes read and written by both plans
+  const uint64_t k = ecimpl->get_data_chunk_count();
+  const uint64_t m = ecimpl->get_coding_chunk_count();
+  const uint64_t delta_io = 2 * (data_shards.size() + m) * (end - start);
+  const uint64_t full_io = plan.to_read.at(oid).size() +
+    plan.will_write.at(oid).size() / k * (k + m);
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " chunk range " << start << "~" << end - start
+		     << " data shards " << data_shards
+		     << " io " << delta_io << " vs " << full_io
+		     << dendl;
+  if (delta_io >= full_io) {
+    return;
+  }
+  plan.parity_delta = WritePlan::ParityDelta{
+    oid, start, end - start, std::move(data_shards)};
+}
+
+static void write_parity_delta(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const ECTransaction::WritePlan::ParityDelta &pd,
+  const map<int, bufferlist> &reads,
+  const extent_map &to_write,
+  uint32_t flags,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp)
+{
+  auto copy_of = [&](int shard) {
+    auto i = reads.find(shard);
+    ceph_assert(i != reads.end());
+    ceph_assert(i->second.length() == pd.chunk_len);
+    bufferptr bp(buffer::create_page_aligned(pd.chunk_len));
+    i->second.begin().copy(pd.chunk_len, bp.c_str());
+    bufferlist bl;
+    bl.push_back(std::move(bp));
+    return bl;
+  };
+
+  // the new content of the range in the touched data shards
+  map<int, bufferlist> data;
+  for (int shard : pd.data_shards) {
+    data[shard] = copy_of(shard);
+  }
+  for (auto &&extent : to_write) {
+    bufferlist bl = extent.get_val();
+    auto p = bl.begin();
+    sinfo.for_each_chunk_piece(
+      extent.get_off(), extent.get_len(),
+      [&](int shard, uint64_t chunk_off, uint64_t len) {
+	ceph_assert(data.count(shard));
+	ceph_assert(chunk_off >= pd.chunk_off);
+	ceph_assert(chunk_off + len <= pd.chunk_off + pd.chunk_len);
+	p.copy(len, data[shard].c_str() + chunk_off - pd.chunk_off);
+      });
+  }
+
+  map<int, bufferlist> deltas;
+  for (auto &&[shard, bl] : data) {
+    int r = ecimpl->encode_delta(reads.at(shard), bl, &deltas[shard]);
+    ceph_assert(r == 0);
+  }
+  map<int, bufferlist> coding;
+  for (unsigned i = ecimpl->get_data_chunk_count();
+       i < ecimpl->get_chunk_count();
+       ++i) {
+    coding[i] = copy_of(i);
+  }
+  int r = ecimpl->apply_delta(deltas, &coding);
+  ceph_assert(r == 0);
+  data.merge(coding);
+
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " writing " << pd.chunk_off << "~" << pd.chunk_len
+		     << " to " << data.size() << " shards"
+		     << dendl;
+  for (auto &&st : *transactions) {
+    auto i = data.find(st.first);
+    if (i == data.end()) {
+      continue;
+    }
+    st.second.write(
+      coll_t(spg_t(pgid, st.first)),
+      ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+      pd.chunk_off,
+      pd.chunk_len,
+      i->second,
+      flags);
+  }
+}
+
 void ECTransaction::generate_transactions(
   PGTransaction* _t,
   WritePlan &plan,
@@ -101,6 +245,7 @@ void ECTransaction::generate_transactions(
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<int, bufferlist> &parity_delta_reads,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -540,6 +685,43 @@ void ECTransaction::generate_transactions(
 			   << dendl;
       }
 
+      if (plan.parity_delta && plan.parity_delta->oid == oid) {
+	auto &pd = *plan.parity_delta;
+	ceph_assert(entry);
+	ceph_assert(new_size == orig_size);
+	ldpp_dout(dpp, 20) << "generate_transactions: parity delta "
+			   << pd.chunk_off << "~" << pd.chunk_len
+			   << dendl;
+	// every shard saves the range so that the log entry can roll
+	// back the same extents everywhere
+	rollback_extents.emplace_back(make_pair(pd.chunk_off, pd.chunk_len));
+	for (auto &&st : *transactions) {
+	  st.second.touch(
+	    coll_t(spg_t(pgid, st.first)),
+	    ghobject_t(oid, entry->version.version, st.first));
+	  st.second.clone_range(
+	    coll_t(spg_t(pgid, st.first)),
+	    ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	    ghobject_t(oid, entry->version.version, st.first),
+	    pd.chunk_off,
+	    pd.chunk_len,
+	    pd.chunk_off);
+	}
+	write_parity_delta(
+	  pgid,
+	  oid,
+	  sinfo,
+	  ecimpl,
+	  pd,
+	  parity_delta_reads,
+	  to_write,
+	  fadvise_flags,
+	  transactions,
+	  dpp);
+	// already written, leave nothing for the full stripe code below
+	to_write.clear();
+      }
+
       set<int> want;
       for (unsigned i = 0; i < ecimpl->get_chunk_count(); ++i) {
 	want.insert(i);
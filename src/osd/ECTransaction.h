@@ -28,6 +28,20 @@ namespace ECTransaction {
     std::map<hobject_t,extent_set> will_write; // superset of to_read
 
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /* Set by plan_parity_delta() for a partial stripe overwrite of a
+     * single object whose coding chunks can be updated from the deltas
+     * of the data it changes.  The same chunk range is read from the
+     * touched data shards and the coding shards and only those shards
+     * are written.  to_read and will_write still hold the full stripe
+     * plan, used if the pipeline falls back to a full stripe rmw. */
+    struct ParityDelta {
+      hobject_t oid;
+      uint64_t chunk_off = 0;   ///< range in each shard, page aligned
+      uint64_t chunk_len = 0;
+      std::set<int> data_shards;
+    };
+    std::optional<ParityDelta> parity_delta;
   };
 
   template <typename F>
@@ -176,6 +190,14 @@ namespace ECTransaction {
     return plan;
   }
 
+  /// fill in plan.parity_delta if it is cheaper than the full stripe plan
+  void plan_parity_delta(
+    const ECUtil::stripe_info_t &sinfo,
+    ceph::ErasureCodeInterfaceRef &ecimpl,
+    PGTransaction& t,
+    WritePlan &plan,
+    DoutPrefixProvider *dpp);
+
   void generate_transactions(
     PGTransaction* _t,
     WritePlan &plan,
@@ -183,6 +205,7 @@ namespace ECTransaction {
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const std::map<hobject_t,extent_map> &partial_extents,
+    const std::map<int, ceph::buffer::list> &parity_delta_reads,
     std::vector<pg_log_entry_t> &entries,
     std::map<hobject_t,extent_map> *written,
     std::map<shard_id_t, ceph::os::Transaction> *transactions,
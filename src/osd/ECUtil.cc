@@ -52,70 +52,107 @@ int ECUtil::decode(
   ErasureCodeInterfaceRef &ec_impl,
   map<int, bufferlist> &to_decode,
   map<int, bufferlist*> &out) {
+  vector<map<int, bufferlist>> in{to_decode};
+  vector<map<int, bufferlist*>> outs{out};
+  return decode_batch(sinfo, ec_impl, in, outs);
+}
 
-  ceph_assert(to_decode.size());
+int ECUtil::decode_batch(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const vector<map<int, bufferlist>> &to_decode,
+  vector<map<int, bufferlist*>> &out) {
 
-  for (auto &&i : to_decode) {
-    if(i.second.length() == 0)
-      return 0;
-  }
+  ceph_assert(to_decode.size() == out.size());
+  if (to_decode.empty())
+    return 0;
 
   set<int> need;
-  for (map<int, bufferlist*>::iterator i = out.begin();
-       i != out.end();
-       ++i) {
-    ceph_assert(i->second);
-    ceph_assert(i->second->length() == 0);
-    need.insert(i->first);
+  for (auto &&i : out.front()) {
+    need.insert(i.first);
   }
-
   set<int> avail;
-  for (auto &&i : to_decode) {
-    ceph_assert(i.second.length() != 0);
+  for (auto &&i : to_decode.front()) {
     avail.insert(i.first);
   }
+  ceph_assert(avail.size());
+  for (size_t n = 0; n < to_decode.size(); n++) {
+    ceph_assert(to_decode[n].size() == avail.size());
+    for (auto &&i : to_decode[n]) {
+      ceph_assert(avail.count(i.first));
+    }
+    ceph_assert(out[n].size() == need.size());
+    for (auto &&i : out[n]) {
+      ceph_assert(need.count(i.first));
+      ceph_assert(i.second);
+      ceph_assert(i.second->length() == 0);
+    }
+  }
 
   map<int, vector<pair<int, int>>> min;
   int r = ec_impl->minimum_to_decode(need, avail, &min);
   ceph_assert(r == 0);
 
-  int chunks_count = 0;
   int repair_data_per_chunk = 0;
   int subchunk_size = sinfo.get_chunk_size()/ec_impl->get_sub_chunk_count();
+  int first_used = -1;
 
-  for (auto &&i : to_decode) {
-    auto found = min.find(i.first);
+  for (auto &&i : avail) {
+    auto found = min.find(i);
     if (found != min.end()) {
       int repair_subchunk_count = 0;
-      for (auto& subchunks : min[i.first]) {
+      for (auto& subchunks : found->second) {
         repair_subchunk_count += subchunks.second;
       }
       repair_data_per_chunk = repair_subchunk_count * subchunk_size;
-      chunks_count = (int)i.second.length() / repair_data_per_chunk;
+      first_used = i;
       break;
     }
   }
 
-  for (int i = 0; i < chunks_count; i++) {
-    map<int, bufferlist> chunks;
-    for (auto j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, 
-                                 i*repair_data_per_chunk, 
-                                 repair_data_per_chunk);
+  // the stripes of all the objects, in order; objects with an empty
+  // shard have nothing to decode
+  vector<int> chunks_count(to_decode.size(), 0);
+  vector<map<int, bufferlist>> chunks;
+  for (size_t n = 0; n < to_decode.size(); n++) {
+    bool empty = false;
+    for (auto &&i : to_decode[n]) {
+      if (i.second.length() == 0)
+	empty = true;
     }
-    map<int, bufferlist> out_bls;
-    r = ec_impl->decode(need, chunks, &out_bls, sinfo.get_chunk_size());
-    ceph_assert(r == 0);
-    for (auto j = out.begin(); j != out.end(); ++j) {
-      ceph_assert(out_bls.count(j->first));
-      ceph_assert(out_bls[j->first].length() == sinfo.get_chunk_size());
-      j->second->claim_append(out_bls[j->first]);
+    if (empty)
+      continue;
+    chunks_count[n] =
+      (int)to_decode[n].at(first_used).length() / repair_data_per_chunk;
+    for (int i = 0; i < chunks_count[n]; i++) {
+      map<int, bufferlist> &stripe = chunks.emplace_back();
+      for (auto &&j : to_decode[n]) {
+	stripe[j.first].substr_of(j.second,
+				  i*repair_data_per_chunk,
+				  repair_data_per_chunk);
+      }
     }
   }
-  for (auto &&i : out) {
-    ceph_assert(i.second->length() == chunks_count * sinfo.get_chunk_size());
+  if (chunks.empty())
+    return 0;
+
+  vector<map<int, bufferlist>> out_bls;
+  r = ec_impl->decode_batch(need, chunks, &out_bls, sinfo.get_chunk_size());
+  ceph_assert(r == 0);
+  ceph_assert(out_bls.size() == chunks.size());
+
+  auto stripe = out_bls.begin();
+  for (size_t n = 0; n < out.size(); n++) {
+    for (int i = 0; i < chunks_count[n]; i++, ++stripe) {
+      for (auto &&j : out[n]) {
+	ceph_assert(stripe->count(j.first));
+	ceph_assert((*stripe)[j.first].length() == sinfo.get_chunk_size());
+	j.second->claim_append((*stripe)[j.first]);
+      }
+    }
+    for (auto &&i : out[n]) {
+      ceph_assert(i.second->length() == chunks_count[n] * sinfo.get_chunk_size());
+    }
   }
   return 0;
 }
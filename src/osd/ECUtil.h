@@ -77,6 +77,21 @@ public:
       (in.first - off) + in.second);
     return std::make_pair(off, len);
   }
+  /// call f(chunk, chunk_off, len) for each piece of the logical extent
+  /// off~len as it is laid out in the data chunks, chunk being the
+  /// index of the data chunk within the stripe
+  template <typename F>
+  void for_each_chunk_piece(uint64_t off, uint64_t len, F &&f) const {
+    const uint64_t end = off + len;
+    while (off < end) {
+      uint64_t in_chunk = off % chunk_size;
+      uint64_t n = std::min(end - off, chunk_size - in_chunk);
+      f((int)((off % stripe_width) / chunk_size),
+	logical_to_prev_chunk_offset(off) + in_chunk,
+	n);
+      off += n;
+    }
+  }
 };
 
 int decode(
@@ -91,6 +106,15 @@ int decode(
   std::map<int, ceph::buffer::list> &to_decode,
   std::map<int, ceph::buffer::list*> &out);
 
+/// decode the shards missing from several objects with one
+/// ErasureCodeInterface::decode_batch call; every to_decode[i] must
+/// hold the same shards and every out[i] want the same shards
+int decode_batch(
+  const stripe_info_t &sinfo,
+  ceph::ErasureCodeInterfaceRef &ec_impl,
+  const std::vector<std::map<int, ceph::buffer::list>> &to_decode,
+  std::vector<std::map<int, ceph::buffer::list*>> &out);
+
 int encode(
   const stripe_info_t &sinfo,
   ceph::ErasureCodeInterfaceRef &ec_impl,
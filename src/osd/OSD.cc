@@ -57,6 +57,7 @@
 #include "common/pick_address.h"
 #include "common/blkdev.h"
 #include "common/numa.h"
+#include "common/Thread.h"
 
 #include "os/ObjectStore.h"
 #ifdef HAVE_LIBFUSE
@@ -1541,6 +1542,36 @@ void OSDService::_add_map_inc_bl(epoch_t e, bufferlist& bl)
   map_bl_inc_cache.add(e, bl);
 }
 
+void OSDService::add_map_scope(epoch_t e, OSDMap::Incremental::Scope&& scope)
+{
+  std::lock_guard l(map_cache_lock);
+  map_scopes[e] = std::move(scope);
+}
+
+void OSDService::trim_map_scopes(epoch_t oldest)
+{
+  std::lock_guard l(map_cache_lock);
+  map_scopes.erase(map_scopes.begin(), map_scopes.lower_bound(oldest));
+}
+
+bool OSDService::map_is_quiet_for(
+  epoch_t e, int64_t pool, const std::vector<int>& acting)
+{
+  std::lock_guard l(map_cache_lock);
+  auto p = map_scopes.find(e);
+  if (p == map_scopes.end()) {
+    // a full map, or one we did not apply ourselves
+    return false;
+  }
+  const auto& scope = p->second;
+  if (scope.all || scope.pools.count(pool) || scope.up_thru.count(whoami)) {
+    return false;
+  }
+  return std::none_of(acting.begin(), acting.end(), [&scope](int osd) {
+    return scope.up_thru.count(osd);
+  });
+}
+
 OSDMapRef OSDService::_add_map(OSDMap *o)
 {
   epoch_t e = o->get_epoch();
@@ -5230,6 +5261,7 @@ void OSD::load_pgs()
 {
   ceph_assert(ceph_mutex_is_locked(osd_lock));
   dout(0) << "load_pgs" << dendl;
+  const auto start = ceph::mono_clock::now();
 
   {
     auto pghist = make_pg_num_history_oid();
@@ -5248,7 +5280,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  int num = 0;
+  vector<PGRef> pgs;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -5302,23 +5334,47 @@ void OSD::load_pgs()
       continue;
     }
 
-    // there can be no waiters here, so we don't call _wake_pg_slot
-
-    pg->lock();
     pg->ch = store->open_collection(pg->coll);
+    pgs.push_back(std::move(pg));
+  }
 
-    // read pg state, log
-    pg->read_state(store.get());
+  // read pg state, log.  this is most of the work, and each pg only
+  // touches its own collection, so spread them over a few threads.
+  {
+    const size_t num_threads = std::min<size_t>(
+      cct->_conf.get_val<uint64_t>("osd_load_pgs_threads"), pgs.size());
+    std::atomic<size_t> next = 0;
+    auto read_states = [&pgs, &next, this] {
+      for (size_t i = next++; i < pgs.size(); i = next++) {
+	pgs[i]->lock();
+	pgs[i]->read_state(store.get());
+	pgs[i]->unlock();
+      }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+      threads.push_back(make_named_thread("load_pgs", read_states));
+    }
+    read_states();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  int num = 0;
+  for (auto& pg : pgs) {
+    // there can be no waiters here, so we don't call _wake_pg_slot
 
+    pg->lock();
     if (pg->dne())  {
-      dout(10) << "load_pgs " << *it << " deleting dne" << dendl;
+      dout(10) << "load_pgs " << pg->coll << " deleting dne" << dendl;
       pg->ch = nullptr;
       pg->unlock();
-      recursive_remove_collection(cct, store.get(), pgid, *it);
+      recursive_remove_collection(cct, store.get(), pg->pg_id, pg->coll);
       continue;
     }
     {
-      uint32_t shard_index = pgid.hash_to_shard(shards.size());
+      uint32_t shard_index = pg->pg_id.hash_to_shard(shards.size());
       assert(NULL != shards[shard_index]);
       store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
     }
@@ -5329,6 +5385,7 @@ void OSD::load_pgs()
     register_pg(pg);
     ++num;
   }
+  logger->tinc(l_osd_boot_load_pgs_lat, ceph::mono_clock::now() - start);
   dout(0) << __func__ << " opened " << num << " pgs" << dendl;
 }
 
@@ -8226,6 +8283,7 @@ void OSD::handle_osd_map(MOSDMap *m)
       }
       got_full_map(e);
       purged_snaps[e] = o->get_new_purged_snaps();
+      service.add_map_scope(e, inc.get_scope());
 
       ghobject_t fulloid = get_osdmap_pobject_name(e);
       t.write(coll_t::meta(), fulloid, 0, fbl.length(), fbl);
@@ -8248,6 +8306,7 @@ void OSD::handle_osd_map(MOSDMap *m)
   if (!superblock.maps.empty()) {
     trim_maps(m->cluster_osdmap_trim_lower_bound);
     pg_num_history.prune(superblock.get_oldest_map());
+    service.trim_map_scopes(superblock.get_oldest_map());
   }
   superblock.insert_osdmap_epochs(first, last);
   if (superblock.maps.num_intervals() > 1) {
@@ -8449,6 +8508,8 @@ void OSD::_committed_osd_maps(epoch_t first, epoch_t last, MOSDMap *m)
     if (is_booting()) {
       dout(1) << "state: booting -> active" << dendl;
       set_state(STATE_ACTIVE);
+      logger->tinc(l_osd_boot_active_lat,
+		   ceph::mono_clock::now() - startup_time);
       do_restart = false;
 
       // set incarnation so that osd_reqid_t's we generate for our
@@ -8749,9 +8810,20 @@ bool OSD::advance_pg(
 
   unsigned old_pg_num = lastmap->have_pg_pool(pg->pg_id.pool()) ?
     lastmap->get_pg_num(pg->pg_id.pool()) : 0;
+  const bool skip_quiet_maps =
+    cct->_conf.get_val<bool>("osd_advance_pg_skip_quiet_maps");
+  unsigned skipped = 0;
   for (epoch_t next_epoch = first_new_epoch;
        next_epoch <= osd_epoch;
        ++next_epoch) {
+    // the last map is always handled, so that the pg ends up there
+    if (skip_quiet_maps &&
+	next_epoch < osd_epoch &&
+	service.map_is_quiet_for(next_epoch, pg->pg_id.pool(),
+				 pg->get_acting())) {
+      ++skipped;
+      continue;
+    }
     OSDMapRef nextmap = service.try_get_map(next_epoch);
     if (!nextmap) {
       dout(20) << __func__ << " missing map " << next_epoch << dendl;
@@ -8920,8 +8992,14 @@ bool OSD::advance_pg(
 
     lastmap = nextmap;
     old_pg_num = new_pg_num;
+    logger->inc(l_osd_pg_map_advance);
     handle.reset_tp_timeout();
   }
+  if (skipped) {
+    dout(20) << __func__ << " " << pg->pg_id << " skipped " << skipped
+	     << " quiet maps" << dendl;
+    logger->inc(l_osd_pg_map_skip, skipped);
+  }
   pg->handle_activate_map(rctx, first_new_epoch);
 
   ret = true;
@@ -9733,13 +9811,21 @@ void OSD::dequeue_op(
 			  pg->get_osdmap(),
 			  op->sent_epoch);
 
-  if (pg->is_deleting())
+  if (pg->is_deleting()) {
+    pg->op_batch_hold = false;
     return;
+  }
 
   op->mark_reached_pg();
   op->osd_trace.event("dequeue_op");
 
+  pg->defer_reads = true;
   pg->do_request(op, handle);
+  pg->defer_reads = false;
+  // unless another op is queued behind this one, submit what was held
+  if (!std::exchange(pg->op_batch_hold, false)) {
+    pg->flush_op_batch();
+  }
 
   // finish
   dout(10) << "dequeue_op " << *op->get_req() << " finish" << dendl;
@@ -11054,6 +11140,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   // take next item
   auto qi = std::move(slot->to_process.front());
   slot->to_process.pop_front();
+  const bool more_queued = !slot->to_process.empty();
   dout(20) << __func__ << " " << qi << " pg " << pg << dendl;
   set<pair<spg_t,epoch_t>> new_children;
   OSDMapRef osdmap;
@@ -11179,6 +11266,14 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   delete f;
   *_dout << dendl;
 
+  // writes may only be held back for batching while ops for this pg are
+  // queued back to back; anything else sees them submitted first
+  if (qi.maybe_get_op()) {
+    pg->op_batch_hold = more_queued;
+  } else {
+    pg->flush_op_batch();
+  }
+
   qi.run(osd, sdata, pg, tp_handle);
 
   {
@@ -697,6 +697,13 @@ public:
   void _add_map_inc_bl(epoch_t e, ceph::buffer::list& bl);
   bool get_inc_map_bl(epoch_t e, ceph::buffer::list& bl);
 
+  /// scopes of the incremental maps we applied, see OSD::advance_pg()
+  std::map<epoch_t, OSDMap::Incremental::Scope> map_scopes;
+  void add_map_scope(epoch_t e, OSDMap::Incremental::Scope&& scope);
+  void trim_map_scopes(epoch_t oldest);
+  /// true if the map of epoch e maps and peers a pg as e - 1 did
+  bool map_is_quiet_for(epoch_t e, int64_t pool, const std::vector<int>& acting);
+
   /// identify split child pgids over a osdmap interval
   void identify_splits_and_merges(
     OSDMapRef old_map,
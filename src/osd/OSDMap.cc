@@ -233,6 +233,72 @@ int OSDMap::Incremental::get_net_marked_down(const OSDMap *previous) const
   return n;
 }
 
+OSDMap::Incremental::Scope OSDMap::Incremental::get_scope() const
+{
+  Scope scope;
+  scope.all =
+    fullmap.length() || crush.length() ||
+    new_max_osd >= 0 || new_flags >= 0 ||
+    new_require_osd_release != ceph_release_t{0xff} ||
+    new_require_min_compat_client != ceph_release_t{0xff} ||
+    change_stretch_mode ||
+    mutate_allow_crimson != mutate_allow_crimson_t::NONE ||
+    new_nearfull_ratio >= 0 || new_backfillfull_ratio >= 0 ||
+    new_full_ratio >= 0 ||
+    !cluster_snapshot.empty() ||
+    !new_up_client.empty() || !new_up_cluster.empty() ||
+    !new_state.empty() || !new_weight.empty() ||
+    !new_primary_affinity.empty() ||
+    !new_last_clean_interval.empty() ||
+    !new_lost.empty() || !new_uuid.empty() || !new_xinfo.empty() ||
+    !new_blocklist.empty() || !old_blocklist.empty() ||
+    !new_range_blocklist.empty() || !old_range_blocklist.empty() ||
+    !new_hb_back_up.empty() || !new_hb_front_up.empty() ||
+    !new_crush_node_flags.empty() || !new_device_class_flags.empty();
+  if (scope.all) {
+    return scope;
+  }
+
+  for (auto &[pool, info] : new_pools) {
+    // the pgs of a tier look at the pools they are tiered with
+    if (info.is_tier() || !info.tiers.empty()) {
+      scope.all = true;
+      return scope;
+    }
+    scope.pools.insert(pool);
+  }
+  for (auto &i : new_pool_names) {
+    scope.pools.insert(i.first);
+  }
+  scope.pools.insert(old_pools.begin(), old_pools.end());
+  for (auto &i : new_removed_snaps) {
+    scope.pools.insert(i.first);
+  }
+  for (auto &i : new_purged_snaps) {
+    scope.pools.insert(i.first);
+  }
+  auto add_pgs = [&scope](const auto &pgs) {
+    for (auto &i : pgs) {
+      scope.pools.insert(i.first.pool());
+    }
+  };
+  add_pgs(new_pg_temp);
+  add_pgs(new_primary_temp);
+  add_pgs(new_pg_upmap);
+  add_pgs(new_pg_upmap_items);
+  add_pgs(new_pg_upmap_primary);
+  for (auto *pgs : {&old_pg_upmap, &old_pg_upmap_items,
+		    &old_pg_upmap_primary}) {
+    for (auto &pgid : *pgs) {
+      scope.pools.insert(pgid.pool());
+    }
+  }
+  for (auto &i : new_up_thru) {
+    scope.up_thru.insert(i.first);
+  }
+  return scope;
+}
+
 int OSDMap::Incremental::identify_osd(uuid_d u) const
 {
   for (auto &uuid : new_uuid)
@@ -2687,6 +2753,30 @@ void OSDMap::_pg_to_raw_osds(
     *ppps = pps;
 }
 
+void OSDMap::_pgs_to_raw_osds(
+  const pg_pool_t& pool, int64_t poolid,
+  unsigned ps_begin, unsigned ps_end,
+  vector<vector<int>> *osds,
+  vector<int> *ppps) const
+{
+  ppps->resize(ps_end - ps_begin);
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    (*ppps)[ps - ps_begin] = pool.raw_pg_to_pps(pg_t(ps, poolid));
+  }
+
+  int ruleno = pool.get_crush_rule();
+  if (ruleno >= 0) {
+    crush->do_rule_batch(ruleno, *ppps, *osds, pool.get_size(), osd_weight,
+			 poolid);
+  } else {
+    osds->assign(ps_end - ps_begin, {});
+  }
+
+  for (auto& o : *osds) {
+    _remove_nonexistent_osds(pool, o);
+  }
+}
+
 int OSDMap::_pick_primary(const vector<int>& osds) const
 {
   for (auto osd : osds) {
@@ -2970,6 +3060,40 @@ void OSDMap::_pg_to_up_acting_osds(
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::pgs_to_up_acting_osds(
+  int64_t poolid, unsigned ps_begin, unsigned ps_end,
+  vector<vector<int>> *up, vector<int> *up_primary,
+  vector<vector<int>> *acting, vector<int> *acting_primary) const
+{
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  ceph_assert(pool);
+  ceph_assert(ps_begin <= ps_end);
+  ceph_assert(ps_end <= pool->get_pg_num());
+  vector<int> pps;
+  _pgs_to_raw_osds(*pool, poolid, ps_begin, ps_end, up, &pps);
+  up_primary->resize(ps_end - ps_begin);
+  acting->resize(ps_end - ps_begin);
+  acting_primary->resize(ps_end - ps_begin);
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    // as _pg_to_up_acting_osds() does with the raw mapping
+    pg_t pg(ps, poolid);
+    unsigned i = ps - ps_begin;
+    vector<int> raw;
+    raw.swap((*up)[i]);
+    _get_temp_osds(*pool, pg, &(*acting)[i], &(*acting_primary)[i]);
+    _apply_upmap(*pool, pg, &raw);
+    _raw_to_up_osds(*pool, raw, &(*up)[i]);
+    (*up_primary)[i] = _pick_primary((*up)[i]);
+    _apply_primary_affinity(pps[i], *pool, &(*up)[i], &(*up_primary)[i]);
+    if ((*acting)[i].empty()) {
+      (*acting)[i] = (*up)[i];
+      if ((*acting_primary)[i] == -1) {
+	(*acting_primary)[i] = (*up_primary)[i];
+      }
+    }
+  }
+}
+
 int OSDMap::calc_pg_role_broken(int osd, const vector<int>& acting, int nrep)
 {
   // This implementation is broken for EC PGs since the osd may appear
@@ -443,6 +443,20 @@ public:
     int get_net_marked_down(const OSDMap *previous) const;
     int identify_osd(uuid_d u) const;
 
+    /// what an incremental may change for the pgs, see get_scope()
+    struct Scope {
+      bool all = false;            ///< may affect the pgs of any pool
+      std::set<int64_t> pools;     ///< pools whose pgs may be affected
+      std::set<int32_t> up_thru;   ///< osds whose up_thru changed
+    };
+    /**
+     * Sort out which pgs this incremental may affect.  A pg of a pool
+     * not in the scope, whose acting osds did not get a new up_thru,
+     * maps and peers the same way before and after it.  Anything not
+     * known to be local to a pool puts every pg in the scope.
+     */
+    Scope get_scope() const;
+
     void encode_client_old(ceph::buffer::list& bl) const;
     void encode_classic(ceph::buffer::list& bl, uint64_t features) const;
     void encode(ceph::buffer::list& bl, uint64_t features=CEPH_FEATURES_ALL) const;
@@ -674,6 +688,7 @@ private:
   uint32_t crush_version = 1;
 
   friend class OSDMonitor;
+  friend class OSDMapMapping;
 
  public:
   OSDMap() : epoch(0), 
@@ -1232,6 +1247,12 @@ private:
     const pg_pool_t& pool, pg_t pg,
     std::vector<int> *osds,
     ps_t *ppps) const;
+  /// _pg_to_raw_osds() of pgs [ps_begin, ps_end), in one crush batch
+  void _pgs_to_raw_osds(
+    const pg_pool_t& pool, int64_t poolid,
+    unsigned ps_begin, unsigned ps_end,
+    std::vector<std::vector<int>> *osds,
+    std::vector<int> *ppps) const;
   int _pick_primary(const std::vector<int>& osds) const;
   void _remove_nonexistent_osds(const pg_pool_t& pool, std::vector<int>& osds) const;
 
@@ -1300,6 +1321,16 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * pg_to_up_acting_osds() of the pgs [ps_begin, ps_end) of a pool, the
+   * mapping of ps_begin + i going to index i of each vector.  The crush
+   * mappings of all of them are computed in one batch.
+   */
+  void pgs_to_up_acting_osds(int64_t poolid, unsigned ps_begin, unsigned ps_end,
+			     std::vector<std::vector<int>> *up,
+			     std::vector<int> *up_primary,
+			     std::vector<std::vector<int>> *acting,
+			     std::vector<int> *acting_primary) const;
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
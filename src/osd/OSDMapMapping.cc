@@ -90,6 +90,192 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  dirty = false;
+}
+
+// the pgs whose mapping may differ between the map inc was applied to
+// and osdmap, the result of applying it.  the mapping itself must still
+// be that of the former.  return false if that might be any pg.
+bool OSDMapMapping::_get_affected_pgs(
+  const OSDMap& osdmap,
+  const OSDMap::Incremental& inc,
+  std::vector<pg_t> *pgs) const
+{
+  if (inc.fullmap.length() ||
+      inc.crush.length() ||
+      inc.new_max_osd >= 0 ||
+      inc.change_stretch_mode) {
+    return false;
+  }
+
+  std::set<int64_t> all_pools;
+  std::set<pg_t> some_pgs;
+  auto add_pg = [&](pg_t pgid) {
+    const pg_pool_t *pi = osdmap.get_pg_pool(pgid.pool());
+    if (pi && pgid.ps() < pi->get_pg_num()) {
+      some_pgs.insert(pgid);
+    }
+  };
+
+  // the pools we have not mapped at this size and pg_num yet, and those
+  // whose rule, pgp_num or tiering may have changed
+  for (auto& [poolid, pool] : osdmap.get_pools()) {
+    auto q = pools.find(poolid);
+    if (q == pools.end() ||
+	q->second.pg_num != pool.get_pg_num() ||
+	q->second.size != pool.get_size() ||
+	inc.new_pools.count(poolid)) {
+      all_pools.insert(poolid);
+    }
+  }
+
+  // pgs that are remapped explicitly, before or after
+  for (auto& i : inc.new_pg_temp) {
+    add_pg(i.first);
+  }
+  for (auto& i : inc.new_primary_temp) {
+    add_pg(i.first);
+  }
+  for (auto& i : inc.new_pg_upmap) {
+    add_pg(i.first);
+  }
+  for (auto& i : inc.new_pg_upmap_items) {
+    add_pg(i.first);
+  }
+  for (auto& i : inc.new_pg_upmap_primary) {
+    add_pg(i.first);
+  }
+  for (auto *old : {&inc.old_pg_upmap, &inc.old_pg_upmap_items,
+		    &inc.old_pg_upmap_primary}) {
+    for (auto& pgid : *old) {
+      add_pg(pgid);
+    }
+  }
+
+  // osds whose state, weight or primary affinity changed.  an osd
+  // that went down (or away) or whose primary affinity changed can only
+  // remap the pgs it was serving, but one that came up or was reweighted
+  // changes the choices CRUSH makes anywhere below the roots it sits
+  // under, so every pool whose rule takes one of those.
+  std::set<int> osds, crush_osds;
+  for (auto& [osd, state] : inc.new_state) {
+    int s = state ? state : CEPH_OSD_UP;
+    if (s & (CEPH_OSD_UP | CEPH_OSD_EXISTS)) {
+      osds.insert(osd);
+    }
+  }
+  for (auto& i : inc.new_up_client) {
+    osds.insert(i.first);
+  }
+  for (auto& i : inc.new_primary_affinity) {
+    osds.insert(i.first);
+  }
+  for (auto& i : inc.new_weight) {
+    osds.insert(i.first);
+    crush_osds.insert(i.first);
+  }
+  for (auto osd : osds) {
+    if (osdmap.is_up(osd)) {
+      crush_osds.insert(osd);
+    }
+  }
+  if (!osds.empty()) {
+    for (auto osd : osds) {
+      if (osd >= 0 && osd < (int)acting_rmap.size()) {
+	for (auto& pgid : acting_rmap[osd]) {
+	  add_pg(pgid);
+	}
+      }
+    }
+    // pg_temp and upmap entries name osds whether or not they are used
+    for (auto p = osdmap.pg_temp->begin(); p != osdmap.pg_temp->end(); ++p) {
+      add_pg(p->first);
+    }
+    for (auto& i : *osdmap.primary_temp) {
+      add_pg(i.first);
+    }
+    for (auto& i : osdmap.pg_upmap) {
+      add_pg(i.first);
+    }
+    for (auto& i : osdmap.pg_upmap_items) {
+      add_pg(i.first);
+    }
+    for (auto& i : osdmap.pg_upmap_primaries) {
+      add_pg(i.first);
+    }
+  }
+  if (!crush_osds.empty()) {
+    std::map<int, bool> rule_affected;
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      if (all_pools.count(poolid)) {
+	continue;
+      }
+      int rule = pool.get_crush_rule();
+      auto r = rule_affected.find(rule);
+      if (r == rule_affected.end()) {
+	std::set<int> roots;
+	osdmap.crush->find_takes_by_rule(rule, &roots);
+	bool affected = roots.empty();
+	for (auto root : roots) {
+	  for (auto osd : crush_osds) {
+	    if (osdmap.crush->subtree_contains(root, osd)) {
+	      affected = true;
+	      break;
+	    }
+	  }
+	  if (affected) {
+	    break;
+	  }
+	}
+	r = rule_affected.emplace(rule, affected).first;
+      }
+      if (r->second) {
+	all_pools.insert(poolid);
+      }
+    }
+  }
+
+  pgs->clear();
+  for (auto poolid : all_pools) {
+    unsigned pg_num = osdmap.get_pg_pool(poolid)->get_pg_num();
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      pgs->push_back(pg_t(ps, poolid));
+    }
+  }
+  for (auto& pgid : some_pgs) {
+    if (!all_pools.count(pgid.pool())) {
+      pgs->push_back(pgid);
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item,
+  const OSDMap::Incremental& inc)
+{
+  std::vector<pg_t> pgs;
+  bool partial = false;
+  if (!dirty && epoch == map.get_epoch()) {
+    // nothing changed
+    partial = true;
+  } else if (!dirty && epoch + 1 == map.get_epoch() &&
+	     inc.epoch == map.get_epoch()) {
+    partial = _get_affected_pgs(map, inc, &pgs);
+  }
+  if (!partial) {
+    return start_update(map, mapper, pgs_per_item);
+  }
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
+  if (pgs.empty()) {
+    job->finish = ceph_clock_now();
+    job->complete();
+  } else {
+    mapper.queue(job.get(), pgs_per_item, pgs);
+  }
+  return job;
 }
 
 void OSDMapMapping::_dump()
@@ -114,14 +300,14 @@ void OSDMapMapping::_update_range(
   ceph_assert(i != pools.end());
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
+  std::vector<std::vector<int>> up, acting;
+  std::vector<int> up_primary, acting_primary;
+  osdmap.pgs_to_up_acting_osds(pool, pg_begin, pg_end,
+			       &up, &up_primary, &acting, &acting_primary);
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
-    int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
-      pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+    unsigned j = ps - pg_begin;
+    i->second.set(ps, std::move(up[j]), up_primary[j],
+		  std::move(acting[j]), acting_primary[j]);
   }
 }
 
@@ -11,8 +11,7 @@
 #include "osd/osd_types.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
-
-class OSDMap;
+#include "osd/OSDMap.h"
 
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
@@ -255,6 +254,7 @@ private:
   //unused: mempool::osdmap_mapping::vector<std::vector<pg_t>> up_rmap;  // osd -> pg
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
+  bool dirty = false;  ///< an update was started but did not finish
 
   void _init_mappings(const OSDMap& osdmap);
   void _update_range(
@@ -264,7 +264,12 @@ private:
 
   void _build_rmap(const OSDMap& osdmap);
 
+  bool _get_affected_pgs(const OSDMap& osdmap,
+			 const OSDMap::Incremental& inc,
+			 std::vector<pg_t> *pgs) const;
+
   void _start(const OSDMap& osdmap) {
+    dirty = true;
     _init_mappings(osdmap);
   }
   void _finish(const OSDMap& osdmap);
@@ -279,7 +284,11 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
-    void process(const std::vector<pg_t>& pgs) override {}
+    void process(const std::vector<pg_t>& pgs) override {
+      for (auto& pgid : pgs) {
+	mapping->_update_range(*osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
+      }
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -341,6 +350,15 @@ public:
     return job;
   }
 
+  /// like start_update(), but if we are still at the epoch before inc
+  /// (the incremental that led to map) only recompute the pgs it can
+  /// have remapped
+  std::unique_ptr<MappingJob> start_update(
+    const OSDMap& map,
+    ParallelPGMapper& mapper,
+    unsigned pgs_per_item,
+    const OSDMap::Incremental& inc);
+
   epoch_t get_epoch() const {
     return epoch;
   }
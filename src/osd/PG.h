@@ -756,6 +756,25 @@ public:
     OpRequestRef& op,
     ThreadPool::TPHandle &handle
   ) = 0;
+
+  /**
+   * True while an op runs which has another item for this pg queued
+   * behind it, set by the op queue with the pg locked.  Only then may
+   * writes be held back to be batched with the ops that follow; they
+   * are submitted by flush_op_batch().
+   */
+  bool op_batch_hold = false;
+  /// submit the writes held back for batching, if any
+  virtual void flush_op_batch() {}
+
+  /**
+   * True while the op queue runs an op with the pg locked.  Only then may
+   * the pg defer the object store reads of the op; the op queue takes
+   * them with take_unlocked_reads() before unlocking the pg and runs the
+   * returned Context once it is unlocked.
+   */
+  bool defer_reads = false;
+  virtual Context *take_unlocked_reads() { return nullptr; }
   virtual void clear_cache() = 0;
   virtual int get_cache_obj_count() = 0;
 
@@ -46,10 +46,10 @@ void PGLog::IndexedLog::split_out_child(
   unsigned split_bits,
   PGLog::IndexedLog *target)
 {
+  const auto indexed = indexed_data;
   unindex();
   *target = IndexedLog(pg_log_t::split_out_child(child_pgid, split_bits));
-  index();
-  target->index();
+  index(indexed);
   reset_rollback_info_trimmed_to_riter();
 }
 
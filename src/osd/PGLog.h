@@ -146,10 +146,13 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
-    mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    // The indexes are built on first use only, so that the logs of pgs
+    // which never look up an object or a request (typically replicas
+    // outside of peering) do not carry them.  Accounted to osd_pglog.
+    mutable mempool::osd_pglog::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
+    mutable mempool::osd_pglog::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
+    mutable mempool::osd_pglog::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+    mutable mempool::osd_pglog::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
 
     // recovery pointers
     std::list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -219,7 +222,6 @@ public:
       rollback_info_trimmed_to_riter(log.rbegin())
     {
       reset_rollback_info_trimmed_to_riter();
-      index();
     }
 
     IndexedLog(const IndexedLog &rhs) :
@@ -260,7 +262,7 @@ public:
 
     mempool::osd_pglog::list<pg_log_entry_t> rewind_from_head(eversion_t newhead) {
       auto divergent = pg_log_t::rewind_from_head(newhead);
-      index();
+      index(indexed_data);
       reset_rollback_info_trimmed_to_riter();
       return divergent;
     }
@@ -286,10 +288,11 @@ public:
       ceph_assert(rollback_info_trimmed_to == head);
       ceph_assert(rollback_info_trimmed_to_riter == log.rbegin());
 
+      const auto indexed = indexed_data;
       *this = IndexedLog(o);
 
       skip_can_rollback_to_to_head();
-      index();
+      index(indexed);
     }
 
     void split_out_child(
@@ -323,6 +326,15 @@ public:
       return objects.count(oid);
     }
 
+    /// the most recent entry for oid, nullptr if it is not logged
+    const pg_log_entry_t *get_latest_entry(const hobject_t& oid) const {
+      if (!(indexed_data & PGLOG_INDEXED_OBJECTS)) {
+         index_objects();
+      }
+      auto p = objects.find(oid);
+      return p == objects.end() ? nullptr : p->second;
+    }
+
     bool logged_req(const osd_reqid_t &r) const {
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
@@ -496,6 +508,10 @@ public:
       indexed_data |= to_index;
     }
 
+    __u16 get_indexed_data() const {
+      return indexed_data;
+    }
+
     void index_objects() const {
       index(PGLOG_INDEXED_OBJECTS);
     }
@@ -865,6 +881,7 @@ public:
   void merge_from(
     const std::vector<PGLog*>& sources,
     eversion_t last_update) {
+    const auto indexed = log.get_indexed_data();
     unindex();
     missing.clear();
 
@@ -874,7 +891,7 @@ public:
     }
     log.merge_from(slogs, last_update);
 
-    index();
+    log.index(indexed);
 
     mark_log_for_rewrite();
   }
@@ -1058,20 +1075,20 @@ protected:
 		       << " last_divergent_update: " << last_divergent_update
 		       << dendl;
 
-    auto objiter = log.objects.find(hoid);
-    if (objiter != log.objects.end() &&
-	objiter->second->version >= first_divergent_update) {
+    auto objentry = log.get_latest_entry(hoid);
+    if (objentry &&
+	objentry->version >= first_divergent_update) {
       /// Case 1)
       ldpp_dout(dpp, 10) << __func__ << ": more recent entry found: "
-			 << *objiter->second << ", already merged" << dendl;
+			 << *objentry << ", already merged" << dendl;
 
-      ceph_assert(objiter->second->version > last_divergent_update);
+      ceph_assert(objentry->version > last_divergent_update);
 
       // ensure missing has been updated appropriately
-      if (objiter->second->is_update() ||
-	  (missing.may_include_deletes && objiter->second->is_delete())) {
+      if (objentry->is_update() ||
+	  (missing.may_include_deletes && objentry->is_delete())) {
 	ceph_assert(missing.is_missing(hoid) &&
-	       missing.get_items().at(hoid).need == objiter->second->version);
+	       missing.get_items().at(hoid).need == objentry->version);
       } else {
 	ceph_assert(!missing.is_missing(hoid));
       }
@@ -532,6 +532,48 @@ public:
     get_object_op_for_modify(hoid);
   }
 
+  /**
+   * True if this transaction only updates the data (other than by
+   * clone_range), attrs and omap of the existing object hoid: it does
+   * not create, remove, truncate or clone it, nor touch another object.
+   * Such transactions can be appended to one another, see append().
+   */
+  bool is_simple_update(const hobject_t &hoid) const {
+    if (op_map.size() != 1 || op_map.begin()->first != hoid)
+      return false;
+    auto &op = op_map.begin()->second;
+    if (!op.is_none() || op.truncate || op.clear_omap || op.updated_snaps)
+      return false;
+    for (auto &&extent : op.buffer_updates) {
+      if (boost::get<ObjectOperation::BufferUpdate::CloneRange>(
+	    &extent.get_val()))
+	return false;
+    }
+    return true;
+  }
+
+  /// Applies other, a simple update, after the updates of this transaction
+  void append(PGTransaction &&other) {
+    ceph_assert(other.op_map.size() == 1);
+    auto &[hoid, oop] = *other.op_map.begin();
+    auto &op = get_object_op_for_modify(hoid);
+    ceph_assert(!op.updated_snaps);
+    op.buffer_updates.insert(std::move(oop.buffer_updates));
+    for (auto &&[key, val] : oop.attr_updates) {
+      op.attr_updates[key] = std::move(val);
+    }
+    op.omap_updates.insert(
+      op.omap_updates.end(),
+      std::make_move_iterator(oop.omap_updates.begin()),
+      std::make_move_iterator(oop.omap_updates.end()));
+    if (oop.omap_header)
+      op.omap_header = std::move(oop.omap_header);
+    if (oop.alloc_hint)
+      op.alloc_hint = oop.alloc_hint;
+    obc_map.insert(other.obc_map.begin(), other.obc_map.end());
+    other.op_map.clear();
+  }
+
   /* Calls t() on all pair<hobject_t, ObjectOperation> & such that clone/rename
    * sinks are always called before clone sources
    *
@@ -294,6 +294,13 @@ void PrimaryLogPG::OpContext::start_async_reads(PrimaryLogPG *pg)
   list<pair<boost::tuple<uint64_t, uint64_t, unsigned>,
 	    pair<bufferlist*, Context*> > > in;
   in.swap(pending_async_reads);
+  if (!pg->get_pool().is_erasure()) {
+    // see PrimaryLogPG::do_read()
+    pg->unlocked_reads.push_back(
+      UnlockedRead{this, obc->obs.oi.soid, std::move(in),
+		   new OnReadComplete(pg, this)});
+    return;
+  }
   pg->pgbackend->objects_read_async(
     obc->obs.oi.soid,
     in,
@@ -304,9 +311,16 @@ void PrimaryLogPG::OpContext::finish_read(PrimaryLogPG *pg)
   ceph_assert(inflightreads > 0);
   --inflightreads;
   if (async_reads_complete()) {
-    ceph_assert(pg->in_progress_async_reads.size());
-    ceph_assert(pg->in_progress_async_reads.front().second == this);
-    pg->in_progress_async_reads.pop_front();
+    // the reads of an ec pool complete in order, reads done without the
+    // pg lock in whichever order the op queue threads finish them
+    auto p = std::find_if(
+      pg->in_progress_async_reads.begin(),
+      pg->in_progress_async_reads.end(),
+      [this](const auto &i) { return i.second == this; });
+    ceph_assert(p != pg->in_progress_async_reads.end());
+    ceph_assert(!pg->get_pool().is_erasure() ||
+		p == pg->in_progress_async_reads.begin());
+    pg->in_progress_async_reads.erase(p);
 
     // Restart the op context now that all reads have been
     // completed. Read failures will be handled by the op finisher
@@ -314,6 +328,79 @@ void PrimaryLogPG::OpContext::finish_read(PrimaryLogPG *pg)
   }
 }
 
+class PrimaryLogPG::C_UnlockedReads : public Context {
+  PrimaryLogPGRef pg;
+  ObjectStore::CollectionHandle ch;
+  epoch_t epoch;
+  std::list<UnlockedRead> reads;
+public:
+  C_UnlockedReads(PrimaryLogPG *pg, std::list<UnlockedRead> &&reads)
+    : pg(pg), ch(pg->ch), epoch(pg->get_osdmap_epoch()),
+      reads(std::move(reads)) {}
+  void finish(int) override {
+    // the pg is not locked here, only the object store may be used
+    std::vector<std::pair<int, bufferlist>> results;
+    for (auto &read : reads) {
+      const ghobject_t goid(read.soid);
+      for (auto &[extent, out] : read.to_read) {
+	bufferlist bl;
+	int r = pg->osd->store->read(ch, goid, extent.get<0>(),
+				     extent.get<1>(), bl, extent.get<2>());
+	results.emplace_back(r, std::move(bl));
+      }
+    }
+
+    std::scoped_lock l{*pg};
+    const bool reset = pg->pg_has_reset_since(epoch);
+    auto result = results.begin();
+    for (auto &read : reads) {
+      // the op is gone if the pg was reset or shut down meanwhile
+      const bool live = !reset && std::any_of(
+	pg->in_progress_async_reads.begin(),
+	pg->in_progress_async_reads.end(),
+	[&read](const auto &i) { return i.second == read.ctx; });
+      for (auto &[extent, out] : read.to_read) {
+	if (live) {
+	  *out.first = std::move(result->second);
+	  out.second->complete(result->first);
+	} else {
+	  delete out.second;
+	}
+	++result;
+      }
+      if (live) {
+	pg->osd->logger->inc(l_osd_op_r_unlocked);
+	read.on_complete->complete(0);
+      } else {
+	delete read.on_complete;
+      }
+    }
+  }
+};
+
+bool PrimaryLogPG::can_read_unlocked(const OpContext *ctx) const
+{
+  // only a client op which reads and nothing else, so that the object
+  // it read locked does not change until it completes
+  return defer_reads &&
+    !pool.info.is_erasure() &&
+    cct->_conf.get_val<bool>("osd_read_without_pg_lock") &&
+    ctx->op &&
+    ctx->op->get_req()->get_type() == CEPH_MSG_OSD_OP &&
+    ctx->lock_type == RWState::RWREAD &&
+    !ctx->op->may_write() &&
+    !ctx->op->may_cache();
+}
+
+Context *PrimaryLogPG::take_unlocked_reads()
+{
+  if (unlocked_reads.empty()) {
+    return nullptr;
+  }
+  dout(20) << __func__ << " " << unlocked_reads.size() << " ops" << dendl;
+  return new C_UnlockedReads(this, std::exchange(unlocked_reads, {}));
+}
+
 class CopyFromCallback : public PrimaryLogPG::CopyCallback {
 public:
   PrimaryLogPG::CopyResults *results = nullptr;
@@ -417,7 +504,7 @@ void PrimaryLogPG::on_local_recover(
   if (!is_delete && recovery_state.get_pg_log().get_missing().is_missing(recovery_info.soid) &&
       recovery_state.get_pg_log().get_missing().get_items().find(recovery_info.soid)->second.need > recovery_info.version) {
     ceph_assert(is_primary());
-    const pg_log_entry_t *latest = recovery_state.get_pg_log().get_log().objects.find(recovery_info.soid)->second;
+    const pg_log_entry_t *latest = recovery_state.get_pg_log().get_log().get_latest_entry(recovery_info.soid);
     if (latest->op == pg_log_entry_t::LOST_REVERT &&
 	latest->reverting_to == recovery_info.version) {
       dout(10) << " got old revert version " << recovery_info.version
@@ -1812,6 +1899,11 @@ void PrimaryLogPG::do_request(
     op->pg_trace.event("do request");
   }
 
+  // only client ops may follow the writes held back for batching
+  if (op->get_req()->get_type() != CEPH_MSG_OSD_OP) {
+    flush_op_batch();
+  }
+
 
 // make sure we have a new enough map
   auto p = waiting_for_map.find(op->get_source());
@@ -4225,7 +4317,6 @@ void PrimaryLogPG::execute_ctx(OpContext *ctx)
   if (result == -EINPROGRESS || pending_async_reads) {
     // come back later.
     if (pending_async_reads) {
-      ceph_assert(pool.info.is_erasure());
       in_progress_async_reads.push_back(make_pair(op, ctx));
       ctx->start_async_reads(this);
     }
@@ -5381,6 +5472,14 @@ struct FillInVerifyExtent : public Context {
   }
 };
 
+struct C_SetReadResult : public Context {
+  int *result;
+  explicit C_SetReadResult(int *result) : result(result) {}
+  void finish(int r) override {
+    *result = r;
+  }
+};
+
 struct ToSparseReadResult : public Context {
   int* result;
   bufferlist* data_bl;
@@ -5847,8 +5946,25 @@ int PrimaryLogPG::do_read(OpContext *ctx, OSDOp& osd_op) {
     ctx->op_finishers[ctx->current_osd_subop_num].reset(
       new ReadFinisher(osd_op));
   } else {
-    int r = pgbackend->objects_read_sync(
-      soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata);
+    int r;
+    if (auto p = ctx->unlocked_reads.find(ctx->current_osd_subop_num);
+	p != ctx->unlocked_reads.end()) {
+      // read without the pg lock, see take_unlocked_reads()
+      r = p->second.first;
+      osd_op.outdata = std::move(p->second.second);
+      ctx->unlocked_reads.erase(p);
+    } else if (can_read_unlocked(ctx)) {
+      auto &result = ctx->unlocked_reads[ctx->current_osd_subop_num];
+      ctx->pending_async_reads.push_back(
+	make_pair(
+	  boost::make_tuple(op.extent.offset, op.extent.length, op.flags),
+	  make_pair(&result.second, new C_SetReadResult(&result.first))));
+      dout(10) << " unlocked read noted for " << soid << dendl;
+      return 0;
+    } else {
+      r = pgbackend->objects_read_sync(
+	soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata);
+    }
     // whole object?  can we verify the checksum?
     if (r >= 0 && op.extent.offset == 0 &&
         (uint64_t)r == oi.size && oi.is_data_digest()) {
@@ -11453,7 +11569,12 @@ void PrimaryLogPG::issue_repop(RepGather *repop, OpContext *ctx)
     ctx->op_t->add_obc(ctx->head_obc);
   }
 
-  Context *on_all_commit = new C_OSD_RepopCommit(this, repop);
+  // the backend must see transactions in version order
+  const bool batch = can_batch_op(ctx);
+  if (!batch) {
+    flush_op_batch();
+  }
+
   if (!(ctx->log.empty())) {
     ceph_assert(ctx->at_version >= projected_last_update);
     projected_last_update = ctx->at_version;
@@ -11466,6 +11587,11 @@ void PrimaryLogPG::issue_repop(RepGather *repop, OpContext *ctx)
     soid,
     ctx->log,
     ctx->at_version);
+  if (batch) {
+    batch_op(repop, ctx);
+    return;
+  }
+  Context *on_all_commit = new C_OSD_RepopCommit(this, repop);
   pgbackend->submit_transaction(
     soid,
     ctx->delta_stats,
@@ -11481,6 +11607,110 @@ void PrimaryLogPG::issue_repop(RepGather *repop, OpContext *ctx)
     ctx->op);
 }
 
+class C_OSD_OpBatchCommit : public Context {
+  PrimaryLogPGRef pg;
+  std::vector<boost::intrusive_ptr<PrimaryLogPG::RepGather>> repops;
+public:
+  C_OSD_OpBatchCommit(
+    PrimaryLogPG *pg,
+    std::vector<boost::intrusive_ptr<PrimaryLogPG::RepGather>> &&repops)
+    : pg(pg), repops(std::move(repops)) {}
+  void finish(int) override {
+    for (auto &repop : repops) {
+      pg->repop_all_committed(repop.get());
+    }
+  }
+};
+
+bool PrimaryLogPG::can_batch_op(const OpContext *ctx) const
+{
+  if (!cct->_conf.get_val<bool>("osd_op_batch_writes") ||
+      pool.info.is_erasure()) {
+    return false;
+  }
+  // a single client write which neither creates, removes nor clones
+  // the object
+  if (!ctx->op ||
+      ctx->op->get_req()->get_type() != CEPH_MSG_OSD_OP ||
+      ctx->clone_obc ||
+      ctx->head_obc ||
+      ctx->log.size() != 1 ||
+      ctx->updated_hset_history ||
+      !ctx->op_t->is_simple_update(ctx->obs->oi.soid)) {
+    return false;
+  }
+  return ctx->op_t->get_bytes_written() <=
+    cct->_conf.get_val<Option::size_t>("osd_op_batch_max_write_size");
+}
+
+void PrimaryLogPG::batch_op(RepGather *repop, OpContext *ctx)
+{
+  const hobject_t& soid = ctx->obs->oi.soid;
+  if (op_batch && op_batch->soid != soid) {
+    flush_op_batch();
+  }
+  const uint64_t bytes = ctx->op_t->get_bytes_written();
+  if (!op_batch) {
+    op_batch.emplace();
+    op_batch->soid = soid;
+    op_batch->t = std::move(ctx->op_t);
+    op_batch->reqid = ctx->reqid;
+    op_batch->op = ctx->op;
+  } else {
+    op_batch->t->append(std::move(*ctx->op_t));
+    ctx->op_t.reset();
+  }
+  op_batch->delta_stats.add(ctx->delta_stats);
+  op_batch->at_version = ctx->at_version;
+  std::move(ctx->log.begin(), ctx->log.end(),
+	    std::back_inserter(op_batch->log));
+  ctx->log.clear();
+  op_batch->repops.emplace_back(repop);
+  op_batch->bytes += bytes;
+  dout(20) << __func__ << " " << soid << " " << ctx->at_version
+	   << ", " << op_batch->repops.size() << " ops "
+	   << op_batch->bytes << " bytes held" << dendl;
+
+  if (!op_batch_hold ||
+      op_batch->repops.size() >=
+      cct->_conf.get_val<uint64_t>("osd_op_batch_max_ops")) {
+    flush_op_batch();
+  }
+}
+
+void PrimaryLogPG::flush_op_batch()
+{
+  if (!op_batch) {
+    return;
+  }
+  OpBatch batch = std::move(*op_batch);
+  op_batch.reset();
+  dout(10) << __func__ << " " << batch.soid << " " << batch.repops.size()
+	   << " ops through " << batch.at_version << dendl;
+
+  if (batch.repops.size() > 1) {
+    osd->logger->inc(l_osd_op_batch);
+    osd->logger->inc(l_osd_op_batched, batch.repops.size());
+  }
+  const ceph_tid_t rep_tid = batch.repops.front()->rep_tid;
+  Context *on_all_commit = new C_OSD_OpBatchCommit(
+    this, std::move(batch.repops));
+  std::optional<pg_hit_set_history_t> hset_history;
+  pgbackend->submit_transaction(
+    batch.soid,
+    batch.delta_stats,
+    batch.at_version,
+    std::move(batch.t),
+    recovery_state.get_pg_trim_to(),
+    recovery_state.get_min_last_complete_ondisk(),
+    std::move(batch.log),
+    hset_history,
+    on_all_commit,
+    rep_tid,
+    batch.reqid,
+    batch.op);
+}
+
 PrimaryLogPG::RepGather *PrimaryLogPG::new_repop(
   OpContext *ctx,
   ceph_tid_t rep_tid)
@@ -11578,6 +11808,7 @@ void PrimaryLogPG::submit_log_entries(
 {
   dout(10) << __func__ << " " << entries << dendl;
   ceph_assert(is_primary());
+  flush_op_batch();
 
   eversion_t version;
   if (!entries.empty()) {
@@ -11753,13 +11984,13 @@ void PrimaryLogPG::check_blocklisted_obc_watchers(ObjectContextRef obc)
 void PrimaryLogPG::populate_obc_watchers(ObjectContextRef obc)
 {
   ceph_assert(is_primary() && is_active());
-  auto it_objects = recovery_state.get_pg_log().get_log().objects.find(obc->obs.oi.soid);
+  auto latest = recovery_state.get_pg_log().get_log().get_latest_entry(obc->obs.oi.soid);
   ceph_assert((recovering.count(obc->obs.oi.soid) ||
 	  !is_missing_object(obc->obs.oi.soid)) ||
-	 (it_objects != recovery_state.get_pg_log().get_log().objects.end() && // or this is a revert... see recover_primary()
-	  it_objects->second->op ==
+	 (latest && // or this is a revert... see recover_primary()
+	  latest->op ==
 	    pg_log_entry_t::LOST_REVERT &&
-	  it_objects->second->reverting_to ==
+	  latest->reverting_to ==
 	    obc->obs.oi.version));
 
   dout(10) << "populate_obc_watchers " << obc->obs.oi.soid << dendl;
@@ -11877,12 +12108,12 @@ ObjectContextRef PrimaryLogPG::get_object_context(
   bool can_create,
   const map<string, bufferlist, less<>> *attrs)
 {
-  auto it_objects = recovery_state.get_pg_log().get_log().objects.find(soid);
+  auto latest = recovery_state.get_pg_log().get_log().get_latest_entry(soid);
   ceph_assert(
     attrs || !recovery_state.get_pg_log().get_missing().is_missing(soid) ||
     // or this is a revert... see recover_primary()
-    (it_objects != recovery_state.get_pg_log().get_log().objects.end() &&
-      it_objects->second->op ==
+    (latest &&
+      latest->op ==
       pg_log_entry_t::LOST_REVERT));
   ObjectContextRef obc = object_contexts.lookup(soid);
   osd->logger->inc(l_osd_object_ctx_cache_total);
@@ -12860,6 +13091,10 @@ void PrimaryLogPG::apply_and_flush_repops(bool requeue)
 {
   list<OpRequestRef> rq;
 
+  // drop the writes held back for batching; their repops are in
+  // repop_queue and are canceled below
+  op_batch.reset();
+
   // apply all repops
   while (!repop_queue.empty()) {
     RepGather *repop = repop_queue.front();
@@ -12941,6 +13176,7 @@ void PrimaryLogPG::clear_async_reads()
              << dendl;
     close_op_ctx(i.second);
   }
+  in_progress_async_reads.clear();
 }
 
 void PrimaryLogPG::clear_cache()
@@ -13430,7 +13666,7 @@ uint64_t PrimaryLogPG::recover_primary(uint64_t max, ThreadPool::TPHandle &handl
   dout(25) << __func__ << " " << missing.get_items() << dendl;
 
   // look at log!
-  pg_log_entry_t *latest = 0;
+  const pg_log_entry_t *latest = 0;
   unsigned started = 0;
   int skipped = 0;
 
@@ -13442,13 +13678,11 @@ uint64_t PrimaryLogPG::recover_primary(uint64_t max, ThreadPool::TPHandle &handl
     hobject_t soid;
     version_t v = p->first;
 
-    auto it_objects = recovery_state.get_pg_log().get_log().objects.find(p->second);
-    if (it_objects != recovery_state.get_pg_log().get_log().objects.end()) {
-      latest = it_objects->second;
+    latest = recovery_state.get_pg_log().get_log().get_latest_entry(p->second);
+    if (latest) {
       ceph_assert(latest->is_update() || latest->is_delete());
       soid = latest->soid;
     } else {
-      latest = 0;
       soid = p->second;
     }
     const pg_missing_item& item = missing.get_items().find(p->second)->second;
@@ -733,6 +733,8 @@ public:
     // pending async reads <off, len, op_flags> -> <outbl, outr>
     std::list<std::pair<boost::tuple<uint64_t, uint64_t, unsigned>,
 	      std::pair<ceph::buffer::list*, Context*> > > pending_async_reads;
+    // results of the reads done without the pg lock, by subop
+    std::map<int, std::pair<int, ceph::buffer::list>> unlocked_reads;
     int inflightreads;
     friend struct OnReadComplete;
     void start_async_reads(PrimaryLogPG *pg);
@@ -940,6 +942,31 @@ protected:
   OpContextUPtr simple_opc_create(ObjectContextRef obc);
   void simple_opc_submit(OpContextUPtr ctx);
 
+  /**
+   * Small client writes to one object which are queued back to back are
+   * held here and submitted to the backend as one transaction, see
+   * osd_op_batch_writes.  Each op keeps its own RepGather, version and
+   * log entry, so replies still go out one by one and in order once the
+   * batch commits.
+   */
+  struct OpBatch {
+    hobject_t soid;
+    PGTransactionUPtr t;
+    object_stat_sum_t delta_stats;
+    eversion_t at_version;
+    std::vector<pg_log_entry_t> log;
+    osd_reqid_t reqid;
+    OpRequestRef op;
+    std::vector<boost::intrusive_ptr<RepGather>> repops;
+    uint64_t bytes = 0;
+  };
+  std::optional<OpBatch> op_batch;
+
+  friend class C_OSD_OpBatchCommit;
+  bool can_batch_op(const OpContext *ctx) const;
+  void batch_op(RepGather *repop, OpContext *ctx);
+  void flush_op_batch() override;
+
   /**
    * Merge entries atomically into all acting_recovery_backfill osds
    * adjusting missing and recovery state as necessary.
@@ -1266,6 +1293,28 @@ protected:
   std::list<std::pair<OpRequestRef, OpContext*> > in_progress_async_reads;
   void complete_read_ctx(int result, OpContext *ctx);
 
+  /**
+   * Client reads of a replicated pool may read the object store without
+   * the pg lock, see osd_read_without_pg_lock.  do_read() notes them as
+   * async reads, the op queue takes them with take_unlocked_reads() and
+   * runs them once the pg is unlocked, then completes the ops with the pg
+   * locked again.  The op keeps its obc read lock meanwhile, so no write
+   * to the object can be in flight.
+   */
+  struct UnlockedRead {
+    OpContext *ctx;
+    hobject_t soid;
+    std::list<std::pair<boost::tuple<uint64_t, uint64_t, unsigned>,
+			std::pair<ceph::buffer::list*, Context*> > > to_read;
+    Context *on_complete;
+  };
+  std::list<UnlockedRead> unlocked_reads;
+
+  class C_UnlockedReads;
+  friend class C_UnlockedReads;
+  bool can_read_unlocked(const OpContext *ctx) const;
+  Context *take_unlocked_reads() override;
+
   // pg on-disk content
   void check_local() override;
 
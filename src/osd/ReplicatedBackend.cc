@@ -959,6 +959,7 @@ Message * ReplicatedBackend::generate_subop(
   const bufferlist &log_entries,
   std::optional<pg_hit_set_history_t> &hset_hist,
   ObjectStore::Transaction &op_t,
+  const bufferlist &op_t_bl,
   pg_shard_t peer,
   const pg_info_t &pinfo)
 {
@@ -977,7 +978,7 @@ Message * ReplicatedBackend::generate_subop(
     ObjectStore::Transaction t;
     encode(t, wr->get_data());
   } else {
-    encode(op_t, wr->get_data());
+    wr->get_data().append(op_t_bl);
     wr->get_header().data_off = op_t.get_data_alignment();
   }
 
@@ -1031,6 +1032,9 @@ void ReplicatedBackend::issue_op(
     // avoid doing the same work in generate_subop
     bufferlist logs;
     encode(log_entries, logs);
+    // every replica gets the same encoding, sharing the payloads
+    bufferlist op_t_bl;
+    encode(op_t, op_t_bl);
 
     for (const auto& shard : get_parent()->get_acting_recovery_backfill_shards()) {
       if (shard == parent->whoami_shard()) continue;
@@ -1049,6 +1053,7 @@ void ReplicatedBackend::issue_op(
 	  logs,
 	  hset_hist,
 	  op_t,
+	  op_t_bl,
 	  shard,
 	  pinfo);
       if (op->op && op->op->pg_trace)
@@ -1412,12 +1417,10 @@ void ReplicatedBackend::prepare_pull(
 	     << " at version " << pmissing.get_items().find(soid)->second.have
 	     << " rather than at version " << v << dendl;
     v = pmissing.get_items().find(soid)->second.have;
-    ceph_assert(get_parent()->get_log().get_log().objects.count(soid) &&
-	   (get_parent()->get_log().get_log().objects.find(soid)->second->op ==
-	    pg_log_entry_t::LOST_REVERT) &&
-	   (get_parent()->get_log().get_log().objects.find(
-	     soid)->second->reverting_to ==
-	    v));
+    auto latest = get_parent()->get_log().get_log().get_latest_entry(soid);
+    ceph_assert(latest &&
+	   (latest->op == pg_log_entry_t::LOST_REVERT) &&
+	   (latest->reverting_to == v));
   }
 
   ObjectRecoveryInfo recovery_info;
@@ -378,6 +378,7 @@ private:
     const ceph::buffer::list &log_entries,
     std::optional<pg_hit_set_history_t> &hset_history,
     ObjectStore::Transaction &op_t,
+    const ceph::buffer::list &op_t_bl,
     pg_shard_t peer,
     const pg_info_t &pinfo);
   void issue_op(
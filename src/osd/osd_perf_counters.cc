@@ -63,6 +63,16 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_op_delayed_degraded, "op_delayed_degraded",
     "Count of ops delayed due to target object being degraded");
 
+  osd_plb.add_u64_counter(
+    l_osd_op_batch, "op_batch",
+    "Batches of client writes submitted as one transaction");
+  osd_plb.add_u64_counter(
+    l_osd_op_batched, "op_batched",
+    "Client writes submitted as part of a batch");
+  osd_plb.add_u64_counter(
+    l_osd_op_r_unlocked, "op_r_unlocked",
+    "Client reads done without the PG lock");
+
   osd_plb.add_u64_counter(
     l_osd_op_r, "op_r", "Client read operations");
   osd_plb.add_u64_counter(
@@ -254,6 +264,19 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_map_bl_cache_miss, "osd_map_bl_cache_miss",
     "OSDMap buffer cache misses");
 
+  osd_plb.add_u64_counter(
+    l_osd_pg_map_advance, "pg_map_advance",
+    "OSDMaps handled by PGs catching up");
+  osd_plb.add_u64_counter(
+    l_osd_pg_map_skip, "pg_map_skip",
+    "OSDMaps skipped by PGs catching up, as they did not affect the PG");
+  osd_plb.add_time_avg(
+    l_osd_boot_load_pgs_lat, "boot_load_pgs_latency",
+    "Time to load the PGs at boot");
+  osd_plb.add_time_avg(
+    l_osd_boot_active_lat, "boot_active_latency",
+    "Time from start until the OSD is active");
+
   osd_plb.add_u64(
     l_osd_stat_bytes, "stat_bytes", "OSD size", "size",
     PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
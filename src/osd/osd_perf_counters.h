@@ -40,6 +40,10 @@ enum {
   l_osd_op_delayed_unreadable,
   l_osd_op_delayed_degraded,
 
+  l_osd_op_batch,
+  l_osd_op_batched,
+  l_osd_op_r_unlocked,
+
   l_osd_op_before_queue_op_lat,
   l_osd_op_before_dequeue_op_lat,
 
@@ -96,6 +100,11 @@ enum {
   l_osd_map_bl_cache_hit,
   l_osd_map_bl_cache_miss,
 
+  l_osd_pg_map_advance,
+  l_osd_pg_map_skip,
+  l_osd_boot_load_pgs_lat,
+  l_osd_boot_active_lat,
+
   l_osd_stat_bytes,
   l_osd_stat_bytes_used,
   l_osd_stat_bytes_avail,
@@ -31,7 +31,11 @@ void PGOpItem::run(
   ThreadPool::TPHandle &handle)
 {
   osd->dequeue_op(pg, op, handle);
+  Context *reads = pg->take_unlocked_reads();
   pg->unlock();
+  if (reads) {
+    reads->complete(0);
+  }
 }
 
 void PGPeeringItem::run(
@@ -239,7 +243,11 @@ void PGRecoveryMsg::run(
     osd->logger->tinc(l_osd_recovery_scan_queue_lat, latency);
   }
   osd->dequeue_op(pg, op, handle);
+  Context *reads = pg->take_unlocked_reads();
   pg->unlock();
+  if (reads) {
+    reads->complete(0);
+  }
 }
 
 }
@@ -34,6 +34,9 @@
      --dump <format>         displays the map in plain text when <format> is 'plain', 'json' if specified format is not supported
      --tree                  displays a tree of the map
      --test-crush [--range-first <first> --range-last <last>] map pgs to acting osds
+     --test-map-pgs-incremental --range-first <first> --range-last <last>
+                             apply the incrementals <mapdir>/inc_<epoch> to the full map
+                             <mapdir>/<first>, timing full vs incremental pg mapping updates
      --adjust-crush-weight <osdid:weight>[,<osdid:weight>,<...>] change <osdid> CRUSH <weight> (but do not persist)
      --save                  write modified osdmap with upmap or crush-adjust changes
      --read <file>           calculate pg upmap entries to balance pg primaries
@@ -498,6 +498,27 @@ TEST_P(FirstnTest, basic) {
   }
 }
 
+TEST_P(FirstnTest, batch) {
+  // more osds per host than straw2 hashes in one block
+  std::unique_ptr<CrushWrapper> c(build_firstn_map(cct, 2, 3, 11));
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  weight[3] = 0;
+  weight[12] = 0x8000;
+
+  vector<int> xs;
+  for (int x = 0; x < 1000; ++x) {
+    xs.push_back(x);
+  }
+  vector<vector<int>> outs;
+  c->do_rule_batch(0, xs, outs, 3, weight, 0);
+  ASSERT_EQ(xs.size(), outs.size());
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    vector<int> out;
+    c->do_rule(0, xs[i], out, 3, weight, 0);
+    ASSERT_EQ(out, outs[i]);
+  }
+}
+
 TEST_P(FirstnTest, toosmall) {
   std::unique_ptr<CrushWrapper> c(build_firstn_map(cct, 1, 3, 1));
   vector<__u32> weight(c->get_max_devices(), 0x10000);
@@ -1099,6 +1120,107 @@ TEST_F(CRUSHTest, straw2_reweight) {
   }
 }
 
+TEST_F(CRUSHTest, straw2_block_mapping) {
+  // straw2 hosts bigger than the block of items whose hashes are computed
+  // together, with the mappings of the scalar implementation
+  struct crush_map *m = crush_create();
+  const int sizes[] = {9, 11, 16, 20};
+  int hosts[4], host_weights[4];
+  int osd = 0;
+  for (int h = 0; h < 4; ++h) {
+    int items[20], weights[20];
+    for (int i = 0; i < sizes[h]; ++i, ++osd) {
+      items[i] = osd;
+      weights[i] = 0x10000 + (osd % 5) * 0x4000;
+    }
+    crush_bucket *b = crush_make_bucket(
+      m, CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1, 1, sizes[h], items, weights);
+    ASSERT_EQ(0, crush_add_bucket(m, 0, b, &hosts[h]));
+    host_weights[h] = b->weight;
+  }
+  int rootno;
+  crush_bucket *root = crush_make_bucket(
+    m, CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1, 2, 4, hosts, host_weights);
+  ASSERT_EQ(0, crush_add_bucket(m, 0, root, &rootno));
+
+  crush_rule *r = crush_make_rule(3, pg_pool_t::TYPE_REPLICATED);
+  crush_rule_set_step(r, 0, CRUSH_RULE_TAKE, rootno, 0);
+  crush_rule_set_step(r, 1, CRUSH_RULE_CHOOSELEAF_FIRSTN, 0, 1);
+  crush_rule_set_step(r, 2, CRUSH_RULE_EMIT, 0, 0);
+  ASSERT_EQ(0, crush_add_rule(m, r, 0));
+  r = crush_make_rule(3, pg_pool_t::TYPE_ERASURE);
+  crush_rule_set_step(r, 0, CRUSH_RULE_TAKE, rootno, 0);
+  crush_rule_set_step(r, 1, CRUSH_RULE_CHOOSELEAF_INDEP, 0, 1);
+  crush_rule_set_step(r, 2, CRUSH_RULE_EMIT, 0, 0);
+  ASSERT_EQ(1, crush_add_rule(m, r, 1));
+  crush_finalize(m);
+
+  vector<__u32> weight(osd, 0x10000);
+  weight[3] = 0;
+  weight[25] = 0x8000;
+
+  const vector<vector<int>> expected[2] = {{
+    {7, 48, 15},
+    {34, 55, 18},
+    {43, 14, 4},
+    {55, 27, 9},
+    {43, 16, 24},
+    {45, 9, 6},
+    {5, 44, 30},
+    {11, 51, 25},
+    {20, 9, 2},
+    {26, 18, 43},
+    {26, 14, 4},
+    {18, 41, 24},
+    {16, 51, 8},
+    {51, 4, 33},
+    {38, 32, 19},
+    {19, 42, 8}
+  }, {
+    {7, 45, 17},
+    {34, 48, 19},
+    {43, 7, 9},
+    {55, 26, 7},
+    {43, 17, 29},
+    {45, 7, 18},
+    {5, 46, 23},
+    {11, 37, 22},
+    {20, 10, 48},
+    {26, 12, 38},
+    {26, 51, 9},
+    {18, 36, 5},
+    {16, 54, 7},
+    {51, 22, 4},
+    {38, 9, 5},
+    {19, 42, 8}
+  }};
+  vector<int> xs;
+  for (int x = 0; x < 16; ++x) {
+    xs.push_back(x * 7919);
+  }
+  vector<char> work(crush_work_size(m, 3));
+  crush_init_workspace(m, work.data());
+  for (int rule = 0; rule < 2; ++rule) {
+    for (unsigned i = 0; i < xs.size(); ++i) {
+      int out[3];
+      int n = crush_do_rule(m, rule, xs[i], out, 3, weight.data(),
+			    weight.size(), work.data(), nullptr);
+      EXPECT_EQ(expected[rule][i], vector<int>(out, out + n)) << "x " << xs[i];
+    }
+    vector<int> outs(xs.size() * 3), lens(xs.size());
+    ASSERT_EQ((int)xs.size(),
+	      crush_do_rule_batch(m, rule, xs.data(), xs.size(), outs.data(),
+				  lens.data(), 3, weight.data(), weight.size(),
+				  work.data(), nullptr));
+    for (unsigned i = 0; i < xs.size(); ++i) {
+      auto first = outs.begin() + i * 3;
+      EXPECT_EQ(expected[rule][i], vector<int>(first, first + lens[i]))
+	<< "x " << xs[i];
+    }
+  }
+  crush_destroy(m);
+}
+
 struct cluster_test_spec_t {
   const int num_osds_per_host;
   const int num_hosts;
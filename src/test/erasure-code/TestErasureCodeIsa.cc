@@ -22,6 +22,7 @@
 #include "include/stringify.h"
 #include "erasure-code/isa/ErasureCodeIsa.h"
 #include "erasure-code/isa/xor_op.h"
+#include "erasure-code/isa/ec_kernel.h"
 #include "global/global_context.h"
 #include "common/config.h"
 #include "gtest/gtest.h"
@@ -876,6 +877,193 @@ TEST_F(IsaErasureCodeTest, isa_xor_codec)
   EXPECT_EQ(5, cnt_cf);
 }
 
+TEST_F(IsaErasureCodeTest, parity_delta)
+{
+  // updating the coding chunks with the deltas of a region of some
+  // data chunks must give the same result as encoding again
+  const char *ms[] = { "1", "2", "3" };
+  for (auto m : ms) {
+    ErasureCodeIsaDefault Isa(tcache);
+    ErasureCodeProfile profile;
+    profile["k"] = "4";
+    profile["m"] = m;
+    Isa.init(profile, &cerr);
+    EXPECT_TRUE(Isa.supports_parity_delta());
+
+    const unsigned k = 4;
+    const unsigned chunk_size = 4096;
+    set<int> want_to_encode;
+    for (unsigned i = 0; i < Isa.get_chunk_count(); i++) {
+      want_to_encode.insert(i);
+    }
+    bufferlist in;
+    for (unsigned i = 0; i < k * chunk_size; i++) {
+      in.append((char)(i * 7 + i / 13));
+    }
+    map<int, bufferlist> encoded;
+    EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+
+    // overwrite 1000 bytes at offset 100 in data chunks 1 and 3
+    const unsigned off = 100, len = 1000;
+    bufferlist changed;
+    in.begin().copy(in.length(), changed);
+    map<int, bufferlist> deltas;
+    for (int c : {1, 3}) {
+      bufferlist old_data, new_data, delta;
+      old_data.substr_of(in, c * chunk_size + off, len);
+      new_data.append(string(len, 'a' + c));
+      EXPECT_EQ(0, Isa.encode_delta(old_data, new_data, &delta));
+      deltas[c] = delta;
+      changed.begin(c * chunk_size + off).copy_in(len, new_data.c_str());
+    }
+    map<int, bufferlist> reencoded;
+    EXPECT_EQ(0, Isa.encode(want_to_encode, changed, &reencoded));
+
+    map<int, bufferlist> coding;
+    for (unsigned i = k; i < Isa.get_chunk_count(); i++) {
+      coding[i].substr_of(encoded[i], off, len);
+      // must not modify the buffers shared with encoded
+      coding[i].rebuild();
+    }
+    EXPECT_EQ(0, Isa.apply_delta(deltas, &coding));
+    for (unsigned i = k; i < Isa.get_chunk_count(); i++) {
+      bufferlist expected;
+      expected.substr_of(reencoded[i], off, len);
+      EXPECT_TRUE(expected.contents_equal(coding[i]));
+    }
+
+    // mismatched sizes
+    coding.erase(k);
+    EXPECT_EQ(-EINVAL, Isa.apply_delta(deltas, &coding));
+  }
+}
+
+TEST_F(IsaErasureCodeTest, decode_batch)
+{
+  const char *ms[] = { "1", "3" };
+  for (auto m : ms) {
+    ErasureCodeIsaDefault Isa(tcache);
+    ErasureCodeProfile profile;
+    profile["k"] = "4";
+    profile["m"] = m;
+    EXPECT_EQ(0, Isa.init(profile, &cerr));
+
+    set<int> want_to_encode;
+    for (unsigned i = 0; i < Isa.get_chunk_count(); i++) {
+      want_to_encode.insert(i);
+    }
+    // several objects, all missing the same chunks, and one more
+    // missing different ones which does not share the decoding tables
+    const int objects = 5;
+    vector<map<int, bufferlist>> encoded(objects);
+    vector<map<int, bufferlist>> chunks(objects);
+    for (int n = 0; n < objects; n++) {
+      bufferlist in;
+      for (unsigned i = 0; i < 4 * 1024; i++) {
+        in.append((char)(i * (n + 3)));
+      }
+      EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded[n]));
+      chunks[n] = encoded[n];
+      chunks[n].erase(n == objects - 1 ? 2 : 1);
+      if (Isa.m > 1)
+        chunks[n].erase(Isa.k);
+    }
+
+    set<int> want_to_read = want_to_encode;
+    vector<map<int, bufferlist>> decoded;
+    EXPECT_EQ(0, Isa.decode_batch(want_to_read, chunks, &decoded, 0));
+    EXPECT_EQ((size_t)objects, decoded.size());
+    for (int n = 0; n < objects; n++) {
+      for (unsigned i = 0; i < Isa.get_chunk_count(); i++) {
+        EXPECT_TRUE(encoded[n][i].contents_equal(decoded[n][i]))
+          << "m=" << m << " object " << n << " chunk " << i;
+      }
+    }
+
+    // same chunks lost everywhere: the tables are looked up once
+    chunks.pop_back();
+    encoded.pop_back();
+    decoded.clear();
+    EXPECT_EQ(0, Isa.decode_batch(want_to_read, chunks, &decoded, 0));
+    EXPECT_EQ((size_t)objects - 1, decoded.size());
+    for (int n = 0; n < objects - 1; n++) {
+      for (unsigned i = 0; i < Isa.get_chunk_count(); i++) {
+        EXPECT_TRUE(encoded[n][i].contents_equal(decoded[n][i]))
+          << "m=" << m << " object " << n << " chunk " << i;
+      }
+    }
+  }
+}
+
+TEST_F(IsaErasureCodeTest, kernels)
+{
+  // every kernel the CPU supports must encode and decode exactly like
+  // ISA-L, including lengths which are not a multiple of the vector size
+  const char *ms[] = { "1", "3" };
+  const char *techniques[] = { "reed_sol_van", "cauchy" };
+  for (auto m : ms) {
+    for (auto technique : techniques) {
+      int matrix = string(technique) == "cauchy" ?
+        ErasureCodeIsaDefault::kCauchy : ErasureCodeIsaDefault::kVandermonde;
+      ErasureCodeProfile profile;
+      profile["k"] = "5";
+      profile["m"] = m;
+      profile["kernel"] = "isal";
+      ErasureCodeIsaDefault reference(tcache, matrix);
+      EXPECT_EQ(0, reference.init(profile, &cerr));
+      EXPECT_EQ(EC_ISA_KERNEL_ISAL, reference.kernel);
+
+      set<int> want_to_encode;
+      for (unsigned i = 0; i < reference.get_chunk_count(); i++) {
+        want_to_encode.insert(i);
+      }
+      bufferlist in;
+      for (unsigned i = 0; i < 5 * 4096 + 5 * 96; i++) {
+        in.append((char)(i * 11 + i / 7));
+      }
+      map<int, bufferlist> expected;
+      EXPECT_EQ(0, reference.encode(want_to_encode, in, &expected));
+
+      for (int kernel = 0; kernel < EC_ISA_KERNEL_MAX; kernel++) {
+        if (!ec_isa_kernel_supported(kernel))
+          continue;
+        profile["kernel"] = ec_isa_kernel_name(kernel);
+        ErasureCodeIsaDefault Isa(tcache, matrix);
+        EXPECT_EQ(0, Isa.init(profile, &cerr));
+        EXPECT_EQ(kernel, Isa.kernel);
+
+        map<int, bufferlist> encoded;
+        EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+        for (unsigned i = 0; i < Isa.get_chunk_count(); i++) {
+          EXPECT_TRUE(expected[i].contents_equal(encoded[i]))
+            << technique << " m=" << m << " kernel " << profile["kernel"]
+            << " chunk " << i;
+        }
+
+        // lose the first data chunk and the last coding chunk
+        map<int, bufferlist> chunks = encoded;
+        chunks.erase(0);
+        if (Isa.m > 1)
+          chunks.erase(Isa.k + Isa.m - 1);
+        map<int, bufferlist> decoded;
+        EXPECT_EQ(0, Isa.decode(want_to_encode, chunks, &decoded, 0));
+        for (unsigned i = 0; i < Isa.get_chunk_count(); i++) {
+          EXPECT_TRUE(expected[i].contents_equal(decoded[i]))
+            << technique << " m=" << m << " kernel " << profile["kernel"]
+            << " decoded chunk " << i;
+        }
+      }
+    }
+  }
+
+  // unknown kernels are refused, unsupported ones fall back
+  ErasureCodeIsaDefault Isa(tcache);
+  ErasureCodeProfile profile;
+  profile["kernel"] = "sse9";
+  EXPECT_EQ(-EINVAL, Isa.init(profile, &cerr));
+  EXPECT_TRUE(ec_isa_kernel_supported(ec_isa_kernel_best()));
+}
+
 TEST_F(IsaErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
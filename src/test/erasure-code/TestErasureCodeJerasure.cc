@@ -228,6 +228,67 @@ TYPED_TEST(ErasureCodeTest, minimum_to_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, parity_delta)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  if (!jerasure.supports_parity_delta()) {
+    // only the Reed Solomon matrix techniques
+    EXPECT_EQ(nullptr, jerasure.get_coding_matrix());
+    map<int, bufferlist> deltas, coding;
+    EXPECT_EQ(-ENOTSUP, jerasure.apply_delta(deltas, &coding));
+    return;
+  }
+
+  // updating the coding chunks with the deltas of a region of some
+  // data chunks must give the same result as encoding again
+  const unsigned k = jerasure.get_data_chunk_count();
+  const unsigned stripe_width = jerasure.get_alignment() * 64;
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < jerasure.get_chunk_count(); i++) {
+    want_to_encode.insert(i);
+  }
+  bufferlist in;
+  for (unsigned i = 0; i < stripe_width; i++) {
+    in.append((char)(i * 7 + i / 13));
+  }
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+  const unsigned chunk_size = encoded[0].length();
+  const unsigned off = 64, len = chunk_size / 2;
+
+  bufferlist changed;
+  in.begin().copy(in.length(), changed);
+  map<int, bufferlist> deltas;
+  for (int c : {0, 2}) {
+    bufferlist old_data, new_data, delta;
+    old_data.substr_of(in, c * chunk_size + off, len);
+    new_data.append(string(len, 'a' + c));
+    EXPECT_EQ(0, jerasure.encode_delta(old_data, new_data, &delta));
+    deltas[c] = delta;
+    changed.begin(c * chunk_size + off).copy_in(len, new_data.c_str());
+  }
+  map<int, bufferlist> reencoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, changed, &reencoded));
+
+  map<int, bufferlist> coding;
+  for (unsigned i = k; i < jerasure.get_chunk_count(); i++) {
+    coding[i].substr_of(encoded[i], off, len);
+    coding[i].rebuild();
+  }
+  EXPECT_EQ(0, jerasure.apply_delta(deltas, &coding));
+  for (unsigned i = k; i < jerasure.get_chunk_count(); i++) {
+    bufferlist expected;
+    expected.substr_of(reencoded[i], off, len);
+    EXPECT_TRUE(expected.contents_equal(coding[i]));
+  }
+}
+
 TEST(ErasureCodeTest, encode)
 {
   ErasureCodeJerasureReedSolomonVandermonde jerasure;
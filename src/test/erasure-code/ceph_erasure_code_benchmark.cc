@@ -30,6 +30,7 @@
 #include "common/ceph_context.h"
 #include "common/config.h"
 #include "common/Clock.h"
+#include "arch/intel.h"
 #include "include/utime.h"
 #include "erasure-code/ErasureCodePlugin.h"
 #include "erasure-code/ErasureCode.h"
@@ -59,11 +60,14 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run encode, decode, overwrite or kernels")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("erased", po::value<vector<int> >(),
      "erased chunk (repeat if more than one chunk is erased)")
+    ("batch,b", po::value<int>()->default_value(1),
+     "decode the buffer as that many objects with a single decode_batch "
+     "call (requires --erased)")
     ("erasures-generation,E", po::value<string>()->default_value("random"),
      "If set to 'random', pick the number of chunks to recover (as specified by "
      " --erasures) at random. If set to 'exhaustive' try all combinations of erasures "
@@ -130,6 +134,7 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     exhaustive_erasures = false;
   if (vm.count("erased") > 0)
     erased = vm["erased"].as<vector<int> >();
+  batch = vm["batch"].as<int>();
   
   try {
     k = stoi(profile["k"]);
@@ -158,6 +163,10 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "overwrite")
+    return overwrite();
+  else if (workload == "kernels")
+    return kernels();
   else
     return decode();
 }
@@ -294,9 +303,33 @@ int ErasureCodeBench::decode()
     display_chunks(encoded, erasure_code->get_chunk_count());
   }
 
+  // the same erasures in batch objects of in_size / batch bytes each
+  vector<map<int,bufferlist>> objects;
+  if (batch > 1) {
+    if (exhaustive_erasures || erased.empty()) {
+      cerr << "--batch requires --erased" << endl;
+      return -EINVAL;
+    }
+    bufferlist object;
+    object.substr_of(in, 0, in_size / batch);
+    for (int b = 0; b < batch; b++) {
+      map<int,bufferlist> &chunks = objects.emplace_back();
+      code = erasure_code->encode(want_to_encode, object, &chunks);
+      if (code)
+	return code;
+      for (int i : erased)
+	chunks.erase(i);
+    }
+  }
+
   utime_t begin_time = ceph_clock_now();
   for (int i = 0; i < max_iterations; i++) {
-    if (exhaustive_erasures) {
+    if (batch > 1) {
+      vector<map<int,bufferlist>> decoded;
+      code = erasure_code->decode_batch(want_to_read, objects, &decoded, 0);
+      if (code)
+	return code;
+    } else if (exhaustive_erasures) {
       code = decode_erasures(encoded, encoded, 0, erasures, erasure_code);
       if (code)
 	return code;
@@ -325,6 +358,215 @@ int ErasureCodeBench::decode()
   return 0;
 }
 
+/*
+ * Random 4K to 64K overwrites of a stripe of --size bytes, the way an
+ * EC pool with overwrites sees small block writes.  Each size is run
+ * --iterations times, once by re-encoding the whole stripe and once by
+ * updating the coding chunks from the deltas of the data chunks the
+ * write touches.  For each size, print the IOPS of both methods and
+ * the bytes each of them reads from and writes to the shards per
+ * write.
+ */
+int ErasureCodeBench::overwrite()
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf().get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+  if (!erasure_code->supports_parity_delta()) {
+    cerr << "plugin " << plugin << " does not support parity delta" << endl;
+    return -ENOTSUP;
+  }
+
+  const unsigned page = 4096;
+  unsigned chunk_size = erasure_code->get_chunk_size(in_size);
+  unsigned stripe_width = chunk_size * k;
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; i++) {
+    want_to_encode.insert(i);
+  }
+
+  bufferlist stripe;
+  stripe.append(string(stripe_width, 'X'));
+  stripe.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  map<int,bufferlist> encoded;
+  code = erasure_code->encode(want_to_encode, stripe, &encoded);
+  if (code)
+    return code;
+
+  cout << "size\tfull_iops\tdelta_iops\tfull_read\tfull_write"
+       << "\tdelta_read\tdelta_write" << endl;
+  for (unsigned size = 4096; size <= 65536 && size <= stripe_width; size *= 2) {
+    bufferlist data;
+    data.append(string(size, 'Y'));
+    vector<unsigned> offsets;
+    for (int i = 0; i < max_iterations; i++) {
+      offsets.push_back((rand() % ((stripe_width - size) / page + 1)) * page);
+    }
+
+    // full stripe: read the data chunks, encode, write every chunk
+    utime_t begin_time = ceph_clock_now();
+    for (int i = 0; i < max_iterations; i++) {
+      bufferlist in;
+      in.substr_of(stripe, 0, offsets[i]);
+      in.append(data);
+      if (offsets[i] + size < stripe_width) {
+	bufferlist tail;
+	tail.substr_of(stripe, offsets[i] + size,
+		       stripe_width - offsets[i] - size);
+	in.append(tail);
+      }
+      map<int,bufferlist> out;
+      code = erasure_code->encode(want_to_encode, in, &out);
+      if (code)
+	return code;
+    }
+    double full_secs = ceph_clock_now() - begin_time;
+
+    // parity delta: read the touched range of the data chunks it
+    // changes and of the coding chunks, write back the same range
+    uint64_t delta_io = 0;
+    begin_time = ceph_clock_now();
+    for (int i = 0; i < max_iterations; i++) {
+      unsigned first = offsets[i] / chunk_size;
+      unsigned last = (offsets[i] + size - 1) / chunk_size;
+      unsigned range_off = 0, range_len = chunk_size;
+      if (first == last) {
+	range_off = offsets[i] % chunk_size / page * page;
+	range_len = std::min(
+	  chunk_size - range_off,
+	  ((offsets[i] + size - 1) % chunk_size / page + 1) * page - range_off);
+      }
+      map<int,bufferlist> deltas;
+      for (unsigned c = first; c <= last; c++) {
+	bufferlist old_data, new_data;
+	old_data.substr_of(encoded[c], range_off, range_len);
+	new_data = old_data;
+	new_data.rebuild();
+	unsigned from = std::max<unsigned>(offsets[i], c * chunk_size + range_off);
+	unsigned to = std::min<unsigned>(offsets[i] + size,
+					 c * chunk_size + range_off + range_len);
+	data.begin(from - offsets[i]).copy(
+	  to - from,
+	  new_data.c_str() + from - c * chunk_size - range_off);
+	code = erasure_code->encode_delta(old_data, new_data, &deltas[c]);
+	if (code)
+	  return code;
+      }
+      map<int,bufferlist> coding;
+      for (int c = k; c < k + m; c++) {
+	coding[c].substr_of(encoded[c], range_off, range_len);
+	coding[c].rebuild();
+      }
+      code = erasure_code->apply_delta(deltas, &coding);
+      if (code)
+	return code;
+      delta_io += (uint64_t)(deltas.size() + m) * range_len;
+    }
+    double delta_secs = ceph_clock_now() - begin_time;
+
+    cout << size
+	 << "\t" << max_iterations / full_secs
+	 << "\t" << max_iterations / delta_secs
+	 << "\t" << (uint64_t)chunk_size * k
+	 << "\t" << (uint64_t)chunk_size * (k + m)
+	 << "\t" << delta_io / max_iterations
+	 << "\t" << delta_io / max_iterations
+	 << endl;
+  }
+  return 0;
+}
+
+/*
+ * Encode and decode throughput of each SIMD kernel of the isa plugin
+ * that the CPU supports.  Every kernel gets the same --size buffer for
+ * --iterations encodes and as many decodes of --erasures random chunks.
+ */
+int ErasureCodeBench::kernels()
+{
+  if (plugin != "isa") {
+    cerr << "the kernels workload requires --plugin isa" << endl;
+    return -EINVAL;
+  }
+  const std::vector<std::pair<string, bool>> kernels = {
+    {"isal", true},
+#ifdef __x86_64__
+    {"avx2", (bool)ceph_arch_intel_avx2},
+    {"avx512", (bool)ceph_arch_intel_avx512},
+    {"avx2_gfni", ceph_arch_intel_avx2 && ceph_arch_intel_gfni},
+    {"avx512_gfni", ceph_arch_intel_avx512 && ceph_arch_intel_gfni},
+#endif
+  };
+
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  bufferlist in;
+  in.append(string(in_size, 'X'));
+  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; i++) {
+    want_to_encode.insert(i);
+  }
+  const double gb = (double)max_iterations * in_size / (1000 * 1000 * 1000);
+
+  cout << "kernel\tencode_GB/s\tdecode_GB/s" << endl;
+  for (auto &[name, supported] : kernels) {
+    if (!supported) {
+      if (verbose)
+	cout << name << " not supported" << endl;
+      continue;
+    }
+    profile["kernel"] = name;
+    ErasureCodeInterfaceRef erasure_code;
+    stringstream messages;
+    int code = instance.factory(plugin,
+				g_conf().get_val<std::string>("erasure_code_dir"),
+				profile, &erasure_code, &messages);
+    if (code) {
+      cerr << messages.str() << endl;
+      return code;
+    }
+
+    map<int,bufferlist> encoded;
+    utime_t begin_time = ceph_clock_now();
+    for (int i = 0; i < max_iterations; i++) {
+      encoded.clear();
+      code = erasure_code->encode(want_to_encode, in, &encoded);
+      if (code)
+	return code;
+    }
+    double encode_secs = ceph_clock_now() - begin_time;
+
+    begin_time = ceph_clock_now();
+    for (int i = 0; i < max_iterations; i++) {
+      map<int,bufferlist> chunks = encoded;
+      for (int j = 0; j < erasures; j++) {
+	int erasure;
+	do {
+	  erasure = rand() % ( k + m );
+	} while(chunks.count(erasure) == 0);
+	chunks.erase(erasure);
+      }
+      map<int,bufferlist> decoded;
+      code = erasure_code->decode(want_to_encode, chunks, &decoded, 0);
+      if (code)
+	return code;
+    }
+    double decode_secs = ceph_clock_now() - begin_time;
+
+    cout << name
+	 << "\t" << gb / encode_secs
+	 << "\t" << gb / decode_secs
+	 << endl;
+  }
+  return 0;
+}
+
 int main(int argc, char** argv) {
   ErasureCodeBench ecbench;
   try {
@@ -41,6 +41,7 @@ class ErasureCodeBench {
 
   bool exhaustive_erasures;
   std::vector<int> erased;
+  int batch;
   std::string workload;
 
   ceph::ErasureCodeProfile profile;
@@ -57,6 +58,8 @@ public:
 		      ErasureCodeInterfaceRef erasure_code);
   int decode();
   int encode();
+  int overwrite();
+  int kernels();
 };
 
 #endif
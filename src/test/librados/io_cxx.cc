@@ -3,6 +3,7 @@
 
 #include <climits>
 #include <errno.h>
+#include <thread>
 
 #include "gtest/gtest.h"
 
@@ -10,6 +11,7 @@
 #include "include/encoding.h"
 #include "include/err.h"
 #include "include/scope_guard.h"
+#include "json_spirit/json_spirit.h"
 #include "test/librados/test_cxx.h"
 #include "test/librados/testcase_cxx.h"
 
@@ -495,6 +497,184 @@ TEST_F(LibRadosIoPP, XattrListPP) {
   }
 }
 
+// client reads of a replicated pool read the object store after the osd
+// drops the pg lock
+class LibRadosIoUnlockedReadPP : public RadosTestPP {
+protected:
+  void SetUp() override {
+    string cmd =
+      "{"
+        "\"prefix\": \"config set\", "
+        "\"who\": \"osd\", "
+        "\"name\": \"osd_read_without_pg_lock\", "
+        "\"value\": \"true\""
+      "}";
+    bufferlist inbl, outbl;
+    ASSERT_EQ(0, s_cluster.mon_command(cmd, inbl, &outbl, NULL));
+    RadosTestPP::SetUp();
+  }
+
+  void TearDown() override {
+    string cmd =
+      "{"
+        "\"prefix\": \"config rm\", "
+        "\"who\": \"osd\", "
+        "\"name\": \"osd_read_without_pg_lock\""
+      "}";
+    bufferlist inbl, outbl;
+    ASSERT_EQ(0, s_cluster.mon_command(cmd, inbl, &outbl, NULL));
+    RadosTestPP::TearDown();
+  }
+
+  int get_acting_primary(const string& oid) {
+    string cmd =
+      "{"
+        "\"prefix\": \"osd map\", "
+        "\"pool\": \"" + pool_name + "\", "
+        "\"object\": \"" + oid + "\", "
+        "\"format\": \"json\""
+      "}";
+    bufferlist inbl, outbl;
+    if (int r = cluster.mon_command(cmd, inbl, &outbl, NULL); r < 0) {
+      return r;
+    }
+    json_spirit::Value v;
+    if (!json_spirit::read(outbl.to_str(), v)) {
+      return -EINVAL;
+    }
+    for (auto& p : v.get_obj()) {
+      if (p.name_ == "acting_primary") {
+	return p.value_.get_int();
+      }
+    }
+    return -ENOENT;
+  }
+
+  int set_primary_affinity(int osd, const char *weight) {
+    string cmd =
+      "{"
+        "\"prefix\": \"osd primary-affinity\", "
+        "\"id\": \"osd." + std::to_string(osd) + "\", "
+        "\"weight\": " + weight +
+      "}";
+    bufferlist inbl, outbl;
+    return cluster.mon_command(cmd, inbl, &outbl, NULL);
+  }
+};
+
+TEST_F(LibRadosIoUnlockedReadPP, MultiOpRead) {
+  bufferlist bl;
+  for (unsigned i = 0; i < 16; ++i) {
+    bl.append(string(4096, 'a' + i));
+  }
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+  bufferlist xattr;
+  xattr.append("bar");
+  ASSERT_EQ(0, ioctx.setxattr("foo", "attr", xattr));
+
+  // several reads of one op are all noted and done in one go
+  bufferlist op_bl, bl1, bl2, bl3, attr_bl;
+  int rval1 = 1000, rval2 = 1000, rval3 = 1000, rval4 = 1000;
+  uint64_t size = 0;
+  ObjectReadOperation op;
+  op.read(0, 4096, &bl1, &rval1);
+  op.getxattr("attr", &attr_bl, &rval2);
+  op.read(5 * 4096 + 100, 8192, &bl2, &rval3);
+  op.stat(&size, NULL, NULL);
+  op.read(15 * 4096, 8192, &bl3, &rval4);  // short read at the end
+  ASSERT_EQ(0, ioctx.operate("foo", &op, &op_bl));
+  ASSERT_EQ(0, rval1);
+  ASSERT_EQ(0, rval2);
+  ASSERT_EQ(0, rval3);
+  ASSERT_EQ(0, rval4);
+  ASSERT_EQ(bl.length(), size);
+  ASSERT_EQ(string(4096, 'a'), bl1.to_str());
+  ASSERT_EQ(string("bar"), attr_bl.to_str());
+  ASSERT_EQ(string(4096 - 100, 'f') + string(4096, 'g') + string(100, 'h'),
+	    bl2.to_str());
+  ASSERT_EQ(string(4096, 'p'), bl3.to_str());
+
+  // a read of a missing object still fails the op
+  ObjectReadOperation op2;
+  op2.read(0, 4096, NULL, NULL);
+  ASSERT_EQ(-ENOENT, ioctx.operate("nonexistent", &op2, &op_bl));
+}
+
+TEST_F(LibRadosIoUnlockedReadPP, WholeObjectReadDigest) {
+  // write_full records a data digest, which a read of the whole object
+  // verifies
+  bufferlist bl;
+  for (unsigned i = 0; i < 64; ++i) {
+    bl.append(string(1000, 'a' + i % 26));
+  }
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+  {
+    bufferlist out;
+    ASSERT_EQ((int)bl.length(), ioctx.read("foo", out, bl.length(), 0));
+    ASSERT_TRUE(bl.contents_equal(out));
+  }
+  {
+    bufferlist out;
+    ObjectReadOperation op;
+    op.read(0, 0, NULL, NULL);  // len=0 mean read the whole object data.
+    ASSERT_EQ(0, ioctx.operate("foo", &op, &out));
+    ASSERT_TRUE(bl.contents_equal(out));
+  }
+  // and after a partial overwrite, which drops the digest
+  bufferlist bl2;
+  bl2.append(string(500, 'z'));
+  ASSERT_EQ(0, ioctx.write("foo", bl2, bl2.length(), 1000));
+  bl.begin(1000).copy_in(bl2.length(), bl2.c_str());
+  {
+    bufferlist out;
+    ASSERT_EQ((int)bl.length(), ioctx.read("foo", out, 0, 0));
+    ASSERT_TRUE(bl.contents_equal(out));
+  }
+}
+
+TEST_F(LibRadosIoUnlockedReadPP, IntervalChange) {
+  const unsigned num_objects = 8;
+  const unsigned num_reads = 64;
+  const unsigned obj_size = 1 << 20;
+  for (unsigned i = 0; i < num_objects; ++i) {
+    bufferlist bl;
+    bl.append(string(obj_size, 'a' + i));
+    ASSERT_EQ(0, ioctx.write_full("foo" + std::to_string(i), bl));
+  }
+  int primary = get_acting_primary("foo0");
+  ASSERT_LE(0, primary);
+
+  // reads in flight while the primary of some of the pgs changes; the
+  // client resends whatever the old primary dropped
+  std::vector<AioCompletion*> completions;
+  std::vector<bufferlist> results(num_reads);
+  for (unsigned i = 0; i < num_reads; ++i) {
+    AioCompletion *c = cluster.aio_create_completion();
+    ASSERT_EQ(0, ioctx.aio_read("foo" + std::to_string(i % num_objects), c,
+				&results[i], obj_size, 0));
+    completions.push_back(c);
+  }
+  ASSERT_EQ(0, set_primary_affinity(primary, "0"));
+  auto restore = make_scope_guard([&] {
+    set_primary_affinity(primary, "1");
+  });
+  for (unsigned i = 0; i < num_reads; ++i) {
+    AioCompletion *c = completions[i];
+    c->wait_for_complete();
+    ASSERT_EQ((int)obj_size, c->get_return_value());
+    c->release();
+    ASSERT_EQ(string(obj_size, 'a' + i % num_objects), results[i].to_str());
+  }
+
+  // and reads after the change
+  for (unsigned i = 0; i < num_objects; ++i) {
+    bufferlist out;
+    ASSERT_EQ((int)obj_size,
+	      ioctx.read("foo" + std::to_string(i), out, obj_size, 0));
+    ASSERT_EQ(string(obj_size, 'a' + i), out.to_str());
+  }
+}
+
 TEST_F(LibRadosIoECPP, SimpleWritePP) {
   SKIP_IF_CRIMSON();
   char buf[128];
@@ -1017,3 +1197,244 @@ TEST_F(LibRadosIoECPP, CmpExtMismatchPP) {
   ASSERT_EQ(0, ioctx.operate("foo", &read, &bl));
   ASSERT_EQ(0, memcmp(bl.c_str(), "ceph", 4));
 }
+
+// small reads of an EC pool read just the needed ranges of the data shards,
+// and fall back to decoding whole stripes if one of those shards fails
+class LibRadosIoECDirectReadPP : public RadosTestECPP {
+protected:
+  void SetUp() override {
+    ASSERT_EQ(0, config_set("osd_ec_direct_partial_reads", "true"));
+    RadosTestECPP::SetUp();
+  }
+
+  void TearDown() override {
+    ASSERT_EQ(0, config_rm("osd_ec_direct_partial_reads"));
+    RadosTestECPP::TearDown();
+  }
+
+  int config_set(const string& name, const string& value) {
+    string cmd =
+      "{"
+        "\"prefix\": \"config set\", "
+        "\"who\": \"osd\", "
+        "\"name\": \"" + name + "\", "
+        "\"value\": \"" + value + "\""
+      "}";
+    bufferlist inbl, outbl;
+    return s_cluster.mon_command(cmd, inbl, &outbl, NULL);
+  }
+
+  int config_rm(const string& name) {
+    string cmd =
+      "{"
+        "\"prefix\": \"config rm\", "
+        "\"who\": \"osd\", "
+        "\"name\": \"" + name + "\""
+      "}";
+    bufferlist inbl, outbl;
+    return s_cluster.mon_command(cmd, inbl, &outbl, NULL);
+  }
+
+  int pool_set(const string& var, const string& val) {
+    string cmd =
+      "{"
+        "\"prefix\": \"osd pool set\", "
+        "\"pool\": \"" + pool_name + "\", "
+        "\"var\": \"" + var + "\", "
+        "\"val\": \"" + val + "\""
+      "}";
+    bufferlist inbl, outbl;
+    return cluster.mon_command(cmd, inbl, &outbl, NULL);
+  }
+
+  int osd_flag(const char *prefix, const char *flag) {
+    string cmd =
+      "{"
+        "\"prefix\": \"" + string(prefix) + "\", "
+        "\"key\": \"" + flag + "\""
+      "}";
+    bufferlist inbl, outbl;
+    return cluster.mon_command(cmd, inbl, &outbl, NULL);
+  }
+
+  /// the osd of each shard, CRUSH_ITEM_NONE for a missing one
+  int get_acting(const string& oid, std::vector<int> *acting) {
+    string cmd =
+      "{"
+        "\"prefix\": \"osd map\", "
+        "\"pool\": \"" + pool_name + "\", "
+        "\"object\": \"" + oid + "\", "
+        "\"nspace\": \"" + nspace + "\", "
+        "\"format\": \"json\""
+      "}";
+    bufferlist inbl, outbl;
+    if (int r = cluster.mon_command(cmd, inbl, &outbl, NULL); r < 0) {
+      return r;
+    }
+    json_spirit::Value v;
+    if (!json_spirit::read(outbl.to_str(), v)) {
+      return -EINVAL;
+    }
+    for (auto& p : v.get_obj()) {
+      if (p.name_ == "acting") {
+	acting->clear();
+	for (auto& o : p.value_.get_array()) {
+	  acting->push_back(o.get_int());
+	}
+	return 0;
+      }
+    }
+    return -ENOENT;
+  }
+
+  /// wait for the osd of shard 0 of oid to be up or down
+  bool wait_for_shard0(const string& oid, int osd, bool up) {
+    for (unsigned i = 0; i < 120; ++i) {
+      std::vector<int> acting;
+      if (get_acting(oid, &acting) == 0 && !acting.empty() &&
+	  (acting[0] == osd) == up) {
+	return true;
+      }
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return false;
+  }
+
+  /// read the ranges one by one and compare them with what was written
+  void check_reads(const string& oid, const bufferlist& expected) {
+    const uint64_t chunk = alignment / 2;  // k=2
+    const std::pair<uint64_t, uint64_t> ranges[] = {
+      {0, 100},                       // head of the first chunk
+      {100, 200},                     // inside the first chunk
+      {chunk - 100, 200},             // across the chunks of a stripe
+      {chunk + 10, 100},              // inside the second chunk
+      {alignment - 50, 100},          // across two stripes
+      {alignment * 2 + 17, alignment * 3},  // several stripes
+      {expected.length() - 30, 100},  // short read at the end
+    };
+    for (auto [off, len] : ranges) {
+      bufferlist out;
+      uint64_t want = std::min<uint64_t>(len, expected.length() - off);
+      ASSERT_EQ((int)want, ioctx.read(oid, out, len, off))
+	<< "off " << off << " len " << len;
+      bufferlist e;
+      e.substr_of(expected, off, want);
+      ASSERT_TRUE(e.contents_equal(out)) << "off " << off << " len " << len;
+    }
+  }
+
+  bufferlist make_object(unsigned stripes) {
+    bufferlist bl;
+    for (uint64_t i = 0; i < stripes * alignment / 64; ++i) {
+      bl.append(string(64, 'a' + i % 26));
+    }
+    return bl;
+  }
+};
+
+TEST_F(LibRadosIoECDirectReadPP, DirectRead) {
+  SKIP_IF_CRIMSON();
+  bufferlist bl = make_object(8);
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+  check_reads("foo", bl);
+
+  // several extents in one op
+  bufferlist op_bl, bl1, bl2;
+  int rval1 = 1000, rval2 = 1000;
+  ObjectReadOperation op;
+  op.read(10, 100, &bl1, &rval1);
+  op.read(alignment * 5 + 3, 1000, &bl2, &rval2);
+  ASSERT_EQ(0, ioctx.operate("foo", &op, &op_bl));
+  ASSERT_EQ(0, rval1);
+  ASSERT_EQ(0, rval2);
+  bufferlist e1, e2;
+  e1.substr_of(bl, 10, 100);
+  e2.substr_of(bl, alignment * 5 + 3, 1000);
+  ASSERT_TRUE(e1.contents_equal(bl1));
+  ASSERT_TRUE(e2.contents_equal(bl2));
+}
+
+TEST_F(LibRadosIoECDirectReadPP, ErroredShard) {
+  SKIP_IF_CRIMSON();
+  bufferlist bl = make_object(8);
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+  std::vector<int> acting;
+  ASSERT_EQ(0, get_acting("foo", &acting));
+  ASSERT_EQ(3u, acting.size());
+
+  // reads of shard 0 return EIO from now on
+  ASSERT_EQ(0, config_set("bluestore_debug_inject_read_err", "true"));
+  auto restore = make_scope_guard([&] {
+    config_rm("bluestore_debug_inject_read_err");
+  });
+  string cmd =
+    "{"
+      "\"prefix\": \"injectdataerr\", "
+      "\"pool\": \"" + pool_name + "\", "
+      "\"objname\": \"" + nspace + "/foo\", "
+      "\"shardid\": 0"
+    "}";
+  bufferlist inbl, outbl;
+  ASSERT_EQ(0, cluster.osd_command(acting[0], cmd, inbl, &outbl, NULL));
+  check_reads("foo", bl);
+}
+
+TEST_F(LibRadosIoECDirectReadPP, MissingShard) {
+  SKIP_IF_CRIMSON();
+  bufferlist bl = make_object(8);
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+  std::vector<int> acting;
+  ASSERT_EQ(0, get_acting("foo", &acting));
+  ASSERT_EQ(3u, acting.size());
+  const int victim = acting[0];
+
+  // keep the pg active with shard 0 down
+  ASSERT_EQ(0, pool_set("min_size", "2"));
+  ASSERT_EQ(0, osd_flag("osd set", "noup"));
+  auto restore = make_scope_guard([&] {
+    osd_flag("osd unset", "noup");
+    wait_for_shard0("foo", victim, true);
+    pool_set("min_size", "3");
+  });
+  string cmd =
+    "{"
+      "\"prefix\": \"osd down\", "
+      "\"ids\": [\"" + std::to_string(victim) + "\"]"
+    "}";
+  bufferlist inbl, outbl;
+  ASSERT_EQ(0, cluster.mon_command(cmd, inbl, &outbl, NULL));
+  ASSERT_TRUE(wait_for_shard0("foo", victim, false));
+  check_reads("foo", bl);
+}
+
+// overwrites cannot be switched off again, so they get a pool of their own
+typedef LibRadosIoECDirectReadPP LibRadosIoECDirectReadOverwritePP;
+
+TEST_F(LibRadosIoECDirectReadOverwritePP, Overwrite) {
+  SKIP_IF_CRIMSON();
+  ASSERT_EQ(0, pool_set("allow_ec_overwrites", "true"));
+  bufferlist bl = make_object(8);
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+
+  // partial overwrites within a chunk and across chunks and stripes
+  const std::pair<uint64_t, uint64_t> writes[] = {
+    {150, 100},
+    {alignment / 2 - 20, 40},
+    {alignment * 3 - 1000, 3000},
+  };
+  char c = 'A';
+  for (auto [off, len] : writes) {
+    bufferlist w;
+    w.append(string(len, c++));
+    ASSERT_EQ(0, ioctx.write("foo", w, len, off));
+    bl.begin(off).copy_in(len, w.c_str());
+  }
+  check_reads("foo", bl);
+
+  // and reads of data appended past the old end
+  bufferlist w;
+  w.append(string(5000, c));
+  ASSERT_EQ(0, ioctx.write("foo", w, w.length(), bl.length()));
+  bl.append(w);
+  check_reads("foo", bl);
+}
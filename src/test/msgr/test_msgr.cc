@@ -32,6 +32,7 @@
 
 #include "common/ceph_argparse.h"
 #include "common/ceph_mutex.h"
+#include "common/perf_counters_collection.h"
 #include "global/global_init.h"
 #include "messages/MCommand.h"
 #include "messages/MPing.h"
@@ -2389,6 +2390,112 @@ TEST_P(MessengerTest, MarkdownTest) {
   delete server_msgr2;
 }
 
+class OrderDispatcher : public Dispatcher {
+ public:
+  ceph::mutex lock = ceph::make_mutex("OrderDispatcher::lock");
+  ceph::condition_variable cond;
+  vector<string> received;
+
+  OrderDispatcher(): Dispatcher(g_ceph_context) {}
+  bool ms_dispatch(Message *m) override {
+    if (m->get_type() == MSG_COMMAND) {
+      std::lock_guard l{lock};
+      received.push_back(static_cast<MCommand*>(m)->cmd.front());
+      cond.notify_all();
+    }
+    m->put();
+    return true;
+  }
+  bool ms_handle_reset(Connection *con) override { return true; }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override { return false; }
+  int ms_handle_fast_authentication(Connection *con) override { return 1; }
+};
+
+struct SendStats {
+  uint64_t bytes = 0;
+  uint64_t frames = 0;
+  uint64_t calls = 0;
+};
+
+static SendStats get_send_stats() {
+  SendStats stats;
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [&stats](const PerfCountersCollectionImpl::CounterMap& by_path) {
+      for (auto& [path, counter] : by_path) {
+        if (!path.starts_with("AsyncMessenger::Worker-")) {
+          continue;
+        }
+        if (path.ends_with(".msgr_send_bytes")) {
+          stats.bytes += counter.data->u64;
+        } else if (path.ends_with(".msgr_send_frames_per_call")) {
+          auto [frames, calls] = counter.data->read_avg();
+          stats.frames += frames;
+          stats.calls += calls;
+        }
+      }
+    });
+  return stats;
+}
+
+TEST_P(MessengerTest, SendBatchTest) {
+  // leave write_message() time enough to batch the whole burst
+  g_ceph_context->_conf.set_val("ms_async_send_batch_max_latency_us", "100000");
+  FakeDispatcher cli_dispatcher(false);
+  OrderDispatcher srv_dispatcher;
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  Messenger::Policy p = Messenger::Policy::stateless_server(0);
+  server_msgr->set_policy(entity_name_t::TYPE_CLIENT, p);
+  p = Messenger::Policy::lossy_client(0);
+  client_msgr->set_policy(entity_name_t::TYPE_OSD, p);
+
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  const SendStats before = get_send_stats();
+  // the messages queue up while the session is being established and
+  // are all written out once it is
+  const unsigned n = 100;
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  uuid_d uuid;
+  uuid.generate_random();
+  for (unsigned i = 0; i < n; i++) {
+    MCommand *m = new MCommand(uuid);
+    m->cmd.push_back(to_string(i));
+    ASSERT_EQ(conn->send_message(m), 0);
+  }
+  {
+    std::unique_lock l{srv_dispatcher.lock};
+    ASSERT_TRUE(srv_dispatcher.cond.wait_for(l, 60s, [&] {
+      return srv_dispatcher.received.size() >= n;
+    }));
+    ASSERT_EQ(n, srv_dispatcher.received.size());
+    for (unsigned i = 0; i < n; i++) {
+      ASSERT_EQ(to_string(i), srv_dispatcher.received[i]);
+    }
+  }
+  const SendStats after = get_send_stats();
+  const uint64_t frames = after.frames - before.frames;
+  const uint64_t calls = after.calls - before.calls;
+  lderr(g_ceph_context) << __func__ << " " << frames << " frames in "
+			<< calls << " sends" << dendl;
+  ASSERT_GE(frames, n);
+  ASSERT_LT(calls, frames);
+  // the bytes of frames flushed as a batch are counted too
+  ASSERT_GE(after.bytes - before.bytes, n * sizeof(ceph_msg_header2));
+
+  server_msgr->shutdown();
+  client_msgr->shutdown();
+  server_msgr->wait();
+  client_msgr->wait();
+  g_ceph_context->_conf.set_val("ms_async_send_batch_max_latency_us", "50");
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Messenger,
   MessengerTest,
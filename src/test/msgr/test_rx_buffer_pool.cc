@@ -0,0 +1,176 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <cstring>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include "common/ceph_context.h"
+#include "include/buffer.h"
+#include "include/page.h"
+#include "msg/async/RxBufferPool.h"
+#include "gtest/gtest.h"
+
+using ceph::bufferptr;
+
+namespace {
+
+CephContext *make_cct(const char *pool_size = "64M",
+		      const char *min_size = "64K")
+{
+  CephContext *cct = (new CephContext(CEPH_ENTITY_TYPE_CLIENT))->get();
+  cct->_conf.set_val_or_die("ms_rx_buffer_pool_size", pool_size);
+  cct->_conf.set_val_or_die("ms_rx_buffer_pool_min_size", min_size);
+  cct->_conf.apply_changes(nullptr);
+  return cct;
+}
+
+RxBufferPool& get_pool(CephContext *cct)
+{
+  return cct->lookup_or_create_singleton_object<RxBufferPool>(
+    "AsyncMessenger::RxBufferPool", false, cct);
+}
+
+} // anonymous namespace
+
+TEST(RxBufferPool, Alignment)
+{
+  CephContext *cct = make_cct();
+  auto& pool = get_pool(cct);
+  for (unsigned len : {64u << 10, (64u << 10) + 1, 1u << 20, (4u << 20) - 7}) {
+    bufferptr p(pool.create(len, CEPH_PAGE_SIZE));
+    ASSERT_EQ(len, p.length());
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(p.c_str()) % CEPH_PAGE_SIZE);
+    // the whole buffer is usable
+    memset(p.c_str(), 0xa5, len);
+  }
+  // small segments are aligned too, but not pooled
+  {
+    bufferptr p(pool.create(4096, 8));
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(p.c_str()) % 8);
+  }
+  cct->put();
+}
+
+TEST(RxBufferPool, Reuse)
+{
+  CephContext *cct = make_cct();
+  auto& pool = get_pool(cct);
+  ASSERT_EQ(0u, pool.free_bytes());
+
+  const char *first;
+  {
+    bufferptr p(pool.create(1 << 20, CEPH_PAGE_SIZE));
+    first = p.c_str();
+    ASSERT_EQ(0u, pool.free_bytes());
+  }
+  // the last reference is gone, so the memory went back to the pool
+  ASSERT_EQ(1u << 20, pool.free_bytes());
+  {
+    bufferptr p(pool.create(1 << 20, CEPH_PAGE_SIZE));
+    ASSERT_EQ(first, p.c_str());
+    ASSERT_EQ(0u, pool.free_bytes());
+  }
+
+  // segments of about the same size share a buffer
+  {
+    bufferptr p(pool.create((1 << 20) + 1, CEPH_PAGE_SIZE));
+    first = p.c_str();
+  }
+  uint64_t held = pool.free_bytes();
+  ASSERT_EQ((1u << 20) + (128u << 10), held - (1u << 20));
+  {
+    bufferptr p(pool.create((1 << 20) + 100000, CEPH_PAGE_SIZE));
+    ASSERT_EQ(first, p.c_str());
+    ASSERT_EQ(held - ((1u << 20) + (128u << 10)), pool.free_bytes());
+  }
+
+  // a buffer is only returned once every reference to it is gone
+  {
+    ceph::bufferlist bl;
+    {
+      bufferptr p(pool.create(1 << 20, CEPH_PAGE_SIZE));
+      bl.append(p);
+      bl.append(bufferptr(p, 0, 4096));
+    }
+    ASSERT_EQ((1u << 20) + (128u << 10), pool.free_bytes());
+  }
+  ASSERT_EQ(held, pool.free_bytes());
+
+  // segments below ms_rx_buffer_pool_min_size are never pooled
+  {
+    bufferptr p(pool.create((64 << 10) - 1, CEPH_PAGE_SIZE));
+  }
+  ASSERT_EQ(held, pool.free_bytes());
+  cct->put();
+}
+
+TEST(RxBufferPool, MaxBytes)
+{
+  CephContext *cct = make_cct("256K");
+  auto& pool = get_pool(cct);
+  {
+    std::vector<bufferptr> ps;
+    for (unsigned i = 0; i < 8; ++i) {
+      ps.emplace_back(pool.create(64 << 10, CEPH_PAGE_SIZE));
+    }
+  }
+  // only ms_rx_buffer_pool_size of the released buffers is kept
+  ASSERT_EQ(256u << 10, pool.free_bytes());
+  {
+    // a buffer bigger than what is left over is freed, not kept
+    bufferptr p(pool.create(128 << 10, CEPH_PAGE_SIZE));
+  }
+  ASSERT_EQ(256u << 10, pool.free_bytes());
+  {
+    std::set<const char*> ptrs;
+    std::vector<bufferptr> ps;
+    for (unsigned i = 0; i < 4; ++i) {
+      ps.emplace_back(pool.create(64 << 10, CEPH_PAGE_SIZE));
+      ptrs.insert(ps.back().c_str());
+    }
+    ASSERT_EQ(4u, ptrs.size());
+    ASSERT_EQ(0u, pool.free_bytes());
+  }
+  ASSERT_EQ(256u << 10, pool.free_bytes());
+  cct->put();
+
+  // 0 disables the pool
+  cct = make_cct("0");
+  auto& off = get_pool(cct);
+  {
+    bufferptr p(off.create(1 << 20, CEPH_PAGE_SIZE));
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(p.c_str()) % CEPH_PAGE_SIZE);
+  }
+  ASSERT_EQ(0u, off.free_bytes());
+  cct->put();
+}
+
+TEST(RxBufferPool, OutlivesPool)
+{
+  CephContext *cct = make_cct();
+  ceph::bufferlist bl;
+  {
+    auto& pool = get_pool(cct);
+    bufferptr p(pool.create(1 << 20, CEPH_PAGE_SIZE));
+    memset(p.c_str(), 'x', p.length());
+    bl.append(std::move(p));
+    // park a released buffer in the pool as well
+    bufferptr q(pool.create(1 << 20, CEPH_PAGE_SIZE));
+  }
+  // the messenger, and with it the pool singleton, can go away while a
+  // message it received is still being worked on
+  cct->put();
+  ASSERT_EQ(1u << 20, bl.length());
+  for (auto c : std::string_view(bl.c_str(), bl.length())) {
+    ASSERT_EQ('x', c);
+  }
+  // releasing the buffer now just frees it
+  bl.clear();
+
+  // and a new pool starts out empty
+  cct = make_cct();
+  ASSERT_EQ(0u, get_pool(cct).free_bytes());
+  cct->put();
+}
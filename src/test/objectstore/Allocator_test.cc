@@ -4,8 +4,11 @@
  * In memory space allocator test cases.
  * Author: Ramesh Chander, Ramesh.Chander@sandisk.com
  */
+#include <fstream>
 #include <iostream>
+#include <thread>
 #include <boost/scoped_ptr.hpp>
+#include <boost/random/uniform_int.hpp>
 #include <gtest/gtest.h>
 
 #include "common/Cond.h"
@@ -13,6 +16,7 @@
 #include "include/stringify.h"
 #include "include/Context.h"
 #include "os/bluestore/Allocator.h"
+#include "os/bluestore/CachingAllocator.h"
 
 using namespace std;
 
@@ -652,6 +656,154 @@ TEST_P(AllocTest, test_init_rm_free_unbound)
   }
 }
 
+TEST_P(AllocTest, test_caching_alloc)
+{
+  uint64_t block_size = 0x1000;
+  uint64_t capacity = 0x1000000;
+  uint64_t chunk = 0x100000;
+  Allocator* backend = Allocator::create(g_ceph_context, GetParam(),
+					 capacity, block_size);
+  backend->init_add_free(0, capacity);
+  alloc.reset(new CachingAllocator(g_ceph_context, backend, 4,
+				   chunk, 0x10000, "caching"));
+  auto calloc = static_cast<CachingAllocator*>(alloc.get());
+
+  // small allocations are carved out of a chunk taken by the shard
+  PExtentVector extents;
+  EXPECT_EQ(0x4000, alloc->allocate(0x4000, block_size, 0x4000, 0, &extents));
+  EXPECT_EQ(chunk - 0x4000, calloc->get_cached());
+  EXPECT_EQ(capacity - 0x4000, alloc->get_free());
+  EXPECT_EQ(0x3000, alloc->allocate(0x3000, block_size, 0x1000, 0, &extents));
+  for (auto& e : extents) {
+    EXPECT_LE(e.length, 0x4000u);
+  }
+
+  // large ones bypass the cache
+  PExtentVector big;
+  EXPECT_EQ(0x100000, alloc->allocate(0x100000, block_size, 0x100000, 0, &big));
+  EXPECT_EQ(chunk - 0x7000, calloc->get_cached());
+
+  // cached space is reported by foreach
+  uint64_t seen = 0;
+  alloc->foreach([&](uint64_t, uint64_t len) { seen += len; });
+  EXPECT_EQ(alloc->get_free(), seen);
+
+  alloc->release(extents);
+  alloc->release(big);
+  EXPECT_EQ(capacity, alloc->get_free());
+  calloc->flush_caches();
+  EXPECT_EQ(0u, calloc->get_cached());
+  EXPECT_EQ(capacity, alloc->get_free());
+
+  // space held in the shards is still handed out when the device is full
+  EXPECT_EQ(0x1000, alloc->allocate(0x1000, block_size, 0x1000, 0, &extents));
+  PExtentVector rest;
+  uint64_t want = capacity - 0x1000;
+  EXPECT_EQ((int64_t)want, alloc->allocate(want, block_size, chunk, 0, &rest));
+  EXPECT_EQ(0u, alloc->get_free());
+}
+
+TEST_P(AllocTest, test_caching_alloc_threads)
+{
+  uint64_t block_size = 0x1000;
+  uint64_t capacity = 0x40000000;
+  Allocator* backend = Allocator::create(g_ceph_context, GetParam(),
+					 capacity, block_size);
+  backend->init_add_free(0, capacity);
+  alloc.reset(new CachingAllocator(g_ceph_context, backend, 4,
+				   0x80000, 0x10000, "caching"));
+
+  const unsigned num_threads = 8;
+  std::vector<PExtentVector> allocated(num_threads);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      gen_type rng(t);
+      boost::uniform_int<> u(1, 16);
+      for (unsigned i = 0; i < 2000; ++i) {
+	uint64_t want = u(rng) * block_size;
+	PExtentVector tmp;
+	ASSERT_EQ((int64_t)want, alloc->allocate(want, block_size, want, 0, &tmp));
+	if (i % 2) {
+	  alloc->release(tmp);
+	} else {
+	  allocated[t].insert(allocated[t].end(), tmp.begin(), tmp.end());
+	}
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // nothing handed out twice
+  interval_set<uint64_t> all;
+  for (auto& v : allocated) {
+    for (auto& e : v) {
+      ASSERT_FALSE(all.intersects(e.offset, e.length));
+      all.insert(e.offset, e.length);
+    }
+  }
+  EXPECT_EQ(capacity - all.size(), alloc->get_free());
+  alloc->shutdown();
+}
+
+TEST_P(AllocTest, test_trace)
+{
+  uint64_t block_size = 0x1000;
+  uint64_t capacity = 0x100000;
+  init_alloc(capacity, block_size);
+  alloc->init_add_free(0x10000, capacity - 0x10000);
+
+  string path = "alloc_trace." + stringify(getpid());
+  ostringstream ss;
+  ASSERT_EQ(0, alloc->start_trace(path, 0, ss));
+  ASSERT_TRUE(alloc->is_tracing());
+  ASSERT_EQ(-EBUSY, alloc->start_trace(path, 0, ss));
+
+  PExtentVector extents;
+  EXPECT_EQ(0x4000, alloc->allocate(0x4000, block_size, 0x4000, 0, &extents));
+  alloc->release(extents);
+  PExtentVector all;
+  EXPECT_EQ((int64_t)capacity - 0x10000,
+	    alloc->allocate(capacity, block_size, capacity, 0, &all));
+  EXPECT_GT(0, alloc->allocate(block_size, block_size, block_size, 0,
+			       &extents));
+  ASSERT_EQ(0, alloc->stop_trace(ss));
+  ASSERT_FALSE(alloc->is_tracing());
+
+  std::ifstream in(path);
+  ASSERT_TRUE(in.is_open());
+  string line;
+  vector<string> lines;
+  while (std::getline(in, line)) {
+    lines.push_back(line);
+  }
+  ::unlink(path.c_str());
+  ASSERT_LE(2u, lines.size());
+  EXPECT_EQ("h " + string(alloc->get_type()) + " 100000 1000", lines[0]);
+  size_t i = 1;
+  uint64_t traced_free = 0;
+  for (; i < lines.size() && lines[i][0] == 'f'; ++i) {
+    uint64_t off, len;
+    ASSERT_EQ(2, sscanf(lines[i].c_str(), "f %jx %jx", &off, &len));
+    traced_free += len;
+  }
+  EXPECT_EQ(capacity - 0x10000, traced_free);
+  ASSERT_EQ(i + 4, lines.size());
+  EXPECT_EQ('a', lines[i][0]);
+  EXPECT_NE(string::npos, lines[i].find(" 4000 1000 4000 0 4000 "));
+  EXPECT_EQ('r', lines[i + 1][0]);
+  EXPECT_EQ('a', lines[i + 2][0]);
+  EXPECT_NE(string::npos, lines[i + 3].find(" -28"));
+
+  // stops by itself after max_ops records
+  ASSERT_EQ(0, alloc->start_trace(path, 1, ss));
+  alloc->release(all);
+  EXPECT_FALSE(alloc->is_tracing());
+  ::unlink(path.c_str());
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
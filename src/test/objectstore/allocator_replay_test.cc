@@ -4,9 +4,15 @@
  * Allocator replay tool.
  * Author: Igor Fedotov, ifedotov@suse.com
  */
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <vector>
 
+#include <boost/algorithm/string.hpp>
+
 #include "common/ceph_argparse.h"
 #include "common/debug.h"
 #include "common/Cycles.h"
@@ -28,7 +34,8 @@ void usage(const string &name) {
           "try_alloc <count> <want> <alloc_unit>|"
           "replay_alloc <alloc_list_file|"
           "export_binary <out_file>|"
-          "free_histogram [<alloc_unit>] [<num_buckets>]"
+          "free_histogram [<alloc_unit>] [<num_buckets>]|"
+          "replay_trace [<allocator>[,<allocator>...]] [<report_every>]"
        << std::endl;
 }
 
@@ -534,6 +541,305 @@ int check_duplicates(char* fname)
   return r >= 0 ? errors != 0 : r;
 }
 
+/*
+ * Replays a trace recorded with
+ *   "ceph daemon <osd> bluestore allocator trace start <name> <path>"
+ * (see Allocator::Tracer for the format) against a set of allocator
+ * implementations and reports throughput, latency percentiles and how
+ * fragmentation evolves.
+ */
+struct alloc_trace_t {
+  struct op_t {
+    bool is_alloc = false;
+    uint64_t want = 0;
+    uint64_t unit = 0;
+    uint64_t max = 0;
+    int64_t hint = 0;
+    int64_t result = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> extents;
+  };
+  string type;
+  uint64_t capacity = 0;
+  uint64_t alloc_unit = 0;
+  interval_set<uint64_t> free;
+  std::vector<op_t> ops;
+};
+
+int load_alloc_trace(const char* fname, alloc_trace_t* t)
+{
+  std::ifstream in(fname);
+  if (!in.is_open()) {
+    std::cerr << "error: unable to open " << fname << std::endl;
+    return -1;
+  }
+  auto parse_extents = [](std::istringstream& ss, alloc_trace_t::op_t& op) {
+    string e;
+    while (ss >> e) {
+      uint64_t off, len;
+      if (std::sscanf(e.c_str(), "%jx~%jx", &off, &len) != 2) {
+	return false;
+      }
+      op.extents.emplace_back(off, len);
+    }
+    return true;
+  };
+  string line;
+  size_t lineno = 0;
+  while (std::getline(in, line)) {
+    ++lineno;
+    std::istringstream ss(line);
+    ss >> std::hex;
+    char c = 0;
+    ss >> c;
+    bool ok = true;
+    if (c == 'h') {
+      ok = bool(ss >> t->type >> t->capacity >> t->alloc_unit);
+    } else if (c == 'f') {
+      uint64_t off, len;
+      ok = bool(ss >> off >> len);
+      if (ok) {
+	t->free.union_insert(off, len);
+      }
+    } else if (c == 'a') {
+      alloc_trace_t::op_t op;
+      uint64_t ts;
+      string result;
+      op.is_alloc = true;
+      ok = bool(ss >> ts >> op.want >> op.unit >> op.max >> op.hint >> result);
+      if (ok) {
+	op.result = result[0] == '-' ?
+	  std::stoll(result) : (int64_t)std::stoull(result, nullptr, 16);
+	ok = parse_extents(ss, op);
+	t->ops.emplace_back(std::move(op));
+      }
+    } else if (c == 'r') {
+      alloc_trace_t::op_t op;
+      uint64_t ts;
+      ok = bool(ss >> ts) && parse_extents(ss, op);
+      if (ok) {
+	t->ops.emplace_back(std::move(op));
+      }
+    } else {
+      ok = line.empty();
+    }
+    if (!ok) {
+      std::cerr << "error: malformed trace record at line " << lineno
+		<< ": " << line << std::endl;
+      return -1;
+    }
+  }
+  if (!t->capacity || !t->alloc_unit) {
+    std::cerr << "error: no trace header in " << fname << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+// Tracks where the space of each traced allocation ended up in the
+// replaying allocator, so that traced releases can be translated.
+class alloc_trace_map_t {
+  struct piece_t {
+    uint64_t len;
+    uint64_t to;
+  };
+  std::map<uint64_t, piece_t> pieces;   ///< traced offset -> replayed one
+  interval_set<uint64_t> preexisting;   ///< in use when tracing started
+
+public:
+  alloc_trace_map_t(uint64_t capacity, const interval_set<uint64_t>& free) {
+    preexisting.insert(0, capacity);
+    preexisting.subtract(free);
+  }
+
+  void map(const std::vector<std::pair<uint64_t, uint64_t>>& traced,
+	   const PExtentVector& replayed) {
+    auto t = traced.begin();
+    auto r = replayed.begin();
+    uint64_t t_pos = 0, r_pos = 0;
+    while (t != traced.end() && r != replayed.end()) {
+      uint64_t len = std::min(t->second - t_pos, r->length - r_pos);
+      pieces[t->first + t_pos] = piece_t{len, r->offset + r_pos};
+      t_pos += len;
+      r_pos += len;
+      if (t_pos == t->second) {
+	++t;
+	t_pos = 0;
+      }
+      if (r_pos == r->length) {
+	++r;
+	r_pos = 0;
+      }
+    }
+  }
+
+  // translate a traced release, dropping whatever the replaying
+  // allocator does not hold (e.g. operations missed by the trace)
+  void translate(uint64_t off, uint64_t len, interval_set<uint64_t>* out) {
+    uint64_t end = off + len;
+    auto identity = [&](uint64_t s, uint64_t e) {
+      interval_set<uint64_t> i;
+      i.insert(s, e - s);
+      i.intersection_of(preexisting);
+      preexisting.subtract(i);
+      out->union_of(i);
+    };
+    auto p = pieces.lower_bound(off);
+    if (p != pieces.begin()) {
+      auto q = std::prev(p);
+      if (q->first + q->second.len > off) {
+	p = q;
+      }
+    }
+    uint64_t pos = off;
+    while (pos < end) {
+      if (p == pieces.end() || p->first >= end) {
+	identity(pos, end);
+	break;
+      }
+      if (p->first > pos) {
+	identity(pos, p->first);
+	pos = p->first;
+      }
+      auto [start, piece] = *p;
+      uint64_t e = std::min(end, start + piece.len);
+      out->union_insert(piece.to + (pos - start), e - pos);
+      pieces.erase(p);
+      if (pos > start) {
+	pieces[start] = piece_t{pos - start, piece.to};
+      }
+      if (start + piece.len > e) {
+	pieces[e] = piece_t{start + piece.len - e, piece.to + (e - start)};
+      }
+      pos = e;
+      p = pieces.lower_bound(pos);
+    }
+  }
+};
+
+void print_percentiles(const char* what, std::vector<uint64_t>& lat)
+{
+  if (lat.empty()) {
+    return;
+  }
+  std::sort(lat.begin(), lat.end());
+  auto pct = [&](double p) {
+    return lat[std::min(lat.size() - 1, size_t(p * lat.size()))];
+  };
+  std::cout << "  " << what << " latency (ns): p50 " << pct(0.5)
+	    << " p90 " << pct(0.9)
+	    << " p99 " << pct(0.99)
+	    << " p99.9 " << pct(0.999)
+	    << " max " << lat.back()
+	    << std::endl;
+}
+
+int replay_alloc_trace(char* fname, const std::vector<string>& types,
+		       uint64_t report_every)
+{
+  alloc_trace_t trace;
+  int r = load_alloc_trace(fname, &trace);
+  if (r < 0) {
+    return r;
+  }
+  std::cout << "trace: " << trace.type << " allocator, capacity 0x"
+	    << std::hex << trace.capacity << ", alloc unit 0x"
+	    << trace.alloc_unit << ", free 0x" << trace.free.size()
+	    << std::dec << ", " << trace.ops.size() << " operations"
+	    << std::endl;
+
+  for (auto& type : types) {
+    unique_ptr<Allocator> a(Allocator::create(
+      g_ceph_context, type, trace.capacity, trace.alloc_unit));
+    if (!a) {
+      std::cerr << "error: unknown allocator " << type << std::endl;
+      return -1;
+    }
+    for (auto p = trace.free.begin(); p != trace.free.end(); ++p) {
+      a->init_add_free(p.get_start(), p.get_len());
+    }
+    alloc_trace_map_t tmap(trace.capacity, trace.free);
+    std::vector<uint64_t> alloc_lat, release_lat;
+    uint64_t failed = 0, diverged = 0, fragments = 0;
+    ceph::timespan total = ceph::timespan::zero();
+
+    auto report = [&](uint64_t ops) {
+      std::cout << type << ": ops " << ops
+		<< " free 0x" << std::hex << a->get_free() << std::dec
+		<< " fragmentation " << a->get_fragmentation()
+		<< " score " << a->get_fragmentation_score()
+		<< std::endl;
+    };
+    report(0);
+    uint64_t n = 0;
+    for (auto& op : trace.ops) {
+      if (op.is_alloc) {
+	PExtentVector extents;
+	auto t0 = ceph::mono_clock::now();
+	int64_t res = a->allocate(op.want, op.unit, op.max, op.hint,
+				  &extents);
+	auto dur = ceph::mono_clock::now() - t0;
+	total += dur;
+	alloc_lat.push_back(dur.count());
+	if (res < 0) {
+	  ++failed;
+	} else {
+	  fragments += extents.size();
+	}
+	if ((res < 0) != (op.result < 0) || (res >= 0 && res != op.result)) {
+	  ++diverged;
+	}
+	if (res > 0) {
+	  tmap.map(op.extents, extents);
+	}
+      } else {
+	interval_set<uint64_t> to_release;
+	for (auto& [off, len] : op.extents) {
+	  tmap.translate(off, len, &to_release);
+	}
+	if (!to_release.empty()) {
+	  auto t0 = ceph::mono_clock::now();
+	  a->release(to_release);
+	  auto dur = ceph::mono_clock::now() - t0;
+	  total += dur;
+	  release_lat.push_back(dur.count());
+	}
+      }
+      if (report_every && ++n % report_every == 0) {
+	report(n);
+      }
+    }
+
+    double secs = std::chrono::duration<double>(total).count();
+    std::cout << type << ": " << alloc_lat.size() << " allocations ("
+	      << failed << " failed, " << diverged << " diverged from trace, "
+	      << (alloc_lat.size() - failed ?
+		  (double)fragments / (alloc_lat.size() - failed) : 0)
+	      << " extents each), " << release_lat.size() << " releases, "
+	      << (secs > 0 ? (alloc_lat.size() + release_lat.size()) / secs : 0)
+	      << " ops/s" << std::endl;
+    print_percentiles("allocate", alloc_lat);
+    print_percentiles("release", release_lat);
+    report(n);
+
+    const size_t num_buckets = 8;
+    Allocator::FreeStateHistogram hist;
+    hist.resize(num_buckets);
+    a->build_free_state_histogram(trace.alloc_unit, hist);
+    uint64_t s = 0;
+    for (size_t i = 0; i < num_buckets; i++) {
+      uint64_t e = hist[i].get_max(i, num_buckets);
+      std::cout << "  (" << s << ".." << e << "]"
+		<< " -> " << hist[i].total
+		<< " chunks, " << hist[i].aligned << " aligned with "
+		<< hist[i].alloc_units << " alloc_units."
+		<< std::endl;
+      s = e;
+    }
+    a->shutdown();
+  }
+  return 0;
+}
+
 int main(int argc, char **argv)
 {
   auto args = argv_to_vec(argc, argv);
@@ -780,5 +1086,16 @@ int main(int argc, char **argv)
     return export_as_binary(argv[1], argv[3]);
   } else if (strcmp(argv[2], "duplicates") == 0) {
     return check_duplicates(argv[1]);
+  } else if (strcmp(argv[2], "replay_trace") == 0) {
+    std::vector<string> types = {"stupid", "bitmap", "avl", "btree", "hybrid"};
+    uint64_t report_every = 100000;
+    if (argc >= 4) {
+      types.clear();
+      boost::split(types, argv[3], boost::is_any_of(","));
+    }
+    if (argc >= 5) {
+      report_every = strtoul(argv[4], nullptr, 10);
+    }
+    return replay_alloc_trace(argv[1], types, report_every);
   }
 }
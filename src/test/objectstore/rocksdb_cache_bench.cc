@@ -0,0 +1,226 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * RocksDB block cache (BinnedLRUCache vs BinnedClockCache) benchmarks.
+ */
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "common/ceph_time.h"
+#include "global/global_context.h"
+#include "include/stringify.h"
+#include "kv/rocksdb_cache/BinnedClockCache.h"
+#include "kv/rocksdb_cache/BinnedLRUCache.h"
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int.hpp>
+typedef boost::mt11213b gen_type;
+
+using namespace std;
+
+class BlockCacheTest : public ::testing::TestWithParam<const char*> {
+public:
+  std::shared_ptr<rocksdb_cache::ShardedCache> cache;
+
+  void init_cache(size_t capacity, int shard_bits, double high_pri = 0.0) {
+    std::shared_ptr<rocksdb::Cache> c;
+    if (string(GetParam()) == "binned_lru") {
+      c = rocksdb_cache::NewBinnedLRUCache(g_ceph_context, capacity, shard_bits,
+					   false, high_pri);
+    } else {
+      c = rocksdb_cache::NewBinnedClockCache(g_ceph_context, capacity, shard_bits,
+					     false, high_pri);
+    }
+    cache = std::dynamic_pointer_cast<rocksdb_cache::ShardedCache>(c);
+    ASSERT_TRUE(cache);
+  }
+
+  static void deleter(const rocksdb::Slice&, void* value) {
+    delete static_cast<uint64_t*>(value);
+  }
+
+  void insert(const string& key, uint64_t v, size_t charge,
+	      rocksdb::Cache::Priority pri = rocksdb::Cache::Priority::LOW) {
+    ASSERT_TRUE(cache->Insert(key, new uint64_t(v), charge, &deleter, nullptr,
+			      pri).ok());
+  }
+};
+
+TEST_P(BlockCacheTest, basics)
+{
+  init_cache(1 << 20, 0);
+  insert("a", 1, 1000);
+  insert("b", 2, 1000);
+  ASSERT_EQ(2000u, cache->GetUsage());
+  ASSERT_EQ(0u, cache->GetPinnedUsage());
+
+  auto h = cache->Lookup("a", nullptr);
+  ASSERT_TRUE(h);
+  ASSERT_EQ(1u, *static_cast<uint64_t*>(cache->Value(h)));
+  ASSERT_EQ(1000u, cache->GetPinnedUsage());
+  ASSERT_FALSE(cache->Lookup("c", nullptr));
+
+  // erase while referenced: gone from the cache, alive for the holder
+  cache->Erase("a");
+  ASSERT_FALSE(cache->Lookup("a", nullptr));
+  ASSERT_EQ(1u, *static_cast<uint64_t*>(cache->Value(h)));
+  ASSERT_TRUE(cache->Release(h));
+  ASSERT_EQ(1000u, cache->GetUsage());
+  ASSERT_EQ(0u, cache->GetPinnedUsage());
+
+  // replace
+  insert("b", 3, 500);
+  h = cache->Lookup("b", nullptr);
+  ASSERT_EQ(3u, *static_cast<uint64_t*>(cache->Value(h)));
+  ASSERT_FALSE(cache->Release(h));
+  ASSERT_EQ(500u, cache->GetUsage());
+
+  cache->EraseUnRefEntries();
+  ASSERT_EQ(0u, cache->GetUsage());
+}
+
+TEST_P(BlockCacheTest, eviction)
+{
+  init_cache(100 * 1000, 0);
+  for (unsigned i = 0; i < 100; ++i) {
+    insert(stringify(i), i, 1000);
+  }
+  ASSERT_EQ(100u * 1000u, cache->GetUsage());
+  // keep one pinned and one recently used
+  auto pinned = cache->Lookup("0", nullptr);
+  cache->Release(cache->Lookup("1", nullptr));
+  for (unsigned i = 100; i < 150; ++i) {
+    insert(stringify(i), i, 1000);
+  }
+  ASSERT_LE(cache->GetUsage(), 100u * 1000u);
+  auto h = cache->Lookup("1", nullptr);
+  ASSERT_TRUE(h);
+  cache->Release(h);
+  ASSERT_EQ(0u, *static_cast<uint64_t*>(cache->Value(pinned)));
+  cache->Release(pinned);
+  h = cache->Lookup("149", nullptr);
+  ASSERT_TRUE(h);
+  cache->Release(h);
+}
+
+TEST_P(BlockCacheTest, age_bins)
+{
+  init_cache(1 << 20, 0);
+  // PRI1 gets age bin 0, PRI2 bins 1-3
+  cache->import_bins({1, 4});
+  ASSERT_EQ(4u, cache->get_bin_count());
+  insert("a", 1, 1000);
+  cache->shift_bins();
+  insert("b", 2, 100);
+  ASSERT_EQ(100, cache->request_cache_bytes(PriorityCache::Priority::PRI1, 1 << 20));
+  ASSERT_EQ(1000, cache->request_cache_bytes(PriorityCache::Priority::PRI2, 1 << 20));
+
+  // a hit moves "a" into the current bin
+  auto h = cache->Lookup("a", nullptr);
+  cache->Release(h);
+  cache->shift_bins();
+  ASSERT_EQ(0, cache->request_cache_bytes(PriorityCache::Priority::PRI1, 1 << 20));
+  ASSERT_EQ(1100, cache->request_cache_bytes(PriorityCache::Priority::PRI2, 1 << 20));
+
+  // everything ages out of the 4 bins
+  for (int i = 0; i < 4; ++i) {
+    cache->shift_bins();
+  }
+  ASSERT_EQ(0, cache->request_cache_bytes(PriorityCache::Priority::PRI2, 1 << 20));
+  ASSERT_EQ(1100, cache->request_cache_bytes(PriorityCache::Priority::LAST, 1 << 20));
+}
+
+// Many threads hitting a small hot set, as RocksDB does with index and
+// filter blocks and hot data blocks.
+TEST_P(BlockCacheTest, bench_hits)
+{
+  const unsigned num_keys = 10000;
+  // short enough to run with the other unit tests
+  const unsigned threads = std::clamp(std::thread::hardware_concurrency(), 4u, 16u);
+  const unsigned ops = 200000;
+  init_cache(num_keys * 4096 * 2, 6);
+  vector<string> keys;
+  for (unsigned i = 0; i < num_keys; ++i) {
+    keys.push_back("key" + stringify(i));
+    insert(keys.back(), i, 4096);
+  }
+
+  std::atomic<uint64_t> misses = 0;
+  auto start = ceph::mono_clock::now();
+  vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      gen_type rng(t);
+      boost::uniform_int<> u(0, num_keys - 1);
+      for (unsigned i = 0; i < ops; ++i) {
+	auto h = cache->Lookup(keys[u(rng)], nullptr);
+	if (h) {
+	  cache->Release(h);
+	} else {
+	  ++misses;
+	}
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  double secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+  std::cout << GetParam() << ": " << threads << " threads, "
+	    << (threads * ops) / secs / 1000000 << " Mlookups/s, "
+	    << misses << " misses" << std::endl;
+  ASSERT_EQ(0u, misses);
+}
+
+// Lookups mixed with inserts of new blocks that force eviction.
+TEST_P(BlockCacheTest, bench_churn)
+{
+  const unsigned num_keys = 100000;
+  const unsigned threads = std::clamp(std::thread::hardware_concurrency(), 4u, 16u);
+  const unsigned ops = 100000;
+  init_cache(num_keys * 4096 / 4, 6);
+  vector<string> keys;
+  for (unsigned i = 0; i < num_keys; ++i) {
+    keys.push_back("key" + stringify(i));
+  }
+
+  std::atomic<uint64_t> hits = 0;
+  auto start = ceph::mono_clock::now();
+  vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      gen_type rng(t);
+      // skewed: most lookups go to the first tenth of the keys
+      boost::uniform_int<> hot(0, num_keys / 10 - 1);
+      boost::uniform_int<> all(0, num_keys - 1);
+      boost::uniform_int<> pick(0, 9);
+      for (unsigned i = 0; i < ops; ++i) {
+	auto& k = keys[pick(rng) < 8 ? hot(rng) : all(rng)];
+	auto h = cache->Lookup(k, nullptr);
+	if (h) {
+	  ++hits;
+	  cache->Release(h);
+	} else {
+	  insert(k, i, 4096);
+	}
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  double secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+  std::cout << GetParam() << ": " << threads << " threads, "
+	    << (threads * ops) / secs / 1000000 << " Mops/s, hit ratio "
+	    << (double)hits / (threads * ops) << std::endl;
+  ASSERT_LE(cache->GetUsage(), num_keys * 4096 / 4 + threads * 4096);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  BlockCache,
+  BlockCacheTest,
+  ::testing::Values("binned_lru", "binned_clock"));
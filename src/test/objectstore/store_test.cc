@@ -5449,6 +5449,189 @@ TEST_P(StoreTestSpecificAUSize, SyntheticMatrixCompression) {
   do_matrix(m, &StoreTestSpecificAUSize::SyntheticTest);
 }
 
+TEST_P(StoreTestSpecificAUSize, SyntheticKVSyncShards) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  // startup option, must be set before mount
+  SetVal(g_conf(), "bluestore_kv_sync_shards", "4");
+  SetVal(g_conf(), "bluestore_nid_prealloc", "16");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(4096);
+  doSyntheticTest(1000, 10000, 262144, 65536, 4096);
+}
+
+TEST_P(StoreTestSpecificAUSize, DeferredKVSyncShards) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  // startup option, must be set before mount
+  SetVal(g_conf(), "bluestore_kv_sync_shards", "4");
+  SetVal(g_conf(), "bluestore_prefer_deferred_size", "65536");
+  SetVal(g_conf(), "bluestore_deferred_batch_ops", "1");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(block_size);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t("test", "", CEPH_NOSNAP, 0, -1, ""));
+  PerfCounters* logger = const_cast<PerfCounters*>(store->get_perf_counters());
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    bufferlist bl;
+    bl.append(std::string(block_size * 16, 'a'));
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto deferred_w = logger->get(l_bluestore_issued_deferred_writes);
+  auto cleaned = logger->get_tavg_ns(l_bluestore_state_deferred_cleanup_lat).second;
+  const unsigned num = 20;
+  for (unsigned i = 0; i < num; ++i) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(std::string(block_size, 'b' + i % 16));
+    t.write(cid, hoid, (i % 16) * block_size, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(deferred_w + num, logger->get(l_bluestore_issued_deferred_writes));
+
+  // the shards commit everything; the deferred writes must still get
+  // cleaned up without anything forcing them out
+  for (unsigned i = 0; i < 1000; ++i) {
+    if (logger->get_tavg_ns(l_bluestore_state_deferred_cleanup_lat).second >=
+	cleaned + num) {
+      break;
+    }
+    usleep(10000);
+  }
+  ASSERT_EQ(cleaned + num,
+	    logger->get_tavg_ns(l_bluestore_state_deferred_cleanup_lat).second);
+
+  {
+    bufferlist bl, expected;
+    r = store->read(ch, hoid, 3 * block_size, block_size, bl);
+    ASSERT_EQ(r, (int)block_size);
+    expected.append(string(block_size, 'b' + 3));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTestSpecificAUSize, SyntheticOnodeCompact) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  // startup option, must be set before mount
+  SetVal(g_conf(), "bluestore_onode_compact_extent_map", "true");
+  SetVal(g_conf(), "bluestore_extent_map_shard_max_size", "200");
+  SetVal(g_conf(), "bluestore_extent_map_shard_target_size", "100");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(4096);
+  doSyntheticTest(1000, 10000, 1048576, 65536, 4096);
+}
+
+TEST_P(StoreTestSpecificAUSize, OnodeCompactDropsBlobs) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  // startup option, must be set before mount
+  SetVal(g_conf(), "bluestore_onode_compact_extent_map", "true");
+  SetVal(g_conf(), "bluestore_extent_map_shard_max_size", "200");
+  SetVal(g_conf(), "bluestore_extent_map_shard_target_size", "100");
+  SetVal(g_conf(), "bluestore_max_blob_size", "65536");
+  SetVal(g_conf(), "bluestore_default_buffered_write", "false");
+  SetVal(g_conf(), "bluestore_default_buffered_read", "false");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(block_size);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t("test", "", CEPH_NOSNAP, 0, -1, ""));
+  PerfCounters* logger = const_cast<PerfCounters*>(store->get_perf_counters());
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // one blob per 64K, so that the blobs of each shard are referenced by
+  // that shard only and go away with its extents
+  const unsigned num_blobs = 64;
+  {
+    ObjectStore::Transaction t;
+    for (unsigned i = 0; i < num_blobs; ++i) {
+      bufferlist bl;
+      bl.append(std::string(block_size, 'a' + i % 26));
+      t.write(cid, hoid, i * 65536, bl.length(), bl,
+	      CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
+    }
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  // the onode is compacted once the transaction lets go of it
+  for (unsigned i = 0; i < 1000; ++i) {
+    if (logger->get(l_bluestore_onode_shard_compacted) > 0) {
+      break;
+    }
+    usleep(10000);
+  }
+  ASSERT_LT(0u, logger->get(l_bluestore_onode_shard_compacted));
+
+  auto unpacked = logger->get(l_bluestore_onode_shard_unpacked);
+  for (unsigned i = 0; i < num_blobs; ++i) {
+    bufferlist bl, expected;
+    r = store->read(ch, hoid, i * 65536, block_size, bl);
+    ASSERT_EQ(r, (int)block_size);
+    expected.append(std::string(block_size, 'a' + i % 26));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  ASSERT_LT(unpacked, logger->get(l_bluestore_onode_shard_unpacked));
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTestSpecificAUSize, SyntheticTinyLfuCache) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  // cache shards are created with the store, set type before mount
+  SetVal(g_conf(), "bluestore_cache_type", "tinylfu");
+  SetVal(g_conf(), "bluestore_cache_autotune", "false");
+  SetVal(g_conf(), "bluestore_cache_size", stringify(16 << 20).c_str());
+  SetVal(g_conf(), "bluestore_default_buffered_read", "true");
+  SetVal(g_conf(), "bluestore_default_buffered_write", "true");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(4096);
+  doSyntheticTest(1000, 10000, 400*1024, 40*1024, 0);
+
+  // far more data than cache, the window must have been drained
+  PerfCounters* logger = const_cast<PerfCounters*>(store->get_perf_counters());
+  ASSERT_LT(0u, logger->get(l_bluestore_buffer_cache_admitted) +
+		logger->get(l_bluestore_buffer_cache_rejected));
+}
+
 TEST_P(StoreTestSpecificAUSize, SyntheticMatrixCompressionAlgorithm) {
   if (string(GetParam()) != "bluestore")
     return;
@@ -10,6 +10,7 @@
 #include <random>
 #include <thread>
 #include <stack>
+#include <filesystem>
 #include <gtest/gtest.h>
 #include "global/global_init.h"
 #include "common/ceph_argparse.h"
@@ -818,6 +819,278 @@ TEST(BlueFS, test_replay_growth) {
   fs.umount();
 }
 
+TEST(BlueFS, test_replay_prefetch) {
+  uint64_t size = 1048576LL * (2 * 1024 + 128);
+  TempBdev bdev{size};
+
+  ConfSaver conf(g_ceph_context->_conf);
+  conf.SetVal("bluefs_alloc_size", "4096");
+  conf.SetVal("bluefs_shared_alloc_size", "4096");
+  conf.SetVal("bluefs_compact_log_sync", "false");
+  conf.SetVal("bluefs_min_log_runway", "32768");
+  conf.SetVal("bluefs_max_log_runway", "65536");
+  conf.SetVal("bluefs_allocator", "stupid");
+  conf.SetVal("bluefs_sync_write", "true");
+  // small chunks so that the log spans many read-ahead windows
+  conf.SetVal("bluefs_max_prefetch", "16384");
+  conf.SetVal("bluefs_log_replay_prefetch", "4");
+  conf.ApplyChanges();
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.maybe_verify_layout({ BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mkdir("dir"));
+
+  char data[2000] = {'x'};
+  BlueFS::FileWriter *h;
+  ASSERT_EQ(0, fs.open_for_write("dir", "file", &h, false));
+  for (size_t i = 0; i < 5000; i++) {
+    h->append(data, 2000);
+    fs.fsync(h);
+  }
+  fs.close_writer(h);
+  fs.umount(true); //do not compact on exit!
+
+  // replay with read-ahead must see every appended byte
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.maybe_verify_layout({ BlueFS::BDEV_DB, false, false }));
+  uint64_t file_size;
+  utime_t mtime;
+  ASSERT_EQ(0, fs.stat("dir", "file", &file_size, &mtime));
+  ASSERT_EQ(5000u * 2000u, file_size);
+  // ... and must actually have read ahead
+  const PerfCounters *logger = fs.get_perf_counters();
+  uint64_t txns = logger->get(l_bluefs_replay_txns);
+  uint64_t bytes = logger->get(l_bluefs_replay_bytes);
+  ASSERT_LT(0u, txns);
+  ASSERT_LT(0u, bytes);
+  ASSERT_LT(0u, logger->get(l_bluefs_replay_prefetch_chunks));
+  fs.umount(true);
+
+  // and agree with the synchronous replay
+  conf.SetVal("bluefs_log_replay_prefetch", "0");
+  conf.ApplyChanges();
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.stat("dir", "file", &file_size, &mtime));
+  ASSERT_EQ(5000u * 2000u, file_size);
+  logger = fs.get_perf_counters();
+  ASSERT_LE(txns, logger->get(l_bluefs_replay_txns));
+  ASSERT_LE(bytes, logger->get(l_bluefs_replay_bytes));
+  ASSERT_EQ(0u, logger->get(l_bluefs_replay_prefetch_chunks));
+  fs.umount();
+}
+
+TEST(BlueFS, test_wal_envelope) {
+  uint64_t size = 1048576LL * 256;
+  TempBdev bdev{size};
+
+  ConfSaver conf(g_ceph_context->_conf);
+  conf.SetVal("bluefs_alloc_size", "4096");
+  conf.SetVal("bluefs_shared_alloc_size", "4096");
+  conf.SetVal("bluefs_wal_envelope_mode", "true");
+  conf.SetVal("bluefs_wal_envelope_prealloc", "65536");
+  conf.ApplyChanges();
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+
+  bufferlist expected;
+  BlueFS::FileWriter *h;
+  ASSERT_EQ(0, fs.open_for_write("dir", "1.log", &h, false));
+  ASSERT_TRUE(h->file->fnode.is_wal_envelope());
+  for (unsigned i = 0; i < 500; i++) {
+    std::string s(100 + i, 'a' + i % 26);
+    h->append(s.c_str(), s.size());
+    expected.append(s);
+    fs.fsync(h);
+  }
+  ASSERT_EQ(expected.length(), h->get_logical_size());
+  // the log only saw the allocations; the envelopes carry the size
+  fs.close_writer(h);
+  fs.umount(true);
+
+  ASSERT_EQ(0, fs.mount());
+  uint64_t file_size;
+  utime_t mtime;
+  ASSERT_EQ(0, fs.stat("dir", "1.log", &file_size, &mtime));
+  ASSERT_EQ(expected.length(), file_size);
+  {
+    BlueFS::FileReader *r;
+    ASSERT_EQ(0, fs.open_for_read("dir", "1.log", &r));
+    bufferlist bl;
+    ASSERT_EQ((int64_t)expected.length(),
+	      fs.read(r, 0, expected.length() + 100, &bl, nullptr));
+    ASSERT_TRUE(bl.contents_equal(expected));
+    // reads that do not start at an envelope boundary
+    char buf[1000];
+    ASSERT_EQ(1000, fs.read_random(r, 12345, 1000, buf));
+    ASSERT_EQ(0, memcmp(buf, expected.c_str() + 12345, 1000));
+    ASSERT_EQ(1000, fs.read_random(r, 777, 1000, buf));
+    ASSERT_EQ(0, memcmp(buf, expected.c_str() + 777, 1000));
+    delete r;
+  }
+
+  // reusing the file starts over; envelopes of the old writer are ignored
+  ASSERT_EQ(0, fs.open_for_write("dir", "1.log", &h, true));
+  std::string s(3000, 'z');
+  h->append(s.c_str(), s.size());
+  fs.fsync(h);
+  fs.close_writer(h);
+  fs.umount(true);
+
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.stat("dir", "1.log", &file_size, &mtime));
+  ASSERT_EQ(s.size(), file_size);
+  fs.umount();
+}
+
+TEST(BlueFS, test_wal_envelope_overwrite_crash) {
+  uint64_t size = 1048576LL * 64;
+  TempBdev bdev{size};
+  TempBdev crashed{size};
+
+  ConfSaver conf(g_ceph_context->_conf);
+  conf.SetVal("bluefs_alloc_size", "4096");
+  conf.SetVal("bluefs_shared_alloc_size", "4096");
+  conf.SetVal("bluefs_wal_envelope_mode", "true");
+  conf.SetVal("bluefs_wal_envelope_prealloc", "65536");
+  conf.ApplyChanges();
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+
+  BlueFS::FileWriter *h;
+  ASSERT_EQ(0, fs.open_for_write("dir", "1.log", &h, false));
+  std::string s1(3000, 'a');
+  h->append(s1.c_str(), s1.size());
+  fs.fsync(h);
+  fs.close_writer(h);
+
+  // overwrite in place within the preallocated space: no allocation,
+  // but the new nonce must still reach the log with the first fsync
+  ASSERT_EQ(0, fs.open_for_write("dir", "1.log", &h, true));
+  std::string s2(1000, 'b');
+  h->append(s2.c_str(), s2.size());
+  fs.fsync(h);
+
+  // Imagine power goes down here: mount what is on disk right now.
+  std::filesystem::copy_file(
+    bdev.path, crashed.path, std::filesystem::copy_options::overwrite_existing);
+  fs.close_writer(h);
+  fs.umount();
+
+  BlueFS fs2(g_ceph_context);
+  ASSERT_EQ(0, fs2.add_block_device(BlueFS::BDEV_DB, crashed.path, false));
+  ASSERT_EQ(0, fs2.mount());
+  uint64_t file_size;
+  utime_t mtime;
+  ASSERT_EQ(0, fs2.stat("dir", "1.log", &file_size, &mtime));
+  ASSERT_EQ(s2.size(), file_size);
+  {
+    BlueFS::FileReader *r;
+    ASSERT_EQ(0, fs2.open_for_read("dir", "1.log", &r));
+    bufferlist bl;
+    ASSERT_EQ((int64_t)s2.size(), fs2.read(r, 0, s2.size() + 100, &bl, nullptr));
+    ASSERT_EQ(s2, bl.to_str());
+    delete r;
+  }
+  fs2.umount();
+}
+
+// the superblock decoder of releases that predate envelope-encoded files
+static void decode_legacy_super(const std::string& path)
+{
+  // the superblock lives in the second 4k block
+  char buf[4096];
+  int fd = ::open(path.c_str(), O_RDONLY);
+  ASSERT_LE(0, fd);
+  ASSERT_EQ((ssize_t)sizeof(buf), ::pread(fd, buf, sizeof(buf), 4096));
+  ::close(fd);
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  auto p = bl.cbegin();
+  bluefs_super_t super;
+  DECODE_START(2, p);
+  decode(super.uuid, p);
+  decode(super.osd_uuid, p);
+  decode(super.version, p);
+  decode(super.block_size, p);
+  decode(super.log_fnode, p);
+  if (struct_v >= 2) {
+    decode(super.memorized_layout, p);
+  }
+  DECODE_FINISH(p);
+}
+
+TEST(BlueFS, test_wal_envelope_super_feature) {
+  uint64_t size = 1048576LL * 64;
+  TempBdev bdev{size};
+
+  ConfSaver conf(g_ceph_context->_conf);
+  conf.SetVal("bluefs_alloc_size", "4096");
+  conf.SetVal("bluefs_shared_alloc_size", "4096");
+  conf.SetVal("bluefs_wal_envelope_mode", "false");
+  conf.ApplyChanges();
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+
+  // switching the option on at runtime does not create envelope files
+  // until the superblock has been marked by a mount
+  conf.SetVal("bluefs_wal_envelope_mode", "true");
+  conf.ApplyChanges();
+  BlueFS::FileWriter *h;
+  ASSERT_EQ(0, fs.open_for_write("dir", "1.log", &h, false));
+  ASSERT_FALSE(h->file->fnode.is_wal_envelope());
+  fs.close_writer(h);
+  fs.umount();
+  ASSERT_NO_THROW(decode_legacy_super(bdev.path));
+
+  // the first envelope file is only created after the mark is on disk,
+  // so an older release decoding a v2 fnode is ruled out at mount
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.open_for_write("dir", "2.log", &h, false));
+  ASSERT_TRUE(h->file->fnode.is_wal_envelope());
+  std::string s(3000, 'a');
+  h->append(s.c_str(), s.size());
+  fs.fsync(h);
+  fs.close_writer(h);
+  ASSERT_THROW(decode_legacy_super(bdev.path),
+	       ceph::buffer::malformed_input);
+  fs.umount();
+
+  // the mark stays while envelope files are left ...
+  conf.SetVal("bluefs_wal_envelope_mode", "false");
+  conf.ApplyChanges();
+  ASSERT_EQ(0, fs.mount());
+  fs.umount();
+  ASSERT_THROW(decode_legacy_super(bdev.path),
+	       ceph::buffer::malformed_input);
+
+  // ... and is dropped once they are gone
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.unlink("dir", "2.log"));
+  fs.umount();
+  ASSERT_EQ(0, fs.mount());
+  fs.umount();
+  ASSERT_NO_THROW(decode_legacy_super(bdev.path));
+}
+
 TEST(BlueFS, test_tracker_50965) {
   uint64_t size_wal = 1048576 * 64;
   TempBdev bdev_wal{size_wal};
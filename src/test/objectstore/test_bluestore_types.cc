@@ -8,6 +8,7 @@
 #include "common/ceph_time.h"
 #include "os/bluestore/BlueStore.h"
 #include "os/bluestore/simple_bitmap.h"
+#include "os/bluestore/frequency_sketch.h"
 #include "os/bluestore/AvlAllocator.h"
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
@@ -2837,6 +2838,52 @@ TEST(bluestore_blob_use_tracker_t, mempool_stats_test)
   }
 }
 
+TEST(frequency_sketch_t, estimate)
+{
+  frequency_sketch_t sketch;
+  sketch.resize(1024);
+  ASSERT_EQ(1024u, sketch.get_width());
+  for (unsigned i = 0; i < 10; ++i) {
+    sketch.increment(42);
+  }
+  sketch.increment(7);
+  // count-min never underestimates
+  ASSERT_GE(sketch.estimate(42), 10u);
+  ASSERT_GE(sketch.estimate(7), 1u);
+  ASSERT_LT(sketch.estimate(7), sketch.estimate(42));
+  // counters saturate
+  for (unsigned i = 0; i < 100; ++i) {
+    sketch.increment(42);
+  }
+  ASSERT_EQ(15u, sketch.estimate(42));
+}
+
+TEST(frequency_sketch_t, aging)
+{
+  frequency_sketch_t sketch;
+  sketch.resize(64);
+  for (unsigned i = 0; i < 15; ++i) {
+    sketch.increment(1);
+  }
+  ASSERT_EQ(15u, sketch.estimate(1));
+  // a long scan of one-shot keys halves the old popularity
+  for (uint64_t k = 1000; k < 1000 + 64 * 10; ++k) {
+    sketch.increment(k);
+  }
+  ASSERT_LT(sketch.estimate(1), 15u);
+  ASSERT_GT(sketch.estimate(1), 0u);
+}
+
+TEST(frequency_sketch_t, ensure_capacity)
+{
+  frequency_sketch_t sketch;
+  size_t w = sketch.get_width();
+  sketch.ensure_capacity(w / 2);
+  ASSERT_EQ(w, sketch.get_width());
+  sketch.ensure_capacity(w * 4);
+  ASSERT_GE(sketch.get_width(), w * 8);
+}
+
 int main(int argc, char **argv) {
   auto args = argv_to_vec(argc, argv);
   auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
@@ -20,6 +20,7 @@
 #include "kv/KeyValueDB.h"
 #include "kv/RocksDBStore.h"
 #include "include/Context.h"
+#include "include/stringify.h"
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
 #include "common/Cond.h"
@@ -359,6 +360,47 @@ TEST_P(KVTest, ShardingRMRange) {
 }
 
 
+TEST_P(KVTest, MultiGet) {
+  std::string cfs;
+  if (string(GetParam()) == "rocksdb") {
+    cfs = "O(7)=";  // keys of one batch spread over several shards
+  }
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (size_t i = 0; i < 100; i += 2) {
+      bufferlist value;
+      value.append("v" + stringify(i));
+      t->set("O", "key" + stringify(i), value);
+      t->set("P", "key" + stringify(i), value);
+    }
+    db->submit_transaction_sync(t);
+  }
+
+  for (auto prefix : {"O", "P"}) {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 100; i++) {
+      keys.push_back("key" + stringify(i));
+    }
+    std::vector<bufferlist> values;
+    std::vector<int> rvals;
+    ASSERT_EQ(0, db->multi_get(prefix, keys, &values, &rvals));
+    ASSERT_EQ(keys.size(), values.size());
+    ASSERT_EQ(keys.size(), rvals.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (i % 2) {
+	ASSERT_EQ(-ENOENT, rvals[i]);
+	ASSERT_EQ(0u, values[i].length());
+      } else {
+	ASSERT_EQ(0, rvals[i]);
+	ASSERT_EQ("v" + stringify(i), values[i].to_str());
+      }
+    }
+  }
+  fini();
+}
+
+
 TEST_P(KVTest, RocksDBColumnFamilyTest) {
   if(string(GetParam()) != "rocksdb")
     return;
@@ -211,3 +211,87 @@ TEST(Transaction, GetNumBytesBenchCurrent)
 {
    bench_num_bytes(false);
 }
+
+TEST(Transaction, EncodeDecode)
+{
+  auto a = ObjectStore::Transaction{};
+  // objects and collections are added out of their sorted order
+  coll_t c1(spg_t(pg_t(2, 1), shard_id_t::NO_SHARD));
+  coll_t c2(spg_t(pg_t(1, 1), shard_id_t::NO_SHARD));
+  ghobject_t o1(hobject_t("zzz", "", CEPH_NOSNAP, 1, 1, ""));
+  ghobject_t o2(hobject_t("aaa", "", CEPH_NOSNAP, 2, 1, ""));
+  bufferlist bl;
+  bl.append("some data");
+  a.write(c1, o1, 0, bl.length(), bl);
+  a.touch(c2, o2);
+  a.write(c2, o1, 100, bl.length(), bl);
+
+  bufferlist encoded;
+  encode(a, encoded);
+
+  auto b = ObjectStore::Transaction{};
+  auto p = encoded.cbegin();
+  decode(b, p);
+  ASSERT_EQ(3, b.get_num_ops());
+  ASSERT_EQ(2u, b.get_object_index().size());
+  ASSERT_EQ(0u, b.get_object_index().at(o1));
+  ASSERT_EQ(1u, b.get_object_index().at(o2));
+  auto i = b.begin();
+  ASSERT_EQ(c1, i.colls[0]);
+  ASSERT_EQ(c2, i.colls[1]);
+
+  // re-encoding gives the same bytes, and so does adding to it
+  bufferlist reencoded;
+  encode(b, reencoded);
+  ASSERT_TRUE(encoded.contents_equal(reencoded));
+  ghobject_t o3(hobject_t("mmm", "", CEPH_NOSNAP, 3, 1, ""));
+  a.touch(c1, o3);
+  b.touch(c1, o3);
+  encoded.clear();
+  reencoded.clear();
+  encode(a, encoded);
+  encode(b, reencoded);
+  ASSERT_TRUE(encoded.contents_equal(reencoded));
+}
+
+TEST(Transaction, IterateFragmentedOps)
+{
+  auto a = ObjectStore::Transaction{};
+  coll_t c(spg_t(pg_t(1, 2), shard_id_t::NO_SHARD));
+  ghobject_t o(hobject_t("obj", "", CEPH_NOSNAP, 1, 1, ""));
+  // more than fit in one buffer of op_bl
+  const int num_ops = 100;
+  for (int n = 0; n < num_ops; ++n) {
+    a.zero(c, o, n, 1);
+  }
+  bufferlist encoded;
+  encode(a, encoded);
+
+  // cut the encoding in pieces which split ops, the way it may arrive
+  // from the messenger
+  bufferlist fragmented;
+  for (unsigned off = 0; off < encoded.length(); off += 7) {
+    bufferlist piece;
+    piece.substr_of(encoded, off, std::min(7u, encoded.length() - off));
+    piece.rebuild();
+    fragmented.claim_append(piece);
+  }
+
+  auto check = [&](ObjectStore::Transaction &t) {
+    int n = 0;
+    for (auto i = t.begin(); i.have_op(); ++n) {
+      auto op = i.decode_op();
+      ASSERT_EQ((uint32_t)ObjectStore::Transaction::OP_ZERO, (uint32_t)op->op);
+      ASSERT_EQ((uint64_t)n, (uint64_t)op->off);
+      ASSERT_EQ(1u, (uint64_t)op->len);
+      ASSERT_EQ(c, i.get_cid(op->cid));
+      ASSERT_EQ(o, i.get_oid(op->oid));
+    }
+    ASSERT_EQ(num_ops, n);
+  };
+  check(a);
+  ObjectStore::Transaction b;
+  auto p = fragmented.cbegin();
+  decode(b, p);
+  check(b);
+}
@@ -32,7 +32,9 @@ static void usage()
       "	 --threads\n"
       "	       number of threads to carry out this workload\n"
       "	 --multi-object\n"
-    "	       have each thread write to a separate object\n" << std::endl;
+      "	       have each thread write to a separate object\n"
+      "	 --collections\n"
+      "	       number of collections to spread the threads over\n" << std::endl;
   generic_server_usage();
 }
 
@@ -76,10 +78,11 @@ struct Config {
   int repeats;
   int threads;
   bool multi_object;
+  int collections;
   Config()
     : size(1048576), block_size(4096),
       repeats(1), threads(1),
-      multi_object(false) {}
+      multi_object(false), collections(1) {}
 };
 
 class C_NotifyCond : public Context {
@@ -190,6 +193,12 @@ int main(int argc, const char *argv[])
       cfg.threads = atoi(val.c_str());
     } else if (ceph_argparse_flag(args, i, "--multi-object", (char*)nullptr)) {
       cfg.multi_object = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--collections", (char*)nullptr)) {
+      cfg.collections = atoi(val.c_str());
+      if (cfg.collections < 1) {
+        derr << "collections must be at least 1" << dendl;
+        exit(1);
+      }
     } else {
       derr << "Error: can't understand argument: " << *i << "\n" << dendl;
       exit(1);
@@ -206,6 +215,7 @@ int main(int argc, const char *argv[])
   dout(0) << "block-size " << cfg.block_size << dendl;
   dout(0) << "repeats " << cfg.repeats << dendl;
   dout(0) << "threads " << cfg.threads << dendl;
+  dout(0) << "collections " << cfg.collections << dendl;
 
   auto os =
       ObjectStore::create(g_ceph_context,
@@ -261,36 +271,37 @@ int main(int argc, const char *argv[])
 
   dout(10) << "created objectstore " << os.get() << dendl;
 
-  // create a collection
-  spg_t pg;
-  const coll_t cid(pg);
-  ObjectStore::CollectionHandle ch = os->create_new_collection(cid);
-  {
+  // create the collections; thread i writes to collection i % collections
+  std::vector<coll_t> cids;
+  std::vector<ObjectStore::CollectionHandle> chs;
+  cids.reserve(cfg.collections);
+  chs.reserve(cfg.collections);
+  for (int i = 0; i < cfg.collections; i++) {
+    cids.emplace_back(spg_t(pg_t(i, 0)));
+    chs.push_back(os->create_new_collection(cids[i]));
+
     ObjectStore::Transaction t;
-    t.create_collection(cid, 0);
-    os->queue_transaction(ch, std::move(t));
+    t.create_collection(cids[i], 0);
+    os->queue_transaction(chs[i], std::move(t));
   }
 
-  // create the objects
+  // create the objects, one per thread or one per collection
   std::vector<ghobject_t> oids;
-  if (cfg.multi_object) {
-    oids.reserve(cfg.threads);
-    for (int i = 0; i < cfg.threads; i++) {
+  const int nobjects = cfg.multi_object ? cfg.threads : cfg.collections;
+  oids.reserve(nobjects);
+  for (int i = 0; i < nobjects; i++) {
+    if (cfg.multi_object) {
       std::stringstream oss;
       oss << "osbench-thread-" << i;
       oids.emplace_back(hobject_t(sobject_t(oss.str(), CEPH_NOSNAP)));
-
-      ObjectStore::Transaction t;
-      t.touch(cid, oids[i]);
-      int r = os->queue_transaction(ch, std::move(t));
-      ceph_assert(r == 0);
+    } else {
+      oids.emplace_back(hobject_t(sobject_t("osbench", CEPH_NOSNAP)));
     }
-  } else {
-    oids.emplace_back(hobject_t(sobject_t("osbench", CEPH_NOSNAP)));
 
+    const int c = i % cfg.collections;
     ObjectStore::Transaction t;
-    t.touch(cid, oids.back());
-    int r = os->queue_transaction(ch, std::move(t));
+    t.touch(cids[c], oids[i]);
+    int r = os->queue_transaction(chs[c], std::move(t));
     ceph_assert(r == 0);
   }
 
@@ -301,9 +312,10 @@ int main(int argc, const char *argv[])
   using namespace std::chrono;
   auto t1 = high_resolution_clock::now();
   for (int i = 0; i < cfg.threads; i++) {
-    const auto &oid = cfg.multi_object ? oids[i] : oids[0];
+    const int c = i % cfg.collections;
+    const auto &oid = cfg.multi_object ? oids[i] : oids[c];
     workers.emplace_back(osbench_worker, os.get(), std::ref(cfg),
-                         cid, oid, i * cfg.size / cfg.threads);
+                         cids[c], oid, i * cfg.size / cfg.threads);
   }
   for (auto &worker : workers)
     worker.join();
@@ -319,10 +331,12 @@ int main(int argc, const char *argv[])
       << iops << " iops" << dendl;
 
   // remove the objects
-  ObjectStore::Transaction t;
-  for (const auto &oid : oids)
-    t.remove(cid, oid);
-  os->queue_transaction(ch, std::move(t));
+  for (int c = 0; c < cfg.collections; c++) {
+    ObjectStore::Transaction t;
+    for (int i = c; i < nobjects; i += cfg.collections)
+      t.remove(cids[c], oids[i]);
+    os->queue_transaction(chs[c], std::move(t));
+  }
 
   os->umount();
   return 0;
@@ -60,3 +60,44 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECUtil, for_each_chunk_piece)
+{
+  const uint64_t swidth = 4096;
+  const uint64_t ssize = 4;
+  ECUtil::stripe_info_t s(ssize, swidth);
+  const uint64_t csize = s.get_chunk_size();
+
+  vector<boost::tuple<int, uint64_t, uint64_t>> pieces;
+  auto collect = [&pieces](int chunk, uint64_t chunk_off, uint64_t len) {
+    pieces.push_back(boost::make_tuple(chunk, chunk_off, len));
+  };
+
+  // inside a single chunk of the second stripe
+  s.for_each_chunk_piece(swidth + csize + 10, 100, collect);
+  ASSERT_EQ(1u, pieces.size());
+  ASSERT_EQ(1, pieces[0].get<0>());
+  ASSERT_EQ(csize + 10, pieces[0].get<1>());
+  ASSERT_EQ(100u, pieces[0].get<2>());
+
+  // across the last chunk of one stripe and the first of the next
+  pieces.clear();
+  s.for_each_chunk_piece(swidth - 10, 20, collect);
+  ASSERT_EQ(2u, pieces.size());
+  ASSERT_EQ(3, pieces[0].get<0>());
+  ASSERT_EQ(csize - 10, pieces[0].get<1>());
+  ASSERT_EQ(10u, pieces[0].get<2>());
+  ASSERT_EQ(0, pieces[1].get<0>());
+  ASSERT_EQ(csize, pieces[1].get<1>());
+  ASSERT_EQ(10u, pieces[1].get<2>());
+
+  // a whole stripe touches every chunk once
+  pieces.clear();
+  s.for_each_chunk_piece(swidth, swidth, collect);
+  ASSERT_EQ(ssize, pieces.size());
+  for (unsigned i = 0; i < ssize; ++i) {
+    ASSERT_EQ((int)i, pieces[i].get<0>());
+    ASSERT_EQ(csize, pieces[i].get<1>());
+    ASSERT_EQ(csize, pieces[i].get<2>());
+  }
+}
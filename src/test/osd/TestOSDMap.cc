@@ -519,6 +519,153 @@ TEST_F(OSDMapTest, MapPG) {
   ASSERT_EQ(osdmap.get_pg_pool(my_rep_pool)->get_size(), up_osds.size());
 }
 
+TEST_F(OSDMapTest, IncrementalScope) {
+  set_up_map();
+  pg_t rep_pg = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  pg_t ec_pg = osdmap.raw_pg_to_pg(pg_t(0, my_ec_pool));
+
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    auto scope = inc.get_scope();
+    ASSERT_FALSE(scope.all);
+    ASSERT_TRUE(scope.pools.empty());
+    ASSERT_TRUE(scope.up_thru.empty());
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[ec_pg] = mempool::osdmap::vector<int32_t>({0, 1, 2});
+    inc.new_up_thru[3] = osdmap.get_epoch();
+    auto scope = inc.get_scope();
+    ASSERT_FALSE(scope.all);
+    ASSERT_EQ(set<int64_t>{my_ec_pool}, scope.pools);
+    ASSERT_EQ(set<int32_t>{3}, scope.up_thru);
+
+    // the pgs of the other pool map as before
+    vector<int> up, acting, new_up, new_acting;
+    osdmap.pg_to_up_acting_osds(rep_pg, up, acting);
+    OSDMap next;
+    next.deepish_copy_from(osdmap);
+    ASSERT_EQ(0, next.apply_incremental(inc));
+    next.pg_to_up_acting_osds(rep_pg, new_up, new_acting);
+    ASSERT_EQ(up, new_up);
+    ASSERT_EQ(acting, new_acting);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[0] = CEPH_OSD_OUT;
+    ASSERT_TRUE(inc.get_scope().all);
+  }
+}
+
+TEST_F(OSDMapTest, IncrementalMappingUpdate) {
+  set_up_map();
+  ThreadPool tp(g_ceph_context, "IncrementalMappingUpdate::tp", "mapping_tp", 4);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  mapping.update(osdmap);
+
+  auto check = [&]() {
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+	pg_t pgid(ps, poolid);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+  };
+  auto apply = [&](OSDMap::Incremental& inc) {
+    ASSERT_EQ(0, osdmap.apply_incremental(inc));
+    auto job = mapping.start_update(osdmap, mapper, 16, inc);
+    job->wait();
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    check();
+  };
+
+  pg_t rep_pg = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  pg_t ec_pg = osdmap.raw_pg_to_pg(pg_t(0, my_ec_pool));
+  {
+    // osd down, then up again
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    apply(inc);
+    ASSERT_FALSE(osdmap.is_up(0));
+    ASSERT_TRUE(mapping.get_osd_acting_pgs(0).empty());
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    apply(inc);
+    ASSERT_TRUE(osdmap.is_up(0));
+  }
+  {
+    // reweight and out
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[1] = CEPH_OSD_IN / 2;
+    inc.new_weight[2] = CEPH_OSD_OUT;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[3] = 0;
+    apply(inc);
+  }
+  {
+    // explicit remaps, then a down osd they name
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    vector<int> up, acting;
+    osdmap.pg_to_up_acting_osds(rep_pg, up, acting);
+    inc.new_pg_temp[rep_pg] =
+      mempool::osdmap::vector<int32_t>(up.rbegin(), up.rend());
+    inc.new_primary_temp[ec_pg] = 5;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[5] = CEPH_OSD_UP;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[5] = CEPH_OSD_UP;
+    inc.new_pg_temp[rep_pg].clear();
+    inc.new_primary_temp[ec_pg] = -1;
+    apply(inc);
+  }
+  {
+    // a pool change
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    pg_pool_t pool = *osdmap.get_pg_pool(my_rep_pool);
+    pool.set_pg_num(pool.get_pg_num() * 2);
+    pool.set_pgp_num(pool.get_pgp_num() * 2);
+    inc.new_pools[my_rep_pool] = pool;
+    apply(inc);
+  }
+  {
+    // nothing that moves pgs
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_up_thru[0] = osdmap.get_epoch();
+    apply(inc);
+  }
+
+  // a mapping that is behind falls back to a full update
+  {
+    OSDMap::Incremental inc1(osdmap.get_epoch() + 1);
+    inc1.new_weight[2] = CEPH_OSD_IN;
+    ASSERT_EQ(0, osdmap.apply_incremental(inc1));
+    OSDMap::Incremental inc2(osdmap.get_epoch() + 1);
+    inc2.new_state[4] = CEPH_OSD_UP;
+    apply(inc2);
+  }
+  tp.stop();
+}
+
 TEST_F(OSDMapTest, MapFunctionsMatch) {
   // TODO: make sure pg_to_up_acting_osds and pg_to_acting_osds match
   set_up_map();
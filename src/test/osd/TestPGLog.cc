@@ -2269,6 +2269,69 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   EXPECT_EQ(del.reqid, entry->reqid);
 }
 
+TEST_F(PGLogTest, LostRevertOnUnindexedLog) {
+  // what recover_primary(), get_object_context() and friends look up
+  // for an object reverted by mark_unfound_lost
+  pg_log_t plog;
+  plog.log.push_back(
+    mk_ple_mod(mk_obj(1), mk_evt(10, 1), mk_evt(10, 0),
+	       osd_reqid_t(entity_name_t::CLIENT(777), 8, 1)));
+  plog.log.push_back(
+    mk_ple_mod(mk_obj(2), mk_evt(10, 2), mk_evt(10, 0),
+	       osd_reqid_t(entity_name_t::CLIENT(777), 8, 2)));
+  pg_log_entry_t revert(pg_log_entry_t::LOST_REVERT, mk_obj(1),
+			mk_evt(10, 3), mk_evt(10, 1), 0, osd_reqid_t(),
+			utime_t(), 0);
+  revert.reverting_to = mk_evt(8, 5);
+  plog.log.push_back(revert);
+  plog.head = mk_evt(10, 3);
+
+  IndexedLog ilog(plog);
+  EXPECT_EQ(0u, ilog.get_indexed_data());
+  const pg_log_entry_t *latest = ilog.get_latest_entry(mk_obj(1));
+  ASSERT_NE(nullptr, latest);
+  EXPECT_EQ(pg_log_entry_t::LOST_REVERT, latest->op);
+  EXPECT_EQ(mk_evt(10, 3), latest->version);
+  EXPECT_EQ(mk_evt(8, 5), latest->reverting_to);
+  EXPECT_EQ(PGLOG_INDEXED_OBJECTS, ilog.get_indexed_data());
+
+  latest = ilog.get_latest_entry(mk_obj(2));
+  ASSERT_NE(nullptr, latest);
+  EXPECT_EQ(pg_log_entry_t::MODIFY, latest->op);
+  EXPECT_EQ(nullptr, ilog.get_latest_entry(mk_obj(3)));
+}
+
+TEST_F(PGLogTest, IndexBuiltOnDemand) {
+  pg_log_t plog;
+  for (unsigned i = 1; i <= 10; ++i) {
+    plog.log.push_back(
+      mk_ple_mod(mk_obj(i), mk_evt(10, i), mk_evt(10, i - 1),
+		 osd_reqid_t(entity_name_t::CLIENT(777), 8, i)));
+  }
+  plog.head = mk_evt(10, 10);
+
+  IndexedLog ilog(plog);
+  EXPECT_EQ(0u, ilog.get_indexed_data());
+  EXPECT_TRUE(ilog.objects.empty());
+  EXPECT_TRUE(ilog.caller_ops.empty());
+
+  const size_t before = mempool::osd_pglog::allocated_bytes();
+  EXPECT_TRUE(ilog.logged_object(mk_obj(3)));
+  EXPECT_EQ(PGLOG_INDEXED_OBJECTS, ilog.get_indexed_data());
+  EXPECT_EQ(10u, ilog.objects.size());
+  EXPECT_TRUE(ilog.caller_ops.empty());
+  EXPECT_LT(before, mempool::osd_pglog::allocated_bytes());
+
+  // new entries only go to the indexes built so far
+  ilog.add(mk_ple_mod(mk_obj(11), mk_evt(10, 11), mk_evt(10, 10),
+		      osd_reqid_t(entity_name_t::CLIENT(777), 8, 11)));
+  EXPECT_EQ(11u, ilog.objects.size());
+  EXPECT_TRUE(ilog.caller_ops.empty());
+
+  EXPECT_TRUE(ilog.logged_req(osd_reqid_t(entity_name_t::CLIENT(777), 8, 5)));
+  EXPECT_EQ(11u, ilog.caller_ops.size());
+}
+
 TEST_F(PGLogTest, split_into_preserves_may_include_deletes) {
   clear();
 
@@ -129,3 +129,90 @@ TEST(pgtransaction, clone_safe_create_traverse3)
       ++num;
     });
 }
+
+TEST(pgtransaction, is_simple_update)
+{
+  hobject_t h, h2;
+  h2.snap = 1;
+  bufferlist bl;
+  bl.append("abc");
+
+  PGTransaction t;
+  t.write(h, 0, bl.length(), bl);
+  t.setattr(h, "_", bl);
+  t.omap_setkeys(h, bl);
+  ASSERT_TRUE(t.is_simple_update(h));
+  ASSERT_FALSE(t.is_simple_update(h2));
+
+  PGTransaction create;
+  create.create(h);
+  ASSERT_FALSE(create.is_simple_update(h));
+
+  PGTransaction truncate;
+  truncate.truncate(h, 0);
+  ASSERT_FALSE(truncate.is_simple_update(h));
+
+  PGTransaction clone_range;
+  clone_range.clone_range(h2, h, 0, 4, 0);
+  ASSERT_FALSE(clone_range.is_simple_update(h));
+
+  PGTransaction two_objects;
+  two_objects.nop(h);
+  two_objects.nop(h2);
+  ASSERT_FALSE(two_objects.is_simple_update(h));
+}
+
+TEST(pgtransaction, append)
+{
+  hobject_t h;
+  using Write = PGTransaction::ObjectOperation::BufferUpdate::Write;
+
+  PGTransaction t;
+  {
+    bufferlist a, attr, keys;
+    a.append(std::string(8, 'a'));
+    attr.append("1");
+    keys.append("k1");
+    t.write(h, 0, a.length(), a);
+    t.setattr(h, "_", attr);
+    t.setattr(h, "x", attr);
+    t.omap_setkeys(h, keys);
+  }
+  PGTransaction t2;
+  {
+    bufferlist b, attr, keys;
+    b.append(std::string(8, 'b'));
+    attr.append("2");
+    keys.append("k2");
+    t2.write(h, 4, b.length(), b);
+    t2.setattr(h, "_", attr);
+    t2.omap_rmkeys(h, keys);
+  }
+  ASSERT_TRUE(t2.is_simple_update(h));
+  t.append(std::move(t2));
+  ASSERT_TRUE(t2.empty());
+
+  ASSERT_EQ(1u, t.op_map.size());
+  auto &op = t.op_map[h];
+  // the later write wins where the two overlap
+  bufferlist data;
+  uint64_t end = 0;
+  for (auto &&extent : op.buffer_updates) {
+    ASSERT_EQ(end, extent.get_off());
+    auto w = boost::get<Write>(&extent.get_val());
+    ASSERT_TRUE(w);
+    data.append(w->buffer);
+    end = extent.get_off() + extent.get_len();
+  }
+  ASSERT_EQ(std::string("aaaabbbbbbbb"), data.to_str());
+
+  ASSERT_EQ(2u, op.attr_updates.size());
+  ASSERT_EQ(std::string("2"), op.attr_updates["_"]->to_str());
+  ASSERT_EQ(std::string("1"), op.attr_updates["x"]->to_str());
+
+  using U = PGTransaction::ObjectOperation::OmapUpdateType;
+  ASSERT_EQ(2u, op.omap_updates.size());
+  ASSERT_EQ(U::Insert, op.omap_updates[0].first);
+  ASSERT_EQ(U::Remove, op.omap_updates[1].first);
+  ASSERT_EQ(std::string("k2"), op.omap_updates[1].second.to_str());
+}
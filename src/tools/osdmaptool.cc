@@ -18,13 +18,16 @@
 #include "common/ceph_argparse.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
+#include "include/stringify.h"
 #include "include/random.h"
 #include "mon/health_check.h"
 #include <time.h>
 #include <algorithm>
+#include <thread>
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 using namespace std;
 
@@ -65,6 +68,9 @@ void usage()
   cout << "   --dump <format>         displays the map in plain text when <format> is 'plain', 'json' if specified format is not supported" << std::endl;
   cout << "   --tree                  displays a tree of the map" << std::endl;
   cout << "   --test-crush [--range-first <first> --range-last <last>] map pgs to acting osds" << std::endl;
+  cout << "   --test-map-pgs-incremental --range-first <first> --range-last <last>" << std::endl;
+  cout << "                           apply the incrementals <mapdir>/inc_<epoch> to the full map" << std::endl;
+  cout << "                           <mapdir>/<first>, timing full vs incremental pg mapping updates" << std::endl;
   cout << "   --adjust-crush-weight <osdid:weight>[,<osdid:weight>,<...>] change <osdid> CRUSH <weight> (but do not persist)" << std::endl;
   cout << "   --save                  write modified osdmap with upmap or crush-adjust changes" << std::endl;
   cout << "   --read <file>           calculate pg upmap entries to balance pg primaries" << std::endl;
@@ -119,6 +125,90 @@ void print_inc_upmaps(const OSDMap::Incremental& pending_inc, int fd, bool vstar
   }
 }
 
+// replay the incrementals <dir>/inc_<first + 1> .. <dir>/inc_<last> on
+// top of the full map <dir>/<first>, updating one pg mapping from scratch
+// and another from each incremental, and check they agree
+int test_map_pgs_incremental(const string& dir, int first, int last)
+{
+  auto read = [](const string& fn, bufferlist *bl) {
+    string error;
+    int r = bl->read_file(fn.c_str(), &error);
+    if (r < 0) {
+      cerr << "unable to read " << fn << ": " << cpp_strerror(r) << std::endl;
+    }
+    return r;
+  };
+
+  OSDMap osdmap;
+  bufferlist bl;
+  if (read(dir + "/" + stringify(first), &bl) < 0) {
+    return 1;
+  }
+  osdmap.decode(bl);
+
+  unsigned pgs_per_chunk = g_ceph_context->_conf->mon_osd_mapping_pgs_per_chunk;
+  ThreadPool tp(g_ceph_context, "osdmaptool::mapping", "tp_mapping",
+		std::max(1u, std::thread::hardware_concurrency()));
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  OSDMapMapping full, incremental;
+  full.start_update(osdmap, mapper, pgs_per_chunk)->wait();
+  incremental.start_update(osdmap, mapper, pgs_per_chunk)->wait();
+
+  utime_t full_total, incremental_total;
+  uint64_t mismatched = 0;
+  for (int e = first + 1; e <= last; ++e) {
+    bl.clear();
+    if (read(dir + "/inc_" + stringify(e), &bl) < 0) {
+      tp.stop();
+      return 1;
+    }
+    OSDMap::Incremental inc(bl);
+    if (inc.epoch != osdmap.get_epoch() + 1) {
+      cerr << "incremental for e" << inc.epoch << " does not follow e"
+	   << osdmap.get_epoch() << std::endl;
+      tp.stop();
+      return 1;
+    }
+    osdmap.apply_incremental(inc);
+
+    auto full_job = full.start_update(osdmap, mapper, pgs_per_chunk);
+    full_job->wait();
+    auto incremental_job = incremental.start_update(
+      osdmap, mapper, pgs_per_chunk, inc);
+    incremental_job->wait();
+    full_total += full_job->get_duration();
+    incremental_total += incremental_job->get_duration();
+    cout << "e" << e << " full " << full_job->get_duration()
+	 << " incremental " << incremental_job->get_duration() << std::endl;
+
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+	pg_t pgid(ps, poolid);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	full.get(pgid, &up, &up_primary, &acting, &acting_primary);
+	incremental.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	if (up != up2 || up_primary != up_primary2 ||
+	    acting != acting2 || acting_primary != acting_primary2) {
+	  cerr << "e" << e << " " << pgid << " full " << up << "/" << acting
+	       << " incremental " << up2 << "/" << acting2 << std::endl;
+	  ++mismatched;
+	}
+      }
+    }
+  }
+  tp.stop();
+
+  cout << "full " << full_total << " incremental " << incremental_total
+       << " over " << (last - first) << " epochs" << std::endl;
+  if (mismatched) {
+    cerr << mismatched << " mismatched pg mappings" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, const char **argv)
 {
   auto args = argv_to_vec(argc, argv);
@@ -164,6 +254,7 @@ int main(int argc, const char **argv)
   bool clean_temps = false;
   bool test_map_pgs = false;
   bool test_map_pgs_dump = false;
+  bool test_map_pgs_incremental = false;
   bool test_random = false;
   bool upmap_cleanup = false;
   bool upmap = false;
@@ -250,6 +341,8 @@ int main(int argc, const char **argv)
       test_map_pgs_dump = true;
     } else if (ceph_argparse_flag(args, i, "--test-map-pgs-dump-all", (char*)NULL)) {
       test_map_pgs_dump_all = true;
+    } else if (ceph_argparse_flag(args, i, "--test-map-pgs-incremental", (char*)NULL)) {
+      test_map_pgs_incremental = true;
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
@@ -318,6 +411,15 @@ int main(int argc, const char **argv)
   }
   fn = args[0];
 
+  if (test_map_pgs_incremental) {
+    if (range_first < 0 || range_last < range_first) {
+      cerr << me << ": --test-map-pgs-incremental requires --range-first"
+	   << " and --range-last" << std::endl;
+      usage();
+    }
+    exit(test_map_pgs_incremental(fn, range_first, range_last));
+  }
+
   if (range_first >= 0 && range_last >= 0) {
     set<OSDMap*> maps;
     OSDMap *prev = NULL;